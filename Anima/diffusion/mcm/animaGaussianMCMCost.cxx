@@ -21,14 +21,11 @@ GaussianMCMCost::GetValues(const ParametersType &parameters)
     m_MCMStructure->SetParametersFromVector(m_TestedParameters);
     
     m_Residuals.SetSize(nbImages);
-    m_PredictedSignals.resize(nbImages);
+    m_MCMStructure->GetPredictedSignals(this->GetGradientScheme(),m_PredictedSignals);
     m_SigmaSquare = 0.0;
 
     for (unsigned int i = 0;i < nbImages;++i)
     {
-        m_PredictedSignals[i] = m_MCMStructure->GetPredictedSignal(m_SmallDelta,m_BigDelta,
-                                                                    m_GradientStrengths[i],m_Gradients[i]);
-
         m_Residuals[i] = m_ObservedSignals[i] - m_PredictedSignals[i];
         m_SigmaSquare += m_Residuals[i] * m_Residuals[i];
     }
@@ -97,15 +97,17 @@ GaussianMCMVariableProjectionCost::PrepareDataForLLS()
     m_IndexesUsefulCompartments.resize(numCompartments);
 
     // Compute predicted signals and jacobian
+    // Whole scheme evaluated at once for each compartment
+    const GradientSchemeSoA &gradientScheme = this->GetGradientScheme();
+    m_BatchSignals.resize(nbValues);
     m_PredictedSignalAttenuations.set_size(nbValues,numCompartments);
-    for (unsigned int i = 0;i < nbValues;++i)
+    for (unsigned int j = 0;j < numCompartments;++j)
     {
-        for (unsigned int j = 0;j < numCompartments;++j)
-        {
-            unsigned int indexComp = m_IndexesUsefulCompartments[j];
-            double predictedSignal = m_MCMStructure->GetCompartment(indexComp)->GetFourierTransformedDiffusionProfile(m_SmallDelta, m_BigDelta, m_GradientStrengths[i], m_Gradients[i]);
-            m_PredictedSignalAttenuations(i,j) = predictedSignal;
-        }
+        unsigned int indexComp = m_IndexesUsefulCompartments[j];
+        m_MCMStructure->GetCompartment(indexComp)->EvaluateSignals(gradientScheme, m_BatchSignals.data());
+
+        for (unsigned int i = 0;i < nbValues;++i)
+            m_PredictedSignalAttenuations(i,j) = m_BatchSignals[i];
     }
 
     m_CholeskyMatrix.set_size(numCompartments,numCompartments);
@@ -193,7 +195,6 @@ GaussianMCMVariableProjectionCost::PrepareDataForDerivative()
     vnl_matrix<double> zeroMatrix(nbValues,numCompartments,0.0);
     m_SignalAttenuationsJacobian.resize(nbParams);
     std::fill(m_SignalAttenuationsJacobian.begin(),m_SignalAttenuationsJacobian.end(),zeroMatrix);
-    ListType compartmentJacobian;
 
     m_GramMatrix.set_size(numOnCompartments,numOnCompartments);
     m_InverseGramMatrix.set_size(numOnCompartments,numOnCompartments);
@@ -248,23 +249,27 @@ GaussianMCMVariableProjectionCost::PrepareDataForDerivative()
         }
     }
 
-    for (unsigned int i = 0;i < nbValues;++i)
+    // Whole scheme jacobians evaluated at once for each compartment, parameter-major
+    const GradientSchemeSoA &gradientScheme = this->GetGradientScheme();
+    m_BatchSignals.resize(nbValues);
+    unsigned int pos = 0;
+    for (unsigned int j = 0;j < numCompartments;++j)
     {
-        unsigned int pos = 0;
-
-        for (unsigned int j = 0;j < numCompartments;++j)
-        {
-            unsigned int indexComp = m_IndexesUsefulCompartments[j];
+        unsigned int indexComp = m_IndexesUsefulCompartments[j];
+        BaseCompartment *compartment = m_MCMStructure->GetCompartment(indexComp);
 
-            compartmentJacobian = m_MCMStructure->GetCompartment(indexComp)->GetSignalAttenuationJacobian(m_SmallDelta, m_BigDelta,
-                                                                                                          m_GradientStrengths[i], m_Gradients[i]);
+        unsigned int compartmentSize = compartment->GetNumberOfParameters();
+        m_BatchJacobians.resize(compartmentSize * nbValues);
+        compartment->EvaluateSignals(gradientScheme, m_BatchSignals.data(), m_BatchJacobians.data());
 
-            unsigned int compartmentSize = compartmentJacobian.size();
-            for (unsigned int k = 0;k < compartmentSize;++k)
-                m_SignalAttenuationsJacobian[pos+k](i,j) = compartmentJacobian[k];
-
-            pos += compartmentSize;
+        for (unsigned int k = 0;k < compartmentSize;++k)
+        {
+            const double *parameterJacobian = m_BatchJacobians.data() + k * nbValues;
+            for (unsigned int i = 0;i < nbValues;++i)
+                m_SignalAttenuationsJacobian[pos+k](i,j) = parameterJacobian[i];
         }
+
+        pos += compartmentSize;
     }
 }
 
@@ -76,6 +76,9 @@ private:
     vnl_matrix <double> m_PredictedSignalAttenuations, m_CholeskyMatrix;
     std::vector< vnl_matrix<double> > m_SignalAttenuationsJacobian;
 
+    // Work buffers for batched compartment evaluations
+    std::vector <double> m_BatchSignals, m_BatchJacobians;
+
     CholeskyDecomposition m_CholeskySolver;
 };
 
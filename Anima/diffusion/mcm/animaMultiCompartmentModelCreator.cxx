@@ -22,6 +22,7 @@ MultiCompartmentModelCreator::MultiCompartmentModelCreator()
 
     m_NumberOfCompartments = 1;
     m_VariableProjectionEstimationMode = true;
+    m_UseNODDILookupTables = false;
 
     m_UseConstrainedDiffusivity = false;
     m_UseConstrainedFreeWaterDiffusivity = true;
@@ -201,6 +202,7 @@ void MultiCompartmentModelCreator::CreateNODDICompartment(BaseCompartmentPointer
     
     NODDIType::Pointer noddiComp = NODDIType::New();
     noddiComp->SetEstimateAxialDiffusivity(!m_UseConstrainedDiffusivity);
+    noddiComp->SetUseLookupTables(m_UseNODDILookupTables);
     
     noddiComp->SetOrientationConcentration(m_OrientationConcentration);
     noddiComp->SetExtraAxonalFraction(m_ExtraAxonalFraction);
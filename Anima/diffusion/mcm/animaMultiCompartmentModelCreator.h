@@ -32,6 +32,10 @@ public:
     void SetNumberOfCompartments(unsigned int num) {m_NumberOfCompartments = num;}
     void SetVariableProjectionEstimationMode(bool arg) {m_VariableProjectionEstimationMode = arg;}
 
+    //! Use tabulated Kummer and Watson terms in NODDI compartments
+    void SetUseNODDILookupTables(bool arg) {m_UseNODDILookupTables = arg;}
+    bool GetUseNODDILookupTables() {return m_UseNODDILookupTables;}
+
     void SetUseConstrainedDiffusivity(bool arg) {m_UseConstrainedDiffusivity = arg;}
     void SetUseConstrainedOrientationConcentration(bool arg) {m_UseConstrainedOrientationConcentration = arg;}
     void SetUseConstrainedExtraAxonalFraction(bool arg) {m_UseConstrainedExtraAxonalFraction = arg;}
@@ -80,6 +84,7 @@ private:
     unsigned int m_NumberOfCompartments;
 
     bool m_VariableProjectionEstimationMode;
+    bool m_UseNODDILookupTables;
     bool m_UseConstrainedDiffusivity;
     bool m_UseConstrainedOrientationConcentration;
     bool m_UseConstrainedExtraAxonalFraction;
@@ -3,6 +3,7 @@
 #include <animaErrorFunctions.h>
 #include <animaKummerFunctions.h>
 #include <animaWatsonDistribution.h>
+#include <animaNODDISignalLookupTables.h>
 #include <animaMCMConstants.h>
 #include <boost/math/special_functions/legendre.hpp>
 
@@ -45,13 +46,32 @@ void NODDICompartment::UpdateSignals(double bValue, const Vector3DType &gradient
     m_IntraKappaDerivative = 0;
     m_IntraAxialDerivative = 0;
     double x = bValue * dpara;
+
+    // Kummer terms only depend on x, computed at once for all coefficients
+    unsigned int numCoefficients = m_WatsonSHCoefficients.size();
+    m_KummerValues.resize(numCoefficients);
+    m_KummerDerivativeValues.resize(numCoefficients);
+    if (m_UseLookupTables)
+    {
+        double *kummerDerivatives = m_EstimateAxialDiffusivity ? m_KummerDerivativeValues.data() : 0;
+        anima::NODDISignalLookupTables::GetInstance().GetKummerValues(x, m_KummerValues.data(), kummerDerivatives);
+    }
+    else
+    {
+        for (unsigned int i = 0;i < numCoefficients;++i)
+        {
+            m_KummerValues[i] = anima::KummerFunction(-x, i + 0.5, 2.0 * i + 1.5, false, true);
+            if (m_EstimateAxialDiffusivity)
+                m_KummerDerivativeValues[i] = anima::KummerFunction(-x, i + 1.5, 2.0 * i + 2.5, false, true);
+        }
+    }
     
-    for (unsigned int i = 0;i < m_WatsonSHCoefficients.size();++i)
+    for (unsigned int i = 0;i < numCoefficients;++i)
     {
         double coefVal = m_WatsonSHCoefficients[i];
         double sqrtVal = std::sqrt((4.0 * i + 1.0) / (4.0 * M_PI));
         double legendreVal = boost::math::legendre_p(2 * i, innerProd);
-        double kummerVal = anima::KummerFunction(-x, i + 0.5, 2.0 * i + 1.5, false, true);
+        double kummerVal = m_KummerValues[i];
         double xPowVal = std::pow(-x, (double)i);
         double cVal = xPowVal * kummerVal;
         
@@ -65,7 +85,7 @@ void NODDICompartment::UpdateSignals(double bValue, const Vector3DType &gradient
         double cDerivVal = 0.0;
         if (m_EstimateAxialDiffusivity)
         {
-            cDerivVal = -xPowVal * anima::KummerFunction(-x, i + 1.5, 2.0 * i + 2.5, false, true);
+            cDerivVal = -xPowVal * m_KummerDerivativeValues[i];
             if (i > 0)
                 cDerivVal += xPowVal * i * kummerVal / x;
         }
@@ -370,6 +390,16 @@ void NODDICompartment::SetEstimateExtraAxonalFraction(bool arg)
     m_ChangedConstraints = true;
 }
 
+void NODDICompartment::SetUseLookupTables(bool arg)
+{
+    if (m_UseLookupTables == arg)
+        return;
+
+    m_UseLookupTables = arg;
+    m_ModifiedParameters = true;
+    m_ModifiedConcentration = true;
+}
+
 void NODDICompartment::SetCompartmentVector(ModelOutputVectorType &compartmentVector)
 {
     if (compartmentVector.GetSize() != this->GetCompartmentSize())
@@ -494,7 +524,10 @@ void NODDICompartment::UpdateKappaValues()
     double dawsonValue = anima::EvaluateDawsonIntegral(std::sqrt(kappa), true);
     m_Tau1 = (1.0 / dawsonValue - 1.0) / (2.0 * kappa);
     m_Tau1Deriv = (1.0 - (1.0 - dawsonValue * (2.0 * kappa - 1.0)) / (2.0 * dawsonValue * dawsonValue)) / (2.0 * kappa * kappa);
-    anima::GetStandardWatsonSHCoefficients(kappa,m_WatsonSHCoefficients,m_WatsonSHCoefficientDerivatives);
+    if (m_UseLookupTables)
+        anima::NODDISignalLookupTables::GetInstance().GetWatsonSHCoefficients(kappa,m_WatsonSHCoefficients,m_WatsonSHCoefficientDerivatives);
+    else
+        anima::GetStandardWatsonSHCoefficients(kappa,m_WatsonSHCoefficients,m_WatsonSHCoefficientDerivatives);
     
     m_ModifiedConcentration = false;
 }
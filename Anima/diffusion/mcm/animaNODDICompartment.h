@@ -42,6 +42,10 @@ public:
     void SetEstimateAxialDiffusivity(bool arg);
     void SetEstimateExtraAxonalFraction(bool arg);
 
+    //! Use tabulated Kummer and Watson terms (see anima::NODDISignalLookupTables) instead of computing them directly
+    void SetUseLookupTables(bool arg);
+    bool GetUseLookupTables() {return m_UseLookupTables;}
+
     void SetCompartmentVector(ModelOutputVectorType &compartmentVector) ITK_OVERRIDE;
 
     unsigned int GetCompartmentSize() ITK_OVERRIDE;
@@ -66,6 +70,7 @@ protected:
         m_EstimateAxialDiffusivity = true;
         m_EstimateExtraAxonalFraction = true;
         m_ChangedConstraints = true;
+        m_UseLookupTables = false;
         
         m_ModifiedParameters = true;
         m_ModifiedConcentration = true;
@@ -98,6 +103,7 @@ private:
     bool m_EstimateOrientationConcentration, m_EstimateAxialDiffusivity, m_EstimateExtraAxonalFraction;
     bool m_ChangedConstraints;
     unsigned int m_NumberOfParameters;
+    bool m_UseLookupTables;
     
     //! Optimization variable: set to true when the internal parameter has been modified requiring to recompute all quantities depending on it
     bool m_ModifiedParameters;
@@ -109,6 +115,7 @@ private:
     
     // Internal work variables for faster processing
     std::vector <double> m_WatsonSHCoefficients, m_WatsonSHCoefficientDerivatives;
+    std::vector <double> m_KummerValues, m_KummerDerivativeValues;
     double m_Tau1, m_Tau1Deriv;
     double m_ExtraAxonalSignal, m_IntraAxonalSignal;
     double m_IntraAngleDerivative, m_IntraKappaDerivative, m_IntraAxialDerivative;
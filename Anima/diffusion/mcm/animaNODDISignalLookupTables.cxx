@@ -0,0 +1,221 @@
+#include <animaNODDISignalLookupTables.h>
+#include <animaKummerFunctions.h>
+#include <animaMCMConstants.h>
+
+#include <cmath>
+
+namespace anima
+{
+
+const NODDISignalLookupTables &NODDISignalLookupTables::GetInstance()
+{
+    // Thread-safe initialization of the shared tables
+    static const NODDISignalLookupTables tables;
+    return tables;
+}
+
+NODDISignalLookupTables::NODDISignalLookupTables()
+{
+    const unsigned int numValues = 3 * NumberOfCoefficients;
+
+    // Kummer values, x = b d up to b = 20000 s/mm2 with the largest diffusivity
+    m_KummerStep = 0.05;
+    m_KummerMaximalValue = 64.0;
+    m_NumberOfKummerNodes = (unsigned int)std::ceil(m_KummerMaximalValue / m_KummerStep) + 2;
+    m_KummerTable.resize(m_NumberOfKummerNodes * numValues);
+
+    for (unsigned int k = 0;k < m_NumberOfKummerNodes;++k)
+    {
+        double x = k * m_KummerStep;
+        for (unsigned int i = 0;i < NumberOfCoefficients;++i)
+        {
+            for (unsigned int j = 0;j < 3;++j)
+                m_KummerTable[k * numValues + 3 * i + j] = anima::KummerFunction(-x, i + 0.5 + j, 2.0 * i + 1.5 + j, false, true);
+        }
+    }
+
+    // Watson coefficients, small kappa values are computed directly (fast series convergence)
+    m_WatsonStep = 0.05;
+    m_WatsonMinimalValue = 2.0;
+    m_WatsonMaximalValue = anima::MCMConcentrationUpperBound + 1.0;
+    m_NumberOfWatsonNodes = (unsigned int)std::ceil((m_WatsonMaximalValue - m_WatsonMinimalValue) / m_WatsonStep) + 2;
+    m_WatsonTable.resize(m_NumberOfWatsonNodes * numValues);
+
+    double coefficients[NumberOfCoefficients];
+    double derivatives[NumberOfCoefficients];
+    double secondDerivatives[NumberOfCoefficients];
+    for (unsigned int k = 0;k < m_NumberOfWatsonNodes;++k)
+    {
+        double kappa = m_WatsonMinimalValue + k * m_WatsonStep;
+        ComputeWatsonSHCoefficients(kappa, coefficients, derivatives, secondDerivatives);
+
+        for (unsigned int i = 0;i < NumberOfCoefficients;++i)
+        {
+            m_WatsonTable[k * numValues + 3 * i] = coefficients[i];
+            m_WatsonTable[k * numValues + 3 * i + 1] = derivatives[i];
+            m_WatsonTable[k * numValues + 3 * i + 2] = secondDerivatives[i];
+        }
+    }
+}
+
+void NODDISignalLookupTables::GetKummerValues(double x, double *values, double *derivativeValues) const
+{
+    double position = x / m_KummerStep;
+    unsigned int index = (unsigned int)std::floor(position);
+    if ((x < 0) || (index + 1 >= m_NumberOfKummerNodes))
+    {
+        ComputeKummerValues(x, values, derivativeValues);
+        return;
+    }
+
+    // Cubic Hermite interpolation, d/dx M(a,b,-x) = - M(a+1,b+1,-x) for normalized Kummer functions
+    double t = position - index;
+    double t2 = t * t;
+    double t3 = t2 * t;
+    double h00 = 2.0 * t3 - 3.0 * t2 + 1.0;
+    double h10 = (t3 - 2.0 * t2 + t) * m_KummerStep;
+    double h01 = - 2.0 * t3 + 3.0 * t2;
+    double h11 = (t3 - t2) * m_KummerStep;
+
+    const unsigned int numValues = 3 * NumberOfCoefficients;
+    const double *lowerNode = m_KummerTable.data() + index * numValues;
+    const double *upperNode = lowerNode + numValues;
+
+    for (unsigned int i = 0;i < NumberOfCoefficients;++i)
+    {
+        const double *lowerValues = lowerNode + 3 * i;
+        const double *upperValues = upperNode + 3 * i;
+
+        values[i] = h00 * lowerValues[0] - h10 * lowerValues[1] + h01 * upperValues[0] - h11 * upperValues[1];
+        if (derivativeValues)
+            derivativeValues[i] = h00 * lowerValues[1] - h10 * lowerValues[2] + h01 * upperValues[1] - h11 * upperValues[2];
+    }
+}
+
+void NODDISignalLookupTables::GetWatsonSHCoefficients(double kappa, std::vector <double> &coefficients, std::vector <double> &derivatives) const
+{
+    coefficients.resize(NumberOfCoefficients);
+    derivatives.resize(NumberOfCoefficients);
+
+    double position = (kappa - m_WatsonMinimalValue) / m_WatsonStep;
+    if ((position < 0) || ((unsigned int)std::floor(position) + 1 >= m_NumberOfWatsonNodes))
+    {
+        ComputeWatsonSHCoefficients(kappa, coefficients.data(), derivatives.data());
+        return;
+    }
+
+    unsigned int index = (unsigned int)std::floor(position);
+    double t = position - index;
+    double t2 = t * t;
+    double t3 = t2 * t;
+    double h00 = 2.0 * t3 - 3.0 * t2 + 1.0;
+    double h10 = (t3 - 2.0 * t2 + t) * m_WatsonStep;
+    double h01 = - 2.0 * t3 + 3.0 * t2;
+    double h11 = (t3 - t2) * m_WatsonStep;
+
+    const unsigned int numValues = 3 * NumberOfCoefficients;
+    const double *lowerNode = m_WatsonTable.data() + index * numValues;
+    const double *upperNode = lowerNode + numValues;
+
+    for (unsigned int i = 0;i < NumberOfCoefficients;++i)
+    {
+        const double *lowerValues = lowerNode + 3 * i;
+        const double *upperValues = upperNode + 3 * i;
+
+        coefficients[i] = h00 * lowerValues[0] + h10 * lowerValues[1] + h01 * upperValues[0] + h11 * upperValues[1];
+        derivatives[i] = h00 * lowerValues[1] + h10 * lowerValues[2] + h01 * upperValues[1] + h11 * upperValues[2];
+    }
+}
+
+void NODDISignalLookupTables::ComputeKummerValues(double x, double *values, double *derivativeValues)
+{
+    for (unsigned int i = 0;i < NumberOfCoefficients;++i)
+    {
+        values[i] = anima::KummerFunction(-x, i + 0.5, 2.0 * i + 1.5, false, true);
+        if (derivativeValues)
+            derivativeValues[i] = anima::KummerFunction(-x, i + 1.5, 2.0 * i + 2.5, false, true);
+    }
+}
+
+void NODDISignalLookupTables::ComputeWatsonSHCoefficients(double kappa, double *coefficients, double *derivatives, double *secondDerivatives)
+{
+    // Coefficient i is sqrt(4 pi (4i + 1)) E[P_2i(t)] with t = u.mu and E the Watson expectation. Writing
+    // E[P_2i(t)] = S_i / S_0 with S_i = sum_m kappa^m / m! int_0^1 t^2m P_2i(t) dt, all terms are non negative
+    // (they are zero for m < i), avoiding the cancellations of closed form expressions for small kappa values.
+    // Moments I(2m,2i) = int_0^1 t^2m P_2i(t) dt follow I(2i,2i) = 2^2i (2i)!^2 / (4i + 1)! and
+    // I(k+2,n) = I(k,n) (k + 2)(k + 1) / ((k + n + 3)(k - n + 2))
+    const double tolerance = 1.0e-17;
+    const unsigned int maxIter = 10000;
+
+    double sums[NumberOfCoefficients];
+    double firstDerivativeSums[NumberOfCoefficients];
+    double secondDerivativeSums[NumberOfCoefficients];
+
+    for (unsigned int i = 0;i < NumberOfCoefficients;++i)
+    {
+        unsigned int n = 2 * i;
+        double moment = 1.0;
+        for (unsigned int j = 1;j <= n;++j)
+            moment *= 2.0 * j / (n + j);
+        moment /= (2.0 * n + 1.0);
+
+        // kappa^(m-p) / (m-p)! for p = 0, 1, 2, starting at m = i
+        double powerTerms[3] = {0.0, 0.0, 0.0};
+        for (unsigned int p = 0;p < 3;++p)
+        {
+            if (p > i)
+                continue;
+
+            powerTerms[p] = 1.0;
+            for (unsigned int j = 1;j <= i - p;++j)
+                powerTerms[p] *= kappa / j;
+        }
+
+        double sum = 0, firstSum = 0, secondSum = 0;
+        for (unsigned int m = i;m < i + maxIter;++m)
+        {
+            double term = powerTerms[0] * moment;
+            double firstTerm = powerTerms[1] * moment;
+            double secondTerm = powerTerms[2] * moment;
+
+            sum += term;
+            firstSum += firstTerm;
+            secondSum += secondTerm;
+
+            if ((m > kappa) && (term <= tolerance * sum) && (firstTerm <= tolerance * firstSum) && (secondTerm <= tolerance * secondSum))
+                break;
+
+            double k = 2.0 * m;
+            moment *= (k + 2.0) * (k + 1.0) / ((k + n + 3.0) * (k - n + 2.0));
+
+            powerTerms[2] = powerTerms[1];
+            powerTerms[1] = powerTerms[0];
+            powerTerms[0] *= kappa / (m + 1.0);
+        }
+
+        sums[i] = sum;
+        firstDerivativeSums[i] = firstSum;
+        secondDerivativeSums[i] = secondSum;
+    }
+
+    double normSum = sums[0];
+    double normFirstSum = firstDerivativeSums[0];
+    double normSecondSum = secondDerivativeSums[0];
+
+    for (unsigned int i = 0;i < NumberOfCoefficients;++i)
+    {
+        double factor = std::sqrt(4.0 * M_PI * (4.0 * i + 1.0));
+        double numerator = firstDerivativeSums[i] * normSum - sums[i] * normFirstSum;
+
+        coefficients[i] = factor * sums[i] / normSum;
+        derivatives[i] = factor * numerator / (normSum * normSum);
+
+        if (secondDerivatives)
+        {
+            secondDerivatives[i] = factor * ((secondDerivativeSums[i] * normSum - sums[i] * normSecondSum) / (normSum * normSum)
+                                             - 2.0 * normFirstSum * numerator / (normSum * normSum * normSum));
+        }
+    }
+}
+
+} // end namespace anima
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include <AnimaMCMExport.h>
+
+namespace anima
+{
+
+/**
+ * @brief Tabulated evaluation of the expensive terms of the NODDI intra-axonal signal: normalized Kummer functions
+ * M(i + 1/2, 2i + 3/2, -x) (and M(i + 3/2, 2i + 5/2, -x) for axial diffusivity derivatives) as functions of x = b d,
+ * and standard Watson SH coefficients and their derivatives as functions of kappa.
+ * Tables are computed once and shared by all NODDI compartments. Values are interpolated with cubic Hermite
+ * polynomials using exact derivatives at nodes (derivatives of normalized Kummer functions are themselves normalized
+ * Kummer functions), leading to relative errors below 1.0e-8 for Kummer values and 1.0e-6 for Watson coefficients.
+ * Watson coefficients are tabulated from a positive terms series expansion, which remains accurate for small and large
+ * kappa values. Outside of tabulated ranges, values are computed directly.
+ */
+class ANIMAMCM_EXPORT NODDISignalLookupTables
+{
+public:
+    //! Shared tables, computed on first call
+    static const NODDISignalLookupTables &GetInstance();
+
+    //! Number of Watson SH coefficients and Kummer values, same as anima::GetStandardWatsonSHCoefficients
+    static const unsigned int NumberOfCoefficients = 7;
+
+    /**
+     * Normalized Kummer values M(i + 1/2, 2i + 3/2, -x) for i in [0, NumberOfCoefficients[, as computed by
+     * anima::KummerFunction. If derivativeValues is not null, also fills it with M(i + 3/2, 2i + 5/2, -x).
+     */
+    void GetKummerValues(double x, double *values, double *derivativeValues = 0) const;
+
+    //! Standard Watson SH coefficients (multiplied by 4 pi) and their derivatives w.r.t. kappa
+    void GetWatsonSHCoefficients(double kappa, std::vector <double> &coefficients, std::vector <double> &derivatives) const;
+
+    //! Direct computation of Kummer values, used outside of the tabulated range
+    static void ComputeKummerValues(double x, double *values, double *derivativeValues = 0);
+
+    //! Direct computation of Watson SH coefficients and their first and second derivatives w.r.t. kappa from their series expansion
+    static void ComputeWatsonSHCoefficients(double kappa, double *coefficients, double *derivatives, double *secondDerivatives = 0);
+
+private:
+    NODDISignalLookupTables();
+
+    NODDISignalLookupTables(const NODDISignalLookupTables&); //purposely not implemented
+    void operator=(const NODDISignalLookupTables&); //purposely not implemented
+
+    // Tables hold for each node and coefficient: value, derivative and second derivative (for Kummer values,
+    // normalized Kummer functions with increasing parameters: M(a,b,-x), M(a+1,b+1,-x), M(a+2,b+2,-x))
+    double m_KummerStep, m_KummerMaximalValue;
+    unsigned int m_NumberOfKummerNodes;
+    std::vector <double> m_KummerTable;
+
+    double m_WatsonStep, m_WatsonMinimalValue, m_WatsonMaximalValue;
+    unsigned int m_NumberOfWatsonNodes;
+    std::vector <double> m_WatsonTable;
+};
+
+} // end namespace anima
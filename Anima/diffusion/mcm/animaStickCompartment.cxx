@@ -45,6 +45,69 @@ StickCompartment::ListType &StickCompartment::GetSignalAttenuationJacobian(doubl
     return m_JacobianVector;
 }
 
+void StickCompartment::EvaluateSignals(const GradientSchemeSoA &scheme, double *signals, double *jacobians)
+{
+    unsigned int numGradients = scheme.GetNumberOfGradients();
+    const double *gradientX = scheme.GetGradientX();
+    const double *gradientY = scheme.GetGradientY();
+    const double *gradientZ = scheme.GetGradientZ();
+    const double *bValues = scheme.GetBValues();
+
+    double sinTheta = std::sin(this->GetOrientationTheta());
+    double cosTheta = std::cos(this->GetOrientationTheta());
+    double sinPhi = std::sin(this->GetOrientationPhi());
+    double cosPhi = std::cos(this->GetOrientationPhi());
+
+    double orientationX = sinTheta * cosPhi;
+    double orientationY = sinTheta * sinPhi;
+    double orientationZ = cosTheta;
+
+    double radialDiffusivity = this->GetRadialDiffusivity1();
+    double diffAxialRadial = this->GetAxialDiffusivity() - radialDiffusivity;
+
+    m_BatchGradientEigenvector1.resize(numGradients);
+    double *gradientEigenvector1 = m_BatchGradientEigenvector1.data();
+
+    // Separate loops on contiguous arrays: exponents first, then exponentials
+    for (unsigned int i = 0;i < numGradients;++i)
+        gradientEigenvector1[i] = gradientX[i] * orientationX + gradientY[i] * orientationY + gradientZ[i] * orientationZ;
+
+    for (unsigned int i = 0;i < numGradients;++i)
+        signals[i] = - bValues[i] * (radialDiffusivity + diffAxialRadial * gradientEigenvector1[i] * gradientEigenvector1[i]);
+
+    for (unsigned int i = 0;i < numGradients;++i)
+        signals[i] = std::exp(signals[i]);
+
+    if (!jacobians)
+        return;
+
+    double *thetaJacobian = jacobians;
+    double *phiJacobian = jacobians + numGradients;
+
+    double dThetaX = cosTheta * cosPhi;
+    double dThetaY = cosTheta * sinPhi;
+    double dThetaZ = - sinTheta;
+
+    for (unsigned int i = 0;i < numGradients;++i)
+    {
+        double factor = -2.0 * bValues[i] * diffAxialRadial * gradientEigenvector1[i] * signals[i];
+
+        // Derivative w.r.t. theta
+        thetaJacobian[i] = factor * (gradientX[i] * dThetaX + gradientY[i] * dThetaY + gradientZ[i] * dThetaZ);
+
+        // Derivative w.r.t. phi
+        phiJacobian[i] = factor * sinTheta * (gradientY[i] * cosPhi - gradientX[i] * sinPhi);
+    }
+
+    if (!m_EstimateAxialDiffusivity)
+        return;
+
+    // Derivative w.r.t. to d1
+    double *axialJacobian = jacobians + 2 * numGradients;
+    for (unsigned int i = 0;i < numGradients;++i)
+        axialJacobian[i] = - bValues[i] * gradientEigenvector1[i] * gradientEigenvector1[i] * signals[i];
+}
+
 double StickCompartment::GetLogDiffusionProfile(const Vector3DType &sample)
 {
     Vector3DType compartmentOrientation(0.0);
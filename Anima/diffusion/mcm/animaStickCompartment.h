@@ -29,6 +29,7 @@ public:
 
     virtual double GetFourierTransformedDiffusionProfile(double smallDelta, double bigDelta, double gradientStrength, const Vector3DType &gradient) ITK_OVERRIDE;
     virtual ListType &GetSignalAttenuationJacobian(double smallDelta, double bigDelta, double gradientStrength, const Vector3DType &gradient) ITK_OVERRIDE;
+    virtual void EvaluateSignals(const GradientSchemeSoA &scheme, double *signals, double *jacobians = 0) ITK_OVERRIDE;
     virtual double GetLogDiffusionProfile(const Vector3DType &sample) ITK_OVERRIDE;
 
     virtual void SetParametersFromVector(const ListType &params) ITK_OVERRIDE;
@@ -63,6 +64,9 @@ private:
     bool m_ChangedConstraints;
     unsigned int m_NumberOfParameters;
     double m_GradientEigenvector1;
+
+    //! Batched evaluation work variable: scalar products of gradients with the compartment orientation
+    ListType m_BatchGradientEigenvector1;
 };
 
 } //end namespace anima
@@ -70,6 +70,114 @@ TensorCompartment::ListType &TensorCompartment::GetSignalAttenuationJacobian(dou
     return m_JacobianVector;
 }
 
+void TensorCompartment::EvaluateSignals(const GradientSchemeSoA &scheme, double *signals, double *jacobians)
+{
+    this->UpdateDiffusionTensor();
+
+    unsigned int numGradients = scheme.GetNumberOfGradients();
+    const double *gradientX = scheme.GetGradientX();
+    const double *gradientY = scheme.GetGradientY();
+    const double *gradientZ = scheme.GetGradientZ();
+    const double *bValues = scheme.GetBValues();
+
+    double dXX = m_DiffusionTensor(0,0);
+    double dYY = m_DiffusionTensor(1,1);
+    double dZZ = m_DiffusionTensor(2,2);
+    double dXY = 2.0 * m_DiffusionTensor(0,1);
+    double dXZ = 2.0 * m_DiffusionTensor(0,2);
+    double dYZ = 2.0 * m_DiffusionTensor(1,2);
+
+    // Separate loops on contiguous arrays: exponents first, then exponentials
+    for (unsigned int i = 0;i < numGradients;++i)
+    {
+        double quadForm = dXX * gradientX[i] * gradientX[i] + dYY * gradientY[i] * gradientY[i] + dZZ * gradientZ[i] * gradientZ[i]
+                + dXY * gradientX[i] * gradientY[i] + dXZ * gradientX[i] * gradientZ[i] + dYZ * gradientY[i] * gradientZ[i];
+
+        signals[i] = - bValues[i] * quadForm;
+    }
+
+    for (unsigned int i = 0;i < numGradients;++i)
+        signals[i] = std::exp(signals[i]);
+
+    if (!jacobians)
+        return;
+
+    m_BatchInnerProducts1.resize(numGradients);
+    m_BatchInnerProducts2.resize(numGradients);
+    double *innerProds1 = m_BatchInnerProducts1.data();
+    double *innerProds2 = m_BatchInnerProducts2.data();
+
+    for (unsigned int i = 0;i < numGradients;++i)
+    {
+        innerProds1[i] = gradientX[i] * m_EigenVector1[0] + gradientY[i] * m_EigenVector1[1] + gradientZ[i] * m_EigenVector1[2];
+        innerProds2[i] = gradientX[i] * m_EigenVector2[0] + gradientY[i] * m_EigenVector2[1] + gradientZ[i] * m_EigenVector2[2];
+    }
+
+    // Derivatives of scalar products with eigenvectors are linear in the gradient, compute their coefficients once
+    double dE1dThetaX = m_CosTheta * m_CosPhi;
+    double dE1dThetaY = m_CosTheta * m_SinPhi;
+    double dE1dThetaZ = - m_SinTheta;
+
+    double dE1dPhiX = - m_SinTheta * m_SinPhi;
+    double dE1dPhiY = m_SinTheta * m_CosPhi;
+
+    double dE2dPhiX = m_CosTheta * m_SinPhi * m_SinAlpha - m_CosPhi * m_CosAlpha;
+    double dE2dPhiY = - m_SinPhi * m_CosAlpha - m_CosTheta * m_CosPhi * m_SinAlpha;
+
+    double dE2dAlphaX = m_SinPhi * m_SinAlpha - m_CosTheta * m_CosPhi * m_CosAlpha;
+    double dE2dAlphaY = - m_CosPhi * m_SinAlpha - m_CosTheta * m_SinPhi * m_CosAlpha;
+    double dE2dAlphaZ = m_SinTheta * m_CosAlpha;
+
+    double diffAxialRadial2 = this->GetAxialDiffusivity() - this->GetRadialDiffusivity2();
+    double diffRadialDiffusivities = this->GetRadialDiffusivity1() - this->GetRadialDiffusivity2();
+
+    double *thetaJacobian = jacobians;
+    double *phiJacobian = jacobians + numGradients;
+    double *alphaJacobian = jacobians + 2 * numGradients;
+
+    for (unsigned int i = 0;i < numGradients;++i)
+    {
+        double DgTe1DTheta = gradientX[i] * dE1dThetaX + gradientY[i] * dE1dThetaY + gradientZ[i] * dE1dThetaZ;
+        double DgTe1DPhi = gradientX[i] * dE1dPhiX + gradientY[i] * dE1dPhiY;
+
+        double DgTe2DTheta = m_SinAlpha * innerProds1[i];
+        double DgTe2DPhi = gradientX[i] * dE2dPhiX + gradientY[i] * dE2dPhiY;
+        double DgTe2DAlpha = gradientX[i] * dE2dAlphaX + gradientY[i] * dE2dAlphaY + gradientZ[i] * dE2dAlphaZ;
+
+        double factor = -2.0 * bValues[i] * signals[i];
+
+        // Derivative w.r.t. theta
+        thetaJacobian[i] = factor * (diffAxialRadial2 * innerProds1[i] * DgTe1DTheta + diffRadialDiffusivities * innerProds2[i] * DgTe2DTheta);
+
+        // Derivative w.r.t. phi
+        phiJacobian[i] = factor * (diffAxialRadial2 * innerProds1[i] * DgTe1DPhi + diffRadialDiffusivities * innerProds2[i] * DgTe2DPhi);
+
+        // Derivative w.r.t. alpha
+        alphaJacobian[i] = factor * diffRadialDiffusivities * innerProds2[i] * DgTe2DAlpha;
+    }
+
+    if (!m_EstimateDiffusivities)
+        return;
+
+    double *axialJacobian = jacobians + 3 * numGradients;
+    double *radial1Jacobian = jacobians + 4 * numGradients;
+    double *radial2Jacobian = jacobians + 5 * numGradients;
+
+    for (unsigned int i = 0;i < numGradients;++i)
+    {
+        double squaredInnerProd1 = innerProds1[i] * innerProds1[i];
+
+        // Derivative w.r.t. to d1
+        axialJacobian[i] = - bValues[i] * squaredInnerProd1 * signals[i];
+
+        // Derivative w.r.t. to d2
+        radial1Jacobian[i] = - bValues[i] * (squaredInnerProd1 + innerProds2[i] * innerProds2[i]) * signals[i];
+
+        // Derivative w.r.t. to d3
+        radial2Jacobian[i] = - bValues[i] * signals[i];
+    }
+}
+
 double TensorCompartment::GetLogDiffusionProfile(const Vector3DType &sample)
 {
     this->UpdateInverseDiffusionTensor();
@@ -30,6 +30,7 @@ public:
 
     virtual double GetFourierTransformedDiffusionProfile(double smallDelta, double bigDelta, double gradientStrength, const Vector3DType &gradient) ITK_OVERRIDE;
     virtual ListType &GetSignalAttenuationJacobian(double smallDelta, double bigDelta, double gradientStrength, const Vector3DType &gradient) ITK_OVERRIDE;
+    virtual void EvaluateSignals(const GradientSchemeSoA &scheme, double *signals, double *jacobians = 0) ITK_OVERRIDE;
     virtual double GetLogDiffusionProfile(const Vector3DType &sample) ITK_OVERRIDE;
 
     virtual void SetParametersFromVector(const ListType &params) ITK_OVERRIDE;
@@ -116,6 +117,9 @@ private:
     Vector3DType m_EigenVector1, m_EigenVector2;
     double m_SinTheta, m_CosTheta, m_SinPhi, m_CosPhi, m_SinAlpha, m_CosAlpha;
     double m_TensorDeterminant;
+
+    //! Batched evaluation work variables: scalar products of gradients with the two first eigenvectors
+    ListType m_BatchInnerProducts1, m_BatchInnerProducts2;
 };
 
 } //end namespace anima
@@ -0,0 +1,265 @@
+#include <animaNODDISignalLookupTables.h>
+#include <animaNODDICompartment.h>
+#include <animaGradientSchemeSoA.h>
+#include <animaDistributionSampling.h>
+#include <animaWatsonDistribution.h>
+#include <animaMCMConstants.h>
+
+#include <itkTimeProbe.h>
+#include <tclap/CmdLine.h>
+#include <boost/math/special_functions/legendre.hpp>
+
+#include <random>
+
+//! NODDI intra-axonal signal from series Watson coefficients and direct Kummer values, accurate on the whole kappa range
+double ComputeReferenceIntraAxonalSignal(double kappa, double x, double innerProd)
+{
+    typedef anima::NODDISignalLookupTables TablesType;
+    const unsigned int numCoefficients = TablesType::NumberOfCoefficients;
+
+    double coefficients[numCoefficients], derivatives[numCoefficients];
+    double kummerValues[numCoefficients];
+    TablesType::ComputeWatsonSHCoefficients(kappa, coefficients, derivatives);
+    TablesType::ComputeKummerValues(x, kummerValues);
+
+    double signal = 0;
+    for (unsigned int i = 0;i < numCoefficients;++i)
+    {
+        double sqrtVal = std::sqrt((4.0 * i + 1.0) / (4.0 * M_PI));
+        signal += coefficients[i] * sqrtVal * boost::math::legendre_p(2 * i, innerProd) * std::pow(-x, (double)i) * kummerValues[i];
+    }
+
+    return signal / 2.0;
+}
+
+int main(int argc, char **argv)
+{
+    TCLAP::CmdLine cmd("Checks accuracy and speed of NODDI lookup tables against direct Kummer and Watson evaluations. INRIA / IRISA - VisAGeS/Empenn Team", ' ',ANIMA_VERSION);
+
+    TCLAP::ValueArg<unsigned int> numSamplesArg("n","nb-samples","Number of random samples for accuracy checks (default: 10000)",false,10000,"number of samples",cmd);
+    TCLAP::ValueArg<unsigned int> numGradientsArg("g","nb-grads","Number of gradient directions per shell for NODDI signal checks (default: 100)",false,100,"number of gradients",cmd);
+    TCLAP::ValueArg<unsigned int> numModelsArg("m","nb-models","Number of random NODDI compartments for signal checks (default: 100)",false,100,"number of models",cmd);
+    TCLAP::ValueArg<double> toleranceArg("t","tol","Relative tolerance on tabulated values (default: 1.0e-6)",false,1.0e-6,"tolerance",cmd);
+    TCLAP::ValueArg<double> closedFormToleranceArg("c","closed-form-tol","Relative tolerance to closed form Watson coefficients (default: 1.0e-5)",false,1.0e-5,"closed form tolerance",cmd);
+    TCLAP::ValueArg<double> signalToleranceArg("s","signal-tol","Absolute tolerance on NODDI signals (default: 1.0e-5)",false,1.0e-5,"signal tolerance",cmd);
+    TCLAP::ValueArg<double> jacobianToleranceArg("j","jacobian-tol","Tolerance on NODDI jacobians, relative to the largest value of each parameter derivative (default: 1.0e-4)",false,1.0e-4,"jacobian tolerance",cmd);
+
+    try
+    {
+        cmd.parse(argc,argv);
+    }
+    catch (TCLAP::ArgException& e)
+    {
+        std::cerr << "Error: " << e.error() << "for argument " << e.argId() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    typedef anima::NODDISignalLookupTables TablesType;
+    const unsigned int numCoefficients = TablesType::NumberOfCoefficients;
+
+    std::mt19937 generator(1);
+
+    itk::TimeProbe tmpTime;
+    tmpTime.Start();
+    const TablesType &tables = TablesType::GetInstance();
+    tmpTime.Stop();
+    std::cout << "Lookup tables computed in " << tmpTime.GetTotal() << "s" << std::endl;
+
+    // Kummer values against anima::KummerFunction, including values outside of the tabulated range
+    std::uniform_real_distribution <double> xDistribution(0.0, 70.0);
+    double values[numCoefficients], derivativeValues[numCoefficients];
+    double refValues[numCoefficients], refDerivativeValues[numCoefficients];
+    double maxKummerError = 0;
+    for (unsigned int i = 0;i < numSamplesArg.getValue();++i)
+    {
+        double x = xDistribution(generator);
+        tables.GetKummerValues(x, values, derivativeValues);
+        TablesType::ComputeKummerValues(x, refValues, refDerivativeValues);
+
+        for (unsigned int j = 0;j < numCoefficients;++j)
+        {
+            maxKummerError = std::max(maxKummerError, std::abs(values[j] - refValues[j]) / std::abs(refValues[j]));
+            maxKummerError = std::max(maxKummerError, std::abs(derivativeValues[j] - refDerivativeValues[j]) / std::abs(refDerivativeValues[j]));
+        }
+    }
+
+    std::cout << "Kummer values, maximal relative error: " << maxKummerError << std::endl;
+
+    // Watson coefficients against their series expansion, and against closed form expressions on the range where those are stable.
+    // Random kappa values cover the whole estimation range, completed by values close to its bounds
+    std::uniform_real_distribution <double> kappaDistribution(0.0, anima::MCMConcentrationUpperBound);
+    std::vector <double> edgeKappas = {1.0e-6, 1.0e-4, 1.0e-3, 1.0e-2, 0.1, 127.9, 127.93, 127.99, anima::MCMConcentrationUpperBound};
+    unsigned int numEdgeKappas = edgeKappas.size();
+
+    std::vector <double> coefficients, derivatives, closedFormCoefficients, closedFormDerivatives;
+    double refCoefficients[numCoefficients], refDerivatives[numCoefficients];
+    double maxWatsonError = 0;
+    double maxClosedFormDifference = 0;
+    for (unsigned int i = 0;i < numSamplesArg.getValue() + numEdgeKappas;++i)
+    {
+        double kappa = (i < numEdgeKappas) ? edgeKappas[i] : kappaDistribution(generator);
+        tables.GetWatsonSHCoefficients(kappa, coefficients, derivatives);
+        TablesType::ComputeWatsonSHCoefficients(kappa, refCoefficients, refDerivatives);
+
+        for (unsigned int j = 1;j < numCoefficients;++j)
+        {
+            maxWatsonError = std::max(maxWatsonError, std::abs(coefficients[j] - refCoefficients[j]) / std::abs(refCoefficients[j]));
+            maxWatsonError = std::max(maxWatsonError, std::abs(derivatives[j] - refDerivatives[j]) / std::abs(refDerivatives[j]));
+        }
+
+        if ((kappa < 1.0) || (kappa > 20.0))
+            continue;
+
+        anima::GetStandardWatsonSHCoefficients(kappa, closedFormCoefficients, closedFormDerivatives);
+        for (unsigned int j = 1;j < numCoefficients;++j)
+            maxClosedFormDifference = std::max(maxClosedFormDifference, std::abs(coefficients[j] - closedFormCoefficients[j]) / std::abs(closedFormCoefficients[j]));
+    }
+
+    std::cout << "Watson SH coefficients (kappa in [0," << anima::MCMConcentrationUpperBound << "]), maximal relative error: " << maxWatsonError << std::endl;
+    std::cout << "Watson SH coefficients, maximal relative difference to closed form for kappa in [1,20]: " << maxClosedFormDifference << std::endl;
+
+    // NODDI signals and jacobians with and without tables, on a three shells scheme
+    std::vector <anima::GradientSchemeSoA::Vector3DType> gradients;
+    std::vector <double> gradientStrengths;
+    std::vector <double> direction(3);
+    anima::GradientSchemeSoA::Vector3DType gradient;
+    for (unsigned int shell = 1;shell <= 3;++shell)
+    {
+        double gradientStrength = anima::GetGradientStrengthFromBValue(1000.0 * shell, anima::DiffusionSmallDelta, anima::DiffusionBigDelta);
+        for (unsigned int i = 0;i < numGradientsArg.getValue();++i)
+        {
+            anima::SampleFromUniformDistributionOn2Sphere(generator, direction);
+            for (unsigned int j = 0;j < 3;++j)
+                gradient[j] = direction[j];
+
+            gradients.push_back(gradient);
+            gradientStrengths.push_back(gradientStrength);
+        }
+    }
+
+    anima::GradientSchemeSoA scheme;
+    scheme.SetGradientScheme(anima::DiffusionSmallDelta, anima::DiffusionBigDelta, gradientStrengths, gradients);
+    unsigned int numGradients = scheme.GetNumberOfGradients();
+
+    anima::NODDICompartment::Pointer exactCompartment = anima::NODDICompartment::New();
+    anima::NODDICompartment::Pointer tabulatedCompartment = anima::NODDICompartment::New();
+    tabulatedCompartment->SetUseLookupTables(true);
+    unsigned int numParameters = exactCompartment->GetNumberOfParameters();
+
+    std::vector <double> exactSignals(numGradients), tabulatedSignals(numGradients);
+    std::vector <double> exactJacobians(numGradients * numParameters), tabulatedJacobians(numGradients * numParameters);
+
+    // Direct evaluation relies on closed form Watson coefficients, only compared to on the range where those are stable
+    std::uniform_real_distribution <double> unitDistribution(0.0, 1.0);
+    std::uniform_real_distribution <double> modelKappaDistribution(1.0, 20.0);
+    double maxSignalDifference = 0;
+    double maxJacobianDifference = 0;
+    itk::TimeProbe exactTime, tabulatedTime;
+
+    for (unsigned int i = 0;i < numModelsArg.getValue();++i)
+    {
+        std::vector <anima::NODDICompartment::Pointer> compartments(2);
+        compartments[0] = exactCompartment;
+        compartments[1] = tabulatedCompartment;
+
+        double theta = std::acos(2.0 * unitDistribution(generator) - 1.0);
+        double phi = 2.0 * M_PI * unitDistribution(generator);
+        double kappa = modelKappaDistribution(generator);
+        double extraAxonalFraction = 0.1 + 0.8 * unitDistribution(generator);
+        double axialDiffusivity = 1.0e-3 + 2.0e-3 * unitDistribution(generator);
+
+        for (unsigned int j = 0;j < compartments.size();++j)
+        {
+            compartments[j]->SetOrientationTheta(theta);
+            compartments[j]->SetOrientationPhi(phi);
+            compartments[j]->SetOrientationConcentration(kappa);
+            compartments[j]->SetExtraAxonalFraction(extraAxonalFraction);
+            compartments[j]->SetAxialDiffusivity(axialDiffusivity);
+        }
+
+        exactTime.Start();
+        exactCompartment->EvaluateSignals(scheme, exactSignals.data(), exactJacobians.data());
+        exactTime.Stop();
+
+        tabulatedTime.Start();
+        tabulatedCompartment->EvaluateSignals(scheme, tabulatedSignals.data(), tabulatedJacobians.data());
+        tabulatedTime.Stop();
+
+        for (unsigned int j = 0;j < numGradients;++j)
+            maxSignalDifference = std::max(maxSignalDifference, std::abs(exactSignals[j] - tabulatedSignals[j]));
+
+        // Derivatives have very different scales from one parameter to the other, and may vanish on some gradients
+        for (unsigned int k = 0;k < numParameters;++k)
+        {
+            double jacobianScale = 0;
+            for (unsigned int j = 0;j < numGradients;++j)
+                jacobianScale = std::max(jacobianScale, std::abs(exactJacobians[k * numGradients + j]));
+
+            jacobianScale = std::max(jacobianScale, 1.0e-12);
+            for (unsigned int j = 0;j < numGradients;++j)
+            {
+                unsigned int pos = k * numGradients + j;
+                maxJacobianDifference = std::max(maxJacobianDifference, std::abs(exactJacobians[pos] - tabulatedJacobians[pos]) / jacobianScale);
+            }
+        }
+    }
+
+    // Intra-axonal signals on the whole kappa range, including its bounds, against a reference using series Watson coefficients
+    tabulatedCompartment->SetExtraAxonalFraction(0.0);
+    const double *bValues = scheme.GetBValues();
+    double maxIntraSignalDifference = 0;
+    for (unsigned int i = 0;i < numModelsArg.getValue() + numEdgeKappas;++i)
+    {
+        double theta = std::acos(2.0 * unitDistribution(generator) - 1.0);
+        double phi = 2.0 * M_PI * unitDistribution(generator);
+        double kappa = (i < numEdgeKappas) ? edgeKappas[i] : kappaDistribution(generator);
+        double axialDiffusivity = 1.0e-3 + 2.0e-3 * unitDistribution(generator);
+
+        tabulatedCompartment->SetOrientationTheta(theta);
+        tabulatedCompartment->SetOrientationPhi(phi);
+        tabulatedCompartment->SetOrientationConcentration(kappa);
+        tabulatedCompartment->SetAxialDiffusivity(axialDiffusivity);
+        tabulatedCompartment->EvaluateSignals(scheme, tabulatedSignals.data());
+
+        for (unsigned int j = 0;j < numGradients;++j)
+        {
+            anima::GradientSchemeSoA::Vector3DType gradient = scheme.GetGradient(j);
+            double innerProd = gradient[0] * std::sin(theta) * std::cos(phi) + gradient[1] * std::sin(theta) * std::sin(phi) + gradient[2] * std::cos(theta);
+            double referenceSignal = ComputeReferenceIntraAxonalSignal(kappa, bValues[j] * axialDiffusivity, innerProd);
+            maxIntraSignalDifference = std::max(maxIntraSignalDifference, std::abs(tabulatedSignals[j] - referenceSignal));
+        }
+    }
+
+    std::cout << "NODDI signals (kappa in [1,20]), maximal absolute difference: " << maxSignalDifference << std::endl;
+    std::cout << "NODDI jacobians (kappa in [1,20]), maximal difference relative to derivative scale: " << maxJacobianDifference << std::endl;
+    std::cout << "NODDI signals and jacobians, direct evaluation time: " << exactTime.GetTotal() << "s, with lookup tables: "
+              << tabulatedTime.GetTotal() << "s (speed-up: " << exactTime.GetTotal() / tabulatedTime.GetTotal() << ")" << std::endl;
+    std::cout << "NODDI intra-axonal signals (kappa in [0," << anima::MCMConcentrationUpperBound << "]), maximal absolute difference to series reference: "
+              << maxIntraSignalDifference << std::endl;
+
+    if ((maxKummerError > toleranceArg.getValue()) || (maxWatsonError > toleranceArg.getValue()))
+    {
+        std::cerr << "Lookup tables relative error above tolerance " << toleranceArg.getValue() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (maxClosedFormDifference > closedFormToleranceArg.getValue())
+    {
+        std::cerr << "Watson SH coefficients difference to closed form above tolerance " << closedFormToleranceArg.getValue() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if ((maxSignalDifference > signalToleranceArg.getValue()) || (maxIntraSignalDifference > signalToleranceArg.getValue()))
+    {
+        std::cerr << "NODDI signals difference to reference evaluation above tolerance " << signalToleranceArg.getValue() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (maxJacobianDifference > jacobianToleranceArg.getValue())
+    {
+        std::cerr << "NODDI jacobians difference to direct evaluation above tolerance " << jacobianToleranceArg.getValue() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -61,6 +61,8 @@ int main(int argc,  char **argv)
     TCLAP::SwitchArg commonKappaArg("", "common-kappa", "Share orientation concentration values among compartments", cmd, false);
     TCLAP::SwitchArg commonEAFArg("", "common-eaf", "Share extra axonal fraction values among compartments", cmd, false);
 
+    TCLAP::SwitchArg noddiExactArg("", "noddi-exact", "Compute NODDI Kummer and Watson terms directly instead of using lookup tables (slower)", cmd, false);
+
     //Initial values for diffusivities
     TCLAP::ValueArg<double> initAxialDiffArg("", "init-axial-diff", "Initial axial diffusivity (default: 1.71e-3)", false, 1.71e-3, "initial axial diffusivity", cmd);
     TCLAP::ValueArg<double> initRadialDiff1Arg("", "init-radial-diff1", "Initial first radial diffusivity (default: 1.9e-4)", false, 1.9e-4, "initial first radial diffusivity", cmd);
@@ -76,6 +78,9 @@ int main(int argc,  char **argv)
     TCLAP::ValueArg<double> gTolArg("G", "g-tol", "Tolerance for gradient in optimization (default: 0 -> function of position tolerance)", false, 0, "gradient tolerance", cmd);
     TCLAP::ValueArg<unsigned int> maxEvalArg("e", "max-eval", "Maximum evaluations (default: 0 -> function of number of unknowns)", false, 0, "max evaluations", cmd);
 
+    TCLAP::ValueArg<unsigned int> dicSizeArg("", "dic-size", "Number of sticks in the sparse initialization dictionary (default: 500)", false, 500, "dictionary size", cmd);
+    TCLAP::ValueArg<double> dicResolutionArg("", "dic-res", "Angular resolution (in degrees) of the sparse initialization dictionary, overrides dictionary size if set", false, 0, "dictionary resolution", cmd);
+    TCLAP::ValueArg<unsigned int> batchSizeArg("", "batch-size", "Number of masked voxels gathered and estimated in a row by each thread (default: 64)", false, 64, "voxel batch size", cmd);
     TCLAP::ValueArg<unsigned int> nbThreadsArg("T", "nb-threads", "Number of threads to run on (default: all cores)", false, itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads(), "number of threads", cmd);
 
     try
@@ -110,6 +115,8 @@ int main(int argc,  char **argv)
     else
         filter->SetUseCommonExtraAxonalFractions(false);
 
+    filter->SetUseNODDILookupTables(!noddiExactArg.isSet());
+
     std::cout << "Loading input DWI image..." << std::endl;
 
     anima::setMultipleImageFilterInputsFromFileName<InputImageType,FilterType>(dwiArg.getValue(), filter);
@@ -187,6 +194,11 @@ int main(int argc,  char **argv)
     filter->SetNoiseType(FilterType::Gaussian);
     filter->SetMLEstimationStrategy((FilterType::MaximumLikelihoodEstimationMode)mlModeArg.getValue());
 
+    filter->SetVoxelBatchSize(batchSizeArg.getValue());
+    filter->SetNumberOfDictionaryEntries(dicSizeArg.getValue());
+    if (dicResolutionArg.isSet())
+        filter->SetDictionaryAngularResolution(dicResolutionArg.getValue());
+
     filter->SetXTolerance(xTolArg.getValue());
     filter->SetGTolerance(gTolArg.getValue());
     filter->SetMaxEval(maxEvalArg.getValue());
@@ -11,6 +11,7 @@
 #include <itkCostFunction.h>
 #include <itkNonLinearOptimizer.h>
 
+#include <animaDictionaryNNLSSolver.h>
 #include <animaHyperbolicFunctions.h>
 #include <animaMCMConstants.h>
 
@@ -77,6 +78,7 @@ public:
     typedef TInputImage  InputImageType;
     typedef TOutputImage OutputImageType;
     typedef typename InputImageType::Pointer InputImagePointer;
+    typedef typename InputImageType::IndexType InputIndexType;
     typedef typename OutputImageType::PixelType VariableLengthVectorType;
     typedef typename OutputImageType::Pointer OutputImagePointer;
 
@@ -98,6 +100,10 @@ public:
     void SetOptimizer(std::string &opt) {m_Optimizer = opt;}
     itkSetMacro(AbsoluteCostChange, double)
 
+    //! Number of masked voxels gathered by each thread before being estimated in a row (default: 64)
+    itkSetMacro(VoxelBatchSize, unsigned int)
+    itkGetMacro(VoxelBatchSize, unsigned int)
+
     itkSetMacro(MLEstimationStrategy, MaximumLikelihoodEstimationMode)
     itkGetMacro(MLEstimationStrategy, MaximumLikelihoodEstimationMode)
 
@@ -129,6 +135,9 @@ public:
 
     itkSetMacro(UseCommonDiffusivities, bool)
 
+    //! Tabulated evaluation of NODDI Kummer and Watson terms (on by default)
+    itkSetMacro(UseNODDILookupTables, bool)
+
     std::string GetOptimizer() {return m_Optimizer;}
 
     std::vector <double> & GetGradientStrengths() {return m_GradientStrengths;}
@@ -155,6 +164,13 @@ public:
     itkSetMacro(RadialDiffusivity1Value, double)
     itkSetMacro(RadialDiffusivity2Value, double)
 
+    //! Number of sticks in the sparse initialization dictionary, larger dictionaries are more accurate but slower
+    itkSetMacro(NumberOfDictionaryEntries, unsigned int)
+    itkGetMacro(NumberOfDictionaryEntries, unsigned int)
+
+    //! Sets the number of dictionary sticks from the angular resolution (in degrees) of their even sampling of the hemisphere
+    void SetDictionaryAngularResolution(double angle);
+
     itkSetMacro(XTolerance, double)
     itkSetMacro(GTolerance, double)
     itkSetMacro(MaxEval, unsigned int)
@@ -173,6 +189,7 @@ protected:
         m_NumberOfDictionaryEntries = 500;
         m_Optimizer = "bobyqa";
         m_AbsoluteCostChange = 0.01;
+        m_VoxelBatchSize = 64;
         m_B0Threshold = 0;
         m_MLEstimationStrategy = Marginal;
 
@@ -199,6 +216,7 @@ protected:
         m_UseConstrainedExtraAxonalFraction = false;
         m_UseCommonConcentrations = false;
         m_UseCommonExtraAxonalFractions = false;
+        m_UseNODDILookupTables = true;
 
         m_AxialDiffusivityValue = 1.71e-3;
         m_StaniszDiffusivityValue = 1.71e-3;
@@ -230,12 +248,22 @@ protected:
     virtual void BeforeThreadedGenerateData() ITK_OVERRIDE;
     void DynamicThreadedGenerateData(const OutputImageRegionType &outputRegionForThread) ITK_OVERRIDE;
 
+    //! Estimates models for a batch of masked voxels, signals being stored contiguously (one row per voxel)
+    void EstimateVoxelBatch(const vnl_matrix <double> &batchSignals, const std::vector <InputIndexType> &batchIndexes,
+                            unsigned int numVoxels, itk::ThreadIdType threadId);
+
     //! Create a cost function following the noise type and estimation mode
     virtual CostFunctionBasePointer CreateCostFunction(std::vector<double> &observedSignals, MCMPointer &mcmModel);
 
+    //! Get the cost function of a thread (created on first call), set up for the provided signals and model
+    CostFunctionBasePointer &GetThreadCostFunction(std::vector<double> &observedSignals, MCMPointer &mcmModel, itk::ThreadIdType threadId);
+
     //! Create an optimizer following the optimizer type and estimation mode
     OptimizerPointer CreateOptimizer(CostFunctionBasePointer &cost, itk::Array<double> &lowerBounds, itk::Array<double> &upperBounds);
 
+    //! Set up an optimizer created by CreateOptimizer for a new cost function and bounds
+    void SetupOptimizer(OptimizerPointer &optimizer, CostFunctionBasePointer &cost, itk::Array<double> &lowerBounds, itk::Array<double> &upperBounds);
+
     //! Specific method for N=0 compartments estimation (only free water)
     void EstimateFreeWaterModel(MCMPointer &mcmValue, std::vector <double> &observedSignals, itk::ThreadIdType threadId,
                                 double &aiccValue, double &b0Value, double &sigmaSqValue);
@@ -254,9 +282,9 @@ protected:
     void ModelEstimation(MCMPointer &mcmValue, bool authorizedNegativeB0Value, std::vector <double> &observedSignals,
                          itk::ThreadIdType threadId, double &aiccValue, double &b0Value, double &sigmaSqValue);
     
-    //! Performs an optimization of the supplied cost function and parameters using the specified optimizer(s). Returns the optimized parameters.
+    //! Performs an optimization of the supplied cost function and parameters using the thread optimizer. Returns the optimized parameters.
     double PerformSingleOptimization(ParametersType &p, CostFunctionBasePointer &cost, itk::Array<double> &lowerBounds,
-                                     itk::Array<double> &upperBounds);
+                                     itk::Array<double> &upperBounds, itk::ThreadIdType threadId);
 
     //! Performs initialization from single DTI
     virtual void SparseInitializeSticks(MCMPointer &complexModel, bool authorizeNegativeB0Value,
@@ -305,10 +333,15 @@ private:
 
     std::vector <MCMCreatorType *> m_MCMCreators;
 
+    //! Per thread cost functions and optimizers, created once and reused for all voxels and models of a run
+    std::vector <CostFunctionBasePointer> m_ThreadCostFunctions;
+    std::vector <OptimizerPointer> m_ThreadOptimizers;
+
     std::string m_Optimizer;
 
     //! Sparse dictionary for pre-, rough estimation of directions in sticks
     vnl_matrix <double> m_SparseSticksDictionary;
+    anima::DictionaryNNLSSolver m_SparseSticksSolver;
     unsigned int m_NumberOfDictionaryEntries;
     std::vector < std::vector <double> > m_DictionaryDirections;
 
@@ -316,6 +349,7 @@ private:
     unsigned int m_NumberOfImages;
 
     double m_AbsoluteCostChange;
+    unsigned int m_VoxelBatchSize;
     MaximumLikelihoodEstimationMode m_MLEstimationStrategy;
 
     bool m_ModelWithFreeWaterComponent, m_ModelWithStationaryWaterComponent, m_ModelWithRestrictedWaterComponent, m_ModelWithStaniszComponent;
@@ -338,6 +372,7 @@ private:
     bool m_UseConstrainedExtraAxonalFraction;
     bool m_UseCommonConcentrations;
     bool m_UseCommonExtraAxonalFractions;
+    bool m_UseNODDILookupTables;
 
     double m_AxialDiffusivityValue;
     double m_IRWDiffusivityValue;
@@ -40,6 +40,20 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
         m_GradientDirections[i] = grad;
 }
 
+template <class InputPixelType, class OutputPixelType>
+void
+MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
+::SetDictionaryAngularResolution(double angle)
+{
+    // Even sampling of the hemisphere (area 2 pi) with spacing angle between neighboring directions
+    double angleInRadians = angle * M_PI / 180.0;
+    if (angleInRadians <= 0)
+        itkExceptionMacro("Dictionary angular resolution should be positive");
+
+    unsigned int numEntries = std::max(1.0, std::round(2.0 * M_PI / (angleInRadians * angleInRadians)));
+    this->SetNumberOfDictionaryEntries(numEntries);
+}
+
 template <class InputPixelType, class OutputPixelType>
 typename MCMEstimatorImageFilter<InputPixelType, OutputPixelType>::MCMCreatorType *
 MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
@@ -208,6 +222,10 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
     for (unsigned int i = 0;i < this->GetNumberOfWorkUnits();++i)
         m_MCMCreators[i] = this->GetNewMCMCreatorInstance();
 
+    // Cost functions and optimizers are created on first use by each thread
+    m_ThreadCostFunctions.assign(this->GetNumberOfWorkUnits(),ITK_NULLPTR);
+    m_ThreadOptimizers.assign(this->GetNumberOfWorkUnits(),ITK_NULLPTR);
+
     std::cout << "Initial diffusivities:" << std::endl;
     std::cout << " - Axial diffusivity: " << m_AxialDiffusivityValue << " mm2/s," << std::endl;
     std::cout << " - Radial diffusivity 1: " << m_RadialDiffusivity1Value << " mm2/s," << std::endl;
@@ -228,6 +246,7 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
         m_MCMCreators[i]->SetStaniszDiffusivityValue(m_StaniszDiffusivityValue);
         m_MCMCreators[i]->SetRadialDiffusivity1Value(m_RadialDiffusivity1Value);
         m_MCMCreators[i]->SetRadialDiffusivity2Value(m_RadialDiffusivity2Value);
+        m_MCMCreators[i]->SetUseNODDILookupTables(m_UseNODDILookupTables);
     }
 
     // Switch over compartment types to setup coarse grid initialization
@@ -288,6 +307,10 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
     m_SparseSticksDictionary.fill(0.0);
 
     countIsoComps = 0;
+    anima::GradientSchemeSoA gradientScheme;
+    gradientScheme.SetGradientScheme(m_SmallDelta, m_BigDelta, m_GradientStrengths, m_GradientDirections);
+    std::vector <double> dictionarySignals(m_NumberOfImages);
+
     MCMPointer mcm;
     MCMCreatorType *mcmCreator = m_MCMCreators[0];
     mcmCreator->SetModelWithFreeWaterComponent(false);
@@ -302,8 +325,9 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
         mcm = mcmCreator->GetNewMultiCompartmentModel();
         mcmCreator->SetModelWithFreeWaterComponent(false);
 
+        mcm->GetPredictedSignals(gradientScheme, dictionarySignals);
         for (unsigned int i = 0;i < m_NumberOfImages;++i)
-            m_SparseSticksDictionary(i,countIsoComps) = mcm->GetPredictedSignal(m_SmallDelta, m_BigDelta, m_GradientStrengths[i], m_GradientDirections[i]);
+            m_SparseSticksDictionary(i,countIsoComps) = dictionarySignals[i];
 
         ++countIsoComps;
     }
@@ -314,8 +338,9 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
         mcm = mcmCreator->GetNewMultiCompartmentModel();
         mcmCreator->SetModelWithStationaryWaterComponent(false);
 
+        mcm->GetPredictedSignals(gradientScheme, dictionarySignals);
         for (unsigned int i = 0;i < m_NumberOfImages;++i)
-            m_SparseSticksDictionary(i,countIsoComps) = mcm->GetPredictedSignal(m_SmallDelta, m_BigDelta, m_GradientStrengths[i], m_GradientDirections[i]);
+            m_SparseSticksDictionary(i,countIsoComps) = dictionarySignals[i];
 
         ++countIsoComps;
     }
@@ -326,8 +351,9 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
         mcm = mcmCreator->GetNewMultiCompartmentModel();
         mcmCreator->SetModelWithRestrictedWaterComponent(false);
 
+        mcm->GetPredictedSignals(gradientScheme, dictionarySignals);
         for (unsigned int i = 0;i < m_NumberOfImages;++i)
-            m_SparseSticksDictionary(i,countIsoComps) = mcm->GetPredictedSignal(m_SmallDelta, m_BigDelta, m_GradientStrengths[i], m_GradientDirections[i]);
+            m_SparseSticksDictionary(i,countIsoComps) = dictionarySignals[i];
 
         ++countIsoComps;
     }
@@ -338,8 +364,9 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
         mcm = mcmCreator->GetNewMultiCompartmentModel();
         mcmCreator->SetModelWithStaniszComponent(false);
 
+        mcm->GetPredictedSignals(gradientScheme, dictionarySignals);
         for (unsigned int i = 0;i < m_NumberOfImages;++i)
-            m_SparseSticksDictionary(i,countIsoComps) = mcm->GetPredictedSignal(m_SmallDelta, m_BigDelta, m_GradientStrengths[i], m_GradientDirections[i]);
+            m_SparseSticksDictionary(i,countIsoComps) = dictionarySignals[i];
 
         ++countIsoComps;
     }
@@ -360,9 +387,14 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
         anima::TransformSphericalToCartesianCoordinates(m_DictionaryDirections[i + countIsoComps],
                 m_DictionaryDirections[i + countIsoComps]);
 
+        mcm->GetPredictedSignals(gradientScheme, dictionarySignals);
         for (unsigned int j = 0;j < m_NumberOfImages;++j)
-            m_SparseSticksDictionary(j,countIsoComps + i) = mcm->GetPredictedSignal(m_SmallDelta, m_BigDelta, m_GradientStrengths[j], m_GradientDirections[j]);
+            m_SparseSticksDictionary(j,countIsoComps + i) = dictionarySignals[j];
     }
+
+    // Gram matrix and per-thread NNLS optimizers, shared by all voxels
+    m_SparseSticksSolver.SetNumberOfThreads(this->GetNumberOfWorkUnits());
+    m_SparseSticksSolver.SetDictionary(m_SparseSticksDictionary);
 }
 
 template <class InputPixelType, class OutputPixelType>
@@ -426,70 +458,86 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
     for (unsigned int i = 0;i < m_NumberOfImages;++i)
         inIterators[i] = ConstImageIteratorType(this->GetInput(i),outputRegionForThread);
 
-    typedef itk::ImageRegionIterator <OutputImageType> OutImageIteratorType;
-    OutImageIteratorType outIterator(this->GetOutput(),outputRegionForThread);
-
     typedef itk::ImageRegionIterator <MaskImageType> MaskIteratorType;
     MaskIteratorType maskItr(this->GetComputationMask(),outputRegionForThread);
 
-    typedef itk::ImageRegionIterator <OutputScalarImageType> ImageIteratorType;
-    ImageIteratorType aiccIterator(m_AICcVolume, outputRegionForThread);
-    ImageIteratorType b0Iterator(m_B0Volume, outputRegionForThread);
-    ImageIteratorType sigmaIterator(m_SigmaSquareVolume, outputRegionForThread);
+    // Masked voxels signals are gathered in a contiguous matrix (one row per voxel), outside mask voxels
+    // keep the null values set in BeforeThreadedGenerateData
+    unsigned int batchSize = std::max(m_VoxelBatchSize,(unsigned int)1);
+    vnl_matrix <double> batchSignals(batchSize,m_NumberOfImages);
+    std::vector <InputIndexType> batchIndexes(batchSize);
+    unsigned int numBatchVoxels = 0;
 
-    typedef itk::ImageRegionIterator <MoseImageType> MoseIteratorType;
-    MoseIteratorType moseIterator(m_MoseVolume, outputRegionForThread);
+    unsigned int threadId = this->GetSafeThreadId();
 
-    std::vector <double> observedSignals(m_NumberOfImages,0);
+    while (!maskItr.IsAtEnd())
+    {
+        if (maskItr.Get() != 0)
+        {
+            double *voxelSignals = batchSignals[numBatchVoxels];
+            for (unsigned int i = 0;i < m_NumberOfImages;++i)
+                voxelSignals[i] = inIterators[i].Get();
 
-    typename OutputImageType::PixelType resVec(this->GetOutput()->GetNumberOfComponentsPerPixel());
+            batchIndexes[numBatchVoxels] = maskItr.GetIndex();
+            ++numBatchVoxels;
 
-    MCMPointer mcmData = ITK_NULLPTR;
-    MCMPointer outputMCMData = this->GetOutput()->GetDescriptionModel()->Clone();
-    MCMType::ListType outputWeights(outputMCMData->GetNumberOfCompartments(),0);
+            if (numBatchVoxels == batchSize)
+            {
+                this->EstimateVoxelBatch(batchSignals,batchIndexes,numBatchVoxels,threadId);
+                numBatchVoxels = 0;
+            }
+        }
 
-    double aiccValue, b0Value, sigmaSqValue;
+        for (unsigned int i = 0;i < m_NumberOfImages;++i)
+            ++inIterators[i];
 
-    unsigned int threadId = this->GetSafeThreadId();
+        ++maskItr;
+    }
 
-    while (!outIterator.IsAtEnd())
-    {
-        resVec.Fill(0.0);
+    if (numBatchVoxels > 0)
+        this->EstimateVoxelBatch(batchSignals,batchIndexes,numBatchVoxels,threadId);
 
-        //if ((maskItr.Get() == 0)||(maskItr.GetIndex()[0] != 61)||(maskItr.GetIndex()[1] != 102)||(maskItr.GetIndex()[2] != 53))
-        if (maskItr.Get() == 0)
-        {
-            outIterator.Set(resVec);
+    this->SafeReleaseThreadId(threadId);
+}
 
-            for (unsigned int i = 0;i < m_NumberOfImages;++i)
-                ++inIterators[i];
+template <class InputPixelType, class OutputPixelType>
+void
+MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
+::EstimateVoxelBatch(const vnl_matrix <double> &batchSignals, const std::vector <InputIndexType> &batchIndexes,
+                     unsigned int numVoxels, itk::ThreadIdType threadId)
+{
+    std::vector <double> observedSignals(m_NumberOfImages,0);
 
-            ++outIterator;
-            ++maskItr;
-            ++aiccIterator;
-            ++b0Iterator;
-            ++sigmaIterator;
-            ++moseIterator;
+    typename OutputImageType::PixelType resVec(this->GetOutput()->GetNumberOfComponentsPerPixel());
 
-            continue;
-        }
+    MCMPointer mcmData = ITK_NULLPTR;
+    MCMPointer outputMCMData = this->GetOutput()->GetDescriptionModel()->Clone();
+    MCMType::ListType outputWeights(outputMCMData->GetNumberOfCompartments(),0);
 
-        // Load DWI
+    bool hasIsoCompartment = m_ModelWithFreeWaterComponent || m_ModelWithRestrictedWaterComponent || m_ModelWithStationaryWaterComponent || m_ModelWithStaniszComponent;
+
+    for (unsigned int voxel = 0;voxel < numVoxels;++voxel)
+    {
+        const InputIndexType &index = batchIndexes[voxel];
+        const double *voxelSignals = batchSignals[voxel];
         for (unsigned int i = 0;i < m_NumberOfImages;++i)
-            observedSignals[i] = inIterators[i].Get();
+            observedSignals[i] = voxelSignals[i];
+
+        double aiccValue = std::numeric_limits <double>::max();
+        double b0Value = 0;
+        double sigmaSqValue = 1;
 
         int moseValue = -1;
         bool estimateNonIsoCompartments = false;
         if (m_ExternalMoseVolume)
         {
-            moseValue = moseIterator.Get();
+            moseValue = m_MoseVolume->GetPixel(index);
             if (moseValue > 0)
                 estimateNonIsoCompartments = true;
         }
         else if (m_NumberOfCompartments > 0)
             estimateNonIsoCompartments = true;
 
-        bool hasIsoCompartment = m_ModelWithFreeWaterComponent || m_ModelWithRestrictedWaterComponent || m_ModelWithStationaryWaterComponent || m_ModelWithStaniszComponent;
         if (estimateNonIsoCompartments)
         {
             // If model selection, handle it here
@@ -551,25 +599,14 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
         else
             resVec = mcmData->GetModelVector();
 
-        outIterator.Set(resVec);
-        aiccIterator.Set(aiccValue);
-        b0Iterator.Set(b0Value);
-        sigmaIterator.Set(sigmaSqValue);
-        moseIterator.Set(mcmData->GetNumberOfCompartments() - mcmData->GetNumberOfIsotropicCompartments());
-
-        for (unsigned int i = 0;i < m_NumberOfImages;++i)
-            ++inIterators[i];
+        this->GetOutput()->SetPixel(index,resVec);
+        m_AICcVolume->SetPixel(index,aiccValue);
+        m_B0Volume->SetPixel(index,b0Value);
+        m_SigmaSquareVolume->SetPixel(index,sigmaSqValue);
+        m_MoseVolume->SetPixel(index,mcmData->GetNumberOfCompartments() - mcmData->GetNumberOfIsotropicCompartments());
 
         this->IncrementNumberOfProcessedPoints();
-        ++outIterator;
-        ++maskItr;
-        ++aiccIterator;
-        ++b0Iterator;
-        ++sigmaIterator;
-        ++moseIterator;
     }
-
-    this->SafeReleaseThreadId(threadId);
 }
 
 template <class InputPixelType, class OutputPixelType>
@@ -631,7 +668,7 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
     b0Value = 0;
     sigmaSqValue = 1;
 
-    CostFunctionBasePointer cost = this->CreateCostFunction(observedSignals,mcmValue);
+    CostFunctionBasePointer cost = this->GetThreadCostFunction(observedSignals,mcmValue,threadId);
 
     unsigned int dimension = mcmValue->GetNumberOfParameters();
     ParametersType p(dimension);
@@ -654,7 +691,7 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
         for (unsigned int i = 0;i < dimension;++i)
             upperBounds[i] = workVec[i];
 
-        costValue = this->PerformSingleOptimization(p,cost,lowerBounds,upperBounds);
+        costValue = this->PerformSingleOptimization(p,cost,lowerBounds,upperBounds,threadId);
 
         // - Get estimated DTI and B0
         for (unsigned int i = 0;i < dimension;++i)
@@ -686,7 +723,7 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
             for (unsigned int i = 0;i < dimension;++i)
                 p[i] = workVec[i];
 
-            costValue = this->PerformSingleOptimization(p,cost,lowerBounds,upperBounds);
+            costValue = this->PerformSingleOptimization(p,cost,lowerBounds,upperBounds,threadId);
 
             // - Get estimated DTI and B0
             for (unsigned int i = 0;i < dimension;++i)
@@ -761,6 +798,39 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>::CreateCostFunction(std
     return returnCost;
 }
 
+template <class InputPixelType, class OutputPixelType>
+typename MCMEstimatorImageFilter<InputPixelType, OutputPixelType>::CostFunctionBasePointer &
+MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
+::GetThreadCostFunction(std::vector <double> &observedSignals, MCMPointer &mcmModel, itk::ThreadIdType threadId)
+{
+    CostFunctionBasePointer &cost = m_ThreadCostFunctions[threadId];
+    if (!cost)
+    {
+        cost = this->CreateCostFunction(observedSignals,mcmModel);
+        return cost;
+    }
+
+    // Internal costs recompute all their work data at each evaluation, only signals and model need to be updated
+    anima::BaseMCMCost *internalCost = ITK_NULLPTR;
+    if (m_Optimizer == "levenberg")
+    {
+        anima::MCMMultipleValuedCostFunction *costCast =
+                dynamic_cast <anima::MCMMultipleValuedCostFunction *> (cost.GetPointer());
+        internalCost = costCast->GetInternalCost();
+    }
+    else
+    {
+        anima::MCMSingleValuedCostFunction *costCast =
+                dynamic_cast <anima::MCMSingleValuedCostFunction *> (cost.GetPointer());
+        internalCost = costCast->GetInternalCost();
+    }
+
+    internalCost->SetObservedSignals(observedSignals);
+    internalCost->SetMCMStructure(mcmModel);
+
+    return cost;
+}
+
 template <class InputPixelType, class OutputPixelType>
 void
 MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
@@ -810,14 +880,14 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
     for (unsigned int j = 0;j < dimension;++j)
         upperBounds[j] = workVec[j];
 
-    CostFunctionBasePointer cost = this->CreateCostFunction(observedSignals,mcmUpdateValue);
+    CostFunctionBasePointer cost = this->GetThreadCostFunction(observedSignals,mcmUpdateValue,threadId);
 
     // - Update ball and stick model against observed signals
     workVec = mcmUpdateValue->GetParametersAsVector();
     for (unsigned int j = 0;j < dimension;++j)
         p[j] = workVec[j];
 
-    double costValue = this->PerformSingleOptimization(p,cost,lowerBounds,upperBounds);
+    double costValue = this->PerformSingleOptimization(p,cost,lowerBounds,upperBounds,threadId);
 
     // - Get estimated data
     for (unsigned int j = 0;j < dimension;++j)
@@ -855,7 +925,7 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
     // - Now the tricky part: initialize from previous model, handled somewhere else
     this->InitializeModelFromSimplifiedOne(mcmValue,mcmUpdateValue);
 
-    CostFunctionBasePointer cost = this->CreateCostFunction(observedSignals,mcmUpdateValue);
+    CostFunctionBasePointer cost = this->GetThreadCostFunction(observedSignals,mcmUpdateValue,threadId);
 
     unsigned int dimension = mcmUpdateValue->GetNumberOfParameters();
     ParametersType p(dimension);
@@ -874,7 +944,7 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
     for (unsigned int i = 0;i < dimension;++i)
         p[i] = workVec[i];
 
-    double costValue = this->PerformSingleOptimization(p,cost,lowerBounds,upperBounds);
+    double costValue = this->PerformSingleOptimization(p,cost,lowerBounds,upperBounds,threadId);
     this->GetProfiledInformation(cost,mcmUpdateValue,b0Value,sigmaSqValue);
 
     for (unsigned int i = 0;i < dimension;++i)
@@ -898,7 +968,7 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
     this->InitializeModelFromSimplifiedOne(mcmValue,mcmUpdateValue);
 
     // - Update ball and zeppelin model against observed signals
-    cost = this->CreateCostFunction(observedSignals,mcmUpdateValue);
+    cost = this->GetThreadCostFunction(observedSignals,mcmUpdateValue,threadId);
     dimension = mcmUpdateValue->GetNumberOfParameters();
     p.SetSize(dimension);
     lowerBounds.SetSize(dimension);
@@ -916,7 +986,7 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
     for (unsigned int i = 0;i < dimension;++i)
         p[i] = workVec[i];
 
-    costValue = this->PerformSingleOptimization(p,cost,lowerBounds,upperBounds);
+    costValue = this->PerformSingleOptimization(p,cost,lowerBounds,upperBounds,threadId);
     this->GetProfiledInformation(cost,mcmUpdateValue,b0Value,sigmaSqValue);
 
     for (unsigned int i = 0;i < dimension;++i)
@@ -945,7 +1015,7 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
     this->InitializeModelFromSimplifiedOne(mcmValue,mcmUpdateValue);
 
     // - Update complex model against observed signals
-    cost = this->CreateCostFunction(observedSignals,mcmUpdateValue);
+    cost = this->GetThreadCostFunction(observedSignals,mcmUpdateValue,threadId);
     dimension = mcmUpdateValue->GetNumberOfParameters();
     p.SetSize(dimension);
     lowerBounds.SetSize(dimension);
@@ -979,7 +1049,7 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
     for (unsigned int i = 0;i < dimension;++i)
         p[i] = workVec[i];
 
-    costValue = this->PerformSingleOptimization(p,cost,lowerBounds,upperBounds);
+    costValue = this->PerformSingleOptimization(p,cost,lowerBounds,upperBounds,threadId);
     this->GetProfiledInformation(cost,mcmUpdateValue,b0Value,sigmaSqValue);
 
     for (unsigned int i = 0;i < dimension;++i)
@@ -1146,6 +1216,44 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
 ::CreateOptimizer(CostFunctionBasePointer &cost, itk::Array<double> &lowerBounds, itk::Array<double> &upperBounds)
 {
     OptimizerPointer returnOpt;
+
+    if (m_Optimizer != "levenberg")
+    {
+        anima::NLOPTOptimizers::Pointer tmpOpt = anima::NLOPTOptimizers::New();
+
+        if (m_Optimizer == "bobyqa")
+            tmpOpt->SetAlgorithm(NLOPT_LN_BOBYQA);
+        else if (m_Optimizer == "ccsaq")
+            tmpOpt->SetAlgorithm(NLOPT_LD_CCSAQ);
+        else if (m_Optimizer == "bfgs")
+            tmpOpt->SetAlgorithm(NLOPT_LD_LBFGS);
+
+        tmpOpt->SetMaximize(false);
+        tmpOpt->SetVectorStorageSize(2000);
+
+        returnOpt = tmpOpt;
+    }
+    else
+    {
+        if (m_MLEstimationStrategy == Marginal)
+            itkExceptionMacro("Levenberg Marquardt optimizer not supported with marginal optimization");
+
+        typedef anima::BoundedLevenbergMarquardtOptimizer LevenbergMarquardtOptimizerType;
+        LevenbergMarquardtOptimizerType::Pointer tmpOpt = LevenbergMarquardtOptimizerType::New();
+
+        returnOpt = tmpOpt;
+    }
+
+    this->SetupOptimizer(returnOpt,cost,lowerBounds,upperBounds);
+
+    return returnOpt;
+}
+
+template <class InputPixelType, class OutputPixelType>
+void
+MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
+::SetupOptimizer(OptimizerPointer &optimizer, CostFunctionBasePointer &cost, itk::Array<double> &lowerBounds, itk::Array<double> &upperBounds)
+{
     double xTol = m_XTolerance;
     bool defaultTol = false;
     if (m_XTolerance == 0)
@@ -1154,47 +1262,38 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
         xTol = 1.0e-4;
     }
 
+    unsigned int dimension = lowerBounds.GetSize();
     unsigned int maxEvals = m_MaxEval;
     if (m_MaxEval == 0)
-        maxEvals = 400 * lowerBounds.GetSize();
+        maxEvals = 400 * dimension;
+
+    // Scales are set once by ITK on the first cost function, reset them for reused optimizers
+    OptimizerType::ScalesType scales(dimension);
+    scales.Fill(1.0);
+    optimizer->SetScales(scales);
 
     if (m_Optimizer != "levenberg")
     {
-        anima::NLOPTOptimizers::Pointer tmpOpt = anima::NLOPTOptimizers::New();
+        anima::NLOPTOptimizers *tmpOpt = dynamic_cast <anima::NLOPTOptimizers *> (optimizer.GetPointer());
 
-        if (m_Optimizer == "bobyqa")
-        {
-            tmpOpt->SetAlgorithm(NLOPT_LN_BOBYQA);
-            if (defaultTol)
-                xTol = 1.0e-7;
-        }
-        else if (m_Optimizer == "ccsaq")
-            tmpOpt->SetAlgorithm(NLOPT_LD_CCSAQ);
-        else if (m_Optimizer == "bfgs")
-            tmpOpt->SetAlgorithm(NLOPT_LD_LBFGS);
+        if ((m_Optimizer == "bobyqa") && defaultTol)
+            xTol = 1.0e-7;
 
         anima::MCMSingleValuedCostFunction *costCast =
                 dynamic_cast <anima::MCMSingleValuedCostFunction *> (cost.GetPointer());
         tmpOpt->SetCostFunction(costCast);
 
-        tmpOpt->SetMaximize(false);
         tmpOpt->SetXTolRel(xTol);
         tmpOpt->SetFTolRel(xTol * 1.0e-2);
         tmpOpt->SetMaxEval(maxEvals);
-        tmpOpt->SetVectorStorageSize(2000);
 
         tmpOpt->SetLowerBoundParameters(lowerBounds);
         tmpOpt->SetUpperBoundParameters(upperBounds);
-
-        returnOpt = tmpOpt;
     }
     else
     {
-        if (m_MLEstimationStrategy == Marginal)
-            itkExceptionMacro("Levenberg Marquardt optimizer not supported with marginal optimization");
-
         typedef anima::BoundedLevenbergMarquardtOptimizer LevenbergMarquardtOptimizerType;
-        LevenbergMarquardtOptimizerType::Pointer tmpOpt = LevenbergMarquardtOptimizerType::New();
+        LevenbergMarquardtOptimizerType *tmpOpt = dynamic_cast <LevenbergMarquardtOptimizerType *> (optimizer.GetPointer());
 
         anima::MCMMultipleValuedCostFunction *costCast =
                 dynamic_cast <anima::MCMMultipleValuedCostFunction *> (cost.GetPointer());
@@ -1203,6 +1302,7 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
         if (m_GTolerance == 0)
             gTol = 1.0e-5;
 
+        // Lambda is updated during optimization, it has to be set back for each run
         tmpOpt->SetCostFunction(costCast);
         tmpOpt->SetLambdaParameter(1.0e-11);
         tmpOpt->SetGradientTolerance(gTol);
@@ -1211,21 +1311,22 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
 
         tmpOpt->SetLowerBounds(lowerBounds);
         tmpOpt->SetUpperBounds(upperBounds);
-
-        returnOpt = tmpOpt;
     }
-
-    return returnOpt;
 }
 
 template <class InputPixelType, class OutputPixelType>
 double
 MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
-::PerformSingleOptimization(ParametersType &p, CostFunctionBasePointer &cost, itk::Array<double> &lowerBounds, itk::Array<double> &upperBounds)
+::PerformSingleOptimization(ParametersType &p, CostFunctionBasePointer &cost, itk::Array<double> &lowerBounds,
+                            itk::Array<double> &upperBounds, itk::ThreadIdType threadId)
 {
     double costValue = this->GetCostValue(cost,p);
 
-    OptimizerPointer optimizer = this->CreateOptimizer(cost,lowerBounds,upperBounds);
+    OptimizerPointer &optimizer = m_ThreadOptimizers[threadId];
+    if (!optimizer)
+        optimizer = this->CreateOptimizer(cost,lowerBounds,upperBounds);
+    else
+        this->SetupOptimizer(optimizer,cost,lowerBounds,upperBounds);
 
     optimizer->SetInitialPosition(p);
     optimizer->StartOptimization();
@@ -1327,25 +1428,13 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
     unsigned int numNonIsotropicComponents = complexModel->GetNumberOfCompartments() - numIsotropicComponents;
     unsigned int numCompartments = complexModel->GetNumberOfCompartments();
 
-    //First compute sparse solution as NNLS optmization
-    anima::NNLSOptimizer::Pointer sparseOptimizer = anima::NNLSOptimizer::New();
-    sparseOptimizer->SetDataMatrix(m_SparseSticksDictionary);
-
+    //First compute sparse solution as NNLS optmization (negated signals if negative B0 is authorized)
     unsigned int dictionarySize = m_SparseSticksDictionary.cols();
-    unsigned int numSignals = observedSignals.size();
-    ParametersType rightHandValues(numSignals);
-    for (unsigned int i = 0;i < numSignals;++i)
-        rightHandValues[i] = observedSignals[i];
-
-    if (authorizeNegativeB0Value)
-        rightHandValues *= -1;
-
-    sparseOptimizer->SetPoints(rightHandValues);
-    sparseOptimizer->SetSquaredProblem(false);
-    sparseOptimizer->StartOptimization();
+    ParametersType sparseSolution;
+    m_SparseSticksSolver.SolveProblem(observedSignals,authorizeNegativeB0Value,threadId,sparseSolution);
 
     // Get atom weights and determine the number of non null weighted components, first quartile of their weights
-    ParametersType dictionaryWeights = sparseOptimizer->GetCurrentPosition();
+    ParametersType dictionaryWeights = sparseSolution;
     std::vector <unsigned int> nonNullAtomIndexes;
 
     double totalWeightsSum = 0.0;
@@ -1377,7 +1466,7 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
 
     double thrWeight = dictionaryWeights[thrIndex];
     double maxDictionaryWeight = dictionaryWeights[dictionarySize - 1];
-    dictionaryWeights = sparseOptimizer->GetCurrentPosition();
+    dictionaryWeights = sparseSolution;
 
     for (unsigned int i = numIsotropicComponents;i < dictionarySize;++i)
     {
@@ -9,6 +9,9 @@
 #include <itkLinearInterpolateImageFunction.h>
 #include <mutex>
 #include <itkProgressReporter.h>
+#include <animaWorkStealingRangeScheduler.h>
+#include <animaFiberStreamingSink.h>
+#include <animaFiberLabelFilter.h>
 
 #include <vector>
 #include <random>
@@ -70,6 +73,7 @@ public:
         BaseProbabilisticTractographyImageFilter *trackerPtr;
         std::vector <FiberProcessVectorType> resultFibersFromThreads;
         std::vector <ListType> resultWeightsFromThreads;
+        std::vector <MembershipType> resultSeedIndexesFromThreads;
     } trackerArguments;
 
     struct pair_comparator
@@ -163,11 +167,27 @@ public:
     itkSetMacro(ModelDimension, unsigned int)
     itkGetMacro(ModelDimension, unsigned int)
 
+    //! Seed of per-seed random streams, fixing it makes results reproducible whatever the number of threads (default: current time)
+    void SetRandomSeed(unsigned int seed) {m_RandomSeed = seed; m_UseFixedRandomSeed = true;}
+    itkGetMacro(RandomSeed, unsigned int)
+
+    /**
+     * Restricts tracking to seeds [start, end[ of the seed list built from the seed mask (end = 0 meaning all remaining seeds).
+     * Random streams are keyed by global seed index, so that a job split in ranges gives the same fibers as the full job
+     */
+    void SetSeedRange(unsigned int start, unsigned int end) {m_SeedRangeStart = start; m_SeedRangeEnd = end;}
+
     void Update() ITK_OVERRIDE;
 
     void createVTKOutput(FiberProcessVectorType &filteredFibers, ListType &filteredWeights);
     vtkPolyData *GetOutput() {return m_Output;}
 
+    //! If set, fibers are handed to the sink while tracking instead of being gathered in the output (left empty)
+    void SetFiberSink(anima::FiberStreamingSink *sink) {m_FiberSink = sink;}
+
+    //! Scheduler of the last run, gives access to per-thread load balance statistics
+    const anima::WorkStealingRangeScheduler &GetSeedScheduler() {return m_SeedScheduler;}
+
 protected:
     BaseProbabilisticTractographyImageFilter();
     virtual ~BaseProbabilisticTractographyImageFilter();
@@ -176,12 +196,13 @@ protected:
     static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ThreadTracker(void *arg);
 
     //! Doing the thread work dispatch
-    void ThreadTrack(unsigned int numThread, FiberProcessVectorType &resultFibers, ListType &resultWeights);
+    void ThreadTrack(unsigned int numThread, FiberProcessVectorType &resultFibers, ListType &resultWeights,
+                     MembershipType &resultSeedIndexes);
 
     //! Doing the real tracking by calling ComputeFiber and merging its results
     void ThreadedTrackComputer(unsigned int numThread, FiberProcessVectorType &resultFibers,
-                               ListType &resultWeights, unsigned int startSeedIndex,
-                               unsigned int endSeedIndex);
+                               ListType &resultWeights, MembershipType &resultSeedIndexes,
+                               unsigned int startSeedIndex, unsigned int endSeedIndex);
 
     //! This little guy is the one handling probabilistic tracking
     FiberProcessVectorType ComputeFiber(FiberType &fiber, InterpolatorPointer &modelInterpolator,
@@ -211,7 +232,8 @@ protected:
                                           double &log_prior, double &log_proposal, unsigned int threadId) = 0;
 
     //! Estimate model from raw diffusion data (model dependent, not implemented here)
-    virtual void ComputeModelValue(InterpolatorPointer &modelInterpolator, ContinuousIndexType &index, VectorType &modelValue) = 0;
+    virtual void ComputeModelValue(InterpolatorPointer &modelInterpolator, ContinuousIndexType &index, VectorType &modelValue,
+                                   unsigned int threadId) = 0;
 
     //! Initialize first direction from user input (model dependent, not implemented here)
     virtual Vector3DType InitializeFirstIterationFromModel(Vector3DType &colinearDir, VectorType &modelValue, unsigned int threadId) = 0;
@@ -219,8 +241,8 @@ protected:
     //! Check stopping criterions to stop a particle (model dependent, not implemented here)
     virtual bool CheckModelProperties(double estimatedB0Value, double estimatedNoiseValue, VectorType &modelValue, unsigned int threadId) = 0;
 
-    //! Computes additional scalar maps that are model dependent to add to the output
-    virtual void ComputeAdditionalScalarMaps() {}
+    //! Computes additional scalar maps that are model dependent to add to the output fibers (whole output or streamed chunk)
+    virtual void ComputeAdditionalScalarMaps(vtkPolyData *outputPtr) {}
 
 private:
     ITK_DISALLOW_COPY_AND_ASSIGN(BaseProbabilisticTractographyImageFilter);
@@ -254,6 +276,12 @@ private:
     ScalarInterpolatorPointer m_B0Interpolator, m_NoiseInterpolator;
 
     std::vector <std::mt19937> m_Generators;
+    unsigned int m_RandomSeed;
+    bool m_UseFixedRandomSeed;
+
+    unsigned int m_SeedRangeStart, m_SeedRangeEnd;
+    //! Global index of the first seed of m_PointsToProcess
+    unsigned int m_FirstSeedIndex;
 
     ColinearityDirectionType m_InitialColinearityDirection;
     InitialDirectionModeType m_InitialDirectionMode;
@@ -261,6 +289,7 @@ private:
 
     FiberProcessVectorType m_PointsToProcess;
     MembershipType m_FilteringValues;
+    anima::FiberLabelFilter m_FiberLabelFilter;
 
     // Multimodal splitting and merging thresholds
     double m_PositionDistanceFuseThreshold;
@@ -272,9 +301,10 @@ private:
     bool m_ComputeLocalColors;
 
     vtkSmartPointer<vtkPolyData> m_Output;
+    anima::FiberStreamingSink *m_FiberSink;
 
-    std::mutex m_LockHighestProcessedSeed;
-    int m_HighestProcessedSeed;
+    anima::WorkStealingRangeScheduler m_SeedScheduler;
+    std::mutex m_LockProgressReport;
     itk::ProgressReporter *m_ProgressReport;
 };
 
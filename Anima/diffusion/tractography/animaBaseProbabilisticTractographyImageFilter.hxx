@@ -20,6 +20,7 @@
 #include <animaKMeansFilter.h>
 
 #include <ctime>
+#include <algorithm>
 
 namespace anima
 {
@@ -55,8 +56,14 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
     m_InitialDirectionMode = Weight;
 
     m_Generators.clear();
+    m_RandomSeed = 0;
+    m_UseFixedRandomSeed = false;
 
-    m_HighestProcessedSeed = 0;
+    m_SeedRangeStart = 0;
+    m_SeedRangeEnd = 0;
+    m_FirstSeedIndex = 0;
+
+    m_FiberSink = 0;
     m_ProgressReport = 0;
 }
 
@@ -79,15 +86,9 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
     if (m_ProgressReport)
         delete m_ProgressReport;
 
-    unsigned int stepData = std::min((int)m_PointsToProcess.size(),100);
-    if (stepData == 0)
-        stepData = 1;
-
-    unsigned int numSteps = std::floor(m_PointsToProcess.size() / (float)stepData);
-    if (m_PointsToProcess.size() % stepData != 0)
-        numSteps++;
-
-    m_ProgressReport = new itk::ProgressReporter(this,0,numSteps);
+    // Seeds are costly and uneven (particle filter), allow handing them out one by one
+    m_ProgressReport = new itk::ProgressReporter(this,0,m_PointsToProcess.size());
+    m_SeedScheduler.Initialize(m_PointsToProcess.size(),this->GetNumberOfWorkUnits(),1);
 
     FiberProcessVectorType resultFibers;
     ListType resultWeights;
@@ -96,21 +97,58 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
     tmpStr.trackerPtr = this;
     tmpStr.resultFibersFromThreads.resize(this->GetNumberOfWorkUnits());
     tmpStr.resultWeightsFromThreads.resize(this->GetNumberOfWorkUnits());
+    tmpStr.resultSeedIndexesFromThreads.resize(this->GetNumberOfWorkUnits());
 
     for (unsigned int i = 0;i < this->GetNumberOfWorkUnits();++i)
     {
         tmpStr.resultFibersFromThreads[i] = resultFibers;
         tmpStr.resultWeightsFromThreads[i] = resultWeights;
+        tmpStr.resultSeedIndexesFromThreads[i].clear();
+    }
+
+    if (m_FiberSink)
+    {
+        m_FiberSink->SetWriteWeights(true);
+        if (m_ComputeLocalColors)
+            m_FiberSink->SetChunkCallback([this] (vtkPolyData *chunk) {this->ComputeAdditionalScalarMaps(chunk);});
+        else
+            m_FiberSink->SetChunkCallback(anima::FiberStreamingSink::ChunkCallbackType());
+
+        m_FiberSink->Start();
     }
 
     this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
     this->GetMultiThreader()->SetSingleMethod(this->ThreadTracker,&tmpStr);
     this->GetMultiThreader()->SingleMethodExecute();
 
+    if (m_FiberSink)
+    {
+        m_FiberSink->Finish();
+        std::cout << "\nKept " << m_FiberSink->GetNumberOfWrittenFibers() << " fibers after filtering" << std::endl;
+        m_Output->Initialize();
+        return;
+    }
+
+    // Gather fibers in seed order, so that the output does not depend on the way seeds were shared between threads
+    // (fibers of a given seed all come from one thread, in their computation order)
+    typedef std::pair <unsigned int, std::pair <unsigned int, unsigned int> > FiberOrderType;
+    std::vector <FiberOrderType> fiberOrder;
     for (unsigned int j = 0;j < this->GetNumberOfWorkUnits();++j)
     {
-        resultFibers.insert(resultFibers.end(),tmpStr.resultFibersFromThreads[j].begin(),tmpStr.resultFibersFromThreads[j].end());
-        resultWeights.insert(resultWeights.end(),tmpStr.resultWeightsFromThreads[j].begin(),tmpStr.resultWeightsFromThreads[j].end());
+        for (unsigned int k = 0;k < tmpStr.resultSeedIndexesFromThreads[j].size();++k)
+            fiberOrder.push_back(std::make_pair(tmpStr.resultSeedIndexesFromThreads[j][k],std::make_pair(j,k)));
+    }
+
+    std::sort(fiberOrder.begin(),fiberOrder.end());
+
+    resultFibers.resize(fiberOrder.size());
+    resultWeights.resize(fiberOrder.size());
+    for (unsigned int i = 0;i < fiberOrder.size();++i)
+    {
+        unsigned int threadIndex = fiberOrder[i].second.first;
+        unsigned int fiberIndex = fiberOrder[i].second.second;
+        resultFibers[i].swap(tmpStr.resultFibersFromThreads[threadIndex][fiberIndex]);
+        resultWeights[i] = tmpStr.resultWeightsFromThreads[threadIndex][fiberIndex];
     }
 
     std::cout << "\nKept " << resultFibers.size() << " fibers after filtering" << std::endl;
@@ -134,13 +172,13 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
     m_NoiseInterpolator = ScalarInterpolatorType::New();
     m_NoiseInterpolator->SetInputImage(m_NoiseImage);
 
-    // Initialize random generator
+    // Initialize random generators, re-seeded for each seed point from the random seed and the seed index
     m_Generators.resize(this->GetNumberOfWorkUnits());
 
-    std::mt19937 motherGenerator(time(0));
+    if (!m_UseFixedRandomSeed)
+        m_RandomSeed = time(0);
 
-    for (unsigned int i = 0;i < this->GetNumberOfWorkUnits();++i)
-        m_Generators[i] = std::mt19937(motherGenerator());
+    std::cout << "Random seed: " << m_RandomSeed << std::endl;
 
     bool is2d = m_InputModelImage->GetLargestPossibleRegion().GetSize()[2] == 1;
     if (is2d && (m_InitialColinearityDirection == Top))
@@ -199,6 +237,11 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
         }
     }
 
+    m_FiberLabelFilter.SetLabelImage(m_FilterMask);
+    m_FiberLabelFilter.SetTouchLabels(m_FilteringValues);
+    m_FiberLabelFilter.SetForbiddenMask(m_ForbiddenMask);
+    m_FiberLabelFilter.Initialize();
+
     while (!maskItr.IsAtEnd())
     {
         if (maskItr.Get() == 0)
@@ -248,6 +291,20 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
     }
 
     std::cout << "Generated " << m_PointsToProcess.size() << " seed points from ROI mask" << std::endl;
+
+    unsigned int numSeeds = m_PointsToProcess.size();
+    unsigned int seedRangeEnd = m_SeedRangeEnd;
+    if ((seedRangeEnd == 0)||(seedRangeEnd > numSeeds))
+        seedRangeEnd = numSeeds;
+
+    m_FirstSeedIndex = std::min(m_SeedRangeStart, seedRangeEnd);
+    if ((m_FirstSeedIndex > 0)||(seedRangeEnd < numSeeds))
+    {
+        FiberProcessVectorType rangePoints(m_PointsToProcess.begin() + m_FirstSeedIndex, m_PointsToProcess.begin() + seedRangeEnd);
+        m_PointsToProcess.swap(rangePoints);
+
+        std::cout << "Tracking from seeds " << m_FirstSeedIndex << " to " << seedRangeEnd << " (excluded)" << std::endl;
+    }
 }
 
 template <class TInputModelImageType>
@@ -272,7 +329,8 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
     unsigned int nbThread = threadArgs->WorkUnitID;
 
     trackerArguments *tmpArg = (trackerArguments *)threadArgs->UserData;
-    tmpArg->trackerPtr->ThreadTrack(nbThread,tmpArg->resultFibersFromThreads[nbThread],tmpArg->resultWeightsFromThreads[nbThread]);
+    tmpArg->trackerPtr->ThreadTrack(nbThread,tmpArg->resultFibersFromThreads[nbThread],tmpArg->resultWeightsFromThreads[nbThread],
+                                    tmpArg->resultSeedIndexesFromThreads[nbThread]);
 
     return ITK_THREAD_RETURN_DEFAULT_VALUE;
 }
@@ -281,40 +339,17 @@ template <class TInputModelImageType>
 void
 BaseProbabilisticTractographyImageFilter <TInputModelImageType>
 ::ThreadTrack(unsigned int numThread, FiberProcessVectorType &resultFibers,
-              ListType &resultWeights)
+              ListType &resultWeights, MembershipType &resultSeedIndexes)
 {
-    bool continueLoop = true;
-    unsigned int highestToleratedSeedIndex = m_PointsToProcess.size();
-
-    unsigned int stepData = std::min((int)m_PointsToProcess.size(),100);
-    if (stepData == 0)
-        stepData = 1;
-
-    while (continueLoop)
+    unsigned int startPoint, endPoint;
+    while (m_SeedScheduler.GetNextChunk(numThread,startPoint,endPoint))
     {
-        m_LockHighestProcessedSeed.lock();
-
-        if (m_HighestProcessedSeed >= highestToleratedSeedIndex)
-        {
-            m_LockHighestProcessedSeed.unlock();
-            continueLoop = false;
-            continue;
-        }
-
-        unsigned int startPoint = m_HighestProcessedSeed;
-        unsigned int endPoint = m_HighestProcessedSeed + stepData;
-        if (endPoint > highestToleratedSeedIndex)
-            endPoint = highestToleratedSeedIndex;
+        this->ThreadedTrackComputer(numThread,resultFibers,resultWeights,resultSeedIndexes,startPoint,endPoint);
 
-        m_HighestProcessedSeed = endPoint;
-
-        m_LockHighestProcessedSeed.unlock();
-
-        this->ThreadedTrackComputer(numThread,resultFibers,resultWeights,startPoint,endPoint);
-
-        m_LockHighestProcessedSeed.lock();
-        m_ProgressReport->CompletedPixel();
-        m_LockHighestProcessedSeed.unlock();
+        m_LockProgressReport.lock();
+        for (unsigned int i = startPoint;i < endPoint;++i)
+            m_ProgressReport->CompletedPixel();
+        m_LockProgressReport.unlock();
     }
 }
 
@@ -322,8 +357,8 @@ template <class TInputModelImageType>
 void
 BaseProbabilisticTractographyImageFilter <TInputModelImageType>
 ::ThreadedTrackComputer(unsigned int numThread, FiberProcessVectorType &resultFibers,
-                        ListType &resultWeights, unsigned int startSeedIndex,
-                        unsigned int endSeedIndex)
+                        ListType &resultWeights, MembershipType &resultSeedIndexes,
+                        unsigned int startSeedIndex, unsigned int endSeedIndex)
 {
     InterpolatorPointer modelInterpolator = this->GetModelInterpolator();
     FiberProcessVectorType tmpFibers;
@@ -334,6 +369,11 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
     {
         m_SeedMask->TransformPhysicalPointToContinuousIndex(m_PointsToProcess[i][0],startIndex);
 
+        // Random stream keyed by random seed and global seed index, independent of threads and seed ranges
+        unsigned int seedIndex = m_FirstSeedIndex + i;
+        std::seed_seq seedSequence = {m_RandomSeed, seedIndex};
+        m_Generators[numThread].seed(seedSequence);
+
         tmpFibers = this->ComputeFiber(m_PointsToProcess[i], modelInterpolator, numThread, tmpWeights);
 
         tmpFibers = this->FilterOutputFibers(tmpFibers, tmpWeights);
@@ -342,8 +382,14 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
         {
             if (tmpFibers[j].size() > m_MinLengthFiber / m_StepProgression)
             {
-                resultFibers.push_back(tmpFibers[j]);
-                resultWeights.push_back(tmpWeights[j]);
+                if (m_FiberSink)
+                    m_FiberSink->PushFiber(tmpFibers[j],tmpWeights[j]);
+                else
+                {
+                    resultFibers.push_back(tmpFibers[j]);
+                    resultWeights.push_back(tmpWeights[j]);
+                    resultSeedIndexes.push_back(seedIndex);
+                }
             }
         }
     }
@@ -354,73 +400,25 @@ typename BaseProbabilisticTractographyImageFilter <TInputModelImageType>::FiberP
 BaseProbabilisticTractographyImageFilter <TInputModelImageType>
 ::FilterOutputFibers(FiberProcessVectorType &fibers, ListType &weights)
 {
+    if (m_FiberLabelFilter.IsEmpty())
+        return fibers;
+
     FiberProcessVectorType resVal;
     ListType tmpWeights = weights;
     weights.clear();
 
-    if ((m_FilteringValues.size() > 0)||(m_ForbiddenMask))
-    {
-        MembershipType touchingLabels;
-        IndexType tmpIndex;
-        PointType tmpPoint;
+    // Called from tracking threads on the fibers of one seed, no further threading here
+    std::vector <unsigned char> keptFibers;
+    m_FiberLabelFilter.ComputeKeptFibers(fibers,keptFibers,1);
 
-        for (unsigned int i = 0;i < fibers.size();++i)
+    for (unsigned int i = 0;i < fibers.size();++i)
+    {
+        if (keptFibers[i])
         {
-            touchingLabels.clear();
-            bool forbiddenTouched = false;
-
-            for (unsigned int j = 0;j < fibers[i].size();++j)
-            {
-                tmpPoint = fibers[i][j];
-                m_SeedMask->TransformPhysicalPointToIndex(tmpPoint,tmpIndex);
-
-                unsigned int maskValue = 0;
-                unsigned int forbiddenMaskValue = 0;
-
-                if (m_FilterMask)
-                    maskValue = m_FilterMask->GetPixel(tmpIndex);
-
-                if (m_ForbiddenMask)
-                    forbiddenMaskValue = m_ForbiddenMask->GetPixel(tmpIndex);
-
-                if (forbiddenMaskValue != 0)
-                {
-                    forbiddenTouched = true;
-                    break;
-                }
-
-                if (maskValue != 0)
-                {
-                    bool alreadyIn = false;
-                    for (unsigned int k = 0;k < touchingLabels.size();++k)
-                    {
-                        if (maskValue == touchingLabels[k])
-                        {
-                            alreadyIn = true;
-                            break;
-                        }
-                    }
-
-                    if (!alreadyIn)
-                        touchingLabels.push_back(maskValue);
-                }
-            }
-
-            if (forbiddenTouched)
-                continue;
-
-            if (touchingLabels.size() == m_FilteringValues.size())
-            {
-                resVal.push_back(fibers[i]);
-                weights.push_back(tmpWeights[i]);
-            }
+            resVal.push_back(fibers[i]);
+            weights.push_back(tmpWeights[i]);
         }
     }
-    else
-    {
-        resVal = fibers;
-        weights = tmpWeights;
-    }
 
     return resVal;
 }
@@ -456,7 +454,7 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
 
     m_Output->SetPoints(myPoints);
     if (m_ComputeLocalColors)
-        this->ComputeAdditionalScalarMaps();
+        this->ComputeAdditionalScalarMaps(m_Output);
 
     // Add particle weights to data
     m_Output->GetPointData()->AddArray(weights);
@@ -560,7 +558,7 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
             // Computes diffusion information at current position
             modelValue.Fill(0.0);
             double estimatedNoiseValue = 20.0;
-            this->ComputeModelValue(modelInterpolator, currentIndex, modelValue);
+            this->ComputeModelValue(modelInterpolator, currentIndex, modelValue, numThread);
             double estimatedB0Value = m_B0Interpolator->EvaluateAtContinuousIndex(currentIndex);
             estimatedNoiseValue = m_NoiseInterpolator->EvaluateAtContinuousIndex(currentIndex);
 
@@ -639,7 +637,7 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
 
             fiberComputationData.fiberParticles[i].push_back(currentPoint);
 
-            this->ComputeModelValue(modelInterpolator, newIndex, modelValue);
+            this->ComputeModelValue(modelInterpolator, newIndex, modelValue, numThread);
             estimatedB0Value = m_B0Interpolator->EvaluateAtContinuousIndex(newIndex);
             estimatedNoiseValue = m_NoiseInterpolator->EvaluateAtContinuousIndex(newIndex);
 
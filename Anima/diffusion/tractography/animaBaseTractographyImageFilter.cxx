@@ -22,7 +22,7 @@ BaseTractographyImageFilter::BaseTractographyImageFilter()
     m_MaxFiberAngle = M_PI / 2.0;
 
     m_ComputeLocalColors = true;
-    m_HighestProcessedSeed = 0;
+    m_FiberSink = ITK_NULLPTR;
     m_ProgressReport = ITK_NULLPTR;
 }
 
@@ -40,15 +40,8 @@ void BaseTractographyImageFilter::Update()
     if (m_ProgressReport)
         delete m_ProgressReport;
 
-    unsigned int stepData = std::min((int)m_PointsToProcess.size(),100);
-    if (stepData == 0)
-        stepData = 1;
-
-    unsigned int numSteps = std::floor(m_PointsToProcess.size() / (float)stepData);
-    if (m_PointsToProcess.size() % stepData != 0)
-        numSteps++;
-
-    m_ProgressReport = new itk::ProgressReporter(this,0,numSteps);
+    m_ProgressReport = new itk::ProgressReporter(this,0,m_PointsToProcess.size());
+    m_SeedScheduler.Initialize(m_PointsToProcess.size(),this->GetNumberOfWorkUnits(),10);
 
     std::vector < FiberType > resultFibers;
     
@@ -57,9 +50,28 @@ void BaseTractographyImageFilter::Update()
     for (unsigned int i = 0;i < this->GetNumberOfWorkUnits();++i)
         tmpStr.resultFibersFromThreads.push_back(resultFibers);
 
+    if (m_FiberSink)
+    {
+        m_FiberSink->SetWriteWeights(false);
+        if (m_ComputeLocalColors)
+            m_FiberSink->SetChunkCallback([this] (vtkPolyData *chunk) {this->ComputeAdditionalScalarMaps(chunk);});
+        else
+            m_FiberSink->SetChunkCallback(anima::FiberStreamingSink::ChunkCallbackType());
+
+        m_FiberSink->Start();
+    }
+
     this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
     this->GetMultiThreader()->SetSingleMethod(this->ThreadTracker,&tmpStr);
     this->GetMultiThreader()->SingleMethodExecute();
+
+    if (m_FiberSink)
+    {
+        m_FiberSink->Finish();
+        std::cout << "\nKept " << m_FiberSink->GetNumberOfWrittenFibers() << " fibers after filtering" << std::endl;
+        m_Output->Initialize();
+        return;
+    }
     
     for (unsigned int j = 0;j < this->GetNumberOfWorkUnits();++j)
     {
@@ -68,7 +80,7 @@ void BaseTractographyImageFilter::Update()
     }
     
     std::cout << "\nTracked a total of " << resultFibers.size() << " fibers" << std::endl;
-    resultFibers = this->FilterOutputFibers(resultFibers);
+    resultFibers = this->FilterOutputFibers(resultFibers,this->GetNumberOfWorkUnits());
     std::cout << "Kept " << resultFibers.size() << " fibers after filtering" << std::endl;
     this->createVTKOutput(resultFibers);
 }
@@ -166,6 +178,19 @@ void BaseTractographyImageFilter::PrepareTractography()
             ++filterItr;
         }
     }
+
+    // Fibers are filtered only when the filtering image holds several labels
+    std::vector <unsigned int> touchLabels;
+    if (m_FilteringValues.size() > 1)
+    {
+        touchLabels = m_FilteringValues;
+        m_FiberLabelFilter.SetLabelImage(m_FilteringImage);
+    }
+    else
+        m_FiberLabelFilter.SetLabelImage(ITK_NULLPTR);
+
+    m_FiberLabelFilter.SetTouchLabels(touchLabels);
+    m_FiberLabelFilter.Initialize();
     
     std::cout << "Generated " << m_PointsToProcess.size() << " seed points from ROI mask" << std::endl;
 }
@@ -183,38 +208,27 @@ ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION BaseTractographyImageFilter::ThreadTr
 
 void BaseTractographyImageFilter::ThreadTrack(unsigned int numThread, std::vector <FiberType> &resultFibers)
 {
-    bool continueLoop = true;
-    unsigned int highestToleratedSeedIndex = m_PointsToProcess.size();
-
-    unsigned int stepData = std::min((int)m_PointsToProcess.size(),100);
-    if (stepData == 0)
-        stepData = 1;
-
-    while (continueLoop)
+    unsigned int startPoint, endPoint;
+    std::vector <FiberType> chunkFibers;
+    while (m_SeedScheduler.GetNextChunk(numThread,startPoint,endPoint))
     {
-        m_LockHighestProcessedSeed.lock();
-
-        if (m_HighestProcessedSeed >= highestToleratedSeedIndex)
+        if (m_FiberSink)
         {
-            m_LockHighestProcessedSeed.unlock();
-            continueLoop = false;
-            continue;
-        }
-
-        unsigned int startPoint = m_HighestProcessedSeed;
-        unsigned int endPoint = m_HighestProcessedSeed + stepData;
-        if (endPoint > highestToleratedSeedIndex)
-            endPoint = highestToleratedSeedIndex;
-
-        m_HighestProcessedSeed = endPoint;
+            // Filtering is done per fiber, it can be done chunk by chunk before streaming
+            chunkFibers.clear();
+            this->ThreadedTrackComputer(numThread,chunkFibers,startPoint,endPoint);
+            chunkFibers = this->FilterOutputFibers(chunkFibers,1);
 
-        m_LockHighestProcessedSeed.unlock();
-
-        this->ThreadedTrackComputer(numThread,resultFibers,startPoint,endPoint);
+            for (unsigned int i = 0;i < chunkFibers.size();++i)
+                m_FiberSink->PushFiber(chunkFibers[i]);
+        }
+        else
+            this->ThreadedTrackComputer(numThread,resultFibers,startPoint,endPoint);
 
-        m_LockHighestProcessedSeed.lock();
-        m_ProgressReport->CompletedPixel();
-        m_LockHighestProcessedSeed.unlock();
+        m_LockProgressReport.lock();
+        for (unsigned int i = startPoint;i < endPoint;++i)
+            m_ProgressReport->CompletedPixel();
+        m_LockProgressReport.unlock();
     }
 }
 
@@ -233,53 +247,20 @@ void BaseTractographyImageFilter::ThreadedTrackComputer(unsigned int numThread,
 }
 
 std::vector < std::vector <BaseTractographyImageFilter::PointType> >
-BaseTractographyImageFilter::FilterOutputFibers(std::vector < FiberType > &fibers)
+BaseTractographyImageFilter::FilterOutputFibers(std::vector < FiberType > &fibers, unsigned int numThreads)
 {
+    if (m_FiberLabelFilter.IsEmpty())
+        return fibers;
+
+    std::vector <unsigned char> keptFibers;
+    m_FiberLabelFilter.ComputeKeptFibers(fibers,keptFibers,numThreads);
+
     std::vector < FiberType > resVal;
-    
-    if (m_FilteringValues.size() > 1)
+    for (unsigned int i = 0;i < fibers.size();++i)
     {
-        std::vector <bool> touchingLabels(m_FilteringValues.size());
-        IndexType tmpIndex;
-        PointType tmpPoint;
-        for (unsigned int i = 0;i < fibers.size();++i)
-        {
-            std::fill(touchingLabels.begin(),touchingLabels.end(),false);
-            for (unsigned int j = 0;j < fibers[i].size();++j)
-            {
-                tmpPoint = fibers[i][j];
-                m_FilteringImage->TransformPhysicalPointToIndex(tmpPoint,tmpIndex);
-                
-                unsigned int maskValue = m_FilteringImage->GetPixel(tmpIndex);
-                if (maskValue != 0)
-                {
-                    for (unsigned int k = 0;k < m_FilteringValues.size();++k)
-                    {
-                        if (maskValue == m_FilteringValues[k])
-                        {
-                            touchingLabels[k] = true;
-                            break;
-                        }
-                    }
-                }
-            }
-            
-            bool keepFiber = true;
-            for (unsigned int k = 0;k < touchingLabels.size();++k)
-            {
-                if (!touchingLabels[k])
-                {
-                    keepFiber = false;
-                    break;
-                }
-            }
-            
-            if (keepFiber)
-                resVal.push_back(fibers[i]);
-        }
+        if (keptFibers[i])
+            resVal.push_back(fibers[i]);
     }
-    else
-        resVal = fibers;
     
     return resVal;
 }
@@ -307,7 +288,7 @@ void BaseTractographyImageFilter::createVTKOutput(std::vector < FiberType > &fil
     if (m_ComputeLocalColors)
     {
         std::cout << "Computing local colors and microstructure maps" << std::endl;
-        this->ComputeAdditionalScalarMaps();
+        this->ComputeAdditionalScalarMaps(m_Output);
     }
 }
 
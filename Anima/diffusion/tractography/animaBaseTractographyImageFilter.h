@@ -9,6 +9,9 @@
 #include <itkProcessObject.h>
 #include <mutex>
 #include <itkProgressReporter.h>
+#include <animaWorkStealingRangeScheduler.h>
+#include <animaFiberStreamingSink.h>
+#include <animaFiberLabelFilter.h>
 
 #include "AnimaTractographyExport.h"
 
@@ -75,6 +78,12 @@ public:
     void SetComputeLocalColors(bool flag) {m_ComputeLocalColors = flag;}
     void createVTKOutput(std::vector < std::vector <PointType> > &filteredFibers);
     vtkPolyData *GetOutput() {return m_Output;}
+
+    //! If set, fibers are handed to the sink while tracking instead of being gathered in the output (left empty)
+    void SetFiberSink(anima::FiberStreamingSink *sink) {m_FiberSink = sink;}
+
+    //! Scheduler of the last run, gives access to per-thread load balance statistics
+    const anima::WorkStealingRangeScheduler &GetSeedScheduler() {return m_SeedScheduler;}
     
 protected:
     BaseTractographyImageFilter();
@@ -88,7 +97,8 @@ protected:
     FiberProcessVectorType ComputeFiber(FiberType &fiber, FiberProgressType ways, itk::ThreadIdType threadId);
     
     virtual void PrepareTractography();
-    std::vector < FiberType > FilterOutputFibers(std::vector < FiberType > &fibers);
+    //! Keeps fibers touching all filtering labels, testing them over numThreads threads
+    std::vector < FiberType > FilterOutputFibers(std::vector < FiberType > &fibers, unsigned int numThreads);
     
     virtual bool CheckModelCompatibility(VectorType &modelValue, itk::ThreadIdType threadId) = 0;
 
@@ -102,7 +112,8 @@ protected:
     virtual PointType GetModelPrincipalDirection(VectorType &modelValue, bool is2d, itk::ThreadIdType threadId) = 0;
     virtual PointType GetNextDirection(PointType &previousDirection, VectorType &modelValue, bool is2d, itk::ThreadIdType threadId) = 0;
 
-    virtual void ComputeAdditionalScalarMaps() {}
+    //! Computes additional scalar maps that are model dependent to add to the output fibers (whole output or streamed chunk)
+    virtual void ComputeAdditionalScalarMaps(vtkPolyData *outputPtr) {}
     bool isZero(VectorType &value);
     
 private:
@@ -121,12 +132,14 @@ private:
     
     FiberProcessVectorType m_PointsToProcess;
     std::vector <unsigned int> m_FilteringValues;
+    anima::FiberLabelFilter m_FiberLabelFilter;
     
     bool m_ComputeLocalColors;
     vtkSmartPointer<vtkPolyData> m_Output;
+    anima::FiberStreamingSink *m_FiberSink;
 
-    std::mutex m_LockHighestProcessedSeed;
-    int m_HighestProcessedSeed;
+    anima::WorkStealingRangeScheduler m_SeedScheduler;
+    std::mutex m_LockProgressReport;
     itk::ProgressReporter *m_ProgressReport;
 };
 
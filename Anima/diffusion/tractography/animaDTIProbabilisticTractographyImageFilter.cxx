@@ -289,7 +289,7 @@ void DTIProbabilisticTractographyImageFilter::GetDTIMinorDirection(VectorType &m
 }
 
 void DTIProbabilisticTractographyImageFilter::ComputeModelValue(InterpolatorPointer &modelInterpolator, ContinuousIndexType &index,
-                                                                VectorType &modelValue)
+                                                                VectorType &modelValue, unsigned int threadId)
 {
     modelValue.SetSize(this->GetModelDimension());
     modelValue.Fill(0.0);
@@ -400,10 +400,8 @@ void DTIProbabilisticTractographyImageFilter::GetEigenValueCombinations(VectorTy
     meanLambda /= 3.0;
 }
 
-void DTIProbabilisticTractographyImageFilter::ComputeAdditionalScalarMaps()
+void DTIProbabilisticTractographyImageFilter::ComputeAdditionalScalarMaps(vtkPolyData *outputPtr)
 {
-    vtkSmartPointer <vtkPolyData> outputPtr = this->GetOutput();
-
     InterpolatorPointer modelInterpolator = this->GetModelInterpolator();
 
     unsigned int numPoints = outputPtr->GetPoints()->GetNumberOfPoints();
@@ -434,7 +432,7 @@ void DTIProbabilisticTractographyImageFilter::ComputeAdditionalScalarMaps()
         this->GetInputModelImage()->TransformPhysicalPointToContinuousIndex(tmpPoint,tmpIndex);
         tensorValue.Fill(0.0);
         if (modelInterpolator->IsInsideBuffer(tmpIndex))
-            this->ComputeModelValue(modelInterpolator,tmpIndex,tensorValue);
+            this->ComputeModelValue(modelInterpolator,tmpIndex,tensorValue,0);
 
         anima::GetTensorFromVectorRepresentation(tensorValue,tmpMat,3,false);
 
@@ -43,7 +43,8 @@ protected:
     virtual double ComputeLogWeightUpdate(double b0Value, double noiseValue, Vector3DType &newDirection, VectorType &modelValue,
                                           double &log_prior, double &log_proposal, unsigned int threadId) ITK_OVERRIDE;
 
-    virtual void ComputeModelValue(InterpolatorPointer &modelInterpolator, ContinuousIndexType &index, VectorType &modelValue) ITK_OVERRIDE;
+    virtual void ComputeModelValue(InterpolatorPointer &modelInterpolator, ContinuousIndexType &index, VectorType &modelValue,
+                                   unsigned int threadId) ITK_OVERRIDE;
 
     virtual Vector3DType InitializeFirstIterationFromModel(Vector3DType &colinearDir,
                                                            VectorType &modelValue, unsigned int threadId) ITK_OVERRIDE;
@@ -54,7 +55,7 @@ protected:
     double GetFractionalAnisotropy(VectorType &modelValue);
     void GetEigenValueCombinations(VectorType &modelValue, double &meanLambda, double &perpLambda);
 
-    void ComputeAdditionalScalarMaps() ITK_OVERRIDE;
+    void ComputeAdditionalScalarMaps(vtkPolyData *outputPtr) ITK_OVERRIDE;
 
 private:
     ITK_DISALLOW_COPY_AND_ASSIGN(DTIProbabilisticTractographyImageFilter);
@@ -166,10 +166,8 @@ dtiTractographyImageFilter::GetNextDirection(PointType &previousDirection, Vecto
 }
 
 
-void dtiTractographyImageFilter::ComputeAdditionalScalarMaps()
+void dtiTractographyImageFilter::ComputeAdditionalScalarMaps(vtkPolyData *outputPtr)
 {
-    vtkSmartPointer <vtkPolyData> outputPtr = this->GetOutput();
-
     unsigned int numPoints = outputPtr->GetPoints()->GetNumberOfPoints();
     vtkPoints *myPoints = outputPtr->GetPoints();
 
@@ -51,7 +51,7 @@ protected:
     virtual PointType GetNextDirection(PointType &previousDirection, VectorType &modelValue, bool is2d,
                                        itk::ThreadIdType threadId) ITK_OVERRIDE;
 
-    virtual void ComputeAdditionalScalarMaps() ITK_OVERRIDE;
+    virtual void ComputeAdditionalScalarMaps(vtkPolyData *outputPtr) ITK_OVERRIDE;
 
 private:
     ITK_DISALLOW_COPY_AND_ASSIGN(dtiTractographyImageFilter);
@@ -0,0 +1,504 @@
+#include "animaFiberLabelFilter.h"
+
+#include <itkImageRegionConstIterator.h>
+#include <itkPoolMultiThreader.h>
+
+#include <vtkPoints.h>
+#include <vtkPointData.h>
+#include <vtkCellData.h>
+#include <vtkCellArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkGenericCell.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace anima
+{
+
+FiberLabelFilter::FiberLabelFilter()
+{
+    m_ReferenceImage = nullptr;
+    m_HasForbiddenVoxels = false;
+    m_NumberOfWords = 0;
+
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        m_RegionStart[i] = 0;
+        m_RegionSize[i] = 0;
+    }
+}
+
+void FiberLabelFilter::Initialize()
+{
+    m_VoxelCodes.clear();
+    m_ReferenceImage = m_LabelImage.GetPointer();
+    if (!m_ReferenceImage)
+        m_ReferenceImage = m_ForbiddenMask.GetPointer();
+
+    m_NumberOfWords = (m_TouchLabels.size() + 63) / 64;
+    m_HasForbiddenVoxels = false;
+
+    if (this->IsEmpty())
+        return;
+
+    if (!m_ReferenceImage)
+        throw itk::ExceptionObject(__FILE__, __LINE__, "No label image given for fiber filtering", ITK_LOCATION);
+
+    if (!m_LabelImage && (m_TouchLabels.size() + m_ForbiddenLabels.size() > 0))
+        throw itk::ExceptionObject(__FILE__, __LINE__, "Touch or forbidden labels given without label image", ITK_LOCATION);
+
+    LabelImageType::RegionType region = m_ReferenceImage->GetBufferedRegion();
+    if (m_LabelImage && m_ForbiddenMask && (m_ForbiddenMask->GetBufferedRegion() != region))
+        throw itk::ExceptionObject(__FILE__, __LINE__, "Label image and forbidden mask regions differ", ITK_LOCATION);
+
+    // Label to code table, forbidden labels taking precedence over touch labels
+    std::vector <unsigned short> labelCodes(std::numeric_limits <unsigned short>::max() + 1, 0);
+    for (unsigned int k = 0;k < m_TouchLabels.size();++k)
+    {
+        if (m_TouchLabels[k] < labelCodes.size())
+            labelCodes[m_TouchLabels[k]] = k + 2;
+    }
+
+    for (unsigned int k = 0;k < m_ForbiddenLabels.size();++k)
+    {
+        if (m_ForbiddenLabels[k] < labelCodes.size())
+            labelCodes[m_ForbiddenLabels[k]] = 1;
+    }
+
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        m_RegionStart[i] = region.GetIndex()[i];
+        m_RegionSize[i] = region.GetSize()[i];
+    }
+
+    m_VoxelCodes.resize(region.GetNumberOfPixels());
+
+    typedef itk::ImageRegionConstIterator <LabelImageType> IteratorType;
+    IteratorType labelItr, forbiddenItr;
+    if (m_LabelImage)
+        labelItr = IteratorType(m_LabelImage, region);
+    if (m_ForbiddenMask)
+        forbiddenItr = IteratorType(m_ForbiddenMask, region);
+
+    for (unsigned int i = 0;i < m_VoxelCodes.size();++i)
+    {
+        unsigned short code = 0;
+        if (m_LabelImage)
+        {
+            code = labelCodes[labelItr.Get()];
+            ++labelItr;
+        }
+
+        if (m_ForbiddenMask)
+        {
+            if (forbiddenItr.Get() != 0)
+                code = 1;
+            ++forbiddenItr;
+        }
+
+        if (code == 1)
+            m_HasForbiddenVoxels = true;
+
+        m_VoxelCodes[i] = code;
+    }
+}
+
+inline bool FiberLabelFilter::VisitVoxel(const int *voxel, BitsetType &workBits, unsigned int &numTouched) const
+{
+    unsigned int linearIndex = 0;
+    unsigned int offset = 1;
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        int localIndex = voxel[i] - m_RegionStart[i];
+        if ((localIndex < 0)||(localIndex >= m_RegionSize[i]))
+            return true;
+
+        linearIndex += localIndex * offset;
+        offset *= m_RegionSize[i];
+    }
+
+    unsigned short code = m_VoxelCodes[linearIndex];
+    if (code == 0)
+        return true;
+
+    if (code == 1)
+        return false;
+
+    unsigned int labelIndex = code - 2;
+    uint64_t labelBit = (uint64_t)1 << (labelIndex % 64);
+    uint64_t &word = workBits[labelIndex / 64];
+    if ((word & labelBit) == 0)
+    {
+        word |= labelBit;
+        ++numTouched;
+    }
+
+    return true;
+}
+
+template <class PointGetterType>
+bool FiberLabelFilter::CheckFiberVoxels(unsigned int numPoints, const PointGetterType &pointGetter, BitsetType &workBits) const
+{
+    workBits.resize(m_NumberOfWords);
+    std::fill(workBits.begin(),workBits.end(),0);
+
+    unsigned int numTouchLabels = m_TouchLabels.size();
+    unsigned int numTouched = 0;
+
+    if (numPoints == 0)
+        return (numTouchLabels == 0);
+
+    ContinuousIndexType previousIndex, currentIndex;
+    m_ReferenceImage->TransformPhysicalPointToContinuousIndex(pointGetter(0),previousIndex);
+
+    // Voxel containing a continuous index c is round(c), its faces lie at half integers
+    int voxel[3], endVoxel[3];
+    for (unsigned int i = 0;i < 3;++i)
+        voxel[i] = std::floor(previousIndex[i] + 0.5);
+
+    if (!this->VisitVoxel(voxel,workBits,numTouched))
+        return false;
+
+    double stepTime[3], nextCrossingTime[3];
+    int step[3];
+    for (unsigned int j = 1;j < numPoints;++j)
+    {
+        if ((!m_HasForbiddenVoxels)&&(numTouched == numTouchLabels))
+            return true;
+
+        m_ReferenceImage->TransformPhysicalPointToContinuousIndex(pointGetter(j),currentIndex);
+
+        // Segment traversal (Amanatides-Woo): starting from the voxel reached at the end of the previous segment,
+        // steps at each face crossing along the axis crossed first, until the voxel of the segment end
+        unsigned int numSteps = 0;
+        for (unsigned int i = 0;i < 3;++i)
+        {
+            endVoxel[i] = std::floor(currentIndex[i] + 0.5);
+            step[i] = 0;
+            nextCrossingTime[i] = std::numeric_limits <double>::max();
+            stepTime[i] = 0;
+
+            if (endVoxel[i] == voxel[i])
+                continue;
+
+            double direction = currentIndex[i] - previousIndex[i];
+            step[i] = (endVoxel[i] > voxel[i]) ? 1 : -1;
+            stepTime[i] = std::abs(1.0 / direction);
+            nextCrossingTime[i] = (voxel[i] + 0.5 * step[i] - previousIndex[i]) / direction;
+            numSteps += std::abs(endVoxel[i] - voxel[i]);
+        }
+
+        for (unsigned int k = 0;k < numSteps;++k)
+        {
+            unsigned int axis = 0;
+            double minTime = std::numeric_limits <double>::max();
+            for (unsigned int i = 0;i < 3;++i)
+            {
+                if ((voxel[i] != endVoxel[i])&&(nextCrossingTime[i] < minTime))
+                {
+                    minTime = nextCrossingTime[i];
+                    axis = i;
+                }
+            }
+
+            voxel[axis] += step[axis];
+            nextCrossingTime[axis] += stepTime[axis];
+
+            if (!this->VisitVoxel(voxel,workBits,numTouched))
+                return false;
+        }
+
+        previousIndex = currentIndex;
+    }
+
+    return (numTouched == numTouchLabels);
+}
+
+bool FiberLabelFilter::IsFiberKept(const FiberType &fiber, BitsetType &workBits) const
+{
+    if (m_VoxelCodes.empty())
+        return true;
+
+    auto pointGetter = [&fiber](unsigned int i) -> const PointType & {return fiber[i];};
+    return this->CheckFiberVoxels(fiber.size(),pointGetter,workBits);
+}
+
+bool FiberLabelFilter::IsFiberKept(vtkPolyData *tracks, vtkIdType numPoints, const vtkIdType *pointIds, BitsetType &workBits) const
+{
+    if (m_VoxelCodes.empty())
+        return true;
+
+    auto pointGetter = [tracks,pointIds](unsigned int i) -> PointType
+    {
+        double pointPositionVTK[3];
+        tracks->GetPoint(pointIds[i],pointPositionVTK);
+
+        PointType pointPosition;
+        for (unsigned int k = 0;k < 3;++k)
+            pointPosition[k] = pointPositionVTK[k];
+
+        return pointPosition;
+    };
+
+    return this->CheckFiberVoxels(numPoints,pointGetter,workBits);
+}
+
+void FiberLabelFilter::ComputeKeptFibers(const std::vector <FiberType> &fibers, std::vector <unsigned char> &keptFibers,
+                                         unsigned int numThreads)
+{
+    keptFibers.resize(fibers.size());
+
+    filterArguments arguments;
+    arguments.filterPtr = this;
+    arguments.pass = TestFibers;
+    arguments.fibers = &fibers;
+    arguments.keptFibers = &keptFibers;
+    arguments.inputTracks = nullptr;
+    arguments.outputTracks = nullptr;
+    arguments.outputCellsData = nullptr;
+
+    unsigned int numBlocks = (fibers.size() + BlockSize - 1) / BlockSize;
+    this->RunFilteringPass(arguments,numBlocks,numThreads);
+}
+
+vtkSmartPointer <vtkPolyData> FiberLabelFilter::FilterTracks(vtkPolyData *tracks, unsigned int numThreads)
+{
+    vtkSmartPointer <vtkPolyData> outputTracks = vtkSmartPointer <vtkPolyData>::New();
+    unsigned int numCells = tracks->GetNumberOfCells();
+
+    if (m_VoxelCodes.empty() || (numCells == 0))
+    {
+        outputTracks->ShallowCopy(tracks);
+        return outputTracks;
+    }
+
+    // Get dummy cell so that cells are built and cell access is thread safe
+    vtkSmartPointer <vtkGenericCell> dummyCell = vtkSmartPointer <vtkGenericCell>::New();
+    tracks->GetCell(0,dummyCell);
+
+    unsigned int numBlocks = (numCells + BlockSize - 1) / BlockSize;
+    m_KeptTracks.resize(numCells);
+    m_BlockKeptTracks.resize(numBlocks);
+    m_BlockKeptPoints.resize(numBlocks);
+
+    filterArguments arguments;
+    arguments.filterPtr = this;
+    arguments.pass = TestTracks;
+    arguments.fibers = nullptr;
+    arguments.keptFibers = &m_KeptTracks;
+    arguments.inputTracks = tracks;
+    arguments.outputTracks = outputTracks;
+    arguments.outputCellsData = nullptr;
+
+    this->RunFilteringPass(arguments,numBlocks,numThreads);
+
+    // Block write positions, keeping input order
+    m_BlockTracksOffsets.resize(numBlocks);
+    m_BlockPointsOffsets.resize(numBlocks);
+    vtkIdType numKeptTracks = 0;
+    vtkIdType numKeptPoints = 0;
+    for (unsigned int i = 0;i < numBlocks;++i)
+    {
+        m_BlockTracksOffsets[i] = numKeptTracks;
+        m_BlockPointsOffsets[i] = numKeptPoints;
+        numKeptTracks += m_BlockKeptTracks[i];
+        numKeptPoints += m_BlockKeptPoints[i];
+    }
+
+    // Output buffers are allocated once, blocks then write to disjoint parts of them
+    vtkSmartPointer <vtkPoints> outputPoints = vtkSmartPointer <vtkPoints>::New();
+    outputPoints->SetDataType(tracks->GetPoints()->GetDataType());
+    outputPoints->SetNumberOfPoints(numKeptPoints);
+    outputTracks->SetPoints(outputPoints);
+
+    vtkSmartPointer <vtkIdTypeArray> cellsData = vtkSmartPointer <vtkIdTypeArray>::New();
+    cellsData->SetNumberOfValues(numKeptTracks + numKeptPoints);
+
+    vtkPointData *inputPointData = tracks->GetPointData();
+    for (int i = 0;i < inputPointData->GetNumberOfArrays();++i)
+    {
+        vtkAbstractArray *inputArray = inputPointData->GetAbstractArray(i);
+        vtkSmartPointer <vtkAbstractArray> outputArray;
+        outputArray.TakeReference(inputArray->NewInstance());
+        outputArray->SetName(inputArray->GetName());
+        outputArray->SetNumberOfComponents(inputArray->GetNumberOfComponents());
+        outputArray->SetNumberOfTuples(numKeptPoints);
+        outputTracks->GetPointData()->AddArray(outputArray);
+    }
+
+    vtkCellData *inputCellData = tracks->GetCellData();
+    for (int i = 0;i < inputCellData->GetNumberOfArrays();++i)
+    {
+        vtkAbstractArray *inputArray = inputCellData->GetAbstractArray(i);
+        vtkSmartPointer <vtkAbstractArray> outputArray;
+        outputArray.TakeReference(inputArray->NewInstance());
+        outputArray->SetName(inputArray->GetName());
+        outputArray->SetNumberOfComponents(inputArray->GetNumberOfComponents());
+        outputArray->SetNumberOfTuples(numKeptTracks);
+        outputTracks->GetCellData()->AddArray(outputArray);
+    }
+
+    arguments.pass = CompactTracks;
+    arguments.outputCellsData = cellsData;
+    this->RunFilteringPass(arguments,numBlocks,numThreads);
+
+    vtkSmartPointer <vtkCellArray> outputCells = vtkSmartPointer <vtkCellArray>::New();
+    outputCells->SetCells(numKeptTracks,cellsData);
+    outputTracks->SetLines(outputCells);
+
+    return outputTracks;
+}
+
+void FiberLabelFilter::RunFilteringPass(filterArguments &arguments, unsigned int numBlocks, unsigned int numThreads)
+{
+    if (numBlocks == 0)
+        return;
+
+    if (numThreads <= 1)
+    {
+        BitsetType workBits;
+        vtkSmartPointer <vtkIdList> cellPointIds = vtkSmartPointer <vtkIdList>::New();
+        for (unsigned int i = 0;i < numBlocks;++i)
+            this->ProcessBlock(&arguments,i,workBits,cellPointIds);
+
+        return;
+    }
+
+    itk::PoolMultiThreader::Pointer threader = itk::PoolMultiThreader::New();
+    threader->SetNumberOfWorkUnits(numThreads);
+    m_BlockScheduler.Initialize(numBlocks,threader->GetNumberOfWorkUnits(),1);
+
+    threader->SetSingleMethod(this->ThreadFilterer,&arguments);
+    threader->SingleMethodExecute();
+}
+
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION FiberLabelFilter::ThreadFilterer(void *arg)
+{
+    itk::MultiThreaderBase::WorkUnitInfo *threadArgs = (itk::MultiThreaderBase::WorkUnitInfo *)arg;
+    unsigned int nbThread = threadArgs->WorkUnitID;
+
+    filterArguments *tmpArg = (filterArguments *)threadArgs->UserData;
+    FiberLabelFilter *filter = tmpArg->filterPtr;
+
+    BitsetType workBits;
+    vtkSmartPointer <vtkIdList> cellPointIds = vtkSmartPointer <vtkIdList>::New();
+
+    unsigned int startBlock, endBlock;
+    while (filter->m_BlockScheduler.GetNextChunk(nbThread,startBlock,endBlock))
+    {
+        for (unsigned int i = startBlock;i < endBlock;++i)
+            filter->ProcessBlock(tmpArg,i,workBits,cellPointIds);
+    }
+
+    return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+void FiberLabelFilter::ProcessBlock(filterArguments *arguments, unsigned int blockIndex, BitsetType &workBits,
+                                    vtkIdList *cellPointIds)
+{
+    switch (arguments->pass)
+    {
+        case TestFibers:
+        {
+            const std::vector <FiberType> &fibers = *(arguments->fibers);
+            std::vector <unsigned char> &keptFibers = *(arguments->keptFibers);
+
+            unsigned int endIndex = std::min((unsigned int)fibers.size(), (blockIndex + 1) * BlockSize);
+            for (unsigned int i = blockIndex * BlockSize;i < endIndex;++i)
+                keptFibers[i] = this->IsFiberKept(fibers[i],workBits);
+
+            break;
+        }
+
+        case TestTracks:
+            this->TestTracksBlock(arguments->inputTracks,blockIndex,workBits,cellPointIds);
+            break;
+
+        case CompactTracks:
+        default:
+            this->CompactTracksBlock(arguments->inputTracks,arguments->outputTracks,arguments->outputCellsData,
+                                     blockIndex,cellPointIds);
+            break;
+    }
+}
+
+void FiberLabelFilter::TestTracksBlock(vtkPolyData *tracks, unsigned int blockIndex, BitsetType &workBits, vtkIdList *cellPointIds)
+{
+    unsigned int endIndex = std::min((unsigned int)m_KeptTracks.size(), (blockIndex + 1) * BlockSize);
+    vtkIdType numKeptTracks = 0;
+    vtkIdType numKeptPoints = 0;
+
+    for (unsigned int i = blockIndex * BlockSize;i < endIndex;++i)
+    {
+        tracks->GetCellPoints(i,cellPointIds);
+        vtkIdType numCellPoints = cellPointIds->GetNumberOfIds();
+
+        bool keepTrack = this->IsFiberKept(tracks,numCellPoints,cellPointIds->GetPointer(0),workBits);
+        m_KeptTracks[i] = keepTrack;
+
+        if (keepTrack)
+        {
+            ++numKeptTracks;
+            numKeptPoints += numCellPoints;
+        }
+    }
+
+    m_BlockKeptTracks[blockIndex] = numKeptTracks;
+    m_BlockKeptPoints[blockIndex] = numKeptPoints;
+}
+
+void FiberLabelFilter::CompactTracksBlock(vtkPolyData *tracks, vtkPolyData *outputTracks, vtkIdTypeArray *outputCellsData,
+                                          unsigned int blockIndex, vtkIdList *cellPointIds)
+{
+    if (m_BlockKeptTracks[blockIndex] == 0)
+        return;
+
+    unsigned int endIndex = std::min((unsigned int)m_KeptTracks.size(), (blockIndex + 1) * BlockSize);
+    vtkIdType trackIndex = m_BlockTracksOffsets[blockIndex];
+    vtkIdType pointIndex = m_BlockPointsOffsets[blockIndex];
+
+    // Legacy cell array layout: number of points followed by point ids, for each cell
+    vtkIdType *cellsData = outputCellsData->GetPointer(0);
+    vtkIdType cellsDataIndex = trackIndex + pointIndex;
+
+    vtkPoints *outputPoints = outputTracks->GetPoints();
+    vtkPointData *inputPointData = tracks->GetPointData();
+    vtkPointData *outputPointData = outputTracks->GetPointData();
+    vtkCellData *inputCellData = tracks->GetCellData();
+    vtkCellData *outputCellData = outputTracks->GetCellData();
+
+    double pointPositionVTK[3];
+    for (unsigned int i = blockIndex * BlockSize;i < endIndex;++i)
+    {
+        if (!m_KeptTracks[i])
+            continue;
+
+        tracks->GetCellPoints(i,cellPointIds);
+        vtkIdType numCellPoints = cellPointIds->GetNumberOfIds();
+        cellsData[cellsDataIndex] = numCellPoints;
+        ++cellsDataIndex;
+
+        for (vtkIdType j = 0;j < numCellPoints;++j)
+        {
+            vtkIdType inputPointIndex = cellPointIds->GetId(j);
+            tracks->GetPoint(inputPointIndex,pointPositionVTK);
+            outputPoints->SetPoint(pointIndex,pointPositionVTK);
+
+            for (int k = 0;k < inputPointData->GetNumberOfArrays();++k)
+                outputPointData->GetAbstractArray(k)->SetTuple(pointIndex,inputPointIndex,inputPointData->GetAbstractArray(k));
+
+            cellsData[cellsDataIndex] = pointIndex;
+            ++cellsDataIndex;
+            ++pointIndex;
+        }
+
+        for (int k = 0;k < inputCellData->GetNumberOfArrays();++k)
+            outputCellData->GetAbstractArray(k)->SetTuple(trackIndex,i,inputCellData->GetAbstractArray(k));
+
+        ++trackIndex;
+    }
+}
+
+} // end of namespace anima
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <itkImage.h>
+#include <itkMultiThreaderBase.h>
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+#include <vtkIdList.h>
+#include <vtkIdTypeArray.h>
+
+#include <animaWorkStealingRangeScheduler.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "AnimaTractographyExport.h"
+
+namespace anima
+{
+
+/**
+ * @brief Label based fiber filtering: a fiber is kept if it goes through all touch labels and through no forbidden label
+ * (or non null voxel of the forbidden mask). Labels are first turned into a compact code per voxel (0: nothing, 1: forbidden,
+ * k + 2: k-th touch label). Fibers are then walked segment by segment through the voxels they cross (3D DDA), each voxel
+ * being looked at once, and touched labels are accumulated in a bitset.
+ * Label image and forbidden mask, when both given, must lie on the same grid.
+ */
+class ANIMATRACTOGRAPHY_EXPORT FiberLabelFilter
+{
+public:
+    typedef itk::Image <unsigned short, 3> LabelImageType;
+    typedef LabelImageType::Pointer LabelImagePointer;
+    typedef LabelImageType::PointType PointType;
+    typedef itk::ContinuousIndex <double, 3> ContinuousIndexType;
+    typedef std::vector <PointType> FiberType;
+    typedef std::vector <uint64_t> BitsetType;
+
+    FiberLabelFilter();
+
+    void SetLabelImage(LabelImageType *image) {m_LabelImage = image;}
+    void SetForbiddenMask(LabelImageType *image) {m_ForbiddenMask = image;}
+
+    void SetTouchLabels(const std::vector <unsigned int> &labels) {m_TouchLabels = labels;}
+    void SetForbiddenLabels(const std::vector <unsigned int> &labels) {m_ForbiddenLabels = labels;}
+
+    //! Builds voxel codes, to be called once labels and images are set
+    void Initialize();
+
+    //! True if nothing would be filtered out
+    bool IsEmpty() const {return m_TouchLabels.empty() && m_ForbiddenLabels.empty() && m_ForbiddenMask.IsNull();}
+
+    //! Tests a fiber, workBits is a work buffer that may be reused from one call to the other (one per thread)
+    bool IsFiberKept(const FiberType &fiber, BitsetType &workBits) const;
+
+    //! Tests a fiber given as point ids of a poly data
+    bool IsFiberKept(vtkPolyData *tracks, vtkIdType numPoints, const vtkIdType *pointIds, BitsetType &workBits) const;
+
+    //! Tests all fibers over numThreads threads (serially if numThreads is 1), keptFibers[i] is non zero if fiber i is kept
+    void ComputeKeptFibers(const std::vector <FiberType> &fibers, std::vector <unsigned char> &keptFibers, unsigned int numThreads);
+
+    /**
+     * Filters all cells of tracks over numThreads threads. Kept cells are compacted without locks (per block counts, then
+     * prefix sums giving write positions) in a new poly data holding their points and point data arrays, in input order
+     */
+    vtkSmartPointer <vtkPolyData> FilterTracks(vtkPolyData *tracks, unsigned int numThreads);
+
+private:
+    typedef enum {
+        TestFibers = 0,
+        TestTracks,
+        CompactTracks
+    } FilteringPassType;
+
+    typedef struct {
+        FiberLabelFilter *filterPtr;
+        FilteringPassType pass;
+        const std::vector <FiberType> *fibers;
+        std::vector <unsigned char> *keptFibers;
+        vtkPolyData *inputTracks;
+        vtkPolyData *outputTracks;
+        vtkIdTypeArray *outputCellsData;
+    } filterArguments;
+
+    //! Runs pass over all blocks with the work stealing scheduler
+    void RunFilteringPass(filterArguments &arguments, unsigned int numBlocks, unsigned int numThreads);
+    static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ThreadFilterer(void *arg);
+    void ProcessBlock(filterArguments *arguments, unsigned int blockIndex, BitsetType &workBits, vtkIdList *cellPointIds);
+
+    void TestTracksBlock(vtkPolyData *tracks, unsigned int blockIndex, BitsetType &workBits, vtkIdList *cellPointIds);
+    void CompactTracksBlock(vtkPolyData *tracks, vtkPolyData *outputTracks, vtkIdTypeArray *outputCellsData,
+                            unsigned int blockIndex, vtkIdList *cellPointIds);
+
+    //! Walks the fiber (numPoints points given by pointGetter) through voxels
+    template <class PointGetterType> bool CheckFiberVoxels(unsigned int numPoints, const PointGetterType &pointGetter,
+                                                           BitsetType &workBits) const;
+
+    //! Accumulates voxel code into touched bits, returns false if voxel is forbidden
+    inline bool VisitVoxel(const int *voxel, BitsetType &workBits, unsigned int &numTouched) const;
+
+    LabelImagePointer m_LabelImage;
+    LabelImagePointer m_ForbiddenMask;
+    LabelImageType *m_ReferenceImage;
+
+    std::vector <unsigned int> m_TouchLabels;
+    std::vector <unsigned int> m_ForbiddenLabels;
+
+    std::vector <unsigned short> m_VoxelCodes;
+    bool m_HasForbiddenVoxels;
+    int m_RegionStart[3];
+    int m_RegionSize[3];
+    unsigned int m_NumberOfWords;
+
+    // Block data for threaded filtering: kept flags, kept counts and write offsets per block
+    static const unsigned int BlockSize = 1024;
+    anima::WorkStealingRangeScheduler m_BlockScheduler;
+    std::vector <unsigned char> m_KeptTracks;
+    std::vector <vtkIdType> m_BlockKeptTracks, m_BlockKeptPoints;
+    std::vector <vtkIdType> m_BlockTracksOffsets, m_BlockPointsOffsets;
+};
+
+} // end of namespace anima
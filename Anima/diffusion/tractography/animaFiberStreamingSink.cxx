@@ -0,0 +1,197 @@
+#include "animaFiberStreamingSink.h"
+
+#include <itkMacro.h>
+
+#include <algorithm>
+
+#include <vtkSmartPointer.h>
+#include <vtkPoints.h>
+#include <vtkDoubleArray.h>
+#include <vtkPointData.h>
+
+namespace anima
+{
+
+FiberStreamingSink::FiberStreamingSink()
+{
+    m_FileName = "";
+    m_MaximalQueueSize = 50000;
+    m_ChunkSize = 10000;
+    m_WriteWeights = false;
+
+    m_Running = false;
+    m_StopRequested = false;
+    m_WriterFailed = false;
+
+    m_NumberOfWrittenFibers = 0;
+}
+
+FiberStreamingSink::~FiberStreamingSink()
+{
+    if (!m_Running)
+        return;
+
+    {
+        std::lock_guard <std::mutex> lock(m_QueueLock);
+        m_StopRequested = true;
+    }
+
+    m_QueueNotEmpty.notify_all();
+    m_WriterThread.join();
+
+    // Finish was not called (e.g. tracking failed), output is incomplete
+    m_Writer.Abort();
+}
+
+void FiberStreamingSink::Start()
+{
+    if (m_Running)
+        throw itk::ExceptionObject(__FILE__, __LINE__, "Fiber streaming sink already started", ITK_LOCATION);
+
+    // The writer waits for full chunks, a chunk has to fit in the queue
+    if (m_ChunkSize > m_MaximalQueueSize)
+        m_ChunkSize = m_MaximalQueueSize;
+
+    if (m_ChunkSize == 0)
+        throw itk::ExceptionObject(__FILE__, __LINE__, "Fiber streaming sink chunk size should be positive", ITK_LOCATION);
+
+    m_Writer.SetFileName(m_FileName);
+    m_Writer.Open();
+
+    m_FiberQueue.clear();
+    m_WeightQueue.clear();
+    m_StopRequested = false;
+    m_WriterFailed = false;
+    m_WriterError = std::exception_ptr();
+    m_NumberOfWrittenFibers = 0;
+
+    m_Running = true;
+    m_WriterThread = std::thread(&FiberStreamingSink::WriterLoop, this);
+}
+
+void FiberStreamingSink::PushFiber(const FiberType &fiber, double weight)
+{
+    std::unique_lock <std::mutex> lock(m_QueueLock);
+    m_QueueNotFull.wait(lock, [this] {return m_WriterFailed || (m_FiberQueue.size() < m_MaximalQueueSize);});
+
+    // Error is reported by Finish
+    if (m_WriterFailed)
+        return;
+
+    m_FiberQueue.push_back(fiber);
+    m_WeightQueue.push_back(weight);
+
+    bool chunkReady = (m_FiberQueue.size() >= m_ChunkSize);
+    lock.unlock();
+
+    if (chunkReady)
+        m_QueueNotEmpty.notify_one();
+}
+
+void FiberStreamingSink::Finish()
+{
+    if (!m_Running)
+        return;
+
+    {
+        std::lock_guard <std::mutex> lock(m_QueueLock);
+        m_StopRequested = true;
+    }
+
+    m_QueueNotEmpty.notify_all();
+    m_WriterThread.join();
+    m_Running = false;
+
+    if (m_WriterFailed)
+    {
+        m_Writer.Abort();
+        std::rethrow_exception(m_WriterError);
+    }
+
+    m_Writer.Close();
+}
+
+void FiberStreamingSink::WriterLoop()
+{
+    std::vector <FiberType> chunkFibers;
+    std::vector <double> chunkWeights;
+
+    try
+    {
+        while (true)
+        {
+            std::unique_lock <std::mutex> lock(m_QueueLock);
+            m_QueueNotEmpty.wait(lock, [this] {return m_StopRequested || (m_FiberQueue.size() >= m_ChunkSize);});
+
+            // Stop requested and everything written
+            if (m_FiberQueue.empty())
+                break;
+
+            unsigned int chunkSize = std::min((unsigned int)m_FiberQueue.size(), m_ChunkSize);
+            chunkFibers.resize(chunkSize);
+            chunkWeights.resize(chunkSize);
+            for (unsigned int i = 0;i < chunkSize;++i)
+            {
+                chunkFibers[i].swap(m_FiberQueue.front());
+                chunkWeights[i] = m_WeightQueue.front();
+                m_FiberQueue.pop_front();
+                m_WeightQueue.pop_front();
+            }
+
+            lock.unlock();
+            m_QueueNotFull.notify_all();
+
+            this->WriteChunk(chunkFibers, chunkWeights);
+        }
+    }
+    catch (...)
+    {
+        std::lock_guard <std::mutex> lock(m_QueueLock);
+        m_WriterError = std::current_exception();
+        m_WriterFailed = true;
+        m_FiberQueue.clear();
+        m_WeightQueue.clear();
+    }
+
+    m_QueueNotFull.notify_all();
+}
+
+void FiberStreamingSink::WriteChunk(std::vector <FiberType> &fibers, std::vector <double> &weights)
+{
+    vtkSmartPointer <vtkPolyData> chunk = vtkSmartPointer <vtkPolyData>::New();
+    chunk->Initialize();
+    chunk->Allocate();
+
+    vtkSmartPointer <vtkPoints> chunkPoints = vtkSmartPointer <vtkPoints>::New();
+    vtkSmartPointer <vtkDoubleArray> weightsArray = vtkSmartPointer <vtkDoubleArray>::New();
+    weightsArray->SetNumberOfComponents(1);
+    weightsArray->SetName("Fiber weights");
+
+    std::vector <vtkIdType> ids;
+    for (unsigned int i = 0;i < fibers.size();++i)
+    {
+        unsigned int npts = fibers[i].size();
+        ids.resize(npts);
+
+        for (unsigned int j = 0;j < npts;++j)
+        {
+            ids[j] = chunkPoints->InsertNextPoint(fibers[i][j][0],fibers[i][j][1],fibers[i][j][2]);
+            if (m_WriteWeights)
+                weightsArray->InsertNextValue(weights[i]);
+        }
+
+        chunk->InsertNextCell(VTK_POLY_LINE, npts, ids.data());
+    }
+
+    chunk->SetPoints(chunkPoints);
+    if (m_ChunkCallback)
+        m_ChunkCallback(chunk);
+
+    if (m_WriteWeights)
+        chunk->GetPointData()->AddArray(weightsArray);
+
+    m_Writer.WriteChunk(chunk);
+    m_NumberOfWrittenFibers += fibers.size();
+}
+
+} // end of namespace anima
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <itkPoint.h>
+#include <vtkPolyData.h>
+
+#include <animaShapesStreamWriter.h>
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AnimaTractographyExport.h"
+
+namespace anima
+{
+
+/**
+ * @brief Streaming output of tractography fibers. Tracking threads push finished fibers into a bounded queue, a writer thread
+ * drains it by chunks: each chunk is turned into a small vtkPolyData, completed by an optional callback (e.g. local colors and
+ * microstructure maps) and appended to the output file through ShapesStreamWriter. Pushing threads wait when the queue is full,
+ * so that memory use stays bounded whatever the number of fibers.
+ */
+class ANIMATRACTOGRAPHY_EXPORT FiberStreamingSink
+{
+public:
+    typedef itk::Point <double, 3> PointType;
+    typedef std::vector <PointType> FiberType;
+    typedef std::function <void (vtkPolyData *)> ChunkCallbackType;
+
+    FiberStreamingSink();
+
+    //! Stops writer thread if still running, the output is then aborted since Finish was not called
+    ~FiberStreamingSink();
+
+    void SetFileName(const std::string &name) {m_FileName = name;}
+
+    //! Maximal number of fibers waiting for the writer thread
+    void SetMaximalQueueSize(unsigned int num) {m_MaximalQueueSize = num;}
+
+    //! Number of fibers per written chunk
+    void SetChunkSize(unsigned int num) {m_ChunkSize = num;}
+
+    //! If true, fiber weights are written as a "Fiber weights" point array
+    void SetWriteWeights(bool val) {m_WriteWeights = val;}
+
+    //! Called by the writer thread on each chunk before writing it
+    void SetChunkCallback(const ChunkCallbackType &callback) {m_ChunkCallback = callback;}
+
+    //! Opens output and starts writer thread
+    void Start();
+
+    //! Adds a fiber to the queue (thread safe), waits while the queue is full
+    void PushFiber(const FiberType &fiber, double weight = 1.0);
+
+    //! Writes remaining fibers, stops writer thread and closes output. Writer thread errors are rethrown after aborting the output
+    void Finish();
+
+    unsigned int GetNumberOfWrittenFibers() {return m_NumberOfWrittenFibers;}
+
+private:
+    void WriterLoop();
+    void WriteChunk(std::vector <FiberType> &fibers, std::vector <double> &weights);
+
+    std::string m_FileName;
+    unsigned int m_MaximalQueueSize;
+    unsigned int m_ChunkSize;
+    bool m_WriteWeights;
+    ChunkCallbackType m_ChunkCallback;
+
+    anima::ShapesStreamWriter m_Writer;
+    std::thread m_WriterThread;
+
+    std::mutex m_QueueLock;
+    std::condition_variable m_QueueNotFull, m_QueueNotEmpty;
+    std::deque <FiberType> m_FiberQueue;
+    std::deque <double> m_WeightQueue;
+
+    bool m_Running;
+    bool m_StopRequested;
+    bool m_WriterFailed;
+    std::exception_ptr m_WriterError;
+
+    unsigned int m_NumberOfWrittenFibers;
+};
+
+} // end of namespace anima
@@ -25,6 +25,10 @@ ODFProbabilisticTractographyImageFilter::ODFProbabilisticTractographyImageFilter
 
     m_ODFSHBasis = NULL;
 
+    m_UsePrecomputedMaxima = false;
+    m_ExactSearchInAmbiguousVoxels = true;
+    m_MaximaAmbiguityAngle = 15.0;
+
     this->SetModelDimension(15);
 }
 
@@ -47,6 +51,195 @@ void ODFProbabilisticTractographyImageFilter::PrepareTractography()
         delete m_ODFSHBasis;
 
     m_ODFSHBasis = new anima::ODFSphericalHarmonicBasis(m_ODFSHOrder);
+
+    m_CurrentVoxelIndexes.resize(this->GetNumberOfWorkUnits());
+    m_ODFMaximaImage = NULL;
+
+    if (m_UsePrecomputedMaxima)
+        this->ComputeODFMaximaImage();
+}
+
+void ODFProbabilisticTractographyImageFilter::ComputeODFMaximaImage()
+{
+    InputModelImageType *inputImage = this->GetInputModelImage();
+
+    m_ODFMaximaImage = MaximaImageType::New();
+    m_ODFMaximaImage->Initialize();
+    m_ODFMaximaImage->SetRegions(inputImage->GetLargestPossibleRegion());
+    m_ODFMaximaImage->SetSpacing(inputImage->GetSpacing());
+    m_ODFMaximaImage->SetOrigin(inputImage->GetOrigin());
+    m_ODFMaximaImage->SetDirection(inputImage->GetDirection());
+    m_ODFMaximaImage->SetNumberOfComponentsPerPixel(2 + MaximalNumberOfStoredMaxima * MaximaImageComponentsPerMaximum);
+    m_ODFMaximaImage->Allocate();
+
+    MaximaImageType::PixelType zeroPixel(m_ODFMaximaImage->GetNumberOfComponentsPerPixel());
+    zeroPixel.Fill(0.0);
+    m_ODFMaximaImage->FillBuffer(zeroPixel);
+
+    unsigned int numVoxels = m_ODFMaximaImage->GetLargestPossibleRegion().GetNumberOfPixels();
+
+    maximaArguments tmpStr;
+    tmpStr.filterPtr = this;
+
+    this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+    this->GetMultiThreader()->SetSingleMethod(this->ThreadODFMaximaComputer,&tmpStr);
+
+    // Ambiguity needs maxima of neighbors, hence two passes
+    tmpStr.computeAmbiguity = false;
+    m_MaximaScheduler.Initialize(numVoxels,this->GetNumberOfWorkUnits(),16);
+    this->GetMultiThreader()->SingleMethodExecute();
+
+    tmpStr.computeAmbiguity = true;
+    m_MaximaScheduler.Initialize(numVoxels,this->GetNumberOfWorkUnits(),64);
+    this->GetMultiThreader()->SingleMethodExecute();
+
+    unsigned int numComponents = m_ODFMaximaImage->GetNumberOfComponentsPerPixel();
+    const float *maximaBuffer = m_ODFMaximaImage->GetBufferPointer();
+    unsigned int numAmbiguousVoxels = 0;
+    for (unsigned int i = 0;i < numVoxels;++i)
+    {
+        if (maximaBuffer[i * numComponents + 1] != 0)
+            ++numAmbiguousVoxels;
+    }
+
+    std::cout << "Precomputed ODF maxima, " << numAmbiguousVoxels << " ambiguous voxels out of " << numVoxels << std::endl;
+}
+
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ODFProbabilisticTractographyImageFilter::ThreadODFMaximaComputer(void *arg)
+{
+    itk::MultiThreaderBase::WorkUnitInfo *threadArgs = (itk::MultiThreaderBase::WorkUnitInfo *)arg;
+    unsigned int nbThread = threadArgs->WorkUnitID;
+
+    maximaArguments *tmpArg = (maximaArguments *)threadArgs->UserData;
+    Self *filter = tmpArg->filterPtr;
+
+    unsigned int startIndex, endIndex;
+    while (filter->m_MaximaScheduler.GetNextChunk(nbThread,startIndex,endIndex))
+    {
+        if (tmpArg->computeAmbiguity)
+            filter->ComputeVoxelsAmbiguity(startIndex,endIndex);
+        else
+            filter->ComputeVoxelsMaxima(startIndex,endIndex);
+    }
+
+    return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+void ODFProbabilisticTractographyImageFilter::ComputeVoxelsMaxima(unsigned int startIndex, unsigned int endIndex)
+{
+    InputModelImageType *inputImage = this->GetInputModelImage();
+    bool is2d = (inputImage->GetLargestPossibleRegion().GetSize()[2] == 1);
+
+    unsigned int modelDimension = this->GetModelDimension();
+    unsigned int inputNumComponents = inputImage->GetNumberOfComponentsPerPixel();
+    const float *inputBuffer = inputImage->GetBufferPointer();
+
+    unsigned int numComponents = m_ODFMaximaImage->GetNumberOfComponentsPerPixel();
+    float *maximaBuffer = m_ODFMaximaImage->GetBufferPointer();
+
+    VectorType modelValue(modelDimension);
+    DirectionVectorType maxima;
+    ListType kappaValues, mixtureWeights;
+
+    for (unsigned int i = startIndex;i < endIndex;++i)
+    {
+        bool isModelNull = true;
+        for (unsigned int j = 0;j < modelDimension;++j)
+        {
+            modelValue[j] = inputBuffer[i * inputNumComponents + j];
+            if (modelValue[j] != 0)
+                isModelNull = false;
+        }
+
+        // Those voxels are stopping particles anyway
+        if (isModelNull)
+            continue;
+
+        if (this->GetGeneralizedFractionalAnisotropy(modelValue) < m_GFAThreshold)
+            continue;
+
+        unsigned int numDirs = this->ComputeODFMaximaProperties(modelValue,maxima,kappaValues,mixtureWeights,is2d);
+        unsigned int numStoredDirs = (numDirs > MaximalNumberOfStoredMaxima) ? MaximalNumberOfStoredMaxima : numDirs;
+
+        float *voxelMaxima = maximaBuffer + i * numComponents;
+        voxelMaxima[0] = numStoredDirs;
+        voxelMaxima[1] = (numDirs > MaximalNumberOfStoredMaxima);
+
+        for (unsigned int j = 0;j < numStoredDirs;++j)
+        {
+            float *maximumValues = voxelMaxima + 2 + j * MaximaImageComponentsPerMaximum;
+            for (unsigned int k = 0;k < 3;++k)
+                maximumValues[k] = maxima[j][k];
+
+            maximumValues[3] = kappaValues[j];
+            maximumValues[4] = mixtureWeights[j];
+        }
+    }
+}
+
+void ODFProbabilisticTractographyImageFilter::ComputeVoxelsAmbiguity(unsigned int startIndex, unsigned int endIndex)
+{
+    MaximaImageType::RegionType region = m_ODFMaximaImage->GetLargestPossibleRegion();
+    unsigned int numComponents = m_ODFMaximaImage->GetNumberOfComponentsPerPixel();
+    float *maximaBuffer = m_ODFMaximaImage->GetBufferPointer();
+
+    IndexType voxelIndex, neighborIndex;
+    Vector3DType voxelDirection, neighborDirection;
+
+    for (unsigned int i = startIndex;i < endIndex;++i)
+    {
+        float *voxelMaxima = maximaBuffer + i * numComponents;
+        if (voxelMaxima[1] != 0)
+            continue;
+
+        unsigned int numDirs = voxelMaxima[0];
+        voxelIndex = m_ODFMaximaImage->ComputeIndex(i);
+
+        // A voxel is ambiguous when the interpolated ODF may differ from its own: a face neighbor
+        // has a different number of maxima, or no maximum close to one of the voxel maxima
+        bool isAmbiguous = false;
+        for (unsigned int d = 0;(d < InputModelImageType::ImageDimension) && !isAmbiguous;++d)
+        {
+            for (int offset = -1;(offset <= 1) && !isAmbiguous;offset += 2)
+            {
+                neighborIndex = voxelIndex;
+                neighborIndex[d] += offset;
+
+                if (!region.IsInside(neighborIndex))
+                    continue;
+
+                const float *neighborMaxima = maximaBuffer + m_ODFMaximaImage->ComputeOffset(neighborIndex) * numComponents;
+                if (neighborMaxima[0] != numDirs)
+                {
+                    isAmbiguous = true;
+                    break;
+                }
+
+                for (unsigned int j = 0;j < numDirs;++j)
+                {
+                    for (unsigned int k = 0;k < 3;++k)
+                        voxelDirection[k] = voxelMaxima[2 + j * MaximaImageComponentsPerMaximum + k];
+
+                    double minAngle = 90.0;
+                    for (unsigned int l = 0;l < numDirs;++l)
+                    {
+                        for (unsigned int k = 0;k < 3;++k)
+                            neighborDirection[k] = neighborMaxima[2 + l * MaximaImageComponentsPerMaximum + k];
+
+                        minAngle = std::min(minAngle, anima::ComputeOrientationAngle(voxelDirection,neighborDirection));
+                    }
+
+                    if (minAngle > m_MaximaAmbiguityAngle)
+                    {
+                        isAmbiguous = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        voxelMaxima[1] = isAmbiguous;
+    }
 }
 
 ODFProbabilisticTractographyImageFilter::Vector3DType
@@ -59,14 +252,10 @@ ODFProbabilisticTractographyImageFilter::ProposeNewDirection(Vector3DType &oldDi
     bool is2d = (this->GetInputModelImage()->GetLargestPossibleRegion().GetSize()[2] == 1);
 
     DirectionVectorType maximaODF;
-    unsigned int numDirs = this->FindODFMaxima(modelValue,maximaODF,m_MinimalDiffusionProbability,is2d);
-    ListType mixtureWeights(numDirs,0);
-    ListType kappaValues(numDirs,0);
+    ListType mixtureWeights, kappaValues;
+    unsigned int numDirs = this->GetMaximaProperties(modelValue,threadId,maximaODF,kappaValues,mixtureWeights);
 
     double chosenKappa = 0;
-
-    Vector3DType sphDirection;
-
     double sumWeights = 0;
 
     for (unsigned int i = 0;i < numDirs;++i)
@@ -74,15 +263,6 @@ ODFProbabilisticTractographyImageFilter::ProposeNewDirection(Vector3DType &oldDi
         if (anima::ComputeScalarProduct(oldDirection, maximaODF[i]) < 0)
             maximaODF[i] *= -1;
 
-        anima::TransformCartesianToSphericalCoordinates(maximaODF[i],sphDirection);
-        mixtureWeights[i] = m_ODFSHBasis->getValueAtPosition(modelValue,sphDirection[0],sphDirection[1]);
-
-        // 0.5 is for Watson kappa
-        kappaValues[i] = 0.5 * m_CurvatureScale * m_ODFSHBasis->getCurvatureAtPosition(modelValue,sphDirection[0],sphDirection[1]);
-
-        if ((std::isnan(kappaValues[i]))||(kappaValues[i] <= 0)||(kappaValues[i] >= 1000))
-            mixtureWeights[i] = 0;
-
         sumWeights += mixtureWeights[i];
     }
 
@@ -145,7 +325,8 @@ ODFProbabilisticTractographyImageFilter::Vector3DType ODFProbabilisticTractograp
     bool is2d = (this->GetInputModelImage()->GetLargestPossibleRegion().GetSize()[2] == 1);
 
     DirectionVectorType maximaODF;
-    unsigned int numDirs = this->FindODFMaxima(modelValue,maximaODF,m_MinimalDiffusionProbability,is2d);
+    ListType mixtureWeights, kappaValues;
+    unsigned int numDirs = this->GetMaximaProperties(modelValue,threadId,maximaODF,kappaValues,mixtureWeights);
     if (numDirs == 0)
         return colinearDir;
 
@@ -226,10 +407,9 @@ double ODFProbabilisticTractographyImageFilter::ComputeLogWeightUpdate(double b0
 {
     double logLikelihood = 0.0;
 
-    bool is2d = (this->GetInputModelImage()->GetLargestPossibleRegion().GetSize()[2] == 1);
-
     DirectionVectorType maximaODF;
-    unsigned int numDirs = this->FindODFMaxima(modelValue,maximaODF,m_MinimalDiffusionProbability,is2d);
+    ListType mixtureWeights, kappaValues;
+    unsigned int numDirs = this->GetMaximaProperties(modelValue,threadId,maximaODF,kappaValues,mixtureWeights);
 
     double concentrationParameter = b0Value / std::sqrt(noiseValue);
 
@@ -397,14 +577,84 @@ unsigned int ODFProbabilisticTractographyImageFilter::FindODFMaxima(const Vector
     return maxima.size();
 }
 
+unsigned int ODFProbabilisticTractographyImageFilter::ComputeODFMaximaProperties(const VectorType &modelValue, DirectionVectorType &maxima,
+                                                                                ListType &kappaValues, ListType &mixtureWeights, bool is2d)
+{
+    unsigned int numDirs = this->FindODFMaxima(modelValue,maxima,m_MinimalDiffusionProbability,is2d);
+    mixtureWeights.resize(numDirs);
+    kappaValues.resize(numDirs);
+
+    // ODF values and curvatures are symmetric, no need to orient maxima first
+    Vector3DType sphDirection;
+    for (unsigned int i = 0;i < numDirs;++i)
+    {
+        anima::TransformCartesianToSphericalCoordinates(maxima[i],sphDirection);
+        mixtureWeights[i] = m_ODFSHBasis->getValueAtPosition(modelValue,sphDirection[0],sphDirection[1]);
+
+        // 0.5 is for Watson kappa
+        kappaValues[i] = 0.5 * m_CurvatureScale * m_ODFSHBasis->getCurvatureAtPosition(modelValue,sphDirection[0],sphDirection[1]);
+
+        if ((std::isnan(kappaValues[i]))||(kappaValues[i] <= 0)||(kappaValues[i] >= 1000))
+            mixtureWeights[i] = 0;
+    }
+
+    return numDirs;
+}
+
+unsigned int ODFProbabilisticTractographyImageFilter::GetMaximaProperties(const VectorType &modelValue, unsigned int threadId,
+                                                                         DirectionVectorType &maxima, ListType &kappaValues,
+                                                                         ListType &mixtureWeights)
+{
+    if (m_ODFMaximaImage)
+    {
+        const IndexType &voxelIndex = m_CurrentVoxelIndexes[threadId];
+        if (m_ODFMaximaImage->GetLargestPossibleRegion().IsInside(voxelIndex))
+        {
+            unsigned int numComponents = m_ODFMaximaImage->GetNumberOfComponentsPerPixel();
+            const float *voxelMaxima = m_ODFMaximaImage->GetBufferPointer() + m_ODFMaximaImage->ComputeOffset(voxelIndex) * numComponents;
+
+            bool isAmbiguous = (voxelMaxima[1] != 0);
+            if (!isAmbiguous || !m_ExactSearchInAmbiguousVoxels)
+            {
+                unsigned int numDirs = voxelMaxima[0];
+                maxima.resize(numDirs);
+                kappaValues.resize(numDirs);
+                mixtureWeights.resize(numDirs);
+
+                for (unsigned int i = 0;i < numDirs;++i)
+                {
+                    const float *maximumValues = voxelMaxima + 2 + i * MaximaImageComponentsPerMaximum;
+                    for (unsigned int j = 0;j < 3;++j)
+                        maxima[i][j] = maximumValues[j];
+
+                    kappaValues[i] = maximumValues[3];
+                    mixtureWeights[i] = maximumValues[4];
+                }
+
+                return numDirs;
+            }
+        }
+    }
+
+    bool is2d = (this->GetInputModelImage()->GetLargestPossibleRegion().GetSize()[2] == 1);
+    return this->ComputeODFMaximaProperties(modelValue,maxima,kappaValues,mixtureWeights,is2d);
+}
+
 void ODFProbabilisticTractographyImageFilter::ComputeModelValue(InterpolatorPointer &modelInterpolator, ContinuousIndexType &index,
-                                                                VectorType &modelValue)
+                                                                VectorType &modelValue, unsigned int threadId)
 {
     modelValue.SetSize(this->GetModelDimension());
     modelValue.Fill(0.0);
 
     if (modelInterpolator->IsInsideBuffer(index))
         modelValue = modelInterpolator->EvaluateAtContinuousIndex(index);
+
+    // Precomputed maxima are selected from the closest voxel
+    if (m_ODFMaximaImage)
+    {
+        for (unsigned int i = 0;i < InputModelImageType::ImageDimension;++i)
+            m_CurrentVoxelIndexes[threadId][i] = static_cast <IndexType::IndexValueType> (std::round(index[i]));
+    }
 }
 
 double ODFProbabilisticTractographyImageFilter::GetGeneralizedFractionalAnisotropy(VectorType &modelValue)
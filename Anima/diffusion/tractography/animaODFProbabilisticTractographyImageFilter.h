@@ -28,11 +28,35 @@ public:
         double x, y, z;
     };
 
+    /**
+     * Precomputed maxima image: per voxel, number of ODF maxima, ambiguity flag, then for each maximum its direction,
+     * Watson kappa and (non normalized) mixture weight
+     */
+    typedef itk::VectorImage <float, 3> MaximaImageType;
+    typedef MaximaImageType::Pointer MaximaImagePointer;
+
+    //! Maximal number of maxima stored per voxel, voxels with more maxima are flagged as ambiguous
+    static const unsigned int MaximalNumberOfStoredMaxima = 4;
+    static const unsigned int MaximaImageComponentsPerMaximum = 5;
+
+    typedef struct {
+        ODFProbabilisticTractographyImageFilter *filterPtr;
+        bool computeAmbiguity;
+    } maximaArguments;
+
     void SetODFSHOrder(unsigned int num);
     itkSetMacro(GFAThreshold,double)
     itkSetMacro(CurvatureScale,double)
     itkSetMacro(MinimalDiffusionProbability,double)
 
+    itkSetMacro(UsePrecomputedMaxima,bool)
+    itkGetMacro(UsePrecomputedMaxima,bool)
+    itkSetMacro(ExactSearchInAmbiguousVoxels,bool)
+    itkGetMacro(ExactSearchInAmbiguousVoxels,bool)
+    itkSetMacro(MaximaAmbiguityAngle,double)
+
+    MaximaImageType *GetODFMaximaImage() {return m_ODFMaximaImage;}
+
 protected:
     ODFProbabilisticTractographyImageFilter();
     virtual ~ODFProbabilisticTractographyImageFilter();
@@ -47,7 +71,8 @@ protected:
     virtual double ComputeLogWeightUpdate(double b0Value, double noiseValue, Vector3DType &newDirection, VectorType &modelValue,
                                           double &log_prior, double &log_proposal, unsigned int threadId) ITK_OVERRIDE;
 
-    virtual void ComputeModelValue(InterpolatorPointer &modelInterpolator, ContinuousIndexType &index, VectorType &modelValue) ITK_OVERRIDE;
+    virtual void ComputeModelValue(InterpolatorPointer &modelInterpolator, ContinuousIndexType &index, VectorType &modelValue,
+                                   unsigned int threadId) ITK_OVERRIDE;
 
     virtual Vector3DType InitializeFirstIterationFromModel(Vector3DType &colinearDir, VectorType &modelValue,
                                                            unsigned int threadId) ITK_OVERRIDE;
@@ -57,6 +82,21 @@ protected:
     unsigned int FindODFMaxima(const VectorType &modelValue, DirectionVectorType &maxima, double minVal, bool is2d);
     double GetGeneralizedFractionalAnisotropy(VectorType &modelValue);
 
+    //! Computes ODF maxima with their Watson kappas and non normalized mixture weights (null for unusable maxima)
+    unsigned int ComputeODFMaximaProperties(const VectorType &modelValue, DirectionVectorType &maxima, ListType &kappaValues,
+                                            ListType &mixtureWeights, bool is2d);
+
+    //! Maxima properties at the last position given to ComputeModelValue by a thread, read from the precomputed image when possible
+    unsigned int GetMaximaProperties(const VectorType &modelValue, unsigned int threadId, DirectionVectorType &maxima,
+                                     ListType &kappaValues, ListType &mixtureWeights);
+
+    //! One-off pass extracting maxima properties of every voxel and flagging voxels where selecting them is ambiguous
+    void ComputeODFMaximaImage();
+
+    static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ThreadODFMaximaComputer(void *arg);
+    void ComputeVoxelsMaxima(unsigned int startIndex, unsigned int endIndex);
+    void ComputeVoxelsAmbiguity(unsigned int startIndex, unsigned int endIndex);
+
 private:
     ITK_DISALLOW_COPY_AND_ASSIGN(ODFProbabilisticTractographyImageFilter);
 
@@ -70,6 +110,18 @@ private:
 
     unsigned int m_ODFSHOrder;
     anima::ODFSphericalHarmonicBasis *m_ODFSHBasis;
+
+    bool m_UsePrecomputedMaxima;
+    bool m_ExactSearchInAmbiguousVoxels;
+
+    //! Maximal angle (in degrees) between maxima of neighboring voxels for a voxel not to be ambiguous
+    double m_MaximaAmbiguityAngle;
+
+    MaximaImagePointer m_ODFMaximaImage;
+    anima::WorkStealingRangeScheduler m_MaximaScheduler;
+
+    //! Closest voxel of the last position given to ComputeModelValue, per thread
+    std::vector <IndexType> m_CurrentVoxelIndexes;
 };
 
 } // end of namespace anima
@@ -39,6 +39,9 @@ int main(int argc,  char*  argv[])
     TCLAP::ValueArg<double> minLengthArg("","min-length","Minimum length for a fiber to be considered for computation (default: 10mm)",false,10.0,"minimum length",cmd);
     TCLAP::ValueArg<double> maxLengthArg("","max-length","Maximum length of a tract (default: 150mm)",false,150.0,"maximum length",cmd);
 
+    TCLAP::SwitchArg streamFibersArg("","stream-fibers","Write fibers by chunks while tracking instead of keeping them all in memory",cmd,false);
+    TCLAP::ValueArg<unsigned int> streamChunkArg("","stream-chunk","Number of fibers per written chunk when streaming (default: 10000)",false,10000,"fibers per chunk",cmd);
+
     TCLAP::ValueArg<unsigned int> nbThreadsArg("T","nb-threads","Number of threads to run on (default: all available)",false,itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads(),"number of threads",cmd);
 
     try
@@ -96,6 +99,15 @@ int main(int argc,  char*  argv[])
     callback->SetCallback(eventCallback);
     dtiTracker->AddObserver(itk::ProgressEvent(), callback);
 
+    anima::FiberStreamingSink fiberSink;
+    if (streamFibersArg.isSet())
+    {
+        fiberSink.SetFileName(fibersArg.getValue());
+        fiberSink.SetChunkSize(streamChunkArg.getValue());
+        fiberSink.SetMaximalQueueSize(4 * streamChunkArg.getValue());
+        dtiTracker->SetFiberSink(&fiberSink);
+    }
+
     itk::TimeProbe tmpTime;
     tmpTime.Start();
 
@@ -105,6 +117,10 @@ int main(int argc,  char*  argv[])
     tmpTime.Stop();
     std::cout << "Tracking time: " << tmpTime.GetTotal() << "s" << std::endl;
 
+    // Fibers are already written
+    if (streamFibersArg.isSet())
+        return EXIT_SUCCESS;
+
     anima::ShapesWriter writer;
     writer.SetInputData(dtiTracker->GetOutput());
     writer.SetFileName(fibersArg.getValue());
@@ -4,116 +4,11 @@
 #include <animaShapesWriter.h>
 
 #include <animaShapesReader.h>
+#include <animaFiberLabelFilter.h>
 #include <vtkSmartPointer.h>
-#include <vtkPoints.h>
-#include <vtkPointData.h>
 #include <vtkPolyData.h>
-#include <vtkCleanPolyData.h>
-#include <vtkGenericCell.h>
 
-#include <itkNearestNeighborInterpolateImageFunction.h>
-#include <itkPoolMultiThreader.h>
-
-void FilterTracks(vtkPolyData *tracks, unsigned int startIndex, unsigned int endIndex,
-                  itk::NearestNeighborInterpolateImageFunction < itk::Image <unsigned short, 3> > * interpolator,
-                  const std::vector <unsigned int> &touchLabels, const std::vector <unsigned int> &forbiddenLabels)
-{
-    std::vector <unsigned int> seenLabels;
-    double pointPositionVTK[3];
-    itk::ContinuousIndex<double, 3> currentIndex;
-    typedef itk::Image <unsigned short, 3>::PointType PointType;
-    PointType pointPosition;
-
-    vtkSmartPointer <vtkGenericCell> cell = vtkGenericCell::New();
-    for (unsigned int i = startIndex;i < endIndex;++i)
-    {
-        // Inspect i-th cell
-        tracks->GetCell(i,cell);
-        vtkPoints *cellPts = cell->GetPoints();
-        vtkIdType numCellPts = cellPts->GetNumberOfPoints();
-        seenLabels.clear();
-        bool lineOk = true;
-
-        for (unsigned int j = 0;j < numCellPts;++j)
-        {
-            cellPts->GetPoint(j, pointPositionVTK);
-            for (unsigned int k = 0; k < 3; ++k)
-                pointPosition[k] = pointPositionVTK[k];
-
-            interpolator->GetInputImage()->TransformPhysicalPointToContinuousIndex(pointPosition,currentIndex);
-
-            if (!interpolator->IsInsideBuffer(currentIndex))
-                continue;
-
-            unsigned int value = static_cast <unsigned int> (std::round(interpolator->EvaluateAtContinuousIndex(currentIndex)));
-
-            for (unsigned int k = 0;k < forbiddenLabels.size();++k)
-            {
-                if (value == forbiddenLabels[k])
-                {
-                    lineOk = false;
-                    break;
-                }
-            }
-
-            if (!lineOk)
-                break;
-
-            for (unsigned int k = 0;k < touchLabels.size();++k)
-            {
-                if (value == touchLabels[k])
-                {
-                    bool alreadyIn = false;
-                    for (unsigned int l = 0;l < seenLabels.size();++l)
-                    {
-                        if (seenLabels[l] == value)
-                        {
-                            alreadyIn = true;
-                            break;
-                        }
-                    }
-
-                    if (!alreadyIn)
-                        seenLabels.push_back(value);
-
-                    break;
-                }
-            }
-        }
-
-        if (!lineOk || (seenLabels.size() != touchLabels.size()))
-            tracks->DeleteCell(i);
-    }
-}
-
-typedef struct
-{
-    vtkPolyData *tracks;
-    itk::NearestNeighborInterpolateImageFunction < itk::Image <unsigned short, 3> > *interpolator;
-    std::vector <unsigned int> touchLabels;
-    std::vector <unsigned int> forbiddenLabels;
-} ThreaderArguments;
-
-ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ThreadFilterer(void *arg)
-{
-    itk::MultiThreaderBase::WorkUnitInfo *threadArgs = (itk::MultiThreaderBase::WorkUnitInfo *)arg;
-    unsigned int nbThread = threadArgs->WorkUnitID;
-    unsigned int numTotalThread = threadArgs->NumberOfWorkUnits;
-
-    ThreaderArguments *tmpArg = (ThreaderArguments *)threadArgs->UserData;
-    unsigned int nbTotalCells = tmpArg->tracks->GetNumberOfCells();
-
-    unsigned int step = nbTotalCells / numTotalThread;
-    unsigned int startIndex = nbThread * step;
-    unsigned int endIndex = (nbThread + 1) * step;
-
-    if (nbThread == numTotalThread - 1)
-        endIndex = nbTotalCells;
-
-    FilterTracks(tmpArg->tracks, startIndex, endIndex, tmpArg->interpolator, tmpArg->touchLabels, tmpArg->forbiddenLabels);
-
-    return ITK_THREAD_RETURN_DEFAULT_VALUE;
-}
+#include <itkMultiThreaderBase.h>
 
 int main(int argc, char **argv)
 {
@@ -140,42 +35,20 @@ int main(int argc, char **argv)
     typedef itk::Image <unsigned short, 3> ROIImageType;
     ROIImageType::Pointer roiImage = anima::readImage <ROIImageType> (roiArg.getValue());
 
-    typedef itk::NearestNeighborInterpolateImageFunction <ROIImageType> InterpolatorType;
-    InterpolatorType::Pointer interpolator = InterpolatorType::New();
-    interpolator->SetInputImage(roiImage);
-
     anima::ShapesReader trackReader;
     trackReader.SetFileName(inArg.getValue());
     trackReader.Update();
 
     vtkSmartPointer <vtkPolyData> tracks = trackReader.GetOutput();
 
-    // Get dummy cell so that it's thread safe
-    vtkSmartPointer <vtkGenericCell> dummyCell = vtkGenericCell::New();
-    tracks->GetCell(0,dummyCell);
-
-    std::vector <unsigned int> touchLabels = touchArg.getValue();
-    std::vector <unsigned int> forbiddenLabels = forbiddenArg.getValue();
-
-    ThreaderArguments tmpStr;
-    tmpStr.interpolator = interpolator;
-    tmpStr.tracks = tracks;
-    tmpStr.touchLabels = touchLabels;
-    tmpStr.forbiddenLabels = forbiddenLabels;
-
-    itk::PoolMultiThreader::Pointer mThreader = itk::PoolMultiThreader::New();
-    mThreader->SetNumberOfWorkUnits(nbThreadsArg.getValue());
-    mThreader->SetSingleMethod(ThreadFilterer,&tmpStr);
-    mThreader->SingleMethodExecute();
-
-    // Final pruning of removed cells
-    tracks->RemoveDeletedCells();
+    anima::FiberLabelFilter labelFilter;
+    labelFilter.SetLabelImage(roiImage);
+    labelFilter.SetTouchLabels(touchArg.getValue());
+    labelFilter.SetForbiddenLabels(forbiddenArg.getValue());
+    labelFilter.Initialize();
 
-    // Out of security, but apparently does not do much
-    vtkSmartPointer <vtkCleanPolyData> vtkCleaner = vtkSmartPointer <vtkCleanPolyData>::New();
-    vtkCleaner->SetInputData(tracks);
-    vtkCleaner->Update();
-    tracks->ShallowCopy(vtkCleaner->GetOutput());
+    // Kept tracks are compacted in a new poly data, unused points are not carried over
+    tracks = labelFilter.FilterTracks(tracks, nbThreadsArg.getValue());
 
     std::cout << "Kept " << tracks->GetNumberOfCells() << " after filtering" << std::endl;
 
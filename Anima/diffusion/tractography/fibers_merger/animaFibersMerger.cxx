@@ -0,0 +1,46 @@
+#include <tclap/CmdLine.h>
+
+#include <animaShapesReader.h>
+#include <animaShapesStreamWriter.h>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+int main(int argc, char **argv)
+{
+    TCLAP::CmdLine cmd("Merges fiber files, e.g. the outputs of a tractography job split in seed ranges, in the order they are given. INRIA / IRISA - VisAGeS/Empenn Team", ' ',ANIMA_VERSION);
+
+    TCLAP::MultiArg<std::string> inArg("i","input","Input fibers (given several times, all with the same point arrays)",true,"input fibers",cmd);
+    TCLAP::ValueArg<std::string> outArg("o","output","Output merged fibers",true,"","output fibers",cmd);
+
+    try
+    {
+        cmd.parse(argc,argv);
+    }
+    catch (TCLAP::ArgException& e)
+    {
+        std::cerr << "Error: " << e.error() << "for argument " << e.argId() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Inputs are appended one by one, only one of them is in memory at a time
+    anima::ShapesStreamWriter writer;
+    std::string outputName = outArg.getValue();
+    writer.SetFileName(outputName);
+    writer.Open();
+
+    std::vector <std::string> inputNames = inArg.getValue();
+    for (unsigned int i = 0;i < inputNames.size();++i)
+    {
+        anima::ShapesReader reader;
+        reader.SetFileName(inputNames[i]);
+        reader.Update();
+
+        writer.WriteChunk(reader.GetOutput());
+    }
+
+    writer.Close();
+    std::cout << "Merged " << writer.GetNumberOfWrittenShapes() << " fibers from " << inputNames.size() << " files" << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -65,6 +65,17 @@ int main(int argc,  char*  argv[])
 
     TCLAP::SwitchArg averageClustersArg("M","average-clusters","Output only cluster mean",cmd,false);
 
+    TCLAP::SwitchArg precomputedMaximaArg("P","precomp-maxima","Precompute ODF maxima, kappas and weights per voxel instead of searching them at each particle step",cmd,false);
+    TCLAP::SwitchArg noExactAmbiguousArg("","no-exact-ambiguous","With precomputed maxima, do not fall back to exact maxima search in ambiguous voxels",cmd,false);
+    TCLAP::ValueArg<double> ambiguityAngleArg("","ambiguity-angle","Maximal angle between maxima of neighboring voxels for precomputed maxima to be used (default: 15)",false,15.0,"ambiguity angle",cmd);
+
+    TCLAP::ValueArg<unsigned int> randomSeedArg("","rng-seed","Random seed, fixing it gives identical results whatever the number of threads (default: current time)",false,0,"random seed",cmd);
+    TCLAP::ValueArg<unsigned int> seedStartArg("","seed-start","First seed point to track, to split a tracking job over several runs (default: 0)",false,0,"first seed index",cmd);
+    TCLAP::ValueArg<unsigned int> seedEndArg("","seed-end","Seed point index to stop tracking at, excluded (default: 0, all remaining seeds)",false,0,"last seed index",cmd);
+
+    TCLAP::SwitchArg streamFibersArg("","stream-fibers","Write fibers by chunks while tracking instead of keeping them all in memory",cmd,false);
+    TCLAP::ValueArg<unsigned int> streamChunkArg("","stream-chunk","Number of fibers per written chunk when streaming (default: 10000)",false,10000,"fibers per chunk",cmd);
+
     TCLAP::ValueArg<unsigned int> nbThreadsArg("T","nb-threads","Number of threads to run on (default: all available)",false,itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads(),"number of threads",cmd);
 
     try
@@ -127,6 +138,10 @@ int main(int argc,  char*  argv[])
     odfTracker->SetKappaSplitThreshold(kappaThrArg.getValue());
     odfTracker->SetClusterDistance(clusterDistArg.getValue());
     odfTracker->SetCurvatureScale(curvScaleArg.getValue());
+
+    odfTracker->SetUsePrecomputedMaxima(precomputedMaximaArg.isSet());
+    odfTracker->SetExactSearchInAmbiguousVoxels(!noExactAmbiguousArg.isSet());
+    odfTracker->SetMaximaAmbiguityAngle(ambiguityAngleArg.getValue());
     
     odfTracker->SetComputeLocalColors(fibersArg.getValue().find(".fds") != std::string::npos);
     odfTracker->SetMAPMergeFibers(averageClustersArg.getValue());
@@ -135,6 +150,20 @@ int main(int argc,  char*  argv[])
     callback->SetCallback(eventCallback);
     odfTracker->AddObserver(itk::ProgressEvent(), callback);
 
+    if (randomSeedArg.isSet())
+        odfTracker->SetRandomSeed(randomSeedArg.getValue());
+
+    odfTracker->SetSeedRange(seedStartArg.getValue(),seedEndArg.getValue());
+
+    anima::FiberStreamingSink fiberSink;
+    if (streamFibersArg.isSet())
+    {
+        fiberSink.SetFileName(fibersArg.getValue());
+        fiberSink.SetChunkSize(streamChunkArg.getValue());
+        fiberSink.SetMaximalQueueSize(4 * streamChunkArg.getValue());
+        odfTracker->SetFiberSink(&fiberSink);
+    }
+
     itk::TimeProbe tmpTime;
     tmpTime.Start();
     
@@ -143,6 +172,10 @@ int main(int argc,  char*  argv[])
 
     tmpTime.Stop();
     std::cout << "Tracking time: " << tmpTime.GetTotal() << "s" << std::endl;
+
+    // Fibers are already written
+    if (streamFibersArg.isSet())
+        return EXIT_SUCCESS;
     
     anima::ShapesWriter writer;
     writer.SetInputData(odfTracker->GetOutput());
@@ -6,6 +6,7 @@
 #include <itkImage.h>
 #include <itkVector.h>
 #include <itkObject.h>
+#include <vector>
 
 
 namespace anima
@@ -67,6 +68,12 @@ public:
     itkSetMacro(VarMinThreshold, double)
     itkSetMacro(WeightMethod, WEIGHT)
 
+    /**
+     * If true, patch distances are obtained for each displacement from the squared difference image, box filtered
+     * with separable running sums, instead of being recomputed for each voxel. Weighted means are accumulated in place.
+     */
+    itkSetMacro(UseFastComputation, bool)
+
 protected:
     NonLocalMeansImageFilter() :
         m_MeanMinThreshold(0.95),
@@ -77,6 +84,7 @@ protected:
         m_SearchStepSize(3),
         m_SearchNeighborhood(6),
         m_WeightMethod(EXP),
+        m_UseFastComputation(false),
         m_localNeighborhood(1)
 
     {}
@@ -92,6 +100,12 @@ private:
     void computeAverageLocalVariance();
     void computeMeanAndVarImages();
 
+    //! Fast version of DynamicThreadedGenerateData, loops over displacements and computes all patch distances at once
+    void FastDynamicThreadedGenerateData(const OutputImageRegionType& outputRegionForThread);
+
+    //! Box filters buffer (of size bufferSize) in place along each dimension, the box half size being the patch half size
+    void BoxFilterBuffer(std::vector <double> &buffer, const long *bufferSize, std::vector <double> &lineSums);
+
     double m_MeanMinThreshold;
     double m_VarMinThreshold;
     double m_WeightThreshold;
@@ -101,6 +115,7 @@ private:
     unsigned int m_SearchStepSize;
     unsigned int m_SearchNeighborhood;
     WEIGHT m_WeightMethod;
+    bool m_UseFastComputation;
 
     double m_noiseCovariance;
     OutputImagePointer m_meanImage;
@@ -103,6 +103,12 @@ void
 NonLocalMeansImageFilter < TInputImage >
 ::DynamicThreadedGenerateData(const OutputImageRegionType &outputRegionForThread)
 {
+    if (m_UseFastComputation)
+    {
+        this->FastDynamicThreadedGenerateData(outputRegionForThread);
+        return;
+    }
+
     // Allocate output
     typename OutputImageType::Pointer output = this->GetOutput();
     typename InputImageType::Pointer input = const_cast<InputImageType *> (this->GetInput());
@@ -191,4 +197,296 @@ NonLocalMeansImageFilter < TInputImage >
     }
 }
 
+template <class TInputImage>
+void
+NonLocalMeansImageFilter <TInputImage>
+::FastDynamicThreadedGenerateData(const OutputImageRegionType &outputRegionForThread)
+{
+    const unsigned int Dimension = InputImageDimension;
+    typedef typename InputImageType::OffsetValueType OffsetValueType;
+
+    const InputImageType *input = this->GetInput();
+    const InputPixelType *inputBuffer = input->GetBufferPointer();
+    const OutputPixelType *meanBuffer = m_meanImage->GetBufferPointer();
+    const OutputPixelType *varBuffer = m_varImage->GetBufferPointer();
+    const OffsetValueType *imageStrides = input->GetOffsetTable();
+
+    InputImageRegionType largestRegion = input->GetLargestPossibleRegion();
+    InputImageIndexType bufferStart = input->GetBufferedRegion().GetIndex();
+    long patchHalfSize = m_PatchHalfSize;
+
+    long imageStart[Dimension], imageEnd[Dimension];
+    long regionStart[Dimension], regionSize[Dimension];
+    unsigned int numRegionVoxels = 1;
+    unsigned int maxNumHaloVoxels = 1;
+    for (unsigned int d = 0;d < Dimension;++d)
+    {
+        imageStart[d] = largestRegion.GetIndex()[d];
+        imageEnd[d] = imageStart[d] + largestRegion.GetSize()[d] - 1;
+        regionStart[d] = outputRegionForThread.GetIndex()[d];
+        regionSize[d] = outputRegionForThread.GetSize()[d];
+        numRegionVoxels *= regionSize[d];
+
+        long haloStart = std::max(imageStart[d], regionStart[d] - patchHalfSize);
+        long haloEnd = std::min(imageEnd[d], regionStart[d] + regionSize[d] - 1 + patchHalfSize);
+        maxNumHaloVoxels *= haloEnd - haloStart + 1;
+    }
+
+    if (numRegionVoxels == 0)
+        return;
+
+    // Weighted sums accumulated over displacements for each voxel of the region
+    std::vector <double> weightedSums(numRegionVoxels,0.0);
+    std::vector <double> weightSums(numRegionVoxels,0.0);
+    std::vector <double> maxWeights(numRegionVoxels,0.0);
+
+    std::vector <double> distanceBuffer(maxNumHaloVoxels);
+    std::vector <double> lineSums;
+
+    unsigned int numDispPerDim = 2 * (m_maxAbsDisp / m_SearchStepSize) + 1;
+    long displacement[Dimension];
+    unsigned int displacementCounter[Dimension];
+    for (unsigned int d = 0;d < Dimension;++d)
+        displacementCounter[d] = 0;
+
+    long validStart[Dimension], validSize[Dimension];
+    long haloStart[Dimension], haloSize[Dimension];
+    long index[Dimension];
+    bool displacementsDone = false;
+    while (!displacementsDone)
+    {
+        bool isCentralDisplacement = true;
+        OffsetValueType displacementOffset = 0;
+        for (unsigned int d = 0;d < Dimension;++d)
+        {
+            displacement[d] = - m_maxAbsDisp + (long)(displacementCounter[d] * m_SearchStepSize);
+            displacementOffset += displacement[d] * imageStrides[d];
+            if (displacement[d] != 0)
+                isCentralDisplacement = false;
+        }
+
+        // Next displacement
+        displacementsDone = true;
+        for (unsigned int d = 0;d < Dimension;++d)
+        {
+            ++displacementCounter[d];
+            if (displacementCounter[d] < numDispPerDim)
+            {
+                displacementsDone = false;
+                break;
+            }
+
+            displacementCounter[d] = 0;
+        }
+
+        if (isCentralDisplacement)
+            continue;
+
+        // Voxels whose (border clipped) patch, once displaced, stays inside the image
+        bool emptyValidRegion = false;
+        unsigned int numHaloVoxels = 1;
+        for (unsigned int d = 0;d < Dimension;++d)
+        {
+            long minValid = regionStart[d];
+            if (displacement[d] < 0)
+                minValid = std::max(minValid, imageStart[d] + patchHalfSize - displacement[d]);
+
+            long maxValid = regionStart[d] + regionSize[d] - 1;
+            if (displacement[d] > 0)
+                maxValid = std::min(maxValid, imageEnd[d] - patchHalfSize - displacement[d]);
+
+            if (maxValid < minValid)
+            {
+                emptyValidRegion = true;
+                break;
+            }
+
+            validStart[d] = minValid;
+            validSize[d] = maxValid - minValid + 1;
+
+            haloStart[d] = std::max(imageStart[d], minValid - patchHalfSize);
+            haloSize[d] = std::min(imageEnd[d], maxValid + patchHalfSize) - haloStart[d] + 1;
+            numHaloVoxels *= haloSize[d];
+        }
+
+        if (emptyValidRegion)
+            continue;
+
+        // Squared difference image between the image and its displaced version
+        for (unsigned int d = 0;d < Dimension;++d)
+            index[d] = haloStart[d];
+
+        for (unsigned int i = 0;i < numHaloVoxels;++i)
+        {
+            OffsetValueType imageOffset = 0;
+            for (unsigned int d = 0;d < Dimension;++d)
+                imageOffset += (index[d] - bufferStart[d]) * imageStrides[d];
+
+            double diffValue = (double)inputBuffer[imageOffset] - (double)inputBuffer[imageOffset + displacementOffset];
+            distanceBuffer[i] = diffValue * diffValue;
+
+            for (unsigned int d = 0;d < Dimension;++d)
+            {
+                ++index[d];
+                if (index[d] < haloStart[d] + haloSize[d])
+                    break;
+
+                index[d] = haloStart[d];
+            }
+        }
+
+        // Patch distances of all voxels at once
+        this->BoxFilterBuffer(distanceBuffer,haloSize,lineSums);
+
+        for (unsigned int d = 0;d < Dimension;++d)
+            index[d] = validStart[d];
+
+        unsigned int numValidVoxels = 1;
+        for (unsigned int d = 0;d < Dimension;++d)
+            numValidVoxels *= validSize[d];
+
+        for (unsigned int i = 0;i < numValidVoxels;++i)
+        {
+            OffsetValueType imageOffset = 0;
+            unsigned int haloOffset = 0;
+            unsigned int regionOffset = 0;
+            unsigned int haloStride = 1;
+            unsigned int regionStride = 1;
+            unsigned int numPatchVoxels = 1;
+            for (unsigned int d = 0;d < Dimension;++d)
+            {
+                imageOffset += (index[d] - bufferStart[d]) * imageStrides[d];
+                haloOffset += (index[d] - haloStart[d]) * haloStride;
+                regionOffset += (index[d] - regionStart[d]) * regionStride;
+                haloStride *= haloSize[d];
+                regionStride *= regionSize[d];
+
+                numPatchVoxels *= std::min(imageEnd[d], index[d] + patchHalfSize) - std::max(imageStart[d], index[d] - patchHalfSize) + 1;
+            }
+
+            for (unsigned int d = 0;d < Dimension;++d)
+            {
+                ++index[d];
+                if (index[d] < validStart[d] + validSize[d])
+                    break;
+
+                index[d] = validStart[d];
+            }
+
+            OffsetValueType movingOffset = imageOffset + displacementOffset;
+            double meanRate = meanBuffer[imageOffset] / meanBuffer[movingOffset];
+            double varianceRate = varBuffer[imageOffset] / varBuffer[movingOffset];
+
+            // Should we compute the weight value of this patch ?
+            if (!((meanRate > m_MeanMinThreshold) && (meanRate < (1.0 / m_MeanMinThreshold)) &&
+                  (varianceRate > m_VarMinThreshold) && (varianceRate < (1.0 / m_VarMinThreshold))))
+                continue;
+
+            double weightValue = std::exp(- distanceBuffer[haloOffset] / (2.0 * m_BetaParameter * m_noiseCovariance * numPatchVoxels));
+            if (weightValue <= m_WeightThreshold)
+                continue;
+
+            double sampleValue = inputBuffer[movingOffset];
+            if (m_WeightMethod == RICIAN)
+                sampleValue *= sampleValue;
+
+            weightedSums[regionOffset] += weightValue * sampleValue;
+            weightSums[regionOffset] += weightValue;
+            if (maxWeights[regionOffset] < weightValue)
+                maxWeights[regionOffset] = weightValue;
+        }
+    }
+
+    typedef itk::ImageRegionConstIterator <InputImageType> InIteratorType;
+    typedef itk::ImageRegionIterator <OutputImageType> OutRegionIteratorType;
+
+    InIteratorType inputIterator(input, outputRegionForThread);
+    OutRegionIteratorType outputIterator(this->GetOutput(), outputRegionForThread);
+
+    for (unsigned int i = 0;i < numRegionVoxels;++i)
+    {
+        double inputValue = inputIterator.Get();
+        if (weightSums[i] != 0)
+        {
+            switch (m_WeightMethod)
+            {
+                case EXP:
+                    outputIterator.Set((weightedSums[i] + maxWeights[i] * inputValue) / (weightSums[i] + maxWeights[i]));
+                    break;
+
+                case RICIAN:
+                {
+                    double t = ((weightedSums[i] + inputValue * inputValue * maxWeights[i]) / (weightSums[i] + maxWeights[i]))
+                            - (2.0 * m_noiseCovariance);
+
+                    if (t < 0)
+                        t = 0;
+
+                    outputIterator.Set(std::sqrt(t));
+                    break;
+                }
+            }
+        }
+        else
+            outputIterator.Set(inputValue);
+
+        this->IncrementNumberOfProcessedPoints();
+        ++outputIterator;
+        ++inputIterator;
+    }
+}
+
+template <class TInputImage>
+void
+NonLocalMeansImageFilter <TInputImage>
+::BoxFilterBuffer(std::vector <double> &buffer, const long *bufferSize, std::vector <double> &lineSums)
+{
+    const unsigned int Dimension = InputImageDimension;
+    long patchHalfSize = m_PatchHalfSize;
+
+    unsigned int numVoxels = 1;
+    for (unsigned int d = 0;d < Dimension;++d)
+        numVoxels *= bufferSize[d];
+
+    unsigned int lineStride = 1;
+    for (unsigned int k = 0;k < Dimension;++k)
+    {
+        long lineLength = bufferSize[k];
+        lineSums.resize(lineLength + 1);
+        unsigned int numLines = numVoxels / lineLength;
+
+        for (unsigned int j = 0;j < numLines;++j)
+        {
+            // Line start: j enumerates positions along all dimensions but k
+            unsigned int lineStart = 0;
+            unsigned int remainder = j;
+            unsigned int stride = 1;
+            for (unsigned int d = 0;d < Dimension;++d)
+            {
+                if (d != k)
+                {
+                    lineStart += (remainder % bufferSize[d]) * stride;
+                    remainder /= bufferSize[d];
+                }
+
+                stride *= bufferSize[d];
+            }
+
+            // Running sums along the line, box clipped to the buffer
+            lineSums[0] = 0;
+            for (long i = 0;i < lineLength;++i)
+                lineSums[i + 1] = lineSums[i] + buffer[lineStart + i * lineStride];
+
+            for (long i = 0;i < lineLength;++i)
+            {
+                long lowIndex = std::max(0L, i - patchHalfSize);
+                long highIndex = std::min(lineLength - 1, i + patchHalfSize);
+                buffer[lineStart + i * lineStride] = lineSums[highIndex + 1] - lineSums[lowIndex];
+            }
+        }
+
+        lineStride *= lineLength;
+    }
+}
+
 } // end of namespace anima
@@ -106,6 +106,20 @@ int main(int ac, const char** av)
                                                 "Patch search neighborhood size",
                                                 cmd);
 
+    TCLAP::SwitchArg tiledArg("t",
+                              "tiled",
+                              "Denoise all volumes together tile by tile (faster, memory use grows with tile size and number of volumes)",
+                              cmd,
+                              false);
+
+    TCLAP::ValueArg<unsigned int> tileSizeArg("",
+                                              "tile-size",
+                                              "Tile size along each spatial dimension in tiled mode -> default: 16",
+                                              false,
+                                              16,
+                                              "tile size",
+                                              cmd);
+
     try
     {
         cmd.parse(ac,av);
@@ -116,6 +130,12 @@ int main(int ac, const char** av)
         return EXIT_FAILURE;
     }
 
+    if (tiledArg.isSet() && (tileSizeArg.getValue() == 0))
+    {
+        std::cerr << "Error: tile size should be strictly positive" << std::endl;
+        return EXIT_FAILURE;
+    }
+
     // Find out the type of the image in file
     itk::ImageIOBase::Pointer imageIO = itk::ImageIOFactory::CreateImageIO(inputArg.getValue().c_str(),
                                                                            itk::ImageIOFactory::ReadMode);
@@ -182,6 +202,8 @@ int main(int ac, const char** av)
             if (weightMethod.getValue())
                 filter->SetWeightMethod(FilterType::RICIAN);
 
+            filter->SetUseTiledComputation(tiledArg.isSet());
+            filter->SetTileSize(tileSizeArg.getValue());
             filter->SetNumberOfWorkUnits(nbpArg.getValue());
 
             filter->Update();
@@ -219,6 +241,8 @@ int main(int ac, const char** av)
             if (weightMethod.getValue())
                 filter->SetWeightMethod(FilterType::RICIAN);
 
+            filter->SetUseTiledComputation(tiledArg.isSet());
+            filter->SetTileSize(tileSizeArg.getValue());
             filter->SetNumberOfWorkUnits(nbpArg.getValue());
 
             filter->AddObserver(itk::ProgressEvent(), callback );
@@ -6,6 +6,11 @@
 #include <itkImage.h>
 #include <itkVector.h>
 #include <itkObject.h>
+#include <itkNumericTraits.h>
+#include <animaWorkStealingRangeScheduler.h>
+
+#include <mutex>
+#include <vector>
 
 
 namespace anima
@@ -66,6 +71,16 @@ public:
     itkSetMacro(VarMinThreshold, double)
     itkSetMacro(WeightMethod, WEIGHT)
 
+    /**
+     * Tiled mode: the image is split in spatial tiles. All volumes of a tile and its search margin are loaded in a contiguous
+     * buffer interleaving volumes voxel per voxel, and are denoised together with displacement-wise patch distances.
+     * Each volume is still denoised independently from the others.
+     */
+    itkSetMacro(UseTiledComputation, bool)
+
+    //! Tile size along each spatial dimension in tiled mode, has to be strictly positive
+    itkSetMacro(TileSize, unsigned int)
+
 protected:
     NonLocalMeansTemporalImageFilter() :
         m_MeanMinThreshold(0.95),
@@ -75,13 +90,42 @@ protected:
         m_PatchHalfSize(1),
         m_SearchStepSize(1),
         m_SearchNeighborhood(5),
-        m_WeightMethod(EXP)
+        m_WeightMethod(EXP),
+        m_UseTiledComputation(false),
+        m_TileSize(16)
     {}
 
     virtual ~NonLocalMeansTemporalImageFilter() {}
 
     void GenerateData() ITK_OVERRIDE;
 
+    static const unsigned int SpatialDimension = InputImageDimension - 1;
+
+    //! Floating point type of local means, variances and patch distances in tiled mode
+    typedef typename itk::NumericTraits <InputPixelType>::FloatType TileRealType;
+
+    //! Work buffers of a thread in tiled mode, buffers over the tile margin hold all volumes of a voxel contiguously
+    struct TileBuffers
+    {
+        std::vector <InputPixelType> Values;
+        std::vector <TileRealType> Means, Variances, Distances;
+        std::vector <double> WeightedSums, WeightSums, MaxWeights;
+        std::vector <double> LineSums;
+    };
+
+    void TiledGenerateData();
+    void ComputeNoiseCovariances();
+
+    static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ThreadTileProcessor(void *arg);
+    void ProcessTile(unsigned int tileIndex, TileBuffers &buffers);
+
+    /**
+     * Box filters buffer (of size bufferSize, numChannels interleaved) in place along each dimension, box half size being the
+     * patch half size. Borders are replicated if replicateBorders is true, box is clipped to the buffer otherwise
+     */
+    void BoxFilterChannels(std::vector <TileRealType> &buffer, const long *bufferSize, unsigned int numChannels,
+                           bool replicateBorders, std::vector <double> &lineSums);
+
 private:
     ITK_DISALLOW_COPY_AND_ASSIGN(NonLocalMeansTemporalImageFilter);
 
@@ -94,6 +138,16 @@ private:
     unsigned int m_SearchStepSize;
     unsigned int m_SearchNeighborhood;
     WEIGHT m_WeightMethod;
+
+    bool m_UseTiledComputation;
+    unsigned int m_TileSize;
+
+    std::vector <double> m_NoiseCovariances;
+    long m_NumberOfTiles[SpatialDimension];
+    anima::WorkStealingRangeScheduler m_TileScheduler;
+
+    std::mutex m_LockProcessedTiles;
+    unsigned int m_NumberOfProcessedTiles;
 };
 
 } //end of namespace anima
@@ -8,6 +8,11 @@
 #include <itkImageRegionConstIterator.h>
 #include <itkImageRegionConstIteratorWithIndex.h>
 #include <itkExtractImageFilter.h>
+#include <itkMultiThreaderBase.h>
+#include <itkProgressReporter.h>
+
+#include <algorithm>
+#include <cmath>
 
 namespace anima
 {
@@ -23,6 +28,12 @@ NonLocalMeansTemporalImageFilter < TInputImage >
 
     this->AllocateOutputs();
 
+    if (m_UseTiledComputation)
+    {
+        this->TiledGenerateData();
+        return;
+    }
+
     unsigned int nbTemporalImage = this->GetInput()->GetLargestPossibleRegion().GetSize()[InputImageDimension - 1];
 
     typename InputImageType::RegionType extractRegion;
@@ -90,4 +101,503 @@ NonLocalMeansTemporalImageFilter < TInputImage >
 
 }
 
-}//end of namespace anima
+template <class TInputImage>
+void
+NonLocalMeansTemporalImageFilter <TInputImage>
+::ComputeNoiseCovariances()
+{
+    // Same estimator as NonLocalMeansImageFilter, one value per volume
+    const InputImageType *input = this->GetInput();
+    const InputPixelType *inputBuffer = input->GetBufferPointer();
+    const typename InputImageType::OffsetValueType *strides = input->GetOffsetTable();
+    InputImageRegionType largestRegion = input->GetLargestPossibleRegion();
+
+    unsigned int numVolumes = largestRegion.GetSize()[SpatialDimension];
+    unsigned int numVolumeVoxels = 1;
+    for (unsigned int d = 0;d < SpatialDimension;++d)
+        numVolumeVoxels *= largestRegion.GetSize()[d];
+
+    unsigned int numLocalPixels = 2 * SpatialDimension;
+    m_NoiseCovariances.resize(numVolumes);
+
+    long index[SpatialDimension];
+    for (unsigned int t = 0;t < numVolumes;++t)
+    {
+        const InputPixelType *volumeBuffer = inputBuffer + t * strides[SpatialDimension];
+        for (unsigned int d = 0;d < SpatialDimension;++d)
+            index[d] = 0;
+
+        double averageCovariance = 0;
+        for (unsigned int i = 0;i < numVolumeVoxels;++i)
+        {
+            double averageLocalSignal = 0;
+            for (unsigned int d = 0;d < SpatialDimension;++d)
+            {
+                long maxIndex = largestRegion.GetSize()[d] - 1;
+                averageLocalSignal += volumeBuffer[i + (std::max(index[d] - 1, 0L) - index[d]) * strides[d]];
+                averageLocalSignal += volumeBuffer[i + (std::min(index[d] + 1, maxIndex) - index[d]) * strides[d]];
+            }
+
+            averageLocalSignal /= numLocalPixels;
+            double diffSignal = std::sqrt(numLocalPixels / (numLocalPixels + 1.0)) * (volumeBuffer[i] - averageLocalSignal);
+            averageCovariance += diffSignal * diffSignal;
+
+            for (unsigned int d = 0;d < SpatialDimension;++d)
+            {
+                ++index[d];
+                if (index[d] < (long)largestRegion.GetSize()[d])
+                    break;
+
+                index[d] = 0;
+            }
+        }
+
+        m_NoiseCovariances[t] = averageCovariance / numVolumeVoxels;
+    }
+}
+
+template <class TInputImage>
+void
+NonLocalMeansTemporalImageFilter <TInputImage>
+::TiledGenerateData()
+{
+    if (m_TileSize == 0)
+        throw itk::ExceptionObject(__FILE__, __LINE__, "Tile size should be strictly positive", ITK_LOCATION);
+
+    this->ComputeNoiseCovariances();
+
+    InputImageRegionType largestRegion = this->GetInput()->GetLargestPossibleRegion();
+    unsigned int totalNumberOfTiles = 1;
+    for (unsigned int d = 0;d < SpatialDimension;++d)
+    {
+        m_NumberOfTiles[d] = (largestRegion.GetSize()[d] + m_TileSize - 1) / m_TileSize;
+        totalNumberOfTiles *= m_NumberOfTiles[d];
+    }
+
+    m_NumberOfProcessedTiles = 0;
+    m_TileScheduler.Initialize(totalNumberOfTiles,this->GetNumberOfWorkUnits());
+
+    this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+    this->GetMultiThreader()->SetSingleMethod(this->ThreadTileProcessor,this);
+    this->GetMultiThreader()->SingleMethodExecute();
+}
+
+template <class TInputImage>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+NonLocalMeansTemporalImageFilter <TInputImage>
+::ThreadTileProcessor(void *arg)
+{
+    itk::MultiThreaderBase::WorkUnitInfo *threadArgs = (itk::MultiThreaderBase::WorkUnitInfo *)arg;
+    unsigned int nbThread = threadArgs->WorkUnitID;
+    Self *filter = (Self *)threadArgs->UserData;
+
+    TileBuffers buffers;
+    unsigned int startTile, endTile;
+    while (filter->m_TileScheduler.GetNextChunk(nbThread,startTile,endTile))
+    {
+        for (unsigned int i = startTile;i < endTile;++i)
+            filter->ProcessTile(i,buffers);
+
+        filter->m_LockProcessedTiles.lock();
+        filter->m_NumberOfProcessedTiles += endTile - startTile;
+        filter->UpdateProgress(static_cast <double> (filter->m_NumberOfProcessedTiles) / filter->m_TileScheduler.GetRangeSize());
+        filter->m_LockProcessedTiles.unlock();
+    }
+
+    return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+template <class TInputImage>
+void
+NonLocalMeansTemporalImageFilter <TInputImage>
+::ProcessTile(unsigned int tileIndex, TileBuffers &buffers)
+{
+    typedef typename InputImageType::OffsetValueType OffsetValueType;
+
+    const InputImageType *input = this->GetInput();
+    OutputImageType *output = this->GetOutput();
+    const InputPixelType *inputBuffer = input->GetBufferPointer();
+    typename OutputImageType::PixelType *outputBuffer = output->GetBufferPointer();
+    const OffsetValueType *imageStrides = input->GetOffsetTable();
+    const OffsetValueType *outputStrides = output->GetOffsetTable();
+    InputImageRegionType largestRegion = input->GetLargestPossibleRegion();
+    InputImageIndexType bufferStart = input->GetBufferedRegion().GetIndex();
+    InputImageIndexType outputBufferStart = output->GetBufferedRegion().GetIndex();
+
+    unsigned int numVolumes = largestRegion.GetSize()[SpatialDimension];
+    long patchHalfSize = m_PatchHalfSize;
+    long maxAbsDisp = (m_SearchNeighborhood / m_SearchStepSize) * m_SearchStepSize;
+    long margin = maxAbsDisp + patchHalfSize;
+
+    // Tile and its margin, patches of displaced voxels included, in image indexes (the largest region may not start at 0)
+    long imageStart[SpatialDimension], imageEnd[SpatialDimension];
+    long tileStart[SpatialDimension], tileSize[SpatialDimension];
+    long haloStart[SpatialDimension], haloSize[SpatialDimension];
+    unsigned int remainder = tileIndex;
+    unsigned int numTileVoxels = 1;
+    unsigned int numHaloVoxels = 1;
+    for (unsigned int d = 0;d < SpatialDimension;++d)
+    {
+        imageStart[d] = largestRegion.GetIndex()[d];
+        imageEnd[d] = imageStart[d] + largestRegion.GetSize()[d] - 1;
+        tileStart[d] = imageStart[d] + (remainder % m_NumberOfTiles[d]) * m_TileSize;
+        remainder /= m_NumberOfTiles[d];
+        tileSize[d] = std::min(imageEnd[d] + 1 - tileStart[d], (long)m_TileSize);
+        numTileVoxels *= tileSize[d];
+
+        haloStart[d] = std::max(imageStart[d], tileStart[d] - margin);
+        haloSize[d] = std::min(imageEnd[d], tileStart[d] + tileSize[d] - 1 + margin) - haloStart[d] + 1;
+        numHaloVoxels *= haloSize[d];
+    }
+
+    // Load all volumes, interleaved voxel per voxel
+    buffers.Values.resize(numHaloVoxels * numVolumes);
+    long index[SpatialDimension];
+    for (unsigned int t = 0;t < numVolumes;++t)
+    {
+        for (unsigned int d = 0;d < SpatialDimension;++d)
+            index[d] = haloStart[d];
+
+        OffsetValueType volumeOffset = (largestRegion.GetIndex()[SpatialDimension] + t - bufferStart[SpatialDimension]) * imageStrides[SpatialDimension];
+        for (unsigned int i = 0;i < numHaloVoxels;++i)
+        {
+            OffsetValueType imageOffset = volumeOffset;
+            for (unsigned int d = 0;d < SpatialDimension;++d)
+                imageOffset += (index[d] - bufferStart[d]) * imageStrides[d];
+
+            buffers.Values[i * numVolumes + t] = inputBuffer[imageOffset];
+
+            for (unsigned int d = 0;d < SpatialDimension;++d)
+            {
+                ++index[d];
+                if (index[d] < haloStart[d] + haloSize[d])
+                    break;
+
+                index[d] = haloStart[d];
+            }
+        }
+    }
+
+    // Local mean and variance images, as computed by MeanAndVarianceImagesFilter (replicated borders)
+    buffers.Means.resize(buffers.Values.size());
+    buffers.Variances.resize(buffers.Values.size());
+    for (unsigned int i = 0;i < buffers.Values.size();++i)
+    {
+        TileRealType value = buffers.Values[i];
+        buffers.Means[i] = value;
+        buffers.Variances[i] = value * value;
+    }
+
+    this->BoxFilterChannels(buffers.Means,haloSize,numVolumes,true,buffers.LineSums);
+    this->BoxFilterChannels(buffers.Variances,haloSize,numVolumes,true,buffers.LineSums);
+
+    double neighborhoodSize = std::pow(2.0 * patchHalfSize + 1.0, (double)SpatialDimension);
+    for (unsigned int i = 0;i < buffers.Means.size();++i)
+    {
+        double meanValue = buffers.Means[i] / neighborhoodSize;
+        buffers.Means[i] = meanValue;
+        buffers.Variances[i] = (buffers.Variances[i] / neighborhoodSize - meanValue * meanValue) * neighborhoodSize / (neighborhoodSize - 1.0);
+    }
+
+    buffers.WeightedSums.resize(numTileVoxels * numVolumes);
+    buffers.WeightSums.resize(numTileVoxels * numVolumes);
+    buffers.MaxWeights.resize(numTileVoxels * numVolumes);
+    std::fill(buffers.WeightedSums.begin(),buffers.WeightedSums.end(),0.0);
+    std::fill(buffers.WeightSums.begin(),buffers.WeightSums.end(),0.0);
+    std::fill(buffers.MaxWeights.begin(),buffers.MaxWeights.end(),0.0);
+
+    unsigned int numDispPerDim = 2 * (maxAbsDisp / m_SearchStepSize) + 1;
+    long displacement[SpatialDimension];
+    unsigned int displacementCounter[SpatialDimension];
+    for (unsigned int d = 0;d < SpatialDimension;++d)
+        displacementCounter[d] = 0;
+
+    long validStart[SpatialDimension], validSize[SpatialDimension];
+    long distanceStart[SpatialDimension], distanceSize[SpatialDimension];
+    bool displacementsDone = false;
+    while (!displacementsDone)
+    {
+        bool isCentralDisplacement = true;
+        for (unsigned int d = 0;d < SpatialDimension;++d)
+        {
+            displacement[d] = - maxAbsDisp + (long)(displacementCounter[d] * m_SearchStepSize);
+            if (displacement[d] != 0)
+                isCentralDisplacement = false;
+        }
+
+        displacementsDone = true;
+        for (unsigned int d = 0;d < SpatialDimension;++d)
+        {
+            ++displacementCounter[d];
+            if (displacementCounter[d] < numDispPerDim)
+            {
+                displacementsDone = false;
+                break;
+            }
+
+            displacementCounter[d] = 0;
+        }
+
+        if (isCentralDisplacement)
+            continue;
+
+        // Tile voxels whose (border clipped) patch, once displaced, stays inside the image
+        bool emptyValidRegion = false;
+        unsigned int numDistanceVoxels = 1;
+        OffsetValueType haloDisplacementOffset = 0;
+        OffsetValueType haloStride = 1;
+        for (unsigned int d = 0;d < SpatialDimension;++d)
+        {
+            long minValid = tileStart[d];
+            if (displacement[d] < 0)
+                minValid = std::max(minValid, imageStart[d] + patchHalfSize - displacement[d]);
+
+            long maxValid = tileStart[d] + tileSize[d] - 1;
+            if (displacement[d] > 0)
+                maxValid = std::min(maxValid, imageEnd[d] - patchHalfSize - displacement[d]);
+
+            if (maxValid < minValid)
+            {
+                emptyValidRegion = true;
+                break;
+            }
+
+            validStart[d] = minValid;
+            validSize[d] = maxValid - minValid + 1;
+
+            distanceStart[d] = std::max(imageStart[d], minValid - patchHalfSize);
+            distanceSize[d] = std::min(imageEnd[d], maxValid + patchHalfSize) - distanceStart[d] + 1;
+            numDistanceVoxels *= distanceSize[d];
+
+            haloDisplacementOffset += displacement[d] * haloStride;
+            haloStride *= haloSize[d];
+        }
+
+        if (emptyValidRegion)
+            continue;
+
+        // Squared differences for all volumes, then patch distances by box filtering
+        buffers.Distances.resize(numDistanceVoxels * numVolumes);
+        for (unsigned int d = 0;d < SpatialDimension;++d)
+            index[d] = distanceStart[d];
+
+        for (unsigned int i = 0;i < numDistanceVoxels;++i)
+        {
+            OffsetValueType haloOffset = 0;
+            haloStride = 1;
+            for (unsigned int d = 0;d < SpatialDimension;++d)
+            {
+                haloOffset += (index[d] - haloStart[d]) * haloStride;
+                haloStride *= haloSize[d];
+            }
+
+            const InputPixelType *refValues = &buffers.Values[haloOffset * numVolumes];
+            const InputPixelType *movingValues = &buffers.Values[(haloOffset + haloDisplacementOffset) * numVolumes];
+            TileRealType *distances = &buffers.Distances[i * numVolumes];
+            for (unsigned int t = 0;t < numVolumes;++t)
+            {
+                TileRealType diffValue = static_cast <TileRealType> (refValues[t]) - static_cast <TileRealType> (movingValues[t]);
+                distances[t] = diffValue * diffValue;
+            }
+
+            for (unsigned int d = 0;d < SpatialDimension;++d)
+            {
+                ++index[d];
+                if (index[d] < distanceStart[d] + distanceSize[d])
+                    break;
+
+                index[d] = distanceStart[d];
+            }
+        }
+
+        this->BoxFilterChannels(buffers.Distances,distanceSize,numVolumes,false,buffers.LineSums);
+
+        unsigned int numValidVoxels = 1;
+        for (unsigned int d = 0;d < SpatialDimension;++d)
+        {
+            numValidVoxels *= validSize[d];
+            index[d] = validStart[d];
+        }
+
+        for (unsigned int i = 0;i < numValidVoxels;++i)
+        {
+            OffsetValueType haloOffset = 0, distanceOffset = 0, tileOffset = 0;
+            OffsetValueType distanceStride = 1, tileStride = 1;
+            unsigned int numPatchVoxels = 1;
+            haloStride = 1;
+            for (unsigned int d = 0;d < SpatialDimension;++d)
+            {
+                haloOffset += (index[d] - haloStart[d]) * haloStride;
+                distanceOffset += (index[d] - distanceStart[d]) * distanceStride;
+                tileOffset += (index[d] - tileStart[d]) * tileStride;
+                haloStride *= haloSize[d];
+                distanceStride *= distanceSize[d];
+                tileStride *= tileSize[d];
+
+                numPatchVoxels *= std::min(imageEnd[d], index[d] + patchHalfSize) - std::max(imageStart[d], index[d] - patchHalfSize) + 1;
+            }
+
+            for (unsigned int d = 0;d < SpatialDimension;++d)
+            {
+                ++index[d];
+                if (index[d] < validStart[d] + validSize[d])
+                    break;
+
+                index[d] = validStart[d];
+            }
+
+            OffsetValueType refOffset = haloOffset * numVolumes;
+            OffsetValueType movingOffset = (haloOffset + haloDisplacementOffset) * numVolumes;
+            for (unsigned int t = 0;t < numVolumes;++t)
+            {
+                double meanRate = buffers.Means[refOffset + t] / buffers.Means[movingOffset + t];
+                double varianceRate = buffers.Variances[refOffset + t] / buffers.Variances[movingOffset + t];
+
+                // Should we compute the weight value of this patch ?
+                if (!((meanRate > m_MeanMinThreshold) && (meanRate < (1.0 / m_MeanMinThreshold)) &&
+                      (varianceRate > m_VarMinThreshold) && (varianceRate < (1.0 / m_VarMinThreshold))))
+                    continue;
+
+                double weightValue = std::exp(- buffers.Distances[distanceOffset * numVolumes + t] /
+                                              (2.0 * m_BetaParameter * m_NoiseCovariances[t] * numPatchVoxels));
+                if (weightValue <= m_WeightThreshold)
+                    continue;
+
+                double sampleValue = buffers.Values[movingOffset + t];
+                if (m_WeightMethod == RICIAN)
+                    sampleValue *= sampleValue;
+
+                unsigned int accumulatorIndex = tileOffset * numVolumes + t;
+                buffers.WeightedSums[accumulatorIndex] += weightValue * sampleValue;
+                buffers.WeightSums[accumulatorIndex] += weightValue;
+                if (buffers.MaxWeights[accumulatorIndex] < weightValue)
+                    buffers.MaxWeights[accumulatorIndex] = weightValue;
+            }
+        }
+    }
+
+    // Weighted means, written back to each volume
+    for (unsigned int d = 0;d < SpatialDimension;++d)
+        index[d] = tileStart[d];
+
+    for (unsigned int i = 0;i < numTileVoxels;++i)
+    {
+        OffsetValueType imageOffset = 0, haloOffset = 0;
+        OffsetValueType haloStride = 1;
+        for (unsigned int d = 0;d < SpatialDimension;++d)
+        {
+            imageOffset += (index[d] - outputBufferStart[d]) * outputStrides[d];
+            haloOffset += (index[d] - haloStart[d]) * haloStride;
+            haloStride *= haloSize[d];
+        }
+
+        for (unsigned int t = 0;t < numVolumes;++t)
+        {
+            unsigned int accumulatorIndex = i * numVolumes + t;
+            double inputValue = buffers.Values[haloOffset * numVolumes + t];
+            double outputValue = inputValue;
+            double weightSum = buffers.WeightSums[accumulatorIndex];
+            double maxWeight = buffers.MaxWeights[accumulatorIndex];
+
+            if (weightSum != 0)
+            {
+                if (m_WeightMethod == EXP)
+                    outputValue = (buffers.WeightedSums[accumulatorIndex] + maxWeight * inputValue) / (weightSum + maxWeight);
+                else
+                {
+                    outputValue = ((buffers.WeightedSums[accumulatorIndex] + inputValue * inputValue * maxWeight) / (weightSum + maxWeight))
+                            - (2.0 * m_NoiseCovariances[t]);
+
+                    outputValue = std::sqrt(std::max(0.0, outputValue));
+                }
+            }
+
+            OffsetValueType volumeOffset = (largestRegion.GetIndex()[SpatialDimension] + t - outputBufferStart[SpatialDimension]) * outputStrides[SpatialDimension];
+            outputBuffer[imageOffset + volumeOffset] = outputValue;
+        }
+
+        for (unsigned int d = 0;d < SpatialDimension;++d)
+        {
+            ++index[d];
+            if (index[d] < tileStart[d] + tileSize[d])
+                break;
+
+            index[d] = tileStart[d];
+        }
+    }
+}
+
+template <class TInputImage>
+void
+NonLocalMeansTemporalImageFilter <TInputImage>
+::BoxFilterChannels(std::vector <TileRealType> &buffer, const long *bufferSize, unsigned int numChannels,
+                    bool replicateBorders, std::vector <double> &lineSums)
+{
+    long patchHalfSize = m_PatchHalfSize;
+
+    unsigned int numVoxels = 1;
+    for (unsigned int d = 0;d < SpatialDimension;++d)
+        numVoxels *= bufferSize[d];
+
+    unsigned int lineStride = 1;
+    for (unsigned int k = 0;k < SpatialDimension;++k)
+    {
+        long lineLength = bufferSize[k];
+        lineSums.resize((lineLength + 1) * numChannels);
+        unsigned int numLines = numVoxels / lineLength;
+
+        for (unsigned int j = 0;j < numLines;++j)
+        {
+            // Line start: j enumerates positions along all dimensions but k
+            unsigned int lineStart = 0;
+            unsigned int remainder = j;
+            unsigned int stride = 1;
+            for (unsigned int d = 0;d < SpatialDimension;++d)
+            {
+                if (d != k)
+                {
+                    lineStart += (remainder % bufferSize[d]) * stride;
+                    remainder /= bufferSize[d];
+                }
+
+                stride *= bufferSize[d];
+            }
+
+            // Running sums along the line, channels being contiguous
+            for (unsigned int c = 0;c < numChannels;++c)
+                lineSums[c] = 0;
+
+            for (long i = 0;i < lineLength;++i)
+            {
+                const TileRealType *values = &buffer[(lineStart + i * lineStride) * numChannels];
+                for (unsigned int c = 0;c < numChannels;++c)
+                    lineSums[(i + 1) * numChannels + c] = lineSums[i * numChannels + c] + values[c];
+            }
+
+            // Values outside of the line, replicated from its ends when needed
+            const double *firstSum = &lineSums[numChannels];
+            const double *lastSum = &lineSums[lineLength * numChannels];
+            for (long i = 0;i < lineLength;++i)
+            {
+                long lowIndex = std::max(0L, i - patchHalfSize);
+                long highIndex = std::min(lineLength - 1, i + patchHalfSize);
+                long numBefore = std::max(0L, patchHalfSize - i);
+                long numAfter = std::max(0L, i + patchHalfSize - lineLength + 1);
+
+                TileRealType *values = &buffer[(lineStart + i * lineStride) * numChannels];
+                for (unsigned int c = 0;c < numChannels;++c)
+                {
+                    double sumValue = lineSums[(highIndex + 1) * numChannels + c] - lineSums[lowIndex * numChannels + c];
+                    if (replicateBorders)
+                        sumValue += numBefore * firstSum[c] + numAfter * (lastSum[c] - lineSums[(lineLength - 1) * numChannels + c]);
+
+                    values[c] = sumValue;
+                }
+            }
+        }
+
+        lineStride *= lineLength;
+    }
+}
+
+} // end of namespace anima
@@ -6,6 +6,10 @@
 #include <itkImageFileReader.h>
 #include <itkImage.h>
 
+#include <exception>
+#include <thread>
+#include <vector>
+
 namespace anima
 {
 template <class TInputImage> class ImageDataSplitter
@@ -35,8 +39,19 @@ public:
 
     bool EmptyMask(TInputIndexType &bIndex);
 
+    /**
+     * Reads the images of the current block. Only the block with its margin is requested from readers, so that streaming
+     * capable image IOs (e.g. uncompressed NRRD, NIfTI, MetaImage) read only its bytes from disk. If that block was
+     * prefetched, its images are taken from the prefetch thread instead
+     */
     void Update();
 
+    /**
+     * Starts reading the images of block bIndex in a background thread, typically the next block while the current one
+     * is processed. Prefetched images are used by the next Update if it is on that block, and dropped otherwise
+     */
+    void PrefetchBlock(TInputIndexType &bIndex);
+
     TInputRegionType GetSpecificBlockRegion(TInputIndexType &block);
     TInputRegionType GetBlockRegion() {if (m_NeedsUpdate) this->Update(); return m_BlockRegion;}
     TInputRegionType GetBlockRegionWithMargin() {if (m_NeedsUpdate) this->Update(); return m_BlockRegionWithMargin;}
@@ -48,6 +63,16 @@ public:
     unsigned int GetNbImages() {return m_NbImages;}
 
 private:
+    //! Block region with margin, clipped to the mask largest region
+    TInputRegionType ComputeBlockRegionWithMargin(TInputRegionType &blockRegion);
+
+    //! Reads regionWithMargin of all input files into images with a null starting index
+    void ReadBlockImages(const TInputRegionType &regionWithMargin, std::vector <TInputPointer> &images);
+
+    void PrefetchImages();
+    void WaitForPrefetch();
+    void CancelPrefetch();
+
     unsigned int m_NbImages;
     bool m_NeedsUpdate;
     TInputIndexType m_NbBlocks;
@@ -60,6 +85,13 @@ private:
     std::vector <TInputPointer> m_Images;
     std::vector <std::string> m_FileNames;
     MaskImagePointer m_MaskImage, m_SmallMask, m_SmallMaskWithMargin;
+
+    // Prefetch thread data
+    std::thread m_PrefetchThread;
+    bool m_PrefetchPending;
+    TInputRegionType m_PrefetchRegionWithMargin;
+    std::vector <TInputPointer> m_PrefetchedImages;
+    std::exception_ptr m_PrefetchError;
 };
 
 } // end namespace anima
@@ -13,6 +13,7 @@ template <typename TInputImage> ImageDataSplitter<TInputImage>::ImageDataSplitte
 {
     m_NbImages = 0;
     m_NeedsUpdate = true;
+    m_PrefetchPending = false;
 
     m_NbBlocks.Fill (0);
     m_Block.Fill (0);
@@ -36,12 +37,16 @@ template <typename TInputImage> ImageDataSplitter<TInputImage>::ImageDataSplitte
 
 template <typename TInputImage> ImageDataSplitter<TInputImage>::~ImageDataSplitter()
 {
+    this->WaitForPrefetch();
+
     m_Images.clear();
     m_FileNames.clear();
 }
 
 template <typename TInputImage> void ImageDataSplitter<TInputImage>::SetUniqueFileName(std::string &inputFileName)
 {
+    this->CancelPrefetch();
+
     m_FileNames.clear();
     m_FileNames.push_back(inputFileName);
     m_NbImages = 1;
@@ -60,6 +65,7 @@ template <typename TInputImage> void ImageDataSplitter<TInputImage>::SetFileName
         throw itk::ExceptionObject(__FILE__, __LINE__,error,ITK_LOCATION);
     }
 
+    this->CancelPrefetch();
     m_FileNames.clear();
 
     char tmpStr[2048];
@@ -78,6 +84,8 @@ template <typename TInputImage> void ImageDataSplitter<TInputImage>::SetFileName
 
 template <typename TInputImage> void ImageDataSplitter<TInputImage>::SetComputationMask(MaskImageType::Pointer &maskIm)
 {
+    this->CancelPrefetch();
+
     m_MaskImage = maskIm;
     typedef itk::ImageRegionConstIteratorWithIndex< MaskImageType > MaskIteratorType;
 
@@ -200,29 +208,8 @@ template <typename TInputImage> void ImageDataSplitter<TInputImage>::Update()
     if (!m_MaskImage)
         throw itk::ExceptionObject(__FILE__, __LINE__,"No mask input. This is required. Exiting...",ITK_LOCATION);
 
-    for (unsigned int i = 0;i < m_GlobalRegionOfInterest.GetImageDimension();++i)
-    {
-        m_BlockRegion.SetIndex(i,m_GlobalRegionOfInterest.GetIndex(i) + m_GlobalRegionOfInterest.GetSize(i)*m_Block[i]/m_NbBlocks[i]);
-        unsigned int tmpMax = m_GlobalRegionOfInterest.GetIndex(i) + m_GlobalRegionOfInterest.GetSize(i)*(1+m_Block[i])/m_NbBlocks[i] - m_BlockRegion.GetIndex(i);
-        m_BlockRegion.SetSize(i,tmpMax);
-    }
-
-    m_BlockRegionWithMargin = m_BlockRegion;
-    for (unsigned int i = 0;i < m_GlobalRegionOfInterest.GetImageDimension();++i)
-    {
-        if (m_Margin[i] != 0)
-        {
-            unsigned int tmpMin = m_BlockRegion.GetIndex()[i] - m_Margin[i];
-            if (tmpMin < m_MaskImage->GetLargestPossibleRegion().GetIndex()[i])
-                tmpMin = m_MaskImage->GetLargestPossibleRegion().GetIndex()[i];
-            unsigned int tmpMax = m_BlockRegion.GetIndex()[i] + m_BlockRegion.GetSize()[i] + m_Margin[i] - 1;
-            if (tmpMax >= m_MaskImage->GetLargestPossibleRegion().GetIndex()[i] + m_MaskImage->GetLargestPossibleRegion().GetSize()[i])
-                tmpMax = m_MaskImage->GetLargestPossibleRegion().GetIndex()[i] + m_MaskImage->GetLargestPossibleRegion().GetSize()[i] - 1;
-
-            m_BlockRegionWithMargin.SetIndex(i,tmpMin);
-            m_BlockRegionWithMargin.SetSize(i,tmpMax - tmpMin + 1);
-        }
-    }
+    m_BlockRegion = this->GetSpecificBlockRegion(m_Block);
+    m_BlockRegionWithMargin = this->ComputeBlockRegionWithMargin(m_BlockRegion);
 
     MaskImageType::RegionType tmpRegion = m_BlockRegion;
     for (unsigned int i = 0;i < MaskImageType::GetImageDimension();++i)
@@ -267,26 +254,91 @@ template <typename TInputImage> void ImageDataSplitter<TInputImage>::Update()
         ++maskItWM;
     }
 
+    this->WaitForPrefetch();
+    if (m_PrefetchPending && (m_PrefetchRegionWithMargin == m_BlockRegionWithMargin))
+    {
+        m_PrefetchPending = false;
+        if (m_PrefetchError)
+        {
+            std::exception_ptr prefetchError = m_PrefetchError;
+            m_PrefetchError = std::exception_ptr();
+            std::rethrow_exception(prefetchError);
+        }
+
+        m_Images.swap(m_PrefetchedImages);
+    }
+    else
+        this->ReadBlockImages(m_BlockRegionWithMargin,m_Images);
+
+    this->CancelPrefetch();
+
+    m_NeedsUpdate = false;
+}
+
+template <typename TInputImage> typename TInputImage::RegionType ImageDataSplitter<TInputImage>::ComputeBlockRegionWithMargin(TInputRegionType &blockRegion)
+{
+    TInputRegionType blockRegionWithMargin = blockRegion;
+    for (unsigned int i = 0;i < m_GlobalRegionOfInterest.GetImageDimension();++i)
+    {
+        if (m_Margin[i] != 0)
+        {
+            unsigned int tmpMin = blockRegion.GetIndex()[i] - m_Margin[i];
+            if (tmpMin < m_MaskImage->GetLargestPossibleRegion().GetIndex()[i])
+                tmpMin = m_MaskImage->GetLargestPossibleRegion().GetIndex()[i];
+            unsigned int tmpMax = blockRegion.GetIndex()[i] + blockRegion.GetSize()[i] + m_Margin[i] - 1;
+            if (tmpMax >= m_MaskImage->GetLargestPossibleRegion().GetIndex()[i] + m_MaskImage->GetLargestPossibleRegion().GetSize()[i])
+                tmpMax = m_MaskImage->GetLargestPossibleRegion().GetIndex()[i] + m_MaskImage->GetLargestPossibleRegion().GetSize()[i] - 1;
+
+            blockRegionWithMargin.SetIndex(i,tmpMin);
+            blockRegionWithMargin.SetSize(i,tmpMax - tmpMin + 1);
+        }
+    }
+
+    return blockRegionWithMargin;
+}
+
+template <typename TInputImage> void ImageDataSplitter<TInputImage>::ReadBlockImages(const TInputRegionType &regionWithMargin,
+                                                                                     std::vector <TInputPointer> &images)
+{
+    images.clear();
+
+    TInputRegionType tmpRegion = regionWithMargin;
+    for (unsigned int i = 0;i < TInputImage::GetImageDimension();++i)
+        tmpRegion.SetIndex(i,0);
+
     for (unsigned int i = 0;i < m_FileNames.size();++i)
     {
         std::cout << "Processing image file " << m_FileNames[i] << "..." << std::endl;
         InputReaderPointer tmpImReader = InputReaderType::New();
         tmpImReader->SetFileName(m_FileNames[i]);
+
+        // Request only the block with its margin: image IOs that cannot stream enlarge it to the whole image
+        tmpImReader->UpdateOutputInformation();
+        if (!tmpImReader->GetOutput()->GetLargestPossibleRegion().IsInside(regionWithMargin))
+        {
+            std::string error("Image ");
+            error += m_FileNames[i];
+            error += " does not contain the requested block, it should be on the mask grid...";
+
+            throw itk::ExceptionObject(__FILE__, __LINE__,error,ITK_LOCATION);
+        }
+
+        tmpImReader->GetOutput()->SetRequestedRegion(regionWithMargin);
         tmpImReader->Update();
 
-        m_Images.push_back(TInputImage::New());
-        m_Images[i]->Initialize();
-        m_Images[i]->SetRegions(tmpRegion);
-        m_Images[i]->SetOrigin(m_MaskImage->GetOrigin());
-        m_Images[i]->SetDirection(m_MaskImage->GetDirection());
-        m_Images[i]->SetSpacing(m_MaskImage->GetSpacing());
+        images.push_back(TInputImage::New());
+        images[i]->Initialize();
+        images[i]->SetRegions(tmpRegion);
+        images[i]->SetOrigin(m_MaskImage->GetOrigin());
+        images[i]->SetDirection(m_MaskImage->GetDirection());
+        images[i]->SetSpacing(m_MaskImage->GetSpacing());
 
-        m_Images[i]->SetNumberOfComponentsPerPixel(tmpImReader->GetOutput()->GetNumberOfComponentsPerPixel());
+        images[i]->SetNumberOfComponentsPerPixel(tmpImReader->GetOutput()->GetNumberOfComponentsPerPixel());
 
-        m_Images[i]->Allocate();
+        images[i]->Allocate();
 
-        itk::ImageRegionIterator <TInputImage> cropImIt(m_Images[i],tmpRegion);
-        itk::ImageRegionConstIterator <TInputImage> reImIt(tmpImReader->GetOutput(),m_BlockRegionWithMargin);
+        itk::ImageRegionIterator <TInputImage> cropImIt(images[i],tmpRegion);
+        itk::ImageRegionConstIterator <TInputImage> reImIt(tmpImReader->GetOutput(),regionWithMargin);
 
         while (!cropImIt.IsAtEnd())
         {
@@ -296,8 +348,50 @@ template <typename TInputImage> void ImageDataSplitter<TInputImage>::Update()
             ++reImIt;
         }
     }
+}
 
-    m_NeedsUpdate = false;
+template <typename TInputImage> void ImageDataSplitter<TInputImage>::PrefetchBlock(TInputIndexType &bIndex)
+{
+    if (!m_MaskImage)
+        throw itk::ExceptionObject(__FILE__, __LINE__,"No mask input. This is required. Exiting...",ITK_LOCATION);
+
+    this->CancelPrefetch();
+
+    TInputRegionType blockRegion = this->GetSpecificBlockRegion(bIndex);
+    m_PrefetchRegionWithMargin = this->ComputeBlockRegionWithMargin(blockRegion);
+    m_PrefetchError = std::exception_ptr();
+
+    m_PrefetchPending = true;
+    m_PrefetchThread = std::thread(&ImageDataSplitter<TInputImage>::PrefetchImages, this);
+}
+
+template <typename TInputImage> void ImageDataSplitter<TInputImage>::PrefetchImages()
+{
+    try
+    {
+        this->ReadBlockImages(m_PrefetchRegionWithMargin,m_PrefetchedImages);
+    }
+    catch (...)
+    {
+        // Reported by Update if the block is used
+        m_PrefetchError = std::current_exception();
+        m_PrefetchedImages.clear();
+    }
+}
+
+template <typename TInputImage> void ImageDataSplitter<TInputImage>::WaitForPrefetch()
+{
+    if (m_PrefetchThread.joinable())
+        m_PrefetchThread.join();
+}
+
+template <typename TInputImage> void ImageDataSplitter<TInputImage>::CancelPrefetch()
+{
+    this->WaitForPrefetch();
+
+    m_PrefetchPending = false;
+    m_PrefetchedImages.clear();
+    m_PrefetchError = std::exception_ptr();
 }
 
 template <typename TInputImage> typename TInputImage::RegionType ImageDataSplitter<TInputImage>::GetBlockRegionInsideMargin()
@@ -3,6 +3,7 @@
 #include <itkImageToImageFilter.h>
 #include <mutex>
 #include <itkVariableLengthVector.h>
+#include <animaWorkStealingRangeScheduler.h>
 
 namespace anima
 {
@@ -37,12 +38,14 @@ public:
     itkSetMacro(ComputationRegion, OutputImageRegionType)
     itkGetMacro(ComputationRegion, OutputImageRegionType)
 
+    //! Scheduler of the last run, gives access to per-thread load balance statistics
+    const anima::WorkStealingRangeScheduler &GetSliceScheduler() {return m_SliceScheduler;}
+
 protected:
     NumberedThreadImageToImageFilter()
     {
         m_NumberOfProcessedPoints = 0;
         m_ComputationRegion.SetSize(0,0);
-        m_HighestProcessedSlice = 0;
         m_ProcessedDimension = 0;
     }
 
@@ -52,7 +55,7 @@ protected:
     virtual void BeforeThreadedGenerateData() ITK_OVERRIDE;
 
     static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ThreaderMultiSplitCallback(void *arg);
-    virtual void ThreadProcessSlices();
+    virtual void ThreadProcessSlices(unsigned int threadId);
 
     unsigned int GetSafeThreadId();
     void SafeReleaseThreadId(unsigned int threadId);
@@ -88,8 +91,7 @@ private:
     unsigned int m_NumberOfProcessedPoints;
     unsigned int m_NumberOfPointsToProcess;
 
-    std::mutex m_LockHighestProcessedSlice;
-    int m_HighestProcessedSlice;
+    anima::WorkStealingRangeScheduler m_SliceScheduler;
     unsigned int m_ProcessedDimension;
 
     // Optimization of multithread code, compute only on region defined from mask... Uninitialized in constructor.
@@ -50,7 +50,7 @@ NumberedThreadImageToImageFilter <TInputImage, TOutputImage>
     this->AllocateOutputs();
     this->BeforeThreadedGenerateData();
 
-    m_HighestProcessedSlice = 0;
+    m_SliceScheduler.Initialize(m_ComputationRegion.GetSize()[m_ProcessedDimension],this->GetNumberOfWorkUnits());
 
     ThreadStruct str;
     str.Filter = this;
@@ -68,13 +68,11 @@ ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
 NumberedThreadImageToImageFilter <TInputImage, TOutputImage>
 ::ThreaderMultiSplitCallback(void *arg)
 {
-    ThreadStruct *str;
-    itk::ThreadIdType threadId;
-
-    str = (ThreadStruct *)( ( (itk::MultiThreaderBase::WorkUnitInfo *)( arg ) )->UserData );
+    itk::MultiThreaderBase::WorkUnitInfo *threadArgs = (itk::MultiThreaderBase::WorkUnitInfo *)arg;
+    ThreadStruct *str = (ThreadStruct *)(threadArgs->UserData);
 
     Self *filterPtr = dynamic_cast <Self *> (str->Filter.GetPointer());
-    filterPtr->ThreadProcessSlices();
+    filterPtr->ThreadProcessSlices(threadArgs->WorkUnitID);
 
     return ITK_THREAD_RETURN_DEFAULT_VALUE;
 }
@@ -82,28 +80,15 @@ NumberedThreadImageToImageFilter <TInputImage, TOutputImage>
 template< typename TInputImage, typename TOutputImage >
 void
 NumberedThreadImageToImageFilter <TInputImage, TOutputImage>
-::ThreadProcessSlices()
+::ThreadProcessSlices(unsigned int threadId)
 {
     OutputImageRegionType processedRegion = m_ComputationRegion;
-    processedRegion.SetSize(m_ProcessedDimension,1);
-    unsigned int highestToleratedSliceValue = m_ComputationRegion.GetSize()[m_ProcessedDimension] - 1;
 
-    bool continueLoop = true;
-    while (continueLoop)
+    unsigned int startSlice, endSlice;
+    while (m_SliceScheduler.GetNextChunk(threadId,startSlice,endSlice))
     {
-        m_LockHighestProcessedSlice.lock();
-
-        if (m_HighestProcessedSlice > highestToleratedSliceValue)
-        {
-            m_LockHighestProcessedSlice.unlock();
-            continueLoop = false;
-            continue;
-        }
-
-        processedRegion.SetIndex(m_ProcessedDimension, m_ComputationRegion.GetIndex()[m_ProcessedDimension] + m_HighestProcessedSlice);
-        m_HighestProcessedSlice++;
-
-        m_LockHighestProcessedSlice.unlock();
+        processedRegion.SetIndex(m_ProcessedDimension, m_ComputationRegion.GetIndex()[m_ProcessedDimension] + startSlice);
+        processedRegion.SetSize(m_ProcessedDimension, endSlice - startSlice);
 
         this->DynamicThreadedGenerateData(processedRegion);
     }
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <itkImportImageContainer.h>
+
+#include <cstdint>
+#include <string>
+
+namespace anima
+{
+
+/**
+ * @brief Pixel container on a memory mapped cache file, unmapped when the container is destroyed. The mapping is private:
+ * in place modifications of the image are never written back to the cache file.
+ */
+template <class TElement>
+class MappedImageContainer : public itk::ImportImageContainer <itk::SizeValueType, TElement>
+{
+public:
+    typedef MappedImageContainer Self;
+    typedef itk::ImportImageContainer <itk::SizeValueType, TElement> Superclass;
+    typedef itk::SmartPointer <Self> Pointer;
+    typedef itk::SmartPointer <const Self> ConstPointer;
+
+    itkNewMacro(Self)
+    itkTypeMacro(MappedImageContainer, itk::ImportImageContainer)
+
+    //! Uses numElements elements starting at dataOffset bytes in the mapping, ownership of the mapping is taken
+    void SetMapping(void *mappedAddress, std::size_t mappedLength, std::size_t dataOffset, itk::SizeValueType numElements);
+
+protected:
+    MappedImageContainer();
+    virtual ~MappedImageContainer();
+
+private:
+    ITK_DISALLOW_COPY_AND_ASSIGN(MappedImageContainer);
+
+    void *m_MappedAddress;
+    std::size_t m_MappedLength;
+};
+
+/**
+ * @brief Optional on-disk cache of images in raw form, used by anima::readImage. Each cached image is a page aligned raw
+ * file (a header page holding the source file name, size, modification time in nanoseconds and a hash of its first and
+ * last pages, the image geometry and pixel type, followed by the pixel buffer), memory mapped on later reads so that
+ * compressed inputs are decompressed only once across runs. Only images read from files are stored, so that a cached
+ * read always gives the image read from the file. Only single file formats (.nii, .nii.gz, .nrrd, .mha) are cached: the
+ * validity check only looks at the source file itself, that would miss rewrites of a separate data file (.mhd / .raw,
+ * .hdr / .img, .nhdr). The cache is enabled by setting ANIMA_IMAGE_CACHE_DIR to a directory,
+ * its size is bounded by ANIMA_IMAGE_CACHE_MAX_SIZE (in MB, 20 GB by default), least recently used files being removed
+ * first. Temporary files left by interrupted stores count in the cache size and are removed once old enough.
+ * Cache failures are never reported: images are then simply read the usual way. Not available on Windows.
+ */
+class RawImageCache
+{
+public:
+    //! Cache directory, empty if cache is disabled
+    static std::string GetCacheDirectory();
+
+    //! Maximal cache size in bytes
+    static uint64_t GetMaximalCacheSize();
+
+    //! Reads image cached for fileName, returns a null pointer if not cached, outdated or if cache is disabled
+    template <class ImageType>
+    static typename ImageType::Pointer ReadImage(const std::string &fileName);
+
+    //! Stores image, as just read from fileName (that has to exist), as its cached version, then evicts old files if needed
+    template <class ImageType>
+    static void StoreImage(const std::string &fileName, ImageType *image);
+
+private:
+    static const unsigned int m_HeaderSize = 4096;
+    static const unsigned int m_MaximalDimension = 8;
+    static const unsigned int m_HashedPageSize = 4096;
+
+    //! Age (in seconds) after which temporary files are considered left by interrupted stores
+    static const long int m_TemporaryFileMaximalAge = 3600;
+
+    struct CacheHeader
+    {
+        char Magic[8];
+        uint32_t Version;
+        uint32_t Dimension;
+        uint32_t NumberOfComponents;
+        uint32_t ElementSize;
+        uint64_t NumberOfElements;
+        uint64_t SourceSize;
+        int64_t SourceTime;
+        int64_t SourceTimeNanoseconds;
+        uint64_t SourcePagesHash;
+        int64_t Index[m_MaximalDimension];
+        uint64_t Size[m_MaximalDimension];
+        double Origin[m_MaximalDimension];
+        double Spacing[m_MaximalDimension];
+        double Direction[m_MaximalDimension * m_MaximalDimension];
+        char TypeName[256];
+        char SourceName[2048];
+    };
+
+    //! Fills source description fields of header, false if fileName cannot be cached
+    template <class ImageType>
+    static bool InitializeHeader(const std::string &fileName, CacheHeader &header);
+
+    //! True if fileName is in a single file format, that the cache handles
+    static bool IsSingleFileFormat(const std::string &fileName);
+
+    //! Size and modification time (seconds and nanoseconds) of fileName, false on failure
+    static bool GetSourceStatus(const std::string &fileName, uint64_t &fileSize, int64_t &modifiedTime, int64_t &modifiedTimeNanoseconds);
+
+    //! FNV-1a hash of the first and last pages of fileName, catches rewrites not seen by modification times
+    static uint64_t ComputeSourcePagesHash(const std::string &fileName, uint64_t fileSize);
+
+    static std::string GetCacheFileName(const std::string &cacheDirectory, const CacheHeader &header);
+    static bool HasSameSource(const CacheHeader &header, const CacheHeader &cachedHeader);
+
+    //! Removes old temporary files, then least recently used cache files (by modification time) until cache fits, keeping keptFileName
+    static void EvictLeastRecentlyUsed(const std::string &cacheDirectory, const std::string &keptFileName);
+};
+
+} // end namespace anima
+
+#include "animaRawImageCache.hxx"
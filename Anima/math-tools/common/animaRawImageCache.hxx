@@ -0,0 +1,419 @@
+#pragma once
+#include "animaRawImageCache.h"
+
+#include <itksys/Directory.hxx>
+#include <itksys/SystemTools.hxx>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace anima
+{
+
+template <class TElement>
+MappedImageContainer <TElement>
+::MappedImageContainer()
+{
+    m_MappedAddress = ITK_NULLPTR;
+    m_MappedLength = 0;
+}
+
+template <class TElement>
+MappedImageContainer <TElement>
+::~MappedImageContainer()
+{
+#ifndef _WIN32
+    if (m_MappedAddress)
+        munmap(m_MappedAddress, m_MappedLength);
+#endif
+}
+
+template <class TElement>
+void
+MappedImageContainer <TElement>
+::SetMapping(void *mappedAddress, std::size_t mappedLength, std::size_t dataOffset, itk::SizeValueType numElements)
+{
+#ifndef _WIN32
+    if (m_MappedAddress)
+        munmap(m_MappedAddress, m_MappedLength);
+#endif
+
+    m_MappedAddress = mappedAddress;
+    m_MappedLength = mappedLength;
+
+    this->SetImportPointer(reinterpret_cast <TElement *> (static_cast <char *> (mappedAddress) + dataOffset), numElements, false);
+}
+
+inline std::string
+RawImageCache
+::GetCacheDirectory()
+{
+#ifdef _WIN32
+    return "";
+#else
+    const char *cacheDirectory = std::getenv("ANIMA_IMAGE_CACHE_DIR");
+    if ((!cacheDirectory) || (strcmp(cacheDirectory,"") == 0))
+        return "";
+
+    std::string cacheDirectoryName(cacheDirectory);
+    if (!itksys::SystemTools::FileIsDirectory(cacheDirectoryName))
+    {
+        if (!itksys::SystemTools::MakeDirectory(cacheDirectoryName))
+            return "";
+    }
+
+    return cacheDirectoryName;
+#endif
+}
+
+inline uint64_t
+RawImageCache
+::GetMaximalCacheSize()
+{
+    uint64_t maximalSizeInMB = 20480;
+
+    const char *maximalSize = std::getenv("ANIMA_IMAGE_CACHE_MAX_SIZE");
+    if (maximalSize && (strcmp(maximalSize,"") != 0))
+        maximalSizeInMB = std::strtoull(maximalSize, ITK_NULLPTR, 10);
+
+    return maximalSizeInMB * 1024 * 1024;
+}
+
+template <class ImageType>
+bool
+RawImageCache
+::InitializeHeader(const std::string &fileName, CacheHeader &header)
+{
+    static_assert(sizeof(CacheHeader) <= m_HeaderSize, "Cache header should fit in its page");
+
+    // Raw copies of the buffer are only valid for plain pixel types
+    typedef typename ImageType::PixelContainer::Element ElementType;
+    if ((!std::is_trivially_copyable <ElementType>::value) || (ImageType::ImageDimension > m_MaximalDimension))
+        return false;
+
+    if ((!IsSingleFileFormat(fileName)) || (!itksys::SystemTools::FileExists(fileName, true)))
+        return false;
+
+    std::string fullName = itksys::SystemTools::CollapseFullPath(fileName);
+    std::string typeName = typeid(ImageType).name();
+    if ((fullName.size() >= sizeof(header.SourceName)) || (typeName.size() >= sizeof(header.TypeName)))
+        return false;
+
+    std::memset(&header, 0, sizeof(CacheHeader));
+    std::memcpy(header.Magic, "ANIMARAW", 8);
+    header.Version = 2;
+    header.Dimension = ImageType::ImageDimension;
+    header.ElementSize = sizeof(ElementType);
+
+    if (!GetSourceStatus(fullName, header.SourceSize, header.SourceTime, header.SourceTimeNanoseconds))
+        return false;
+
+    header.SourcePagesHash = ComputeSourcePagesHash(fullName, header.SourceSize);
+    std::strcpy(header.TypeName, typeName.c_str());
+    std::strcpy(header.SourceName, fullName.c_str());
+
+    return true;
+}
+
+inline bool
+RawImageCache
+::IsSingleFileFormat(const std::string &fileName)
+{
+    std::string lowerName = itksys::SystemTools::LowerCase(fileName);
+    const char *extensions[4] = {".nii", ".nii.gz", ".nrrd", ".mha"};
+
+    for (unsigned int i = 0;i < 4;++i)
+    {
+        std::string extension(extensions[i]);
+        if ((lowerName.size() > extension.size()) &&
+                (lowerName.compare(lowerName.size() - extension.size(), extension.size(), extension) == 0))
+            return true;
+    }
+
+    return false;
+}
+
+inline bool
+RawImageCache
+::GetSourceStatus(const std::string &fileName, uint64_t &fileSize, int64_t &modifiedTime, int64_t &modifiedTimeNanoseconds)
+{
+#ifdef _WIN32
+    return false;
+#else
+    struct stat sourceStat;
+    if (stat(fileName.c_str(), &sourceStat) != 0)
+        return false;
+
+    fileSize = sourceStat.st_size;
+#ifdef __APPLE__
+    modifiedTime = sourceStat.st_mtimespec.tv_sec;
+    modifiedTimeNanoseconds = sourceStat.st_mtimespec.tv_nsec;
+#else
+    modifiedTime = sourceStat.st_mtim.tv_sec;
+    modifiedTimeNanoseconds = sourceStat.st_mtim.tv_nsec;
+#endif
+
+    return true;
+#endif
+}
+
+inline uint64_t
+RawImageCache
+::ComputeSourcePagesHash(const std::string &fileName, uint64_t fileSize)
+{
+    std::vector <char> pages;
+    std::ifstream sourceFile(fileName.c_str(), std::ios::binary);
+
+    uint64_t firstPageSize = std::min((uint64_t)m_HashedPageSize, fileSize);
+    pages.resize(firstPageSize);
+    sourceFile.read(pages.data(), firstPageSize);
+
+    if (fileSize > m_HashedPageSize)
+    {
+        uint64_t lastPageStart = std::max((uint64_t)m_HashedPageSize, fileSize - m_HashedPageSize);
+        pages.resize(firstPageSize + fileSize - lastPageStart);
+        sourceFile.seekg(lastPageStart);
+        sourceFile.read(pages.data() + firstPageSize, fileSize - lastPageStart);
+    }
+
+    uint64_t hashValue = 14695981039346656037ULL;
+    for (unsigned int i = 0;i < pages.size();++i)
+    {
+        hashValue ^= (unsigned char)pages[i];
+        hashValue *= 1099511628211ULL;
+    }
+
+    return hashValue;
+}
+
+inline std::string
+RawImageCache
+::GetCacheFileName(const std::string &cacheDirectory, const CacheHeader &header)
+{
+    std::string key = header.SourceName;
+    key += "|";
+    key += header.TypeName;
+
+    std::ostringstream cacheFileName;
+    cacheFileName << cacheDirectory << "/" << std::hex << std::hash <std::string> () (key) << ".raw";
+
+    return cacheFileName.str();
+}
+
+inline bool
+RawImageCache
+::HasSameSource(const CacheHeader &header, const CacheHeader &cachedHeader)
+{
+    if (std::memcmp(header.Magic, cachedHeader.Magic, 8) != 0)
+        return false;
+
+    if ((header.Version != cachedHeader.Version) || (header.Dimension != cachedHeader.Dimension) ||
+            (header.ElementSize != cachedHeader.ElementSize))
+        return false;
+
+    if ((header.SourceSize != cachedHeader.SourceSize) || (header.SourceTime != cachedHeader.SourceTime) ||
+            (header.SourceTimeNanoseconds != cachedHeader.SourceTimeNanoseconds) || (header.SourcePagesHash != cachedHeader.SourcePagesHash))
+        return false;
+
+    return (std::strncmp(header.TypeName, cachedHeader.TypeName, sizeof(header.TypeName)) == 0) &&
+            (std::strncmp(header.SourceName, cachedHeader.SourceName, sizeof(header.SourceName)) == 0);
+}
+
+template <class ImageType>
+typename ImageType::Pointer
+RawImageCache
+::ReadImage(const std::string &fileName)
+{
+    typename ImageType::Pointer image;
+
+    std::string cacheDirectory = GetCacheDirectory();
+    if (cacheDirectory == "")
+        return image;
+
+    CacheHeader header;
+    if (!InitializeHeader <ImageType> (fileName, header))
+        return image;
+
+#ifndef _WIN32
+    std::string cacheFileName = GetCacheFileName(cacheDirectory, header);
+    int fileDescriptor = open(cacheFileName.c_str(), O_RDONLY);
+    if (fileDescriptor < 0)
+        return image;
+
+    CacheHeader cachedHeader;
+    struct stat cacheStat;
+    bool validFile = (fstat(fileDescriptor, &cacheStat) == 0) &&
+            (pread(fileDescriptor, &cachedHeader, sizeof(CacheHeader), 0) == sizeof(CacheHeader)) &&
+            HasSameSource(header, cachedHeader) &&
+            ((uint64_t)cacheStat.st_size == m_HeaderSize + cachedHeader.NumberOfElements * cachedHeader.ElementSize);
+
+    // Private mapping: pages are copied on write, the cache file is never modified
+    void *mappedAddress = MAP_FAILED;
+    std::size_t mappedLength = validFile ? cacheStat.st_size : 0;
+    if (validFile)
+        mappedAddress = mmap(ITK_NULLPTR, mappedLength, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileDescriptor, 0);
+
+    close(fileDescriptor);
+    if (mappedAddress == MAP_FAILED)
+        return image;
+
+    typedef typename ImageType::PixelContainer::Element ElementType;
+    typedef anima::MappedImageContainer <ElementType> ContainerType;
+    typename ContainerType::Pointer container = ContainerType::New();
+    container->SetMapping(mappedAddress, mappedLength, m_HeaderSize, cachedHeader.NumberOfElements);
+
+    typename ImageType::RegionType region;
+    typename ImageType::PointType origin;
+    typename ImageType::SpacingType spacing;
+    typename ImageType::DirectionType direction;
+    for (unsigned int i = 0;i < ImageType::ImageDimension;++i)
+    {
+        region.SetIndex(i, cachedHeader.Index[i]);
+        region.SetSize(i, cachedHeader.Size[i]);
+        origin[i] = cachedHeader.Origin[i];
+        spacing[i] = cachedHeader.Spacing[i];
+
+        for (unsigned int j = 0;j < ImageType::ImageDimension;++j)
+            direction(i,j) = cachedHeader.Direction[i * m_MaximalDimension + j];
+    }
+
+    image = ImageType::New();
+    image->Initialize();
+    image->SetNumberOfComponentsPerPixel(cachedHeader.NumberOfComponents);
+    image->SetRegions(region);
+    image->SetOrigin(origin);
+    image->SetSpacing(spacing);
+    image->SetDirection(direction);
+    image->SetPixelContainer(container);
+
+    // Modification time is the last access time for eviction
+    itksys::SystemTools::Touch(cacheFileName, false);
+#endif
+
+    return image;
+}
+
+template <class ImageType>
+void
+RawImageCache
+::StoreImage(const std::string &fileName, ImageType *image)
+{
+    std::string cacheDirectory = GetCacheDirectory();
+    if ((cacheDirectory == "") || (!image))
+        return;
+
+    if (image->GetBufferedRegion() != image->GetLargestPossibleRegion())
+        return;
+
+    CacheHeader header;
+    if (!InitializeHeader <ImageType> (fileName, header))
+        return;
+
+#ifndef _WIN32
+    typename ImageType::PixelContainer *pixelContainer = image->GetPixelContainer();
+    header.NumberOfComponents = image->GetNumberOfComponentsPerPixel();
+    header.NumberOfElements = pixelContainer->Size();
+
+    typename ImageType::RegionType region = image->GetLargestPossibleRegion();
+    for (unsigned int i = 0;i < ImageType::ImageDimension;++i)
+    {
+        header.Index[i] = region.GetIndex(i);
+        header.Size[i] = region.GetSize(i);
+        header.Origin[i] = image->GetOrigin()[i];
+        header.Spacing[i] = image->GetSpacing()[i];
+
+        for (unsigned int j = 0;j < ImageType::ImageDimension;++j)
+            header.Direction[i * m_MaximalDimension + j] = image->GetDirection()(i,j);
+    }
+
+    // Written to a temporary file then renamed, so that other processes never map a partial file
+    std::string cacheFileName = GetCacheFileName(cacheDirectory, header);
+    std::ostringstream temporaryName;
+    temporaryName << cacheFileName << "." << getpid() << "." << std::this_thread::get_id() << ".tmp";
+
+    std::vector <char> headerPage(m_HeaderSize, 0);
+    std::memcpy(headerPage.data(), &header, sizeof(CacheHeader));
+
+    std::ofstream cacheFile(temporaryName.str().c_str(), std::ios::binary);
+    cacheFile.write(headerPage.data(), headerPage.size());
+    cacheFile.write(reinterpret_cast <const char *> (pixelContainer->GetBufferPointer()),
+                    header.NumberOfElements * header.ElementSize);
+    cacheFile.close();
+
+    if ((!cacheFile) || (std::rename(temporaryName.str().c_str(), cacheFileName.c_str()) != 0))
+    {
+        itksys::SystemTools::RemoveFile(temporaryName.str());
+        return;
+    }
+
+    EvictLeastRecentlyUsed(cacheDirectory, cacheFileName);
+#endif
+}
+
+inline void
+RawImageCache
+::EvictLeastRecentlyUsed(const std::string &cacheDirectory, const std::string &keptFileName)
+{
+    uint64_t maximalSize = GetMaximalCacheSize();
+
+    itksys::Directory directory;
+    if (!directory.Load(cacheDirectory))
+        return;
+
+    long int currentTime = std::time(ITK_NULLPTR);
+    uint64_t totalSize = 0;
+    std::vector < std::pair <long int, std::string> > cacheFiles;
+    for (unsigned long int i = 0;i < directory.GetNumberOfFiles();++i)
+    {
+        std::string name = directory.GetFile(i);
+        std::string fullName = cacheDirectory + "/" + name;
+
+        // Temporary files of stores in progress are counted, those left by interrupted stores are removed
+        if ((name.size() >= 4) && (name.compare(name.size() - 4, 4, ".tmp") == 0) && (name.find(".raw.") != std::string::npos))
+        {
+            if (currentTime - itksys::SystemTools::ModifiedTime(fullName) > m_TemporaryFileMaximalAge)
+                itksys::SystemTools::RemoveFile(fullName);
+            else
+                totalSize += itksys::SystemTools::FileLength(fullName);
+
+            continue;
+        }
+
+        if ((name.size() < 4) || (name.compare(name.size() - 4, 4, ".raw") != 0))
+            continue;
+
+        totalSize += itksys::SystemTools::FileLength(fullName);
+
+        if (fullName != keptFileName)
+            cacheFiles.push_back(std::make_pair(itksys::SystemTools::ModifiedTime(fullName), fullName));
+    }
+
+    // Oldest first
+    std::sort(cacheFiles.begin(), cacheFiles.end());
+    for (unsigned int i = 0;(i < cacheFiles.size()) && (totalSize > maximalSize);++i)
+    {
+        uint64_t fileSize = itksys::SystemTools::FileLength(cacheFiles[i].second);
+        if (itksys::SystemTools::RemoveFile(cacheFiles[i].second))
+            totalSize -= std::min(fileSize, totalSize);
+    }
+}
+
+} // end namespace anima
@@ -4,13 +4,20 @@
 #include <itkImageFileWriter.h>
 #include <itkExtractImageFilter.h>
 
+#include <animaRawImageCache.h>
+
 namespace anima
 {
 
+//! Reads an image, through the raw image cache if enabled (see anima::RawImageCache)
 template <class ImageType>
 typename itk::SmartPointer<ImageType>
 readImage(std::string filename)
 {
+    typename itk::SmartPointer<ImageType> cachedImage = anima::RawImageCache::ReadImage <ImageType> (filename);
+    if (cachedImage)
+        return cachedImage;
+
     typedef itk::ImageFileReader<ImageType> ReaderType;
     typename ReaderType::Pointer reader = ReaderType::New();
     reader->SetFileName(filename);
@@ -20,9 +27,12 @@ readImage(std::string filename)
     reader->Update();
 
     img = reader->GetOutput();
+    anima::RawImageCache::StoreImage <ImageType> (filename, img);
+
     return img;
 }
 
+//! Writes an image. Not stored in the raw image cache: it is filled by readImage from what is actually read from the file
 template <class OutputImageType>
 void
 writeImage(std::string filename, OutputImageType* img)
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+namespace anima
+{
+
+/**
+ * @brief Lock-free work-stealing scheduler over an index range [0, N[.
+ * The range is first split evenly between threads. Each thread takes chunks from the front of its own range,
+ * with a chunk size adapted to the remaining work (guided scheduling, never below the minimal chunk size).
+ * When its range is empty, a thread steals the back half of another thread range.
+ * Each index is given exactly once. Per-thread busy and idle times are recorded to check load balance.
+ */
+class WorkStealingRangeScheduler
+{
+public:
+    struct ThreadStatistics
+    {
+        double BusyTime;
+        double IdleTime;
+        unsigned int NumberOfChunks;
+        unsigned int NumberOfItems;
+        unsigned int NumberOfSteals;
+    };
+
+    WorkStealingRangeScheduler();
+    ~WorkStealingRangeScheduler() {}
+
+    /** Resets the scheduler for a new range, to be called before threads start */
+    void Initialize(unsigned int rangeSize, unsigned int numThreads, unsigned int minimalChunkSize = 1);
+
+    /**
+     * Gets the next chunk [startIndex, endIndex[ for thread threadId, from its own range or stolen from another one.
+     * Returns false when there is nothing left to process. Time between two calls is counted as busy time,
+     * time spent inside the call as idle time.
+     */
+    bool GetNextChunk(unsigned int threadId, unsigned int &startIndex, unsigned int &endIndex);
+
+    unsigned int GetNumberOfThreads() const {return m_NumberOfThreads;}
+    unsigned int GetRangeSize() const {return m_RangeSize;}
+
+    const ThreadStatistics &GetThreadStatistics(unsigned int threadId) const {return m_Statistics[threadId].Statistics;}
+
+    /** Ratio between mean and max busy time over threads, 1 for a perfectly balanced run */
+    double GetLoadBalance() const;
+
+    void PrintStatistics(std::ostream &os) const;
+
+private:
+    typedef std::chrono::steady_clock ClockType;
+
+    static uint64_t PackRange(uint32_t startIndex, uint32_t endIndex) {return (static_cast <uint64_t> (startIndex) << 32) | endIndex;}
+    static uint32_t RangeStart(uint64_t range) {return static_cast <uint32_t> (range >> 32);}
+    static uint32_t RangeEnd(uint64_t range) {return static_cast <uint32_t> (range & 0xFFFFFFFF);}
+
+    bool PopOwnChunk(unsigned int threadId, unsigned int &startIndex, unsigned int &endIndex);
+    bool StealRange(unsigned int threadId);
+
+    // Padded to avoid false sharing between thread ranges
+    struct alignas(64) ThreadRange
+    {
+        std::atomic <uint64_t> Range;
+    };
+
+    struct alignas(64) PaddedStatistics
+    {
+        ThreadStatistics Statistics;
+        ClockType::time_point LastChunkStart;
+        bool ChunkInProgress;
+    };
+
+    unsigned int m_RangeSize;
+    unsigned int m_NumberOfThreads;
+    unsigned int m_MinimalChunkSize;
+
+    std::unique_ptr <ThreadRange[]> m_ThreadRanges;
+    std::vector <PaddedStatistics> m_Statistics;
+};
+
+} // end namespace anima
+
+#include "animaWorkStealingRangeScheduler.hxx"
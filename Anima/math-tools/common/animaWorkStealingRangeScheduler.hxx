@@ -0,0 +1,182 @@
+#pragma once
+#include "animaWorkStealingRangeScheduler.h"
+
+#include <algorithm>
+
+namespace anima
+{
+
+inline
+WorkStealingRangeScheduler
+::WorkStealingRangeScheduler()
+{
+    m_RangeSize = 0;
+    m_NumberOfThreads = 0;
+    m_MinimalChunkSize = 1;
+}
+
+inline void
+WorkStealingRangeScheduler
+::Initialize(unsigned int rangeSize, unsigned int numThreads, unsigned int minimalChunkSize)
+{
+    m_RangeSize = rangeSize;
+    m_NumberOfThreads = std::max(numThreads,1u);
+    m_MinimalChunkSize = std::max(minimalChunkSize,1u);
+
+    m_ThreadRanges.reset(new ThreadRange[m_NumberOfThreads]);
+    m_Statistics.resize(m_NumberOfThreads);
+
+    // Initial even split of the range between threads
+    unsigned int baseSize = m_RangeSize / m_NumberOfThreads;
+    unsigned int remainder = m_RangeSize % m_NumberOfThreads;
+    unsigned int startIndex = 0;
+    for (unsigned int i = 0;i < m_NumberOfThreads;++i)
+    {
+        unsigned int endIndex = startIndex + baseSize + (i < remainder);
+        m_ThreadRanges[i].Range.store(PackRange(startIndex,endIndex));
+        startIndex = endIndex;
+
+        m_Statistics[i].Statistics.BusyTime = 0;
+        m_Statistics[i].Statistics.IdleTime = 0;
+        m_Statistics[i].Statistics.NumberOfChunks = 0;
+        m_Statistics[i].Statistics.NumberOfItems = 0;
+        m_Statistics[i].Statistics.NumberOfSteals = 0;
+        m_Statistics[i].ChunkInProgress = false;
+    }
+}
+
+inline bool
+WorkStealingRangeScheduler
+::PopOwnChunk(unsigned int threadId, unsigned int &startIndex, unsigned int &endIndex)
+{
+    std::atomic <uint64_t> &ownRange = m_ThreadRanges[threadId].Range;
+    uint64_t currentRange = ownRange.load();
+
+    while (RangeStart(currentRange) < RangeEnd(currentRange))
+    {
+        uint32_t rangeStart = RangeStart(currentRange);
+        uint32_t rangeEnd = RangeEnd(currentRange);
+        uint32_t remaining = rangeEnd - rangeStart;
+
+        // Guided chunk size: large chunks while there is plenty of work, small ones at the end to leave work to steal
+        uint32_t chunkSize = std::max(remaining / 4, (uint32_t)m_MinimalChunkSize);
+        chunkSize = std::min(chunkSize, remaining);
+
+        if (ownRange.compare_exchange_weak(currentRange, PackRange(rangeStart + chunkSize, rangeEnd)))
+        {
+            startIndex = rangeStart;
+            endIndex = rangeStart + chunkSize;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+inline bool
+WorkStealingRangeScheduler
+::StealRange(unsigned int threadId)
+{
+    while (true)
+    {
+        // Look for the thread with the largest remaining range
+        unsigned int victimId = m_NumberOfThreads;
+        uint32_t largestRemaining = 0;
+        uint64_t victimRange = 0;
+        for (unsigned int i = 1;i < m_NumberOfThreads;++i)
+        {
+            unsigned int candidateId = (threadId + i) % m_NumberOfThreads;
+            uint64_t candidateRange = m_ThreadRanges[candidateId].Range.load();
+            uint32_t candidateStart = RangeStart(candidateRange);
+            uint32_t candidateEnd = RangeEnd(candidateRange);
+
+            if ((candidateStart < candidateEnd) && (candidateEnd - candidateStart > largestRemaining))
+            {
+                largestRemaining = candidateEnd - candidateStart;
+                victimId = candidateId;
+                victimRange = candidateRange;
+            }
+        }
+
+        if (victimId == m_NumberOfThreads)
+            return false;
+
+        // Steal the back half of the victim range
+        uint32_t victimStart = RangeStart(victimRange);
+        uint32_t victimEnd = RangeEnd(victimRange);
+        uint32_t splitIndex = victimStart + (victimEnd - victimStart) / 2;
+
+        if (m_ThreadRanges[victimId].Range.compare_exchange_strong(victimRange, PackRange(victimStart, splitIndex)))
+        {
+            // Own range is empty here, no thief can modify it concurrently
+            m_ThreadRanges[threadId].Range.store(PackRange(splitIndex, victimEnd));
+            ++m_Statistics[threadId].Statistics.NumberOfSteals;
+            return true;
+        }
+    }
+}
+
+inline bool
+WorkStealingRangeScheduler
+::GetNextChunk(unsigned int threadId, unsigned int &startIndex, unsigned int &endIndex)
+{
+    if (threadId >= m_NumberOfThreads)
+        return false;
+
+    PaddedStatistics &threadStats = m_Statistics[threadId];
+    ClockType::time_point entryTime = ClockType::now();
+    if (threadStats.ChunkInProgress)
+        threadStats.Statistics.BusyTime += std::chrono::duration <double> (entryTime - threadStats.LastChunkStart).count();
+
+    bool chunkFound = this->PopOwnChunk(threadId, startIndex, endIndex);
+    while (!chunkFound && this->StealRange(threadId))
+        chunkFound = this->PopOwnChunk(threadId, startIndex, endIndex);
+
+    ClockType::time_point exitTime = ClockType::now();
+    threadStats.Statistics.IdleTime += std::chrono::duration <double> (exitTime - entryTime).count();
+    threadStats.ChunkInProgress = chunkFound;
+
+    if (chunkFound)
+    {
+        threadStats.LastChunkStart = exitTime;
+        ++threadStats.Statistics.NumberOfChunks;
+        threadStats.Statistics.NumberOfItems += endIndex - startIndex;
+    }
+
+    return chunkFound;
+}
+
+inline double
+WorkStealingRangeScheduler
+::GetLoadBalance() const
+{
+    double maxBusyTime = 0;
+    double meanBusyTime = 0;
+    for (unsigned int i = 0;i < m_NumberOfThreads;++i)
+    {
+        maxBusyTime = std::max(maxBusyTime, m_Statistics[i].Statistics.BusyTime);
+        meanBusyTime += m_Statistics[i].Statistics.BusyTime;
+    }
+
+    if (maxBusyTime <= 0)
+        return 1.0;
+
+    meanBusyTime /= m_NumberOfThreads;
+    return meanBusyTime / maxBusyTime;
+}
+
+inline void
+WorkStealingRangeScheduler
+::PrintStatistics(std::ostream &os) const
+{
+    os << "Scheduler load balance: " << this->GetLoadBalance() << std::endl;
+    for (unsigned int i = 0;i < m_NumberOfThreads;++i)
+    {
+        const ThreadStatistics &stats = m_Statistics[i].Statistics;
+        os << "Thread " << i << ": busy " << stats.BusyTime << "s, idle " << stats.IdleTime << "s, "
+           << stats.NumberOfItems << " items in " << stats.NumberOfChunks << " chunks, "
+           << stats.NumberOfSteals << " steals" << std::endl;
+    }
+}
+
+} // end namespace anima
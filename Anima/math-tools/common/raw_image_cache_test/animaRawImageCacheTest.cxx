@@ -0,0 +1,178 @@
+#include <animaReadWriteFunctions.h>
+#include <tclap/CmdLine.h>
+
+#include <itkImage.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIterator.h>
+#include <itksys/SystemTools.hxx>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+typedef itk::Image <float, 3> ImageType;
+
+//! Checks that image has the same geometry and pixels as reference
+bool CheckSameImage(ImageType *image, ImageType *reference, const std::string &description)
+{
+    bool sameImage = (image->GetLargestPossibleRegion() == reference->GetLargestPossibleRegion()) &&
+            (image->GetBufferedRegion() == reference->GetBufferedRegion()) &&
+            (image->GetOrigin() == reference->GetOrigin()) && (image->GetSpacing() == reference->GetSpacing()) &&
+            (image->GetDirection() == reference->GetDirection());
+
+    if (sameImage)
+    {
+        itk::ImageRegionConstIterator <ImageType> imageItr(image, image->GetLargestPossibleRegion());
+        itk::ImageRegionConstIterator <ImageType> referenceItr(reference, reference->GetLargestPossibleRegion());
+
+        while (!imageItr.IsAtEnd())
+        {
+            if (imageItr.Get() != referenceItr.Get())
+            {
+                sameImage = false;
+                break;
+            }
+
+            ++imageItr;
+            ++referenceItr;
+        }
+    }
+
+    if (!sameImage)
+        std::cerr << description << " differs from plain file read" << std::endl;
+
+    return sameImage;
+}
+
+int main(int argc, char **argv)
+{
+    TCLAP::CmdLine cmd("INRIA / IRISA - VisAGeS/Empenn Team", ' ',ANIMA_VERSION);
+
+    TCLAP::ValueArg<std::string> workDirArg("d","work-dir","Directory for test image and cache (default: current directory)",false,".","work directory",cmd);
+
+    try
+    {
+        cmd.parse(argc,argv);
+    }
+    catch (TCLAP::ArgException& e)
+    {
+        std::cerr << "Error: " << e.error() << "for argument " << e.argId() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+#ifdef _WIN32
+    std::cout << "Raw image cache is not available on Windows" << std::endl;
+    return EXIT_SUCCESS;
+#else
+    std::string fileName = workDirArg.getValue() + "/animaRawImageCacheTestImage.nii.gz";
+    std::string cacheDirectory = workDirArg.getValue() + "/animaRawImageCacheTestDir";
+
+    // In memory image with a non zero index and a non trivial geometry, files are always read with a zero index
+    ImageType::RegionType region;
+    for (unsigned int i = 0;i < ImageType::ImageDimension;++i)
+    {
+        region.SetIndex(i, 3 - 2 * (int)i);
+        region.SetSize(i, 6 - i);
+    }
+
+    ImageType::PointType origin;
+    ImageType::SpacingType spacing;
+    ImageType::DirectionType direction;
+    direction.Fill(0.0);
+    for (unsigned int i = 0;i < ImageType::ImageDimension;++i)
+    {
+        origin[i] = 10.0 * i - 4.5;
+        spacing[i] = 0.5 + 0.25 * i;
+        direction(i, (i + 1) % ImageType::ImageDimension) = 1.0;
+    }
+
+    ImageType::Pointer image = ImageType::New();
+    image->SetRegions(region);
+    image->SetOrigin(origin);
+    image->SetSpacing(spacing);
+    image->SetDirection(direction);
+    image->Allocate();
+
+    itk::ImageRegionIterator <ImageType> imageItr(image, region);
+    for (unsigned int i = 0;!imageItr.IsAtEnd();++i, ++imageItr)
+        imageItr.Set(0.5 * i - 7.0);
+
+    itksys::SystemTools::RemoveADirectory(cacheDirectory);
+    setenv("ANIMA_IMAGE_CACHE_DIR", cacheDirectory.c_str(), 1);
+
+    anima::writeImage <ImageType> (fileName, image);
+
+    typedef itk::ImageFileReader <ImageType> ReaderType;
+    ReaderType::Pointer reader = ReaderType::New();
+    reader->SetFileName(fileName);
+    reader->Update();
+    ImageType::Pointer plainImage = reader->GetOutput();
+
+    // First read stores the image in the cache, second one maps it
+    ImageType::Pointer storingReadImage = anima::readImage <ImageType> (fileName);
+    ImageType::Pointer cachedImage = anima::readImage <ImageType> (fileName);
+
+    bool testOk = CheckSameImage(storingReadImage, plainImage, "Cache storing read") &&
+            CheckSameImage(cachedImage, plainImage, "Cached read");
+
+    if (!dynamic_cast <anima::MappedImageContainer <float> *> (cachedImage->GetPixelContainer()))
+    {
+        std::cerr << "Second read did not come from the cache" << std::endl;
+        testOk = false;
+    }
+
+    // Two file format: rewriting only the data file has to be seen, here by not caching such formats at all
+    std::string headerFileName = workDirArg.getValue() + "/animaRawImageCacheTestPair.mhd";
+    std::string dataFileName = workDirArg.getValue() + "/animaRawImageCacheTestPair.raw";
+
+    typedef itk::ImageFileWriter <ImageType> WriterType;
+    WriterType::Pointer writer = WriterType::New();
+    writer->SetUseCompression(false);
+    writer->SetFileName(headerFileName);
+    writer->SetInput(image);
+    writer->Update();
+
+    anima::readImage <ImageType> (headerFileName);
+    anima::readImage <ImageType> (headerFileName);
+
+    unsigned int numPixels = region.GetNumberOfPixels();
+    std::vector <float> newValues(numPixels);
+    for (unsigned int i = 0;i < numPixels;++i)
+        newValues[i] = 2.0 * i + 1.0;
+
+    std::ofstream dataFile(dataFileName.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+    dataFile.write(reinterpret_cast <const char *> (newValues.data()), numPixels * sizeof(float));
+    dataFile.close();
+
+    reader = ReaderType::New();
+    reader->SetFileName(headerFileName);
+    reader->Update();
+    ImageType::Pointer plainPairImage = reader->GetOutput();
+    ImageType::Pointer pairImage = anima::readImage <ImageType> (headerFileName);
+
+    if (plainPairImage->GetBufferPointer()[numPixels - 1] != newValues[numPixels - 1])
+    {
+        std::cerr << "Data file rewrite was not applied" << std::endl;
+        testOk = false;
+    }
+
+    testOk = CheckSameImage(pairImage, plainPairImage, "Read after data file rewrite") && testOk;
+    if (dynamic_cast <anima::MappedImageContainer <float> *> (pairImage->GetPixelContainer()))
+    {
+        std::cerr << "Two file format image was read from the cache" << std::endl;
+        testOk = false;
+    }
+
+    itksys::SystemTools::RemoveFile(fileName);
+    itksys::SystemTools::RemoveFile(headerFileName);
+    itksys::SystemTools::RemoveFile(dataFileName);
+    itksys::SystemTools::RemoveADirectory(cacheDirectory);
+
+    if (!testOk)
+        return EXIT_FAILURE;
+
+    std::cout << "Cached reads are identical to plain file reads" << std::endl;
+    return EXIT_SUCCESS;
+#endif
+}
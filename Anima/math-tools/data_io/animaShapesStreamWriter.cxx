@@ -0,0 +1,487 @@
+#include <animaShapesStreamWriter.h>
+#include <itkMacro.h>
+
+#include <vtkXMLPolyDataWriter.h>
+#include <vtkPointData.h>
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkIdList.h>
+#include <vtksys/SystemTools.hxx>
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+
+namespace anima {
+
+ShapesStreamWriter::ShapesStreamWriter()
+{
+    m_FileName = "";
+    m_OutputFormat = VTKXML;
+    m_IsOpen = false;
+
+    m_NumberOfWrittenShapes = 0;
+    m_NumberOfWrittenPoints = 0;
+    m_NumberOfWrittenCellValues = 0;
+    m_VTKXMLHeaderWritten = false;
+}
+
+ShapesStreamWriter::~ShapesStreamWriter()
+{
+    if (m_OutputFile.is_open())
+        m_OutputFile.close();
+
+    this->RemoveTemporaryFiles();
+}
+
+void ShapesStreamWriter::Open()
+{
+    if (m_IsOpen)
+        throw itk::ExceptionObject(__FILE__, __LINE__,"Shapes stream already open.",ITK_LOCATION);
+
+    m_NumberOfWrittenShapes = 0;
+    m_NumberOfWrittenPoints = 0;
+    m_NumberOfWrittenCellValues = 0;
+    m_ArrayNames.clear();
+    m_ArrayNumberOfComponents.clear();
+
+    std::string extensionName = m_FileName.substr(m_FileName.find_last_of('.') + 1);
+    if (extensionName == "vtk")
+    {
+        m_OutputFormat = VTKAscii;
+
+        // Points and lines sections, point arrays sections are added with the first chunk
+        m_TemporaryFileNames.push_back(m_FileName + ".points.tmp");
+        m_TemporaryFileNames.push_back(m_FileName + ".lines.tmp");
+        for (unsigned int i = 0;i < m_TemporaryFileNames.size();++i)
+        {
+            m_TemporaryFiles.push_back(new std::ofstream(m_TemporaryFileNames[i].c_str()));
+            m_TemporaryFiles[i]->precision(11);
+
+            if (!m_TemporaryFiles[i]->is_open())
+                throw itk::ExceptionObject(__FILE__, __LINE__,"Temporary shapes file could not be opened.",ITK_LOCATION);
+        }
+    }
+    else if ((extensionName == "vtp")||(extensionName == ""))
+    {
+        if (extensionName == "")
+            m_FileName += ".vtp";
+
+        m_OutputFormat = VTKXML;
+        this->OpenVTKXMLFile(m_FileName);
+    }
+    else if (extensionName == "fds")
+    {
+        m_OutputFormat = MedinriaFibers;
+
+        std::replace(m_FileName.begin(),m_FileName.end(),'\\','/');
+
+        std::string baseName;
+        std::size_t lastDotPos = m_FileName.find_last_of('.');
+        baseName.append(m_FileName.begin(),m_FileName.begin() + lastDotPos);
+
+        std::string noPathName = baseName;
+        std::size_t lastSlashPos = baseName.find_last_of("/");
+
+        if (lastSlashPos != std::string::npos)
+        {
+            noPathName.clear();
+            noPathName.append(baseName.begin() + lastSlashPos + 1,baseName.end());
+        }
+
+        vtksys::SystemTools::MakeDirectory(baseName.c_str());
+
+        this->WriteMedinriaHeaderFile(noPathName + "/" + noPathName + "_0.vtp");
+        this->OpenVTKXMLFile(baseName + "/" + noPathName + "_0.vtp");
+    }
+    else if (extensionName == "csv")
+    {
+        m_OutputFormat = CSV;
+
+        m_OutputFile.open(m_FileName.c_str(), std::ios_base::out);
+        m_OutputFile.precision(std::numeric_limits<long double>::digits10);
+
+        if (!m_OutputFile.is_open())
+            throw itk::ExceptionObject(__FILE__, __LINE__, "The output file could not be opened", ITK_LOCATION);
+    }
+    else
+        throw itk::ExceptionObject(__FILE__, __LINE__,"Unsupported shapes extension.",ITK_LOCATION);
+
+    m_IsOpen = true;
+}
+
+void ShapesStreamWriter::WriteChunk(vtkPolyData *chunk)
+{
+    if (!m_IsOpen)
+        throw itk::ExceptionObject(__FILE__, __LINE__,"Shapes stream is not open.",ITK_LOCATION);
+
+    if (chunk->GetNumberOfLines() == 0)
+        return;
+
+    switch (m_OutputFormat)
+    {
+        case VTKAscii:
+            this->WriteVTKAsciiChunk(chunk);
+            break;
+
+        case CSV:
+            this->WriteCSVChunk(chunk);
+            break;
+
+        case VTKXML:
+        case MedinriaFibers:
+        default:
+            this->WriteVTKXMLChunk(chunk);
+            break;
+    }
+
+    m_NumberOfWrittenShapes += chunk->GetNumberOfLines();
+}
+
+void ShapesStreamWriter::Close()
+{
+    if (!m_IsOpen)
+        return;
+
+    switch (m_OutputFormat)
+    {
+        case VTKAscii:
+            this->CloseVTKAsciiFile();
+            break;
+
+        case CSV:
+            m_OutputFile << std::endl;
+            m_OutputFile.close();
+            break;
+
+        case VTKXML:
+        case MedinriaFibers:
+        default:
+            this->CloseVTKXMLFile();
+            break;
+    }
+
+    m_IsOpen = false;
+}
+
+void ShapesStreamWriter::Abort()
+{
+    if (!m_IsOpen)
+        return;
+
+    if (m_OutputFile.is_open())
+        m_OutputFile.close();
+
+    switch (m_OutputFormat)
+    {
+        case CSV:
+            std::remove(m_FileName.c_str());
+            break;
+
+        case MedinriaFibers:
+        {
+            // Header file, fibers file and fibers directory (only removed if empty)
+            std::remove(m_VTKXMLFileName.c_str());
+            std::remove(m_FileName.c_str());
+            std::string baseName = m_FileName.substr(0, m_FileName.find_last_of('.'));
+            std::remove(baseName.c_str());
+            break;
+        }
+
+        case VTKXML:
+            std::remove(m_VTKXMLFileName.c_str());
+            break;
+
+        case VTKAscii:
+        default:
+            // Output file is only written at Close
+            break;
+    }
+
+    this->RemoveTemporaryFiles();
+    m_IsOpen = false;
+}
+
+void ShapesStreamWriter::OpenVTKXMLFile(const std::string &fileName)
+{
+    m_VTKXMLFileName = fileName;
+    m_VTKXMLHeaderWritten = false;
+
+    m_OutputFile.open(fileName.c_str(), std::ios_base::out | std::ios_base::binary);
+    if (!m_OutputFile.is_open())
+        throw itk::ExceptionObject(__FILE__, __LINE__, "The output file could not be opened", ITK_LOCATION);
+}
+
+void ShapesStreamWriter::WriteVTKXMLChunk(vtkPolyData *chunk)
+{
+    // Each chunk is encoded by VTK as a complete file in memory, its piece is then appended to the output
+    vtkSmartPointer <vtkXMLPolyDataWriter> vtkWriter = vtkSmartPointer <vtkXMLPolyDataWriter>::New();
+    vtkWriter->SetInputData(chunk);
+    vtkWriter->WriteToOutputStringOn();
+    vtkWriter->SetDataModeToBinary();
+    vtkWriter->EncodeAppendedDataOff();
+    vtkWriter->SetCompressorTypeToZLib();
+    vtkWriter->Update();
+
+    std::string chunkString(vtkWriter->GetOutputString(), vtkWriter->GetOutputStringLength());
+
+    std::size_t pieceStart = chunkString.find("<Piece");
+    std::size_t pieceEnd = chunkString.rfind("</PolyData>");
+    if ((pieceStart == std::string::npos)||(pieceEnd == std::string::npos)||(pieceEnd < pieceStart))
+        throw itk::ExceptionObject(__FILE__, __LINE__, "Unexpected VTK XML chunk structure", ITK_LOCATION);
+
+    if (!m_VTKXMLHeaderWritten)
+    {
+        m_OutputFile.write(chunkString.data(), pieceStart);
+        m_VTKXMLHeaderWritten = true;
+    }
+
+    m_OutputFile.write(chunkString.data() + pieceStart, pieceEnd - pieceStart);
+}
+
+void ShapesStreamWriter::CloseVTKXMLFile()
+{
+    if (!m_VTKXMLHeaderWritten)
+    {
+        // Nothing was written, let VTK write an empty data set
+        m_OutputFile.close();
+
+        vtkSmartPointer <vtkPolyData> emptyData = vtkSmartPointer <vtkPolyData>::New();
+        vtkSmartPointer <vtkXMLPolyDataWriter> vtkWriter = vtkSmartPointer <vtkXMLPolyDataWriter>::New();
+        vtkWriter->SetInputData(emptyData);
+        vtkWriter->SetFileName(m_VTKXMLFileName.c_str());
+        vtkWriter->SetDataModeToBinary();
+        vtkWriter->EncodeAppendedDataOff();
+        vtkWriter->SetCompressorTypeToZLib();
+        vtkWriter->Update();
+        return;
+    }
+
+    m_OutputFile << "</PolyData>" << std::endl;
+    m_OutputFile << "</VTKFile>" << std::endl;
+    m_OutputFile.close();
+}
+
+void ShapesStreamWriter::WriteVTKAsciiChunk(vtkPolyData *chunk)
+{
+    vtkPointData *pointData = chunk->GetPointData();
+    unsigned int numArrays = pointData->GetNumberOfArrays();
+
+    if (m_ArrayNames.empty())
+    {
+        for (unsigned int i = 0;i < numArrays;++i)
+        {
+            m_ArrayNames.push_back(pointData->GetArrayName(i));
+            m_ArrayNumberOfComponents.push_back(pointData->GetArray(i)->GetNumberOfComponents());
+
+            std::string arrayFileName = m_FileName + ".array" + std::to_string(i) + ".tmp";
+            m_TemporaryFileNames.push_back(arrayFileName);
+            m_TemporaryFiles.push_back(new std::ofstream(arrayFileName.c_str()));
+            m_TemporaryFiles.back()->precision(11);
+
+            if (!m_TemporaryFiles.back()->is_open())
+                throw itk::ExceptionObject(__FILE__, __LINE__,"Temporary shapes file could not be opened.",ITK_LOCATION);
+        }
+    }
+    else if (numArrays != m_ArrayNames.size())
+        throw itk::ExceptionObject(__FILE__, __LINE__,"All shape chunks should have the same point arrays.",ITK_LOCATION);
+
+    std::ofstream &pointsFile = *m_TemporaryFiles[0];
+    std::ofstream &linesFile = *m_TemporaryFiles[1];
+
+    unsigned int numPoints = chunk->GetNumberOfPoints();
+    double p[3];
+    for (unsigned int i = 0;i < numPoints;++i)
+    {
+        chunk->GetPoint(i, p);
+        pointsFile << p[0] << " " << p[1] << " " << p[2] << "\n";
+    }
+
+    vtkSmartPointer <vtkIdList> idList = vtkSmartPointer <vtkIdList>::New();
+    vtkCellArray *lines = chunk->GetLines();
+    lines->InitTraversal();
+    while (lines->GetNextCell(idList))
+    {
+        unsigned int lineSize = idList->GetNumberOfIds();
+        linesFile << lineSize;
+        for (unsigned int j = 0;j < lineSize;++j)
+            linesFile << " " << idList->GetId(j) + m_NumberOfWrittenPoints;
+        linesFile << "\n";
+
+        m_NumberOfWrittenCellValues += lineSize + 1;
+    }
+
+    for (unsigned int k = 0;k < m_ArrayNames.size();++k)
+    {
+        vtkDataArray *array = pointData->GetArray(m_ArrayNames[k].c_str());
+        if ((!array)||(array->GetNumberOfComponents() != (int)m_ArrayNumberOfComponents[k]))
+            throw itk::ExceptionObject(__FILE__, __LINE__,"All shape chunks should have the same point arrays.",ITK_LOCATION);
+
+        std::ofstream &arrayFile = *m_TemporaryFiles[2 + k];
+        for (unsigned int i = 0;i < numPoints;++i)
+        {
+            for (unsigned int j = 0;j < m_ArrayNumberOfComponents[k];++j)
+                arrayFile << array->GetComponent(i, j) << " ";
+            arrayFile << "\n";
+        }
+    }
+
+    m_NumberOfWrittenPoints += numPoints;
+}
+
+void ShapesStreamWriter::CloseVTKAsciiFile()
+{
+    for (unsigned int i = 0;i < m_TemporaryFiles.size();++i)
+        m_TemporaryFiles[i]->close();
+
+    std::ofstream outputFile(m_FileName.c_str());
+    if (!outputFile.is_open())
+        throw itk::ExceptionObject(__FILE__, __LINE__, "The output file could not be opened", ITK_LOCATION);
+
+    outputFile << "# vtk DataFile Version 3.0" << std::endl;
+    outputFile << "vtk output" << std::endl;
+    outputFile << "ASCII" << std::endl;
+    outputFile << "DATASET POLYDATA" << std::endl;
+
+    std::ifstream sectionFile;
+    outputFile << "POINTS " << m_NumberOfWrittenPoints << " double" << std::endl;
+    if (m_NumberOfWrittenPoints > 0)
+    {
+        sectionFile.open(m_TemporaryFileNames[0].c_str());
+        outputFile << sectionFile.rdbuf();
+        sectionFile.close();
+    }
+
+    outputFile << "LINES " << m_NumberOfWrittenShapes << " " << m_NumberOfWrittenCellValues << std::endl;
+    if (m_NumberOfWrittenShapes > 0)
+    {
+        sectionFile.open(m_TemporaryFileNames[1].c_str());
+        outputFile << sectionFile.rdbuf();
+        sectionFile.close();
+    }
+
+    if ((m_NumberOfWrittenPoints > 0)&&(!m_ArrayNames.empty()))
+    {
+        outputFile << "POINT_DATA " << m_NumberOfWrittenPoints << std::endl;
+        outputFile << "FIELD FieldData " << m_ArrayNames.size() << std::endl;
+
+        for (unsigned int k = 0;k < m_ArrayNames.size();++k)
+        {
+            // Legacy VTK format does not allow spaces in names, encoded the same way as vtkDataWriter
+            std::string arrayName;
+            for (unsigned int i = 0;i < m_ArrayNames[k].size();++i)
+            {
+                if (m_ArrayNames[k][i] == ' ')
+                    arrayName += "%20";
+                else
+                    arrayName += m_ArrayNames[k][i];
+            }
+
+            outputFile << arrayName << " " << m_ArrayNumberOfComponents[k] << " " << m_NumberOfWrittenPoints << " double" << std::endl;
+
+            sectionFile.open(m_TemporaryFileNames[2 + k].c_str());
+            outputFile << sectionFile.rdbuf();
+            sectionFile.close();
+        }
+    }
+
+    outputFile.close();
+    this->RemoveTemporaryFiles();
+}
+
+void ShapesStreamWriter::WriteMedinriaHeaderFile(const std::string &vtpFileName)
+{
+    std::ofstream outputHeaderFile(m_FileName.c_str());
+    outputHeaderFile << "<?xml version=\"1.0\"?>" << std::endl;
+    outputHeaderFile << "<VTKFile type=\"vtkFiberDataSet\" version=\"1.0\" byte_order=\"LittleEndian\" compressor=\"vtkZLibDataCompressor\">" << std::endl;
+    outputHeaderFile << "<vtkFiberDataSet>" << std::endl;
+    outputHeaderFile << "\t<Fibers index=\"0\" file=\"" << vtpFileName << "\">" << std::endl;
+    outputHeaderFile << "\t</Fibers>" << std::endl;
+    outputHeaderFile << "</vtkFiberDataSet>" << std::endl;
+    outputHeaderFile << "</VTKFile>" << std::endl;
+
+    outputHeaderFile.close();
+}
+
+void ShapesStreamWriter::WriteCSVChunk(vtkPolyData *chunk)
+{
+    vtkPointData *inputData = chunk->GetPointData();
+    unsigned int numArrays = inputData->GetNumberOfArrays();
+
+    if (m_NumberOfWrittenShapes == 0)
+    {
+        m_OutputFile << "X,Y,Z,PointId,StreamlineId";
+
+        for (unsigned int i = 0;i < numArrays;++i)
+        {
+            unsigned int arraySize = inputData->GetArray(i)->GetNumberOfComponents();
+            m_ArrayNames.push_back(inputData->GetArrayName(i));
+            m_ArrayNumberOfComponents.push_back(arraySize);
+
+            if (arraySize == 1)
+            {
+                m_OutputFile << "," << inputData->GetArrayName(i);
+                continue;
+            }
+
+            for (unsigned int j = 0;j < arraySize;++j)
+                m_OutputFile << "," << inputData->GetArrayName(i) << "#" << j;
+        }
+    }
+    else if (numArrays != m_ArrayNames.size())
+        throw itk::ExceptionObject(__FILE__, __LINE__,"All shape chunks should have the same point arrays.",ITK_LOCATION);
+
+    vtkSmartPointer <vtkIdList> idList = vtkSmartPointer <vtkIdList>::New();
+    vtkCellArray *lines = chunk->GetLines();
+    lines->InitTraversal();
+    unsigned int streamlineId = m_NumberOfWrittenShapes;
+    double p[3];
+
+    while (lines->GetNextCell(idList))
+    {
+        ++streamlineId;
+        unsigned int streamlineSize = idList->GetNumberOfIds();
+
+        if (streamlineSize == 1)
+            continue;
+
+        for (unsigned int j = 0;j < streamlineSize;++j)
+        {
+            unsigned int pid = idList->GetId(j);
+            m_OutputFile << std::endl;
+
+            chunk->GetPoint(pid, p);
+            for (unsigned int k = 0;k < 3;++k)
+                m_OutputFile << p[k] << ",";
+
+            m_OutputFile << j + 1 << "," << streamlineId;
+
+            for (unsigned int k = 0;k < numArrays;++k)
+            {
+                vtkDataArray *array = inputData->GetArray(m_ArrayNames[k].c_str());
+                if (!array)
+                    throw itk::ExceptionObject(__FILE__, __LINE__,"All shape chunks should have the same point arrays.",ITK_LOCATION);
+
+                for (unsigned int l = 0;l < m_ArrayNumberOfComponents[k];++l)
+                    m_OutputFile << "," << array->GetComponent(pid, l);
+            }
+        }
+    }
+}
+
+void ShapesStreamWriter::RemoveTemporaryFiles()
+{
+    for (unsigned int i = 0;i < m_TemporaryFiles.size();++i)
+    {
+        if (m_TemporaryFiles[i]->is_open())
+            m_TemporaryFiles[i]->close();
+
+        delete m_TemporaryFiles[i];
+        std::remove(m_TemporaryFileNames[i].c_str());
+    }
+
+    m_TemporaryFiles.clear();
+    m_TemporaryFileNames.clear();
+}
+
+} // end namespace anima
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include "AnimaDataIOExport.h"
+
+namespace anima {
+
+/**
+ * @brief Writes shapes (polylines and their point arrays) chunk by chunk, so that the whole data set never has to be held in memory.
+ * Supports the same formats as ShapesWriter. VTP (and the VTP file of FDS) outputs get one piece per chunk, VTK legacy outputs are
+ * assembled at Close from temporary section files, CSV outputs are appended directly. All chunks must carry the same point arrays.
+ */
+class ANIMADATAIO_EXPORT ShapesStreamWriter
+{
+public:
+    ShapesStreamWriter();
+    ~ShapesStreamWriter();
+
+    void SetFileName(const std::string &name) {m_FileName = name;}
+
+    //! Opens output file, format is given by the file extension as in ShapesWriter
+    void Open();
+
+    //! Appends polylines of chunk to the output
+    void WriteChunk(vtkPolyData *chunk);
+
+    //! Finalizes output file, nothing may be written afterwards
+    void Close();
+
+    //! Closes without finalizing, after a failure: incomplete output files (.fds header included) and temporary files are removed
+    void Abort();
+
+    unsigned int GetNumberOfWrittenShapes() {return m_NumberOfWrittenShapes;}
+    bool IsOpen() {return m_IsOpen;}
+
+protected:
+    enum OutputFormatType
+    {
+        VTKAscii = 0,
+        VTKXML,
+        MedinriaFibers,
+        CSV
+    };
+
+    void OpenVTKXMLFile(const std::string &fileName);
+    void WriteVTKXMLChunk(vtkPolyData *chunk);
+    void CloseVTKXMLFile();
+
+    void WriteVTKAsciiChunk(vtkPolyData *chunk);
+    void CloseVTKAsciiFile();
+
+    void WriteMedinriaHeaderFile(const std::string &vtpFileName);
+
+    void WriteCSVChunk(vtkPolyData *chunk);
+
+    void RemoveTemporaryFiles();
+
+private:
+    std::string m_FileName;
+    OutputFormatType m_OutputFormat;
+    bool m_IsOpen;
+
+    unsigned int m_NumberOfWrittenShapes;
+    unsigned int m_NumberOfWrittenPoints;
+    unsigned int m_NumberOfWrittenCellValues;
+
+    //! Main output stream (VTP file, CSV file)
+    std::ofstream m_OutputFile;
+    std::string m_VTKXMLFileName;
+    bool m_VTKXMLHeaderWritten;
+
+    //! Temporary section files for VTK legacy output: points, lines, then one per point array
+    std::vector <std::string> m_TemporaryFileNames;
+    std::vector <std::ofstream *> m_TemporaryFiles;
+    std::vector <std::string> m_ArrayNames;
+    std::vector <unsigned int> m_ArrayNumberOfComponents;
+};
+
+} // end namespace anima
@@ -0,0 +1,231 @@
+#include <animaShapesStreamWriter.h>
+#include <animaShapesWriter.h>
+#include <animaShapesReader.h>
+#include <tclap/CmdLine.h>
+#include <itkMacro.h>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+#include <vtkPoints.h>
+#include <vtkPointData.h>
+#include <vtkDoubleArray.h>
+#include <vtkDataArray.h>
+#include <vtkIdList.h>
+#include <vtksys/SystemTools.hxx>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+//! Polylines of fibers firstFiber to lastFiber (excluded) with a scalar and a vector point array
+vtkSmartPointer <vtkPolyData> BuildFibers(unsigned int firstFiber, unsigned int lastFiber)
+{
+    vtkSmartPointer <vtkPolyData> fibers = vtkSmartPointer <vtkPolyData>::New();
+    fibers->Initialize();
+    fibers->Allocate();
+
+    vtkSmartPointer <vtkPoints> points = vtkSmartPointer <vtkPoints>::New();
+    vtkSmartPointer <vtkDoubleArray> weights = vtkSmartPointer <vtkDoubleArray>::New();
+    weights->SetNumberOfComponents(1);
+    weights->SetName("Fiber weights");
+    vtkSmartPointer <vtkDoubleArray> colors = vtkSmartPointer <vtkDoubleArray>::New();
+    colors->SetNumberOfComponents(3);
+    colors->SetName("Colors");
+
+    std::vector <vtkIdType> ids;
+    for (unsigned int i = firstFiber;i < lastFiber;++i)
+    {
+        unsigned int numPoints = 2 + (7 * i) % 29;
+        ids.resize(numPoints);
+        for (unsigned int j = 0;j < numPoints;++j)
+        {
+            ids[j] = points->InsertNextPoint(0.5 * j + 0.01 * i, std::sin(0.3 * j + i), 1.0 / (1.0 + i + j));
+            weights->InsertNextValue(0.1 * i + 1.0);
+            colors->InsertNextTuple3(std::cos(0.2 * j), 0.25 * i, - 1.5 * j);
+        }
+
+        fibers->InsertNextCell(VTK_POLY_LINE, numPoints, ids.data());
+    }
+
+    fibers->SetPoints(points);
+    fibers->GetPointData()->AddArray(weights);
+    fibers->GetPointData()->AddArray(colors);
+
+    return fibers;
+}
+
+//! Checks that shapes read back from testName are the same as the ones read back from referenceName
+bool CheckSameShapes(std::string &testName, std::string &referenceName)
+{
+    anima::ShapesReader testReader, referenceReader;
+    testReader.SetFileName(testName);
+    testReader.Update();
+    referenceReader.SetFileName(referenceName);
+    referenceReader.Update();
+
+    vtkPolyData *testData = testReader.GetOutput();
+    vtkPolyData *referenceData = referenceReader.GetOutput();
+    double tolerance = 1.0e-6;
+
+    if ((testData->GetNumberOfPoints() != referenceData->GetNumberOfPoints()) ||
+            (testData->GetNumberOfCells() != referenceData->GetNumberOfCells()))
+    {
+        std::cerr << testName << ": " << testData->GetNumberOfCells() << " cells and " << testData->GetNumberOfPoints()
+                  << " points instead of " << referenceData->GetNumberOfCells() << " and "
+                  << referenceData->GetNumberOfPoints() << std::endl;
+        return false;
+    }
+
+    // Cells compared through the coordinates of their points
+    vtkSmartPointer <vtkIdList> testIds = vtkSmartPointer <vtkIdList>::New();
+    vtkSmartPointer <vtkIdList> referenceIds = vtkSmartPointer <vtkIdList>::New();
+    double testPoint[3], referencePoint[3];
+    for (vtkIdType i = 0;i < referenceData->GetNumberOfCells();++i)
+    {
+        testData->GetCellPoints(i, testIds);
+        referenceData->GetCellPoints(i, referenceIds);
+        if (testIds->GetNumberOfIds() != referenceIds->GetNumberOfIds())
+        {
+            std::cerr << testName << ": cell " << i << " differs in size" << std::endl;
+            return false;
+        }
+
+        for (vtkIdType j = 0;j < referenceIds->GetNumberOfIds();++j)
+        {
+            testData->GetPoint(testIds->GetId(j), testPoint);
+            referenceData->GetPoint(referenceIds->GetId(j), referencePoint);
+            for (unsigned int k = 0;k < 3;++k)
+            {
+                if (std::abs(testPoint[k] - referencePoint[k]) > tolerance)
+                {
+                    std::cerr << testName << ": point " << j << " of cell " << i << " differs" << std::endl;
+                    return false;
+                }
+            }
+        }
+    }
+
+    vtkPointData *testPointData = testData->GetPointData();
+    vtkPointData *referencePointData = referenceData->GetPointData();
+    if (testPointData->GetNumberOfArrays() != referencePointData->GetNumberOfArrays())
+    {
+        std::cerr << testName << ": " << testPointData->GetNumberOfArrays() << " point arrays instead of "
+                  << referencePointData->GetNumberOfArrays() << std::endl;
+        return false;
+    }
+
+    for (int i = 0;i < referencePointData->GetNumberOfArrays();++i)
+    {
+        vtkDataArray *referenceArray = referencePointData->GetArray(i);
+        vtkDataArray *testArray = testPointData->GetArray(referenceArray->GetName());
+        if ((!testArray) || (testArray->GetNumberOfComponents() != referenceArray->GetNumberOfComponents()) ||
+                (testArray->GetNumberOfTuples() != referenceArray->GetNumberOfTuples()))
+        {
+            std::cerr << testName << ": point array " << referenceArray->GetName() << " missing or wrongly sized" << std::endl;
+            return false;
+        }
+
+        for (vtkIdType j = 0;j < referenceArray->GetNumberOfTuples();++j)
+        {
+            for (int k = 0;k < referenceArray->GetNumberOfComponents();++k)
+            {
+                if (std::abs(testArray->GetComponent(j,k) - referenceArray->GetComponent(j,k)) > tolerance)
+                {
+                    std::cerr << testName << ": point array " << referenceArray->GetName() << " differs at " << j << std::endl;
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    TCLAP::CmdLine cmd("INRIA / IRISA - VisAGeS/Empenn Team", ' ',ANIMA_VERSION);
+
+    TCLAP::ValueArg<std::string> workDirArg("d","work-dir","Directory for test shapes files (default: current directory)",false,".","work directory",cmd);
+
+    try
+    {
+        cmd.parse(argc,argv);
+    }
+    catch (TCLAP::ArgException& e)
+    {
+        std::cerr << "Error: " << e.error() << "for argument " << e.argId() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    unsigned int numFibers = 53;
+    unsigned int chunkSize = 10;
+    vtkSmartPointer <vtkPolyData> allFibers = BuildFibers(0, numFibers);
+
+    const char *extensions[4] = {"vtp", "vtk", "csv", "fds"};
+    bool testOk = true;
+    for (unsigned int i = 0;i < 4;++i)
+    {
+        std::string extension(extensions[i]);
+        std::string streamName = workDirArg.getValue() + "/animaShapesStreamWriterTest." + extension;
+        std::string referenceName = workDirArg.getValue() + "/animaShapesStreamWriterReference." + extension;
+
+        // Stream written by chunks, the last one being incomplete
+        anima::ShapesStreamWriter streamWriter;
+        streamWriter.SetFileName(streamName);
+        streamWriter.Open();
+        for (unsigned int j = 0;j < numFibers;j += chunkSize)
+        {
+            vtkSmartPointer <vtkPolyData> chunk = BuildFibers(j, std::min(j + chunkSize, numFibers));
+            streamWriter.WriteChunk(chunk);
+        }
+
+        streamWriter.Close();
+
+        anima::ShapesWriter referenceWriter;
+        referenceWriter.SetInputData(allFibers);
+        referenceWriter.SetFileName(referenceName);
+        referenceWriter.Update();
+
+        try
+        {
+            if (!CheckSameShapes(streamName, referenceName))
+                testOk = false;
+        }
+        catch (itk::ExceptionObject &e)
+        {
+            std::cerr << streamName << ": " << e << std::endl;
+            testOk = false;
+        }
+
+        // Aborted streams leave no output behind
+        std::string abortedName = workDirArg.getValue() + "/animaShapesStreamWriterAborted." + extension;
+        anima::ShapesStreamWriter abortedWriter;
+        abortedWriter.SetFileName(abortedName);
+        abortedWriter.Open();
+        vtkSmartPointer <vtkPolyData> chunk = BuildFibers(0, chunkSize);
+        abortedWriter.WriteChunk(chunk);
+        abortedWriter.Abort();
+
+        std::string abortedDirectory = workDirArg.getValue() + "/animaShapesStreamWriterAborted";
+        if (vtksys::SystemTools::FileExists(abortedName) || vtksys::SystemTools::FileExists(abortedDirectory))
+        {
+            std::cerr << abortedName << ": aborted output still exists" << std::endl;
+            testOk = false;
+        }
+
+        vtksys::SystemTools::RemoveFile(streamName);
+        vtksys::SystemTools::RemoveFile(referenceName);
+        if (extension == "fds")
+        {
+            vtksys::SystemTools::RemoveADirectory(workDirArg.getValue() + "/animaShapesStreamWriterTest");
+            vtksys::SystemTools::RemoveADirectory(workDirArg.getValue() + "/animaShapesStreamWriterReference");
+        }
+    }
+
+    if (!testOk)
+        return EXIT_FAILURE;
+
+    std::cout << "Streamed shapes are identical to shapes written at once" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -106,6 +106,9 @@ protected:
     //! Sets averager specific parameters if sub-classes are derived
     virtual void SetSpecificAveragerParameters(unsigned int threadIndex) const {}
 
+    //! Forces reloading of neighbor models at the next evaluation for all work indexes
+    void InvalidateCellCaches() const;
+
     unsigned int GetFreeWorkIndex() const;
     void UnlockWorkIndex(unsigned int index) const;
 
@@ -123,6 +126,13 @@ private:
     mutable std::vector < std::vector <MCModelPointer> > m_ReferenceInputModels;
     mutable std::vector < std::vector <double> > m_ReferenceInputWeights;
     mutable std::vector <AveragerPointer> m_MCMAveragers;
+
+    // Per work index cache of the last interpolation cell: base index, mask of used neighbors (-1 if invalid),
+    // input image modification time and maximal number of anisotropic compartments of neighbors
+    mutable std::vector <IndexType> m_CachedCellIndexes;
+    mutable std::vector <int> m_CachedNeighborMasks;
+    mutable std::vector <itk::ModifiedTimeType> m_CachedInputTimeStamps;
+    mutable std::vector <unsigned int> m_CachedMaximalNumberOfCompartments;
 };
 
 } // end namespace anima
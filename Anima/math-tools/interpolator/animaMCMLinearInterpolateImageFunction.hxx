@@ -40,6 +40,12 @@ MCMLinearInterpolateImageFunction< TInputImage, TCoordRep >
     unsigned int numThreads = itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
     m_ReferenceInputModels.resize(numThreads);
     m_ReferenceInputWeights.resize(numThreads);
+    m_CachedCellIndexes.resize(numThreads);
+    m_CachedNeighborMasks.resize(numThreads);
+    m_CachedInputTimeStamps.resize(numThreads);
+    m_CachedMaximalNumberOfCompartments.resize(numThreads);
+    this->InvalidateCellCaches();
+
     for (unsigned int i = 0;i < numThreads;++i)
     {
         m_ReferenceInputModels[i].resize(m_Neighbors);
@@ -59,6 +65,17 @@ MCMLinearInterpolateImageFunction< TInputImage, TCoordRep >
         this->TestModelsAdequation(m_ReferenceInputModels[0][0],model);
 
     this->ResetAveragePointers(model);
+
+    // New averagers do not know the models loaded in cached cells
+    this->InvalidateCellCaches();
+}
+
+template<class TInputImage, class TCoordRep>
+void
+MCMLinearInterpolateImageFunction< TInputImage, TCoordRep >
+::InvalidateCellCaches() const
+{
+    std::fill(m_CachedNeighborMasks.begin(),m_CachedNeighborMasks.end(),-1);
 }
 
 template<class TInputImage, class TCoordRep>
@@ -73,6 +90,7 @@ MCMLinearInterpolateImageFunction< TInputImage, TCoordRep >
     {
         m_MCMAveragers[i] = AveragerType::New();
         m_MCMAveragers[i]->SetOutputModel(model);
+        m_MCMAveragers[i]->SetUseGreedyMatching(true);
     }
 }
 
@@ -214,6 +232,7 @@ MCMLinearInterpolateImageFunction< TInputImage, TCoordRep >
     {
         m_ReferenceInputModels[threadIndex][0]->SetModelVector(static_cast<OutputType> (this->GetInputImage()->GetPixel(closestIndex)));
         m_ReferenceInputWeights[threadIndex][0] = 1;
+        m_CachedNeighborMasks[threadIndex] = -1;
 
         m_MCMAveragers[threadIndex]->SetInputModels(m_ReferenceInputModels[threadIndex]);
         m_MCMAveragers[threadIndex]->SetInputWeights(m_ReferenceInputWeights[threadIndex]);
@@ -230,10 +249,9 @@ MCMLinearInterpolateImageFunction< TInputImage, TCoordRep >
     double totalOverlap = 0;
 
     unsigned int posMCM = 0;
-    unsigned int maxNumCompartments = 0;
-
-    unsigned int numIsoCompartments = m_ReferenceInputModels[threadIndex][0]->GetNumberOfIsotropicCompartments();
-    unsigned int numberOfTotalInputCompartments = m_ReferenceInputModels[threadIndex][0]->GetNumberOfCompartments();
+    unsigned int neighborMask = 0;
+    IndexType neighIndexes[1 << ImageDimension];
+    double neighOverlaps[1 << ImageDimension];
 
     for (unsigned int counterInput = 0;counterInput < m_Neighbors;++counterInput)
     {
@@ -273,20 +291,50 @@ MCMLinearInterpolateImageFunction< TInputImage, TCoordRep >
             upper >>= 1;
         }
 
-        // get neighbor value only if overlap is not zero
+        // keep neighbor only if overlap is not zero
         if ((overlap > 0) && okValue)
         {
             const PixelType input = this->GetInputImage()->GetPixel( neighIndex );
             if (isZero(input))
                 continue;
 
-            m_ReferenceInputModels[threadIndex][posMCM]->SetModelVector(input);
-            m_ReferenceInputWeights[threadIndex][posMCM] = overlap;
+            neighIndexes[posMCM] = neighIndex;
+            neighOverlaps[posMCM] = overlap;
+            neighborMask |= (1 << counterInput);
+
+            totalOverlap += overlap;
+            ++posMCM;
+        }
+    }
+
+    if (totalOverlap < 0.5)
+    {
+        this->UnlockWorkIndex(threadIndex);
+        voxelOutputValue.Fill(0.0);
+        return voxelOutputValue;
+    }
+
+    // Neighbor models and their compartment matching are re-used for all queries falling in the same cell,
+    // as long as the input image was not modified in between
+    itk::ModifiedTimeType inputTimeStamp = this->GetInputImage()->GetMTime();
+    bool sameCell = (m_CachedNeighborMasks[threadIndex] == (int)neighborMask) && (m_CachedCellIndexes[threadIndex] == baseIndex) &&
+            (m_CachedInputTimeStamps[threadIndex] == inputTimeStamp);
+
+    if (!sameCell)
+    {
+        unsigned int maxNumCompartments = 0;
+        unsigned int numIsoCompartments = m_ReferenceInputModels[threadIndex][0]->GetNumberOfIsotropicCompartments();
+        unsigned int numberOfTotalInputCompartments = m_ReferenceInputModels[threadIndex][0]->GetNumberOfCompartments();
+
+        for (unsigned int i = 0;i < posMCM;++i)
+        {
+            const PixelType input = this->GetInputImage()->GetPixel( neighIndexes[i] );
+            m_ReferenceInputModels[threadIndex][i]->SetModelVector(input);
 
             unsigned int numEffectiveAnisotropicCompartments = 0;
-            for (unsigned int i = numIsoCompartments;i < numberOfTotalInputCompartments;++i)
+            for (unsigned int j = numIsoCompartments;j < numberOfTotalInputCompartments;++j)
             {
-                double fascWeight = m_ReferenceInputModels[threadIndex][posMCM]->GetCompartmentWeight(i);
+                double fascWeight = m_ReferenceInputModels[threadIndex][i]->GetCompartmentWeight(j);
                 if (fascWeight <= 0)
                     continue;
 
@@ -295,21 +343,23 @@ MCMLinearInterpolateImageFunction< TInputImage, TCoordRep >
 
             if (numEffectiveAnisotropicCompartments > maxNumCompartments)
                 maxNumCompartments = numEffectiveAnisotropicCompartments;
-
-            totalOverlap += overlap;
-            ++posMCM;
         }
-    }
 
-    if (totalOverlap < 0.5)
-    {
-        this->UnlockWorkIndex(threadIndex);
-        voxelOutputValue.Fill(0.0);
-        return voxelOutputValue;
+        m_CachedCellIndexes[threadIndex] = baseIndex;
+        m_CachedNeighborMasks[threadIndex] = neighborMask;
+        m_CachedInputTimeStamps[threadIndex] = inputTimeStamp;
+        m_CachedMaximalNumberOfCompartments[threadIndex] = maxNumCompartments;
     }
 
-    m_MCMAveragers[threadIndex]->SetNumberOfOutputDirectionalCompartments(maxNumCompartments);
-    m_MCMAveragers[threadIndex]->SetInputModels(m_ReferenceInputModels[threadIndex]);
+    for (unsigned int i = 0;i < posMCM;++i)
+        m_ReferenceInputWeights[threadIndex][i] = neighOverlaps[i];
+
+    m_MCMAveragers[threadIndex]->SetNumberOfOutputDirectionalCompartments(m_CachedMaximalNumberOfCompartments[threadIndex]);
+    if (sameCell)
+        m_MCMAveragers[threadIndex]->SetInputModelsUnchanged();
+    else
+        m_MCMAveragers[threadIndex]->SetInputModels(m_ReferenceInputModels[threadIndex]);
+
     m_MCMAveragers[threadIndex]->SetInputWeights(m_ReferenceInputWeights[threadIndex]);
 
     m_MCMAveragers[threadIndex]->Update();
@@ -13,6 +13,25 @@ double BaseCompartment::GetPredictedSignal(double smallDelta, double bigDelta, d
     return std::abs(ftDiffusionProfile);
 }
 
+void BaseCompartment::EvaluateSignals(const GradientSchemeSoA &scheme, double *signals, double *jacobians)
+{
+    unsigned int numGradients = scheme.GetNumberOfGradients();
+    const double *gradientStrengths = scheme.GetGradientStrengths();
+
+    for (unsigned int i = 0;i < numGradients;++i)
+    {
+        Vector3DType gradient = scheme.GetGradient(i);
+        signals[i] = this->GetFourierTransformedDiffusionProfile(scheme.GetSmallDelta(), scheme.GetBigDelta(), gradientStrengths[i], gradient);
+
+        if (!jacobians)
+            continue;
+
+        ListType &jacobian = this->GetSignalAttenuationJacobian(scheme.GetSmallDelta(), scheme.GetBigDelta(), gradientStrengths[i], gradient);
+        for (unsigned int k = 0;k < jacobian.size();++k)
+            jacobians[k * numGradients + i] = jacobian[k];
+    }
+}
+
 bool BaseCompartment::IsEqual(Self *rhs, double tolerance, double absoluteTolerance)
 {
     if (this->GetTensorCompatible() && rhs->GetTensorCompatible())
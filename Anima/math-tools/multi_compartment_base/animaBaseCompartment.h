@@ -9,6 +9,7 @@
 
 #include <AnimaMCMBaseExport.h>
 #include <animaMCMConstants.h>
+#include <animaGradientSchemeSoA.h>
 
 namespace anima
 {
@@ -51,6 +52,13 @@ public:
     virtual ListType &GetSignalAttenuationJacobian(double smallDelta, double bigDelta, double gradientStrength, const Vector3DType &gradient) = 0;
     virtual double GetLogDiffusionProfile(const Vector3DType &sample) = 0;
 
+    /**
+     * Batched evaluation of signal attenuations (and optionally their jacobian) for a whole acquisition scheme.
+     * signals has the scheme size, jacobians (if not null) is parameter-major: jacobians[k * numGradients + i].
+     * Default implementation loops over the single gradient methods, re-implemented by compartments for speed
+     */
+    virtual void EvaluateSignals(const GradientSchemeSoA &scheme, double *signals, double *jacobians = 0);
+
     //! Various methods for optimization parameters setting and getting
     virtual void SetParametersFromVector(const ListType &params) = 0;
     virtual ListType &GetParametersAsVector() = 0;
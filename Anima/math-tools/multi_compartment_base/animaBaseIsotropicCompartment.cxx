@@ -26,6 +26,25 @@ BaseCompartment::ListType &BaseIsotropicCompartment::GetSignalAttenuationJacobia
     return m_JacobianVector;
 }
     
+void BaseIsotropicCompartment::EvaluateSignals(const GradientSchemeSoA &scheme, double *signals, double *jacobians)
+{
+    unsigned int numGradients = scheme.GetNumberOfGradients();
+    const double *bValues = scheme.GetBValues();
+    double diffusivity = this->GetAxialDiffusivity();
+
+    for (unsigned int i = 0;i < numGradients;++i)
+        signals[i] = - bValues[i] * diffusivity;
+
+    for (unsigned int i = 0;i < numGradients;++i)
+        signals[i] = std::exp(signals[i]);
+
+    if ((!jacobians) || (this->GetNumberOfParameters() == 0))
+        return;
+
+    for (unsigned int i = 0;i < numGradients;++i)
+        jacobians[i] = - bValues[i] * signals[i];
+}
+
 double BaseIsotropicCompartment::GetLogDiffusionProfile(const Vector3DType &sample)
 {
     double resVal = - 1.5 * std::log(2.0 * M_PI * this->GetAxialDiffusivity());
@@ -10,6 +10,19 @@ BaseMCMCost::BaseMCMCost()
 
     m_SmallDelta = anima::DiffusionSmallDelta;
     m_BigDelta = anima::DiffusionBigDelta;
+
+    m_ModifiedGradientScheme = true;
+}
+
+const GradientSchemeSoA &BaseMCMCost::GetGradientScheme()
+{
+    if (m_ModifiedGradientScheme)
+    {
+        m_GradientScheme.SetGradientScheme(m_SmallDelta, m_BigDelta, m_GradientStrengths, m_Gradients);
+        m_ModifiedGradientScheme = false;
+    }
+
+    return m_GradientScheme;
 }
 
 } // end namespace anima
@@ -5,6 +5,7 @@
 #include <itkOptimizerParameters.h>
 
 #include <animaMultiCompartmentModel.h>
+#include <animaGradientSchemeSoA.h>
 #include <AnimaMCMBaseExport.h>
 
 namespace anima
@@ -36,8 +37,8 @@ public:
     typedef MCMType::ListType ListType;
 
     void SetObservedSignals(ListType &value) {m_ObservedSignals = value;}
-    void SetGradients(std::vector<Vector3DType> &value) {m_Gradients = value;}
-    void SetGradientStrengths(ListType &value) {m_GradientStrengths = value;}
+    void SetGradients(std::vector<Vector3DType> &value) {m_Gradients = value; m_ModifiedGradientScheme = true;}
+    void SetGradientStrengths(ListType &value) {m_GradientStrengths = value; m_ModifiedGradientScheme = true;}
 
     void SetMCMStructure(MCMType *model) {m_MCMStructure = model;}
     MCMPointer &GetMCMStructure() {return m_MCMStructure;}
@@ -70,13 +71,16 @@ public:
 
     virtual double GetSigmaSquare() {return m_SigmaSquare;}
 
-    void SetSmallDelta(double val) {m_SmallDelta = val;}
-    void SetBigDelta(double val) {m_BigDelta = val;}
+    void SetSmallDelta(double val) {m_SmallDelta = val; m_ModifiedGradientScheme = true;}
+    void SetBigDelta(double val) {m_BigDelta = val; m_ModifiedGradientScheme = true;}
 
 protected:
     BaseMCMCost();
     virtual ~BaseMCMCost() {}
 
+    //! Structure of arrays version of the acquisition scheme for batched compartment evaluations, updated on demand
+    const GradientSchemeSoA &GetGradientScheme();
+
     double m_SigmaSquare;
     std::vector <double> m_PredictedSignals;
 
@@ -89,6 +93,9 @@ protected:
     double m_BigDelta;
     ListType m_GradientStrengths;
 
+    GradientSchemeSoA m_GradientScheme;
+    bool m_ModifiedGradientScheme;
+
     MCMPointer m_MCMStructure;
 
 private:
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+#include <vnl/vnl_vector_fixed.h>
+
+#include <animaMCMConstants.h>
+
+namespace anima
+{
+
+/**
+ * @brief Structure of arrays description of a diffusion acquisition scheme (gradient coordinates, strengths and b-values),
+ * used by batched compartment signal evaluations. Coordinates and b-values are stored in separate contiguous arrays
+ * so that loops over gradients run on contiguous data.
+ */
+class GradientSchemeSoA
+{
+public:
+    typedef vnl_vector_fixed <double,3> Vector3DType;
+
+    GradientSchemeSoA()
+    {
+        m_SmallDelta = 0;
+        m_BigDelta = 0;
+    }
+
+    void SetGradientScheme(double smallDelta, double bigDelta, const std::vector <double> &gradientStrengths,
+                           const std::vector <Vector3DType> &gradients)
+    {
+        m_SmallDelta = smallDelta;
+        m_BigDelta = bigDelta;
+
+        unsigned int numGradients = gradients.size();
+        m_GradientX.resize(numGradients);
+        m_GradientY.resize(numGradients);
+        m_GradientZ.resize(numGradients);
+        m_GradientStrengths.resize(numGradients);
+        m_BValues.resize(numGradients);
+
+        for (unsigned int i = 0;i < numGradients;++i)
+        {
+            m_GradientX[i] = gradients[i][0];
+            m_GradientY[i] = gradients[i][1];
+            m_GradientZ[i] = gradients[i][2];
+            m_GradientStrengths[i] = gradientStrengths[i];
+            m_BValues[i] = anima::GetBValueFromAcquisitionParameters(smallDelta, bigDelta, gradientStrengths[i]);
+        }
+    }
+
+    unsigned int GetNumberOfGradients() const {return m_BValues.size();}
+
+    double GetSmallDelta() const {return m_SmallDelta;}
+    double GetBigDelta() const {return m_BigDelta;}
+
+    const double *GetGradientX() const {return m_GradientX.data();}
+    const double *GetGradientY() const {return m_GradientY.data();}
+    const double *GetGradientZ() const {return m_GradientZ.data();}
+    const double *GetGradientStrengths() const {return m_GradientStrengths.data();}
+    const double *GetBValues() const {return m_BValues.data();}
+
+    Vector3DType GetGradient(unsigned int i) const
+    {
+        Vector3DType gradient;
+        gradient[0] = m_GradientX[i];
+        gradient[1] = m_GradientY[i];
+        gradient[2] = m_GradientZ[i];
+        return gradient;
+    }
+
+private:
+    double m_SmallDelta, m_BigDelta;
+
+    std::vector <double> m_GradientX, m_GradientY, m_GradientZ;
+    std::vector <double> m_GradientStrengths;
+    std::vector <double> m_BValues;
+};
+
+} // end namespace anima
@@ -0,0 +1,179 @@
+#include <animaMCMBlockSoAView.h>
+
+#include <itkSymmetricEigenAnalysis.h>
+#include <cmath>
+#include <vnl/vnl_vector_fixed.h>
+
+namespace anima
+{
+
+MCMBlockSoAView::MCMBlockSoAView()
+{
+    m_NumberOfVoxels = 0;
+    m_MaximalNumberOfCompartments = 0;
+    m_StoreTensors = false;
+}
+
+void MCMBlockSoAView::Initialize(unsigned int numVoxels, unsigned int maxCompartments, bool storeTensors)
+{
+    m_NumberOfVoxels = numVoxels;
+    m_MaximalNumberOfCompartments = maxCompartments;
+    m_StoreTensors = storeTensors;
+
+    unsigned int numValues = numVoxels * maxCompartments;
+
+    m_NumberOfCompartments.assign(numVoxels, 0);
+    m_Weights.assign(numValues, 0.0);
+    m_OrientationsX.assign(numValues, 0.0);
+    m_OrientationsY.assign(numValues, 0.0);
+    m_OrientationsZ.assign(numValues, 0.0);
+    m_AxialDiffusivities.assign(numValues, 0.0);
+    m_RadialDiffusivities1.assign(numValues, 0.0);
+    m_RadialDiffusivities2.assign(numValues, 0.0);
+
+    if (storeTensors)
+    {
+        m_Tensors.assign(6 * numValues, 0.0);
+        m_LogTensors.assign(6 * numValues, 0.0);
+    }
+    else
+    {
+        m_Tensors.clear();
+        m_LogTensors.clear();
+    }
+}
+
+void MCMBlockSoAView::SetVoxel(unsigned int voxel, MCMType *model)
+{
+    if (voxel >= m_NumberOfVoxels)
+        throw itk::ExceptionObject(__FILE__, __LINE__, "Voxel index out of view bounds", ITK_LOCATION);
+
+    unsigned int numCompartments = model->GetNumberOfCompartments();
+    double logVector[6];
+    unsigned int slot = 0;
+
+    for (unsigned int i = 0;i < numCompartments;++i)
+    {
+        double weight = model->GetCompartmentWeight(i);
+        if (weight <= 0)
+            continue;
+
+        if (slot >= m_MaximalNumberOfCompartments)
+            throw itk::ExceptionObject(__FILE__, __LINE__, "Too many compartments for view storage", ITK_LOCATION);
+
+        anima::BaseCompartment *compartment = model->GetCompartment(i);
+        unsigned int pos = slot * m_NumberOfVoxels + voxel;
+
+        double theta = compartment->GetOrientationTheta();
+        double phi = compartment->GetOrientationPhi();
+
+        m_Weights[pos] = weight;
+        m_OrientationsX[pos] = std::sin(theta) * std::cos(phi);
+        m_OrientationsY[pos] = std::sin(theta) * std::sin(phi);
+        m_OrientationsZ[pos] = std::cos(theta);
+        m_AxialDiffusivities[pos] = compartment->GetAxialDiffusivity();
+        m_RadialDiffusivities1[pos] = compartment->GetRadialDiffusivity1();
+        m_RadialDiffusivities2[pos] = compartment->GetRadialDiffusivity2();
+
+        if (m_StoreTensors)
+        {
+            const Matrix3DType &tensor = compartment->GetDiffusionTensor();
+            ComputeLogTensorVector(tensor, logVector);
+
+            unsigned int component = 0;
+            for (unsigned int j = 0;j < 3;++j)
+            {
+                for (unsigned int k = 0;k <= j;++k)
+                {
+                    unsigned int tensorPos = (component * m_MaximalNumberOfCompartments + slot) * m_NumberOfVoxels + voxel;
+                    m_Tensors[tensorPos] = tensor(j,k);
+                    m_LogTensors[tensorPos] = logVector[component];
+                    ++component;
+                }
+            }
+        }
+
+        ++slot;
+    }
+
+    m_NumberOfCompartments[voxel] = slot;
+
+    // Clear remaining slots so that arrays over voxels can be read without checking compartment numbers
+    for (unsigned int i = slot;i < m_MaximalNumberOfCompartments;++i)
+        m_Weights[i * m_NumberOfVoxels + voxel] = 0.0;
+}
+
+unsigned int MCMBlockSoAView::GetVoxelLogTensors(unsigned int voxel, double *weights, double *logTensors) const
+{
+    unsigned int numCompartments = m_NumberOfCompartments[voxel];
+    for (unsigned int i = 0;i < numCompartments;++i)
+    {
+        weights[i] = m_Weights[i * m_NumberOfVoxels + voxel];
+        for (unsigned int j = 0;j < 6;++j)
+            logTensors[6 * i + j] = m_LogTensors[(j * m_MaximalNumberOfCompartments + i) * m_NumberOfVoxels + voxel];
+    }
+
+    return numCompartments;
+}
+
+unsigned int MCMBlockSoAView::GetVoxelTensors(unsigned int voxel, double *weights, Matrix3DType *tensors) const
+{
+    unsigned int numCompartments = m_NumberOfCompartments[voxel];
+    for (unsigned int i = 0;i < numCompartments;++i)
+    {
+        weights[i] = m_Weights[i * m_NumberOfVoxels + voxel];
+
+        unsigned int component = 0;
+        for (unsigned int j = 0;j < 3;++j)
+        {
+            for (unsigned int k = 0;k <= j;++k)
+            {
+                double value = m_Tensors[(component * m_MaximalNumberOfCompartments + i) * m_NumberOfVoxels + voxel];
+                tensors[i](j,k) = value;
+                tensors[i](k,j) = value;
+                ++component;
+            }
+        }
+    }
+
+    return numCompartments;
+}
+
+void MCMBlockSoAView::ComputeLogTensorVector(const Matrix3DType &tensor, double *logVector)
+{
+    typedef vnl_vector_fixed <double,3> EigenValuesType;
+    itk::SymmetricEigenAnalysis <Matrix3DType, EigenValuesType, Matrix3DType> eigenComputer(3);
+
+    EigenValuesType eigenValues;
+    Matrix3DType eigenVectors;
+    eigenComputer.ComputeEigenValuesAndVectors(tensor, eigenValues, eigenVectors);
+
+    // Same clamping of eigenvalues as anima::GetTensorLogarithm
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        if (eigenValues[i] <= 1.0e-16)
+            eigenValues[i] = 1.0e-16;
+
+        eigenValues[i] = std::log(eigenValues[i]);
+    }
+
+    const double sqrt2 = std::sqrt(2.0);
+    unsigned int pos = 0;
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        for (unsigned int j = 0;j <= i;++j)
+        {
+            double value = 0;
+            for (unsigned int k = 0;k < 3;++k)
+                value += eigenValues[k] * eigenVectors(k,i) * eigenVectors(k,j);
+
+            if (i != j)
+                value *= sqrt2;
+
+            logVector[pos] = value;
+            ++pos;
+        }
+    }
+}
+
+} // end namespace anima
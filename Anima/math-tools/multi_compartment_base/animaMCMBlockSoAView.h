@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <animaMultiCompartmentModel.h>
+
+#include <AnimaMCMBaseExport.h>
+
+namespace anima
+{
+
+/**
+ * @brief Compact structure of arrays view of a block of multi-compartment models (e.g. the voxels of a fixed image
+ * block in registration metrics). Only compartments with a positive weight are kept: for each voxel, those are packed
+ * in slots 0 to GetNumberOfCompartments(voxel) - 1. Each field is stored slot by slot in contiguous arrays over voxels
+ * (value of slot s for voxel v at s * numVoxels + v) so that no model object has to be kept per voxel.
+ * Tensors are stored in the lower triangular vector representation (six values), log-tensors with off-diagonal terms
+ * scaled by sqrt(2) so that squared euclidean distances between vectors are Log-Euclidean distances.
+ */
+class ANIMAMCMBASE_EXPORT MCMBlockSoAView
+{
+public:
+    typedef anima::MultiCompartmentModel MCMType;
+    typedef MCMType::Pointer MCMPointer;
+    typedef anima::BaseCompartment::Matrix3DType Matrix3DType;
+
+    MCMBlockSoAView();
+
+    /**
+     * Allocates storage for numVoxels voxels with at most maxCompartments non null compartments. If storeTensors is true,
+     * tensors and log-tensors of compartments are also stored (all compartments must then be tensor compatible)
+     */
+    void Initialize(unsigned int numVoxels, unsigned int maxCompartments, bool storeTensors);
+
+    //! Stores compartments with positive weights of model in voxel slots
+    void SetVoxel(unsigned int voxel, MCMType *model);
+
+    unsigned int GetNumberOfVoxels() const {return m_NumberOfVoxels;}
+    unsigned int GetMaximalNumberOfCompartments() const {return m_MaximalNumberOfCompartments;}
+    bool GetStoreTensors() const {return m_StoreTensors;}
+
+    //! Number of non null compartments of a voxel
+    unsigned int GetNumberOfCompartments(unsigned int voxel) const {return m_NumberOfCompartments[voxel];}
+
+    //! Arrays over voxels for a given compartment slot
+    const double *GetWeights(unsigned int slot) const {return m_Weights.data() + slot * m_NumberOfVoxels;}
+    const double *GetOrientationsX(unsigned int slot) const {return m_OrientationsX.data() + slot * m_NumberOfVoxels;}
+    const double *GetOrientationsY(unsigned int slot) const {return m_OrientationsY.data() + slot * m_NumberOfVoxels;}
+    const double *GetOrientationsZ(unsigned int slot) const {return m_OrientationsZ.data() + slot * m_NumberOfVoxels;}
+    const double *GetAxialDiffusivities(unsigned int slot) const {return m_AxialDiffusivities.data() + slot * m_NumberOfVoxels;}
+    const double *GetRadialDiffusivities1(unsigned int slot) const {return m_RadialDiffusivities1.data() + slot * m_NumberOfVoxels;}
+    const double *GetRadialDiffusivities2(unsigned int slot) const {return m_RadialDiffusivities2.data() + slot * m_NumberOfVoxels;}
+
+    //! Tensor and log-tensor component arrays over voxels, component in [0,6[
+    const double *GetTensorComponents(unsigned int slot, unsigned int component) const
+    {
+        return m_Tensors.data() + (component * m_MaximalNumberOfCompartments + slot) * m_NumberOfVoxels;
+    }
+
+    const double *GetLogTensorComponents(unsigned int slot, unsigned int component) const
+    {
+        return m_LogTensors.data() + (component * m_MaximalNumberOfCompartments + slot) * m_NumberOfVoxels;
+    }
+
+    /**
+     * Gathers weights and log-tensors (six values per compartment, compartment after compartment) of a voxel into
+     * caller provided buffers of at least GetMaximalNumberOfCompartments() compartments. Returns the number of compartments
+     */
+    unsigned int GetVoxelLogTensors(unsigned int voxel, double *weights, double *logTensors) const;
+
+    //! Gathers weights and tensors of a voxel, same layout as GetVoxelLogTensors
+    unsigned int GetVoxelTensors(unsigned int voxel, double *weights, Matrix3DType *tensors) const;
+
+    //! Log-tensor vector (off-diagonal terms scaled by sqrt(2)) of a 3D tensor, without any heap allocation
+    static void ComputeLogTensorVector(const Matrix3DType &tensor, double *logVector);
+
+private:
+    unsigned int m_NumberOfVoxels;
+    unsigned int m_MaximalNumberOfCompartments;
+    bool m_StoreTensors;
+
+    std::vector <unsigned int> m_NumberOfCompartments;
+
+    std::vector <double> m_Weights;
+    std::vector <double> m_OrientationsX, m_OrientationsY, m_OrientationsZ;
+    std::vector <double> m_AxialDiffusivities;
+    std::vector <double> m_RadialDiffusivities1, m_RadialDiffusivities2;
+
+    std::vector <double> m_Tensors;
+    std::vector <double> m_LogTensors;
+};
+
+} // end namespace anima
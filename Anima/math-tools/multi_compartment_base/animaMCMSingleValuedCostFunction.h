@@ -29,6 +29,7 @@ public:
     typedef InternalCostType::Pointer InternalCostPointer;
 
     itkSetMacro(InternalCost, InternalCostPointer)
+    itkGetConstReferenceMacro(InternalCost, InternalCostPointer)
 
     virtual MeasureType GetValue(const ParametersType &parameters) const ITK_OVERRIDE;
     virtual void GetDerivative(const ParametersType & parameters, DerivativeType & derivative) const ITK_OVERRIDE;
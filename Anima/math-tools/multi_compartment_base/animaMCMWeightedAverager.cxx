@@ -9,14 +9,30 @@ MCMWeightedAverager::MCMWeightedAverager()
 {
     m_UpToDate = false;
     m_NumberOfOutputDirectionalCompartments = 3;
+
+    m_UseGreedyMatching = false;
+    this->SetGreedyMatchingAngleThreshold(30.0);
+
+    m_InputModelsUnchanged = false;
+    m_WorkDataValid = false;
+    m_GreedyMatchingValid = false;
+    m_MatchingNumberOfOutputCompartments = 0;
 }
 
 void MCMWeightedAverager::SetOutputModel(MCMType *model)
 {
     m_OutputModel = model->Clone();
+    m_WorkDataValid = false;
     this->ResetNumberOfOutputDirectionalCompartments();
 }
 
+void MCMWeightedAverager::SetGreedyMatchingAngleThreshold(double val)
+{
+    m_GreedyMatchingCosineThreshold = std::cos(val * M_PI / 180.0);
+    m_WorkDataValid = false;
+    m_UpToDate = false;
+}
+
 void MCMWeightedAverager::SetNumberOfOutputDirectionalCompartments(unsigned int val)
 {
     m_NumberOfOutputDirectionalCompartments = val;
@@ -58,6 +74,9 @@ void MCMWeightedAverager::Update()
     if (m_InputModels.size() != m_InputWeights.size())
         itkExceptionMacro("Not the same number of weights and input models");
 
+    if (!m_InputModelsUnchanged)
+        m_WorkDataValid = false;
+
     unsigned int numInputs = m_InputModels.size();
     // First make sure weights sum up to 1
     double sumWeights = 0;
@@ -106,6 +125,7 @@ void MCMWeightedAverager::Update()
 
     m_WorkCompartmentsVector.clear();
     m_WorkCompartmentWeights.clear();
+    m_WorkCompartmentInputIndexes.clear();
 
     for (unsigned int i = 0;i < numInputs;++i)
     {
@@ -120,6 +140,7 @@ void MCMWeightedAverager::Update()
 
             m_WorkCompartmentsVector.push_back(m_InputModels[i]->GetCompartment(j));
             m_WorkCompartmentWeights.push_back(m_InputWeights[i] * tmpWeight);
+            m_WorkCompartmentInputIndexes.push_back(i);
         }
     }
 
@@ -140,26 +161,46 @@ void MCMWeightedAverager::Update()
     }
 
     bool tensorCompatibility = m_WorkCompartmentsVector[0]->GetTensorCompatible();
-    if (tensorCompatibility)
-        this->ComputeTensorDistanceMatrix();
-    else
-        this->ComputeNonTensorDistanceMatrix();
 
-    typedef anima::SpectralClusteringFilter<double> SpectralClusterType;
-    SpectralClusterType spectralCluster;
-    spectralCluster.SetNbClass(numOutputCompartments);
-    spectralCluster.SetMaxIterations(200);
-    spectralCluster.SetInputData(m_InternalDistanceMatrix);
-    spectralCluster.SetDataWeights(m_WorkCompartmentWeights);
-    spectralCluster.SetVerbose(false);
-    spectralCluster.InitializeSigmaFromDistances();
-    spectralCluster.SetCMeansAverageType(SpectralClusterType::CMeansFilterType::Euclidean);
+    // Log-tensors, distances and greedy matching only depend on input models, not on their weights
+    bool reuseWorkData = m_InputModelsUnchanged && m_WorkDataValid && (m_MatchingNumberOfOutputCompartments == numOutputCompartments);
+    if (!reuseWorkData)
+    {
+        m_GreedyMatchingValid = false;
+        if (tensorCompatibility)
+        {
+            this->ComputeInternalLogTensors();
+            if (m_UseGreedyMatching)
+                m_GreedyMatchingValid = this->ComputeGreedyMatching(numOutputCompartments);
 
-    spectralCluster.Update();
+            if (!m_GreedyMatchingValid)
+                this->ComputeTensorDistanceMatrix();
+        }
+        else
+            this->ComputeNonTensorDistanceMatrix();
 
-    m_InternalSpectralMemberships.resize(numInputCompartments);
-    for (unsigned int i = 0;i < numInputCompartments;++i)
-        m_InternalSpectralMemberships[i] = spectralCluster.GetClassesMembership(i);
+        m_MatchingNumberOfOutputCompartments = numOutputCompartments;
+        m_WorkDataValid = true;
+    }
+
+    if (!m_GreedyMatchingValid)
+    {
+        typedef anima::SpectralClusteringFilter<double> SpectralClusterType;
+        SpectralClusterType spectralCluster;
+        spectralCluster.SetNbClass(numOutputCompartments);
+        spectralCluster.SetMaxIterations(200);
+        spectralCluster.SetInputData(m_InternalDistanceMatrix);
+        spectralCluster.SetDataWeights(m_WorkCompartmentWeights);
+        spectralCluster.SetVerbose(false);
+        spectralCluster.InitializeSigmaFromDistances();
+        spectralCluster.SetCMeansAverageType(SpectralClusterType::CMeansFilterType::Euclidean);
+
+        spectralCluster.Update();
+
+        m_InternalSpectralMemberships.resize(numInputCompartments);
+        for (unsigned int i = 0;i < numInputCompartments;++i)
+            m_InternalSpectralMemberships[i] = spectralCluster.GetClassesMembership(i);
+    }
 
     if (tensorCompatibility)
         this->ComputeOutputTensorModel();
@@ -171,7 +212,7 @@ void MCMWeightedAverager::Update()
     m_UpToDate = true;
 }
 
-void MCMWeightedAverager::ComputeTensorDistanceMatrix()
+void MCMWeightedAverager::ComputeInternalLogTensors()
 {
     unsigned int numCompartments = m_WorkCompartmentsVector.size();
     m_InternalLogTensors.resize(numCompartments);
@@ -183,6 +224,11 @@ void MCMWeightedAverager::ComputeTensorDistanceMatrix()
         anima::GetTensorLogarithm(workMatrix,workMatrixLog);
         anima::GetVectorRepresentation(workMatrixLog,m_InternalLogTensors[i],6,true);
     }
+}
+
+void MCMWeightedAverager::ComputeTensorDistanceMatrix()
+{
+    unsigned int numCompartments = m_WorkCompartmentsVector.size();
 
     m_InternalDistanceMatrix.set_size(numCompartments,numCompartments);
     m_InternalDistanceMatrix.fill(0);
@@ -199,6 +245,111 @@ void MCMWeightedAverager::ComputeTensorDistanceMatrix()
         }
 }
 
+bool MCMWeightedAverager::ComputeGreedyMatching(unsigned int numOutputCompartments)
+{
+    unsigned int numCompartments = m_WorkCompartmentsVector.size();
+    if ((numCompartments == 0)||(numOutputCompartments == 0))
+        return false;
+
+    // Compartments are stored input after input, find ranges and the reference input (the first one with the most compartments)
+    m_WorkInputRanges.clear();
+    unsigned int referenceRange = 0;
+    unsigned int rangeStart = 0;
+    for (unsigned int i = 1;i <= numCompartments;++i)
+    {
+        if ((i < numCompartments)&&(m_WorkCompartmentInputIndexes[i] == m_WorkCompartmentInputIndexes[rangeStart]))
+            continue;
+
+        m_WorkInputRanges.push_back(rangeStart);
+        m_WorkInputRanges.push_back(i);
+
+        unsigned int referenceSize = m_WorkInputRanges[2 * referenceRange + 1] - m_WorkInputRanges[2 * referenceRange];
+        if (i - rangeStart > referenceSize)
+            referenceRange = m_WorkInputRanges.size() / 2 - 1;
+
+        rangeStart = i;
+    }
+
+    unsigned int referenceStart = m_WorkInputRanges[2 * referenceRange];
+    if (m_WorkInputRanges[2 * referenceRange + 1] - referenceStart != numOutputCompartments)
+        return false;
+
+    m_WorkOrientations.resize(3 * numCompartments);
+    for (unsigned int i = 0;i < numCompartments;++i)
+    {
+        double theta = m_WorkCompartmentsVector[i]->GetOrientationTheta();
+        double phi = m_WorkCompartmentsVector[i]->GetOrientationPhi();
+        m_WorkOrientations[3 * i] = std::sin(theta) * std::cos(phi);
+        m_WorkOrientations[3 * i + 1] = std::sin(theta) * std::sin(phi);
+        m_WorkOrientations[3 * i + 2] = std::cos(theta);
+    }
+
+    m_InternalSpectralMemberships.resize(numCompartments);
+    for (unsigned int i = 0;i < numCompartments;++i)
+        m_InternalSpectralMemberships[i].assign(numOutputCompartments,0.0);
+
+    std::vector <bool> usedSeeds(numOutputCompartments);
+    std::vector <bool> matchedCompartments(numOutputCompartments);
+    unsigned int numRanges = m_WorkInputRanges.size() / 2;
+    for (unsigned int r = 0;r < numRanges;++r)
+    {
+        unsigned int start = m_WorkInputRanges[2 * r];
+        unsigned int numRangeCompartments = m_WorkInputRanges[2 * r + 1] - start;
+
+        if (r == referenceRange)
+        {
+            for (unsigned int i = 0;i < numRangeCompartments;++i)
+                m_InternalSpectralMemberships[start + i][i] = 1.0;
+
+            continue;
+        }
+
+        std::fill(usedSeeds.begin(),usedSeeds.end(),false);
+        std::fill(matchedCompartments.begin(),matchedCompartments.end(),false);
+
+        // Repeatedly pair the closest unmatched compartment and reference compartment
+        for (unsigned int k = 0;k < numRangeCompartments;++k)
+        {
+            double bestCosine = -1.0;
+            unsigned int bestCompartment = 0;
+            unsigned int bestSeed = 0;
+
+            for (unsigned int i = 0;i < numRangeCompartments;++i)
+            {
+                if (matchedCompartments[i])
+                    continue;
+
+                const double *orientation = m_WorkOrientations.data() + 3 * (start + i);
+                for (unsigned int j = 0;j < numOutputCompartments;++j)
+                {
+                    if (usedSeeds[j])
+                        continue;
+
+                    const double *seedOrientation = m_WorkOrientations.data() + 3 * (referenceStart + j);
+                    double cosine = std::abs(orientation[0] * seedOrientation[0] + orientation[1] * seedOrientation[1]
+                            + orientation[2] * seedOrientation[2]);
+
+                    if (cosine > bestCosine)
+                    {
+                        bestCosine = cosine;
+                        bestCompartment = i;
+                        bestSeed = j;
+                    }
+                }
+            }
+
+            if (bestCosine < m_GreedyMatchingCosineThreshold)
+                return false;
+
+            matchedCompartments[bestCompartment] = true;
+            usedSeeds[bestSeed] = true;
+            m_InternalSpectralMemberships[start + bestCompartment][bestSeed] = 1.0;
+        }
+    }
+
+    return true;
+}
+
 void MCMWeightedAverager::ComputeNonTensorDistanceMatrix()
 {
     itkExceptionMacro("No non-tensor distance matrix implemented in public version")
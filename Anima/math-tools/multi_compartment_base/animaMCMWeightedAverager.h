@@ -13,7 +13,11 @@ namespace anima
 /**
  * @brief Computes a weighted average of input multi-compartment models. The output model is at the same
  * time giving the number and type of output compartments but also its parameters are erased when performing Update
- * to get the result
+ * to get the result.
+ * Anisotropic compartments are grouped by spectral clustering. For tensor compatible compartments, a greedy angular pairing
+ * is first tried: compartments of each input are matched one to one to those of the input with the most compartments,
+ * clustering is skipped if all matched orientations are closer than GreedyMatchingAngleThreshold. Greedy matching is off
+ * by default (it is enabled by MCM linear interpolation).
  */
 class ANIMAMCMBASE_EXPORT MCMWeightedAverager : public itk::LightObject
 {
@@ -32,7 +36,13 @@ public:
     typedef MCMType::BaseCompartmentPointer MCMCompartmentPointer;
     typedef MCMType::Pointer MCMPointer;
 
-    void SetInputModels(std::vector <MCMPointer> &models) {m_InputModels = models; m_UpToDate = false;}
+    void SetInputModels(std::vector <MCMPointer> &models) {m_InputModels = models; m_UpToDate = false; m_InputModelsUnchanged = false;}
+
+    /**
+     * Declares that input models have not changed since the last update (only their weights), so that compartment log-tensors,
+     * distances and greedy matching (which do not depend on input weights) are re-used. Inputs with a null weight must be the same
+     */
+    void SetInputModelsUnchanged() {m_InputModelsUnchanged = true; m_UpToDate = false;}
     void SetInputWeights(std::vector <double> &weights) {m_InputWeights = weights; m_UpToDate = false;}
 
     void SetNumberOfOutputDirectionalCompartments(unsigned int val);
@@ -44,6 +54,12 @@ public:
 
     unsigned int GetOutputModelSize();
 
+    void SetUseGreedyMatching(bool val) {m_UseGreedyMatching = val; m_UpToDate = false;}
+    bool GetUseGreedyMatching() {return m_UseGreedyMatching;}
+
+    //! Maximal angle (in degrees) between greedily matched compartments
+    void SetGreedyMatchingAngleThreshold(double val);
+
     void SetUpToDate(bool val) {m_UpToDate = val;}
 
     void Update();
@@ -52,7 +68,11 @@ protected:
     MCMWeightedAverager();
     ~MCMWeightedAverager() {}
 
+    void ComputeInternalLogTensors();
     void ComputeTensorDistanceMatrix();
+
+    //! Tries greedy angular pairing of compartments, fills memberships and returns true if all pairs are close enough
+    bool ComputeGreedyMatching(unsigned int numOutputCompartments);
     virtual void ComputeNonTensorDistanceMatrix();
 
     void ComputeOutputTensorModel();
@@ -67,6 +87,15 @@ private:
     MCMPointer m_OutputModel;
     bool m_UpToDate;
 
+    bool m_UseGreedyMatching;
+    double m_GreedyMatchingCosineThreshold;
+
+    // Re-use of weight independent data between updates
+    bool m_InputModelsUnchanged;
+    bool m_WorkDataValid;
+    bool m_GreedyMatchingValid;
+    unsigned int m_MatchingNumberOfOutputCompartments;
+
 protected:
     // Internal work variables
     std::vector < itk::VariableLengthVector <double> > m_InternalLogTensors;
@@ -74,6 +103,9 @@ protected:
     std::vector <double> m_InternalOutputWeights;
     std::vector <MCMCompartmentPointer> m_WorkCompartmentsVector;
     std::vector <double> m_WorkCompartmentWeights;
+    std::vector <unsigned int> m_WorkCompartmentInputIndexes;
+    std::vector <unsigned int> m_WorkInputRanges;
+    std::vector <double> m_WorkOrientations;
     vnl_matrix <double> m_InternalDistanceMatrix;
     std::vector < std::vector <double> > m_InternalSpectralMemberships;
 };
@@ -242,6 +242,24 @@ double MultiCompartmentModel::GetPredictedSignal(double smallDelta, double bigDe
     return ftDiffusionProfile;
 }
     
+void MultiCompartmentModel::GetPredictedSignals(const GradientSchemeSoA &scheme, ListType &signals)
+{
+    unsigned int numGradients = scheme.GetNumberOfGradients();
+    signals.resize(numGradients);
+    std::fill(signals.begin(),signals.end(),0.0);
+    m_WorkVector.resize(numGradients);
+
+    for (unsigned int i = 0;i < m_Compartments.size();++i)
+    {
+        if (m_CompartmentWeights[i] == 0.0)
+            continue;
+
+        m_Compartments[i]->EvaluateSignals(scheme, m_WorkVector.data());
+        for (unsigned int j = 0;j < numGradients;++j)
+            signals[j] += m_CompartmentWeights[i] * m_WorkVector[j];
+    }
+}
+
 MultiCompartmentModel::ListType &MultiCompartmentModel::GetSignalJacobian(double smallDelta, double bigDelta, double gradientStrength, const Vector3DType &gradient)
 {
     unsigned int jacobianSize = 0;
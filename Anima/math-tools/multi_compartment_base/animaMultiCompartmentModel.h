@@ -62,6 +62,8 @@ public:
     void SetModelVector(const ModelOutputVectorType &mcmVec);
 
     double GetPredictedSignal(double smallDelta, double bigDelta, double gradientStrength, const Vector3DType &gradient);
+    //! Batched version of GetPredictedSignal over a whole acquisition scheme
+    void GetPredictedSignals(const GradientSchemeSoA &scheme, ListType &signals);
     ListType &GetSignalJacobian(double smallDelta, double bigDelta, double gradientStrength, const Vector3DType &gradient);
     double GetDiffusionProfile(Vector3DType &sample);
 
@@ -0,0 +1,109 @@
+#include <animaDictionaryNNLSSolver.h>
+
+namespace anima
+{
+
+DictionaryNNLSSolver::DictionaryNNLSSolver()
+{
+    m_UseWarmStart = true;
+}
+
+void DictionaryNNLSSolver::SetDictionary(const MatrixType &dictionary)
+{
+    m_Dictionary = dictionary;
+
+    unsigned int numEquations = m_Dictionary.rows();
+    unsigned int numAtoms = m_Dictionary.cols();
+
+    m_GramMatrix.set_size(numAtoms,numAtoms);
+    m_GramMatrix.fill(0.0);
+
+    // Row by row accumulation, the dictionary is stored row major
+    for (unsigned int k = 0;k < numEquations;++k)
+    {
+        const double *dictionaryRow = m_Dictionary[k];
+        for (unsigned int i = 0;i < numAtoms;++i)
+        {
+            double rowValue = dictionaryRow[i];
+            double *gramRow = m_GramMatrix[i];
+            for (unsigned int j = i;j < numAtoms;++j)
+                gramRow[j] += rowValue * dictionaryRow[j];
+        }
+    }
+
+    for (unsigned int i = 0;i < numAtoms;++i)
+    {
+        for (unsigned int j = i + 1;j < numAtoms;++j)
+            m_GramMatrix(j,i) = m_GramMatrix(i,j);
+    }
+
+    this->SetNumberOfThreads(m_Optimizers.size());
+}
+
+void DictionaryNNLSSolver::SetNumberOfThreads(unsigned int numThreads)
+{
+    m_Optimizers.resize(numThreads);
+    m_SignedSignals.resize(numThreads);
+    m_ProjectedSignals.resize(numThreads);
+    m_WarmStartSets.resize(2 * numThreads);
+
+    for (unsigned int i = 0;i < numThreads;++i)
+    {
+        m_Optimizers[i] = NNLSOptimizer::New();
+        m_Optimizers[i]->SetDataMatrix(m_Dictionary);
+        m_Optimizers[i]->SetGramMatrix(m_GramMatrix);
+        m_Optimizers[i]->SetSquaredProblem(false);
+
+        m_WarmStartSets[2 * i].clear();
+        m_WarmStartSets[2 * i + 1].clear();
+    }
+}
+
+void DictionaryNNLSSolver::SolveProblem(const std::vector <double> &signals, bool negateSignals,
+                                        unsigned int threadId, ParametersType &weights)
+{
+    unsigned int numEquations = m_Dictionary.rows();
+    unsigned int numAtoms = m_Dictionary.cols();
+
+    if (signals.size() != numEquations)
+        throw itk::ExceptionObject(__FILE__, __LINE__, "Signals and dictionary sizes do not match", ITK_LOCATION);
+
+    if (threadId >= m_Optimizers.size())
+        throw itk::ExceptionObject(__FILE__, __LINE__, "Thread index larger than the number of threads", ITK_LOCATION);
+
+    // Projection of the signal on atoms, D^T s
+    ParametersType &signedSignal = m_SignedSignals[threadId];
+    ParametersType &projectedSignal = m_ProjectedSignals[threadId];
+    signedSignal.SetSize(numEquations);
+    projectedSignal.SetSize(numAtoms);
+    projectedSignal.Fill(0.0);
+
+    double signalSign = negateSignals ? -1.0 : 1.0;
+    for (unsigned int k = 0;k < numEquations;++k)
+    {
+        const double *dictionaryRow = m_Dictionary[k];
+        double signalValue = signalSign * signals[k];
+        signedSignal[k] = signalValue;
+        for (unsigned int i = 0;i < numAtoms;++i)
+            projectedSignal[i] += dictionaryRow[i] * signalValue;
+    }
+
+    NNLSOptimizer *optimizer = m_Optimizers[threadId];
+    std::vector <unsigned int> &warmStartSet = m_WarmStartSets[2 * threadId + negateSignals];
+
+    if (m_UseWarmStart)
+        optimizer->SetInitialPassiveSet(warmStartSet);
+    else
+        optimizer->ClearInitialPassiveSet();
+
+    optimizer->SetPoints(signedSignal);
+    optimizer->SetProjectedPoints(projectedSignal);
+    optimizer->StartOptimization();
+
+    weights = optimizer->GetCurrentPosition();
+
+    if (m_UseWarmStart)
+        warmStartSet = optimizer->GetPassiveSet();
+}
+
+} // end namespace anima
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <vnl/vnl_matrix.h>
+
+#include <animaNNLSOptimizer.h>
+#include "AnimaOptimizersExport.h"
+
+namespace anima
+{
+
+/**
+ * @brief Non negative least squares decomposition of many signals on a fixed dictionary (one atom per column).
+ * The Gram matrix of the dictionary is computed once, each problem then only requires the projection of the signal
+ * on the atoms to get NNLS dual vectors. Sub-problems are solved by QR on the dictionary columns (not on the squared
+ * problem, that may be too badly conditioned for correlated atoms) by a per-thread NNLS optimizer.
+ * Each thread optimizer is warm started from the support of its previous solution with the same signal sign, which is
+ * usually close for neighboring voxels, so that fewer active set iterations (each requiring a QR solve) are needed.
+ * Iterations stop on the same optimality conditions as from a cold start, overcomplete dictionaries included: the fitted
+ * signal is the same, weights are too unless the NNLS solution is not unique.
+ */
+class ANIMAOPTIMIZERS_EXPORT DictionaryNNLSSolver
+{
+public:
+    typedef vnl_matrix <double> MatrixType;
+    typedef NNLSOptimizer::ParametersType ParametersType;
+
+    DictionaryNNLSSolver();
+
+    //! Sets dictionary and precomputes its Gram matrix, resets warm starts
+    void SetDictionary(const MatrixType &dictionary);
+    const MatrixType &GetDictionary() const {return m_Dictionary;}
+
+    //! Allocates one optimizer per thread, resets warm starts
+    void SetNumberOfThreads(unsigned int numThreads);
+    unsigned int GetNumberOfThreads() const {return m_Optimizers.size();}
+
+    void SetUseWarmStart(bool val) {m_UseWarmStart = val;}
+    bool GetUseWarmStart() const {return m_UseWarmStart;}
+
+    //! True if the last problem solved by thread threadId started from its warm start support
+    bool GetWarmStartUsed(unsigned int threadId) const {return m_Optimizers[threadId]->GetWarmStartUsed();}
+
+    //! Number of sub-problem solves of the last problem solved by thread threadId
+    unsigned int GetNumberOfSubProblemSolves(unsigned int threadId) const {return m_Optimizers[threadId]->GetNumberOfSubProblemSolves();}
+
+    //! Computes non negative weights minimizing |D w - s| (or |D w + s| if negateSignals is true) using thread threadId optimizer
+    void SolveProblem(const std::vector <double> &signals, bool negateSignals, unsigned int threadId, ParametersType &weights);
+
+private:
+    MatrixType m_Dictionary;
+    MatrixType m_GramMatrix;
+
+    bool m_UseWarmStart;
+
+    std::vector <NNLSOptimizer::Pointer> m_Optimizers;
+    std::vector <ParametersType> m_SignedSignals;
+    std::vector <ParametersType> m_ProjectedSignals;
+
+    //! Supports of previous solutions, two per thread (positive and negated signals)
+    std::vector < std::vector <unsigned int> > m_WarmStartSets;
+};
+
+} // end namespace anima
@@ -14,6 +14,12 @@ void NNLSOptimizer::StartOptimization()
     if ((numEquations != m_Points.size())||(numEquations == 0)||(parametersSize == 0))
         itkExceptionMacro("Wrongly sized inputs to NNLS, aborting");
 
+    if ((!m_SquaredProblem) && (m_GramMatrix.rows() != 0))
+    {
+        if ((m_GramMatrix.rows() != parametersSize) || (m_GramMatrix.cols() != parametersSize) || (m_ProjectedPoints.size() != parametersSize))
+            itkExceptionMacro("Wrongly sized Gram matrix or projected points in NNLS, aborting");
+    }
+
     m_CurrentPosition.SetSize(parametersSize);
     m_CurrentPosition.Fill(0.0);
     m_TreatedIndexes.resize(parametersSize);
@@ -21,7 +27,14 @@ void NNLSOptimizer::StartOptimization()
     m_ProcessedIndexes.clear();
     m_WVector.resize(parametersSize);
 
+    m_NumberOfSubProblemSolves = 0;
     unsigned int numProcessedIndexes = 0;
+    if ((!m_InitialPassiveSet.empty()) && (m_InitialPassiveSet.size() <= numEquations))
+        numProcessedIndexes = this->InitializeFromPassiveSet();
+
+    m_WarmStartUsed = (numProcessedIndexes > 0);
+    if (numProcessedIndexes == parametersSize)
+        return;
 
     this->ComputeWVector();
 
@@ -131,6 +144,46 @@ void NNLSOptimizer::StartOptimization()
     }
 }
 
+unsigned int NNLSOptimizer::InitializeFromPassiveSet()
+{
+    unsigned int parametersSize = m_DataMatrix.cols();
+    for (unsigned int i = 0;i < m_InitialPassiveSet.size();++i)
+    {
+        if (m_InitialPassiveSet[i] < parametersSize)
+            m_TreatedIndexes[m_InitialPassiveSet[i]] = 1;
+    }
+
+    // Drop non positive coefficients until the unconstrained solution on the passive set is feasible,
+    // main loop iterations then start from that feasible point
+    unsigned int numProcessedIndexes = this->UpdateProcessedIndexes();
+    while (numProcessedIndexes > 0)
+    {
+        this->ComputeSPVector();
+
+        bool feasibleSolution = true;
+        for (unsigned int i = 0;i < numProcessedIndexes;++i)
+        {
+            if (m_SPVector[i] <= m_EpsilonValue)
+            {
+                m_TreatedIndexes[m_ProcessedIndexes[i]] = 0;
+                feasibleSolution = false;
+            }
+        }
+
+        if (feasibleSolution)
+        {
+            for (unsigned int i = 0;i < numProcessedIndexes;++i)
+                m_CurrentPosition[m_ProcessedIndexes[i]] = m_SPVector[i];
+
+            break;
+        }
+
+        numProcessedIndexes = this->UpdateProcessedIndexes();
+    }
+
+    return numProcessedIndexes;
+}
+
 void NNLSOptimizer::ComputeWVector()
 {
     unsigned int parametersSize = m_DataMatrix.cols();
@@ -139,7 +192,7 @@ void NNLSOptimizer::ComputeWVector()
     m_WVector.resize(parametersSize);
 
     std::fill(m_WVector.begin(),m_WVector.end(),0.0);
-    if (!m_SquaredProblem)
+    if ((!m_SquaredProblem) && (m_GramMatrix.rows() == 0))
     {
         for (unsigned int i = 0;i < numEquations;++i)
         {
@@ -153,11 +206,21 @@ void NNLSOptimizer::ComputeWVector()
     }
     else
     {
-        for (unsigned int i = 0;i < numEquations;++i)
+        // Current position is only non null on processed indexes, only those columns of the
+        // (symmetric) squared matrix are needed, read as rows
+        const MatrixType &squaredMatrix = m_SquaredProblem ? m_DataMatrix : m_GramMatrix;
+        const ParametersType &squaredPoints = m_SquaredProblem ? m_Points : m_ProjectedPoints;
+
+        for (unsigned int i = 0;i < parametersSize;++i)
+            m_WVector[i] = squaredPoints[i];
+
+        for (unsigned int j = 0;j < m_ProcessedIndexes.size();++j)
         {
-            m_WVector[i] = m_Points[i];
-            for (unsigned int j = 0;j < parametersSize;++j)
-                m_WVector[i] -= m_DataMatrix(i,j) * m_CurrentPosition[j];
+            unsigned int jIndex = m_ProcessedIndexes[j];
+            double positionValue = m_CurrentPosition[jIndex];
+            const double *dataRow = squaredMatrix[jIndex];
+            for (unsigned int i = 0;i < parametersSize;++i)
+                m_WVector[i] -= dataRow[i] * positionValue;
         }
     }
 }
@@ -188,6 +251,7 @@ void NNLSOptimizer::ComputeSPVector()
 {
     unsigned int numEquations = m_DataMatrix.rows();
     unsigned int numProcessedIndexes = m_ProcessedIndexes.size();
+    ++m_NumberOfSubProblemSolves;
 
     if (!m_SquaredProblem)
     {
@@ -47,10 +47,37 @@ public:
 
     itkSetMacro(SquaredProblem, bool)
 
+    /**
+     * Non squared problem only: optional Gram matrix AtA and projected points AtB, used to compute the dual vector
+     * from the columns of the current passive set only. Sub-problems are still solved by QR on the columns of A
+     */
+    void SetGramMatrix(MatrixType &gram) {m_GramMatrix = gram;}
+    void SetProjectedPoints(ParametersType &data) {m_ProjectedPoints = data;}
+
+    /**
+     * Warm start: indexes of parameters guessed non null (e.g. from the solution of a similar problem). Indexes with non
+     * positive unconstrained solutions are removed until it is feasible, the regular active set iterations then start from
+     * that point and end, as from a cold start, once the optimality (KKT) conditions hold. This is valid for any data
+     * matrix, including ones with more columns than rows. A cold start is run if the guess has more indexes than equations.
+     */
+    void SetInitialPassiveSet(const std::vector <unsigned int> &indexes) {m_InitialPassiveSet = indexes;}
+    void ClearInitialPassiveSet() {m_InitialPassiveSet.clear();}
+
+    //! True if the last optimization started from a non empty feasible initial passive set
+    bool GetWarmStartUsed() const {return m_WarmStartUsed;}
+
+    //! Number of unconstrained sub-problems solved (QR or Cholesky) during the last optimization
+    unsigned int GetNumberOfSubProblemSolves() const {return m_NumberOfSubProblemSolves;}
+
+    //! Indexes of non null parameters at the end of the optimization
+    const std::vector <unsigned int> &GetPassiveSet() const {return m_ProcessedIndexes;}
+
 protected:
     NNLSOptimizer()
     {
         m_SquaredProblem = false;
+        m_WarmStartUsed = false;
+        m_NumberOfSubProblemSolves = 0;
     }
 
     virtual ~NNLSOptimizer() ITK_OVERRIDE {}
@@ -62,14 +89,24 @@ private:
     void ComputeSPVector();
     void ComputeWVector();
 
+    //! Sets processed indexes and current position from the initial passive set, returns the number of processed indexes
+    unsigned int InitializeFromPassiveSet();
+
     MatrixType m_DataMatrix;
     ParametersType m_Points;
 
+    MatrixType m_GramMatrix;
+    ParametersType m_ProjectedPoints;
+
     static const double m_EpsilonValue;
 
     //! Flag to indicate if the inputs are already AtA and AtB
     bool m_SquaredProblem;
 
+    std::vector <unsigned int> m_InitialPassiveSet;
+    bool m_WarmStartUsed;
+    unsigned int m_NumberOfSubProblemSolves;
+
     // Working values
     std::vector <unsigned short> m_TreatedIndexes;
     std::vector <unsigned int> m_ProcessedIndexes;
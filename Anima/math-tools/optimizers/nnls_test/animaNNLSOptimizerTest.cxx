@@ -1,10 +1,143 @@
 #include <animaNNLSOptimizer.h>
+#include <animaDictionaryNNLSSolver.h>
 #include <itkTimeProbe.h>
 #include <iostream>
 #include <fstream>
+#include <cmath>
+#include <algorithm>
+
+//! Checks that warm started dictionary solves give the same solutions as cold started ones, on a sticks dictionary
+//! shaped as in MCM estimation: an isotropic atom and more stick atoms than measurements
+bool CheckWarmStartMatchesColdStart()
+{
+    typedef anima::DictionaryNNLSSolver SolverType;
+
+    unsigned int numEquations = 60;
+    unsigned int numSticks = 300;
+    unsigned int numAtoms = numSticks + 1;
+
+    // Spiral point sets for gradient and stick directions, three shells
+    std::vector < std::vector <double> > gradients(numEquations, std::vector <double> (3));
+    std::vector <double> bValues(numEquations);
+    for (unsigned int i = 0;i < numEquations;++i)
+    {
+        double zValue = 1.0 - (2.0 * i + 1.0) / numEquations;
+        double rValue = std::sqrt(1.0 - zValue * zValue);
+        double phiValue = 2.399963 * i;
+        gradients[i][0] = rValue * std::cos(phiValue);
+        gradients[i][1] = rValue * std::sin(phiValue);
+        gradients[i][2] = zValue;
+        bValues[i] = 1000.0 * (1 + i % 3);
+    }
+
+    std::vector < std::vector <double> > sticks(numSticks, std::vector <double> (3));
+    for (unsigned int j = 0;j < numSticks;++j)
+    {
+        // Half sphere, sticks are symmetric
+        double zValue = 1.0 - (j + 0.5) / numSticks;
+        double rValue = std::sqrt(1.0 - zValue * zValue);
+        double phiValue = 2.399963 * j;
+        sticks[j][0] = rValue * std::cos(phiValue);
+        sticks[j][1] = rValue * std::sin(phiValue);
+        sticks[j][2] = zValue;
+    }
+
+    double diffusivity = 1.7e-3;
+    SolverType::MatrixType dictionary(numEquations,numAtoms);
+    for (unsigned int i = 0;i < numEquations;++i)
+    {
+        dictionary(i,0) = std::exp(- bValues[i] * 3.0e-3);
+        for (unsigned int j = 0;j < numSticks;++j)
+        {
+            double dotProduct = 0;
+            for (unsigned int k = 0;k < 3;++k)
+                dotProduct += gradients[i][k] * sticks[j][k];
+
+            dictionary(i,j + 1) = std::exp(- bValues[i] * diffusivity * dotProduct * dotProduct);
+        }
+    }
+
+    SolverType warmSolver, coldSolver;
+    warmSolver.SetDictionary(dictionary);
+    warmSolver.SetNumberOfThreads(1);
+    warmSolver.SetUseWarmStart(true);
+    coldSolver.SetDictionary(dictionary);
+    coldSolver.SetNumberOfThreads(1);
+    coldSolver.SetUseWarmStart(false);
+
+    unsigned int numProblems = 200;
+    unsigned int numWarmStartsUsed = 0;
+    unsigned int numWarmSolves = 0, numColdSolves = 0;
+    std::vector <double> signals(numEquations);
+    SolverType::ParametersType warmWeights, coldWeights;
+    double maxFitDifference = 0.0;
+    double maxResidualDifference = 0.0;
+
+    for (unsigned int k = 0;k < numProblems;++k)
+    {
+        // Slowly varying two fascicle voxels with some free water, as for neighboring voxels, with small noise
+        unsigned int firstStick = 1 + (k / 20) % numSticks;
+        unsigned int secondStick = 1 + (k / 20 + numSticks / 3) % numSticks;
+        double firstWeight = 0.5 + 0.2 * std::sin(0.05 * k);
+        for (unsigned int i = 0;i < numEquations;++i)
+        {
+            signals[i] = 0.1 * dictionary(i,0) + firstWeight * dictionary(i,firstStick) +
+                    (0.9 - firstWeight) * dictionary(i,secondStick);
+            signals[i] += 0.005 * std::sin(7.1 * k + 3.7 * i);
+        }
+
+        bool negateSignals = (k % 7 == 6);
+        warmSolver.SolveProblem(signals, negateSignals, 0, warmWeights);
+        coldSolver.SolveProblem(signals, negateSignals, 0, coldWeights);
+
+        if (warmSolver.GetWarmStartUsed(0))
+            ++numWarmStartsUsed;
+
+        numWarmSolves += warmSolver.GetNumberOfSubProblemSolves(0);
+        numColdSolves += coldSolver.GetNumberOfSubProblemSolves(0);
+
+        // The fitted signal (hence the residual) of NNLS is unique, weights may not be with more atoms than measurements
+        double warmResidual = 0, coldResidual = 0;
+        double signalSign = negateSignals ? -1.0 : 1.0;
+        for (unsigned int i = 0;i < numEquations;++i)
+        {
+            double warmFit = 0, coldFit = 0;
+            for (unsigned int j = 0;j < numAtoms;++j)
+            {
+                warmFit += dictionary(i,j) * warmWeights[j];
+                coldFit += dictionary(i,j) * coldWeights[j];
+            }
+
+            maxFitDifference = std::max(maxFitDifference, std::abs(warmFit - coldFit));
+            warmResidual += (warmFit - signalSign * signals[i]) * (warmFit - signalSign * signals[i]);
+            coldResidual += (coldFit - signalSign * signals[i]) * (coldFit - signalSign * signals[i]);
+        }
+
+        maxResidualDifference = std::max(maxResidualDifference, std::abs(warmResidual - coldResidual));
+    }
+
+    std::cout << "Warm starts used: " << numWarmStartsUsed << " / " << numProblems << std::endl;
+    std::cout << "Sub-problem solves, warm starts: " << numWarmSolves << ", cold starts: " << numColdSolves << std::endl;
+    std::cout << "Maximal warm / cold start fitted signal difference: " << maxFitDifference << std::endl;
+    std::cout << "Maximal warm / cold start residual difference: " << maxResidualDifference << std::endl;
+
+    if ((numWarmStartsUsed == 0) || (numWarmSolves >= numColdSolves))
+    {
+        std::cerr << "Warm starts were not used or did not save sub-problem solves" << std::endl;
+        return false;
+    }
+
+    return (maxFitDifference <= 1.0e-6) && (maxResidualDifference <= 1.0e-8);
+}
 
 int main()
 {
+    if (!CheckWarmStartMatchesColdStart())
+    {
+        std::cerr << "Warm started NNLS solutions differ from cold started ones" << std::endl;
+        return EXIT_FAILURE;
+    }
+
     typedef anima::NNLSOptimizer OptimizerType;
 
     itk::TimeProbe tmpTime;
@@ -146,6 +146,17 @@ void LowMemoryNLMeansPatientToGroupComparisonBridge::Update(int specificSplitToD
         m_DatabaseMeanDistanceStd->SetBlockIndex(splitIndexesToProcess[i]);
         m_DatabaseMeanDistanceStd->Update();
 
+        // Next block images are read from disk while this one is processed
+        if (i + 1 < splitIndexesToProcess.size())
+        {
+            m_DatabaseImages->PrefetchBlock(splitIndexesToProcess[i+1]);
+            m_TestImage->PrefetchBlock(splitIndexesToProcess[i+1]);
+            m_DatabaseCovarianceDistanceAverage->PrefetchBlock(splitIndexesToProcess[i+1]);
+            m_DatabaseCovarianceDistanceStd->PrefetchBlock(splitIndexesToProcess[i+1]);
+            m_DatabaseMeanDistanceAverage->PrefetchBlock(splitIndexesToProcess[i+1]);
+            m_DatabaseMeanDistanceStd->PrefetchBlock(splitIndexesToProcess[i+1]);
+        }
+
         MainFilterType::Pointer mainFilter = MainFilterType::New();
 
         for (unsigned int j = 0;j < m_DatabaseImages->GetNbImages();++j)
@@ -90,6 +90,13 @@ void LowMemoryPatientToGroupComparisonBridge::Update(int specificSplitToDo, bool
         m_TestLTImage->SetBlockIndex(splitIndexesToProcess[i]);
         m_TestLTImage->Update();
 
+        // Next block images are read from disk while this one is processed
+        if (i + 1 < splitIndexesToProcess.size())
+        {
+            m_DataLTImages->PrefetchBlock(splitIndexesToProcess[i+1]);
+            m_TestLTImage->PrefetchBlock(splitIndexesToProcess[i+1]);
+        }
+
         MainFilterType::Pointer mainFilter = MainFilterType::New();
 
         for (unsigned int j = 0;j < m_DataLTImages->GetNbImages();++j)
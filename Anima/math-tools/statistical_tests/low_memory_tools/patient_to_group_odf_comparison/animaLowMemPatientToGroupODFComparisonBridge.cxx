@@ -92,6 +92,13 @@ void LowMemoryPatientToGroupODFComparisonBridge::Update(int specificSplitToDo, b
         m_TestODFImage->SetBlockIndex(splitIndexesToProcess[i]);
         m_TestODFImage->Update();
 
+        // Next block images are read from disk while this one is processed
+        if (i + 1 < splitIndexesToProcess.size())
+        {
+            m_DataODFImages->PrefetchBlock(splitIndexesToProcess[i+1]);
+            m_TestODFImage->PrefetchBlock(splitIndexesToProcess[i+1]);
+        }
+
         MainFilterType::Pointer mainFilter = MainFilterType::New();
 
         for (unsigned int j = 0;j < m_DataODFImages->GetNbImages();++j)
@@ -31,11 +31,6 @@ LocalPatchCovarianceDistanceImageFilter<PixelScalarType>
     typedef itk::ImageRegionIteratorWithIndex< OutputImageType > OutRegionIteratorType;
     typedef itk::ImageRegionConstIteratorWithIndex < MaskImageType > MaskRegionIteratorType;
 
-    OutRegionIteratorType outMeanIterator(this->GetOutput(0), outputRegionForThread);
-    OutRegionIteratorType outStdIterator(this->GetOutput(1), outputRegionForThread);
-
-    MaskRegionIteratorType maskIterator (this->GetComputationMask(), outputRegionForThread);
-
     unsigned int numSamplesDatabase = this->GetNumberOfIndexedInputs();
 
     unsigned int ndim = this->GetInput(0)->GetNumberOfComponentsPerPixel();
@@ -55,60 +50,88 @@ LocalPatchCovarianceDistanceImageFilter<PixelScalarType>
     InputImageIndexType curIndex;
     OutputImageRegionType largestRegionOut = this->GetOutput(0)->GetLargestPossibleRegion();
 
-    while (!maskIterator.IsAtEnd())
+    // Patch statistics are read from moments tables, built for each database image on small tiles of the region
+    // (tables hold n(n+3)/2 moments per voxel for each image, tiles keep them in cache)
+    const unsigned int tileEdge = 8;
+    std::vector < anima::VectorImagePatchMomentsTable <PixelScalarType, 3> > momentsTables(numSamplesDatabase);
+    std::vector <OutputImageRegionType> tileRegions;
+    anima::splitRegionInTiles(outputRegionForThread, tileEdge, tileRegions);
+
+    for (unsigned int t = 0;t < tileRegions.size();++t)
     {
-        if (maskIterator.Get() == 0)
-        {
-            outMeanIterator.Set(0.0);
-            outStdIterator.Set(0.0);
+        OutRegionIteratorType outMeanIterator(this->GetOutput(0), tileRegions[t]);
+        OutRegionIteratorType outStdIterator(this->GetOutput(1), tileRegions[t]);
+        MaskRegionIteratorType maskIterator (this->GetComputationMask(), tileRegions[t]);
 
-            ++outMeanIterator;
-            ++outStdIterator;
-            ++maskIterator;
-            continue;
-        }
+        bool tablesInitialized = false;
+        while (!maskIterator.IsAtEnd())
+        {
+            if (maskIterator.Get() == 0)
+            {
+                outMeanIterator.Set(0.0);
+                outStdIterator.Set(0.0);
 
-        curIndex = maskIterator.GetIndex();
+                ++outMeanIterator;
+                ++outStdIterator;
+                ++maskIterator;
+                continue;
+            }
 
-        for (unsigned int i = 0;i < 3;++i)
-        {
-            tmpBlockRegion.SetIndex(i,std::max(0,(int)curIndex[i] - (int)m_PatchHalfSize));
-            tmpBlockRegion.SetSize(i,std::min((unsigned int)(largestRegionOut.GetSize()[i] - 1),(unsigned int)(curIndex[i] + m_PatchHalfSize)) - tmpBlockRegion.GetIndex(i) + 1);
-        }
+            if (!tablesInitialized)
+            {
+                OutputImageRegionType tableRegion = tileRegions[t];
+                tableRegion.PadByRadius(m_PatchHalfSize);
+                tableRegion.Crop(largestRegionOut);
 
-        for (unsigned int i = 0;i < numSamplesDatabase;++i)
-        {
-            anima::computePatchMeanAndCovariance(this->GetInput(i),tmpBlockRegion,patchMean,varianceVector[i]);
-            EigenAnalysis.ComputeEigenValuesAndVectors(varianceVector[i], eVals, eVec);
+                for (unsigned int i = 0;i < numSamplesDatabase;++i)
+                    momentsTables[i].Initialize(this->GetInput(i),tableRegion);
 
-            for (unsigned int j = 0;j < ndim;++j)
-                eVals[j] = log(eVals[j]);
+                tablesInitialized = true;
+            }
 
-            logVarianceVector[i] = eVec.transpose() * eVals * eVec;
-        }
+            curIndex = maskIterator.GetIndex();
 
-        double meanDist = 0;
-        double varDist = 0;
-        for (unsigned int i = 0;i < numSamplesDatabase;++i)
-            for (unsigned int j = i+1;j < numSamplesDatabase;++j)
+            for (unsigned int i = 0;i < 3;++i)
             {
-                double tmpDist = anima::VectorCovarianceTest(logVarianceVector[i], varianceVector[j]);
-                meanDist += tmpDist;
-                varDist += tmpDist * tmpDist;
+                tmpBlockRegion.SetIndex(i,std::max(0,(int)curIndex[i] - (int)m_PatchHalfSize));
+                tmpBlockRegion.SetSize(i,std::min((unsigned int)(largestRegionOut.GetSize()[i] - 1),(unsigned int)(curIndex[i] + m_PatchHalfSize)) - tmpBlockRegion.GetIndex(i) + 1);
             }
 
-        varDist /= numDistances;
-        meanDist /= numDistances;
-        varDist -= meanDist * meanDist;
-        varDist *= numDistances / (numDistances - 1.0);
+            // Log-covariances are computed once per database image, not once per pair
+            for (unsigned int i = 0;i < numSamplesDatabase;++i)
+            {
+                momentsTables[i].ComputePatchMeanAndCovariance(tmpBlockRegion,patchMean,varianceVector[i]);
+                EigenAnalysis.ComputeEigenValuesAndVectors(varianceVector[i], eVals, eVec);
+
+                for (unsigned int j = 0;j < ndim;++j)
+                    eVals[j] = log(eVals[j]);
 
-        outMeanIterator.Set(meanDist);
-        outStdIterator.Set(sqrt(varDist));
+                logVarianceVector[i] = eVec.transpose() * eVals * eVec;
+            }
 
-        this->IncrementNumberOfProcessedPoints();
-        ++outMeanIterator;
-        ++outStdIterator;
-        ++maskIterator;
+            double meanDist = 0;
+            double varDist = 0;
+            for (unsigned int i = 0;i < numSamplesDatabase;++i)
+                for (unsigned int j = i+1;j < numSamplesDatabase;++j)
+                {
+                    double tmpDist = anima::VectorLogCovarianceTest(logVarianceVector[i], logVarianceVector[j]);
+                    meanDist += tmpDist;
+                    varDist += tmpDist * tmpDist;
+                }
+
+            varDist /= numDistances;
+            meanDist /= numDistances;
+            varDist -= meanDist * meanDist;
+            varDist *= numDistances / (numDistances - 1.0);
+
+            outMeanIterator.Set(meanDist);
+            outStdIterator.Set(sqrt(varDist));
+
+            this->IncrementNumberOfProcessedPoints();
+            ++outMeanIterator;
+            ++outStdIterator;
+            ++maskIterator;
+        }
     }
 }
 
@@ -31,11 +31,6 @@ LocalPatchMeanDistanceImageFilter<PixelScalarType>
     typedef itk::ImageRegionIteratorWithIndex< OutputImageType > OutRegionIteratorType;
     typedef itk::ImageRegionConstIteratorWithIndex < MaskImageType > MaskRegionIteratorType;
 
-    OutRegionIteratorType outMeanIterator(this->GetOutput(0), outputRegionForThread);
-    OutRegionIteratorType outStdIterator(this->GetOutput(1), outputRegionForThread);
-
-    MaskRegionIteratorType maskIterator (this->GetComputationMask(), outputRegionForThread);
-
     unsigned int numSamplesDatabase = this->GetNumberOfIndexedInputs();
 
     unsigned int ndim = this->GetInput(0)->GetNumberOfComponentsPerPixel();
@@ -52,53 +47,80 @@ LocalPatchMeanDistanceImageFilter<PixelScalarType>
     InputImageIndexType curIndex;
     OutputImageRegionType largestRegionOut = this->GetOutput(0)->GetLargestPossibleRegion();
 
-    while (!maskIterator.IsAtEnd())
-    {
-        if (maskIterator.Get() == 0)
-        {
-            outMeanIterator.Set(0.0);
-            outStdIterator.Set(0.0);
+    // Patch statistics are read from moments tables, built for each database image on small tiles of the region
+    // (tables hold n(n+3)/2 moments per voxel for each image, tiles keep them in cache)
+    const unsigned int tileEdge = 8;
+    std::vector < anima::VectorImagePatchMomentsTable <PixelScalarType, 3> > momentsTables(numSamplesDatabase);
+    std::vector <OutputImageRegionType> tileRegions;
+    anima::splitRegionInTiles(outputRegionForThread, tileEdge, tileRegions);
 
-            ++outMeanIterator;
-            ++outStdIterator;
-            ++maskIterator;
-            continue;
-        }
-
-        curIndex = maskIterator.GetIndex();
+    for (unsigned int t = 0;t < tileRegions.size();++t)
+    {
+        OutRegionIteratorType outMeanIterator(this->GetOutput(0), tileRegions[t]);
+        OutRegionIteratorType outStdIterator(this->GetOutput(1), tileRegions[t]);
+        MaskRegionIteratorType maskIterator (this->GetComputationMask(), tileRegions[t]);
 
-        for (unsigned int i = 0;i < 3;++i)
+        bool tablesInitialized = false;
+        while (!maskIterator.IsAtEnd())
         {
-            tmpBlockRegion.SetIndex(i,std::max(0,(int)curIndex[i] - (int)m_PatchHalfSize));
-            tmpBlockRegion.SetSize(i,std::min((unsigned int)(largestRegionOut.GetSize()[i] - 1),(unsigned int)(curIndex[i] + m_PatchHalfSize)) - tmpBlockRegion.GetIndex(i) + 1);
-        }
+            if (maskIterator.Get() == 0)
+            {
+                outMeanIterator.Set(0.0);
+                outStdIterator.Set(0.0);
 
-        for (unsigned int i = 0;i < numSamplesDatabase;++i)
-            numPixels[i] = anima::computePatchMeanAndCovariance(this->GetInput(i),tmpBlockRegion,meanVectors[i],varianceVector[i]);
+                ++outMeanIterator;
+                ++outStdIterator;
+                ++maskIterator;
+                continue;
+            }
 
-        double meanDist = 0;
-        double varDist = 0;
-        for (unsigned int i = 0;i < numSamplesDatabase;++i)
-            for (unsigned int j = i+1;j < numSamplesDatabase;++j)
+            if (!tablesInitialized)
             {
-                double tmpDist = anima::VectorMeansTest(meanVectors[i], meanVectors[j], numPixels[i], numPixels[j],
-                                                        varianceVector[i], varianceVector[j]);
-                meanDist += tmpDist;
-                varDist += tmpDist * tmpDist;
+                OutputImageRegionType tableRegion = tileRegions[t];
+                tableRegion.PadByRadius(m_PatchHalfSize);
+                tableRegion.Crop(largestRegionOut);
+
+                for (unsigned int i = 0;i < numSamplesDatabase;++i)
+                    momentsTables[i].Initialize(this->GetInput(i),tableRegion);
+
+                tablesInitialized = true;
             }
 
-        varDist /= numDistances;
-        meanDist /= numDistances;
-        varDist -= meanDist * meanDist;
-        varDist *= numDistances / (numDistances - 1.0);
+            curIndex = maskIterator.GetIndex();
 
-        outMeanIterator.Set(meanDist);
-        outStdIterator.Set(std::sqrt(varDist));
+            for (unsigned int i = 0;i < 3;++i)
+            {
+                tmpBlockRegion.SetIndex(i,std::max(0,(int)curIndex[i] - (int)m_PatchHalfSize));
+                tmpBlockRegion.SetSize(i,std::min((unsigned int)(largestRegionOut.GetSize()[i] - 1),(unsigned int)(curIndex[i] + m_PatchHalfSize)) - tmpBlockRegion.GetIndex(i) + 1);
+            }
 
-        this->IncrementNumberOfProcessedPoints();
-        ++outMeanIterator;
-        ++outStdIterator;
-        ++maskIterator;
+            for (unsigned int i = 0;i < numSamplesDatabase;++i)
+                numPixels[i] = momentsTables[i].ComputePatchMeanAndCovariance(tmpBlockRegion,meanVectors[i],varianceVector[i]);
+
+            double meanDist = 0;
+            double varDist = 0;
+            for (unsigned int i = 0;i < numSamplesDatabase;++i)
+                for (unsigned int j = i+1;j < numSamplesDatabase;++j)
+                {
+                    double tmpDist = anima::VectorMeansTest(meanVectors[i], meanVectors[j], numPixels[i], numPixels[j],
+                                                            varianceVector[i], varianceVector[j]);
+                    meanDist += tmpDist;
+                    varDist += tmpDist * tmpDist;
+                }
+
+            varDist /= numDistances;
+            meanDist /= numDistances;
+            varDist -= meanDist * meanDist;
+            varDist *= numDistances / (numDistances - 1.0);
+
+            outMeanIterator.Set(meanDist);
+            outStdIterator.Set(std::sqrt(varDist));
+
+            this->IncrementNumberOfProcessedPoints();
+            ++outMeanIterator;
+            ++outStdIterator;
+            ++maskIterator;
+        }
     }
 }
 
@@ -1,10 +1,50 @@
 #pragma once
 
 #include <itkVectorImage.h>
+#include <vector>
 
 namespace anima
 {
 
+/**
+ * @brief Summed area tables of the components of a vector image and of their products over a region. Gives the mean
+ * and covariance matrix of any patch inside that region in constant time. Values are shifted by the region mean
+ * before summation to limit cancellation in covariances.
+ */
+template <class T1, unsigned int Dimension>
+class VectorImagePatchMomentsTable
+{
+public:
+    typedef itk::VectorImage <T1, Dimension> VectorImageType;
+    typedef itk::ImageRegion <Dimension> ImageRegionType;
+
+    VectorImagePatchMomentsTable();
+
+    //! Builds tables over region, that has to lie inside the buffered region of inputImage
+    void Initialize(const VectorImageType *inputImage, const ImageRegionType &region);
+
+    //! Same as computePatchMeanAndCovariance, patchRegion has to lie inside the tables region
+    template <class T2>
+    unsigned int ComputePatchMeanAndCovariance(const ImageRegionType &patchRegion, itk::VariableLengthVector <T2> &patchMean,
+                                               vnl_matrix <T2> &patchCov);
+
+private:
+    ImageRegionType m_Region;
+    unsigned int m_NumberOfComponents;
+    //! Components then upper triangular products
+    unsigned int m_NumberOfMoments;
+    unsigned int m_TableStrides[Dimension];
+
+    std::vector <double> m_Shift;
+    std::vector <double> m_Table;
+    std::vector <double> m_PatchSums;
+};
+
+//! Splits region into tiles of at most tileEdge voxels per dimension, e.g. to bound the size of moments tables
+template <unsigned int Dimension>
+void splitRegionInTiles(const itk::ImageRegion <Dimension> &region, unsigned int tileEdge,
+                        std::vector < itk::ImageRegion <Dimension> > &tiles);
+
 //! Computes the average and covariance matrix from a patch of a vector image
 template <class T1, class T2, unsigned int Dimension>
 unsigned int computePatchMeanAndCovariance(const itk::VectorImage <T1, Dimension> *inputImage, const itk::ImageRegion<Dimension> &patchRegion,
@@ -19,6 +59,9 @@ void computeAverageLocalCovariance(vnl_matrix <T2> &resVariance, itk::VectorImag
 //! Test if covariance matrices are different (returns distance)
 template <class T> double VectorCovarianceTest(vnl_matrix <T> &logRefPatchCov, vnl_matrix <T> &movingPatchCov);
 
+//! Same as VectorCovarianceTest from both log-covariances, so that logs may be computed once for several tests
+template <class T1, class T2> double VectorLogCovarianceTest(const vnl_matrix <T1> &logRefPatchCov, const vnl_matrix <T2> &logMovingPatchCov);
+
 //! Test if vector means are different (returns distance)
 template <class T> double VectorMeansTest(itk::VariableLengthVector <T> &refPatchMean, itk::VariableLengthVector <T> &movingPatchMean,
                                           const unsigned int &refPatchNumElts, const unsigned int &movingPatchNumElts,
@@ -4,9 +4,184 @@
 #include <itkImageRegionConstIteratorWithIndex.h>
 #include <itkSymmetricEigenAnalysis.h>
 
+#include <algorithm>
+
 namespace anima
 {
 
+template <class T1, unsigned int Dimension>
+VectorImagePatchMomentsTable <T1, Dimension>
+::VectorImagePatchMomentsTable()
+{
+    m_NumberOfComponents = 0;
+    m_NumberOfMoments = 0;
+    for (unsigned int i = 0;i < Dimension;++i)
+        m_TableStrides[i] = 0;
+}
+
+template <class T1, unsigned int Dimension>
+void
+VectorImagePatchMomentsTable <T1, Dimension>
+::Initialize(const VectorImageType *inputImage, const ImageRegionType &region)
+{
+    m_Region = region;
+    m_NumberOfComponents = inputImage->GetNumberOfComponentsPerPixel();
+    m_NumberOfMoments = m_NumberOfComponents * (m_NumberOfComponents + 3) / 2;
+
+    // Tables have a leading row of zeros along each dimension
+    unsigned int tableSize = m_NumberOfMoments;
+    for (unsigned int i = 0;i < Dimension;++i)
+    {
+        m_TableStrides[i] = tableSize;
+        tableSize *= region.GetSize()[i] + 1;
+    }
+
+    m_Table.resize(tableSize);
+    std::fill(m_Table.begin(),m_Table.end(),0.0);
+
+    typedef itk::ImageRegionConstIteratorWithIndex <VectorImageType> InIteratorType;
+    InIteratorType imageIt(inputImage,region);
+
+    m_Shift.resize(m_NumberOfComponents);
+    std::fill(m_Shift.begin(),m_Shift.end(),0.0);
+    while (!imageIt.IsAtEnd())
+    {
+        for (unsigned int i = 0;i < m_NumberOfComponents;++i)
+            m_Shift[i] += imageIt.Get()[i];
+
+        ++imageIt;
+    }
+
+    for (unsigned int i = 0;i < m_NumberOfComponents;++i)
+        m_Shift[i] /= region.GetNumberOfPixels();
+
+    std::vector <double> shiftedValue(m_NumberOfComponents);
+    imageIt.GoToBegin();
+    while (!imageIt.IsAtEnd())
+    {
+        unsigned int tablePosition = 0;
+        for (unsigned int i = 0;i < Dimension;++i)
+            tablePosition += (imageIt.GetIndex()[i] - region.GetIndex()[i] + 1) * m_TableStrides[i];
+
+        for (unsigned int i = 0;i < m_NumberOfComponents;++i)
+        {
+            shiftedValue[i] = imageIt.Get()[i] - m_Shift[i];
+            m_Table[tablePosition + i] = shiftedValue[i];
+        }
+
+        unsigned int pos = tablePosition + m_NumberOfComponents;
+        for (unsigned int i = 0;i < m_NumberOfComponents;++i)
+            for (unsigned int j = i;j < m_NumberOfComponents;++j)
+            {
+                m_Table[pos] = shiftedValue[i] * shiftedValue[j];
+                ++pos;
+            }
+
+        ++imageIt;
+    }
+
+    // Cumulative sums along each dimension
+    for (unsigned int d = 0;d < Dimension;++d)
+    {
+        unsigned int dimSize = region.GetSize()[d] + 1;
+        for (unsigned int pos = 0;pos < tableSize;pos += m_NumberOfMoments)
+        {
+            if ((pos / m_TableStrides[d]) % dimSize == 0)
+                continue;
+
+            for (unsigned int k = 0;k < m_NumberOfMoments;++k)
+                m_Table[pos + k] += m_Table[pos - m_TableStrides[d] + k];
+        }
+    }
+}
+
+template <class T1, unsigned int Dimension>
+template <class T2>
+unsigned int
+VectorImagePatchMomentsTable <T1, Dimension>
+::ComputePatchMeanAndCovariance(const ImageRegionType &patchRegion, itk::VariableLengthVector <T2> &patchMean,
+                                vnl_matrix <T2> &patchCov)
+{
+    unsigned int ndim = m_NumberOfComponents;
+    if (patchMean.GetSize() != ndim)
+        patchMean.SetSize(ndim);
+
+    patchCov.set_size(ndim,ndim);
+
+    // Inclusion-exclusion over the patch corners
+    m_PatchSums.resize(m_NumberOfMoments);
+    std::fill(m_PatchSums.begin(),m_PatchSums.end(),0.0);
+
+    unsigned int numCorners = 1 << Dimension;
+    for (unsigned int c = 0;c < numCorners;++c)
+    {
+        unsigned int tablePosition = 0;
+        unsigned int numLowCorners = 0;
+        for (unsigned int i = 0;i < Dimension;++i)
+        {
+            unsigned int tableIndex = patchRegion.GetIndex()[i] - m_Region.GetIndex()[i];
+            if ((c >> i) & 1)
+                tableIndex += patchRegion.GetSize()[i];
+            else
+                ++numLowCorners;
+
+            tablePosition += tableIndex * m_TableStrides[i];
+        }
+
+        double sign = (numLowCorners % 2 == 0) ? 1.0 : -1.0;
+        for (unsigned int k = 0;k < m_NumberOfMoments;++k)
+            m_PatchSums[k] += sign * m_Table[tablePosition + k];
+    }
+
+    unsigned int numPixels = patchRegion.GetNumberOfPixels();
+    unsigned int pos = ndim;
+    for (unsigned int i = 0;i < ndim;++i)
+        for (unsigned int j = i;j < ndim;++j)
+        {
+            double covValue = (m_PatchSums[pos] - m_PatchSums[i] * m_PatchSums[j] / numPixels) / (numPixels - 1.0);
+            patchCov(i,j) = covValue;
+            patchCov(j,i) = covValue;
+            ++pos;
+        }
+
+    for (unsigned int i = 0;i < ndim;++i)
+        patchMean[i] = m_PatchSums[i] / numPixels + m_Shift[i];
+
+    return numPixels;
+}
+
+template <unsigned int Dimension>
+void splitRegionInTiles(const itk::ImageRegion <Dimension> &region, unsigned int tileEdge,
+                        std::vector < itk::ImageRegion <Dimension> > &tiles)
+{
+    tiles.clear();
+    if (region.GetNumberOfPixels() == 0)
+        return;
+
+    unsigned int numTiles[Dimension];
+    unsigned int totalNumTiles = 1;
+    for (unsigned int d = 0;d < Dimension;++d)
+    {
+        numTiles[d] = (region.GetSize(d) + tileEdge - 1) / tileEdge;
+        totalNumTiles *= numTiles[d];
+    }
+
+    tiles.resize(totalNumTiles);
+    for (unsigned int t = 0;t < totalNumTiles;++t)
+    {
+        unsigned int tileIndex = t;
+        for (unsigned int d = 0;d < Dimension;++d)
+        {
+            unsigned int posTile = tileIndex % numTiles[d];
+            tileIndex /= numTiles[d];
+
+            unsigned int startTile = posTile * tileEdge;
+            tiles[t].SetIndex(d, region.GetIndex(d) + startTile);
+            tiles[t].SetSize(d, std::min(tileEdge, (unsigned int)(region.GetSize(d) - startTile)));
+        }
+    }
+}
+
 template <class T1, class T2, unsigned int Dimension>
 unsigned int computePatchMeanAndCovariance(const itk::VectorImage <T1, Dimension> *inputImage, const itk::ImageRegion<Dimension> &patchRegion,
                                            itk::VariableLengthVector <T2> &patchMean, vnl_matrix <T2> &patchCov)
@@ -160,6 +335,13 @@ template <class T> double VectorCovarianceTest(vnl_matrix <T> &logRefPatchCov, v
 
     vnl_matrix <double> logMoving = eVec.transpose() * eVals * eVec;
 
+    return VectorLogCovarianceTest(logRefPatchCov, logMoving);
+}
+
+template <class T1, class T2> double VectorLogCovarianceTest(const vnl_matrix <T1> &logRefPatchCov, const vnl_matrix <T2> &logMoving)
+{
+    unsigned int ndim = logRefPatchCov.rows();
+
     double varsDist = 0;
     for (unsigned int i = 0;i < ndim;++i)
         for (unsigned int j = i;j < ndim;++j)
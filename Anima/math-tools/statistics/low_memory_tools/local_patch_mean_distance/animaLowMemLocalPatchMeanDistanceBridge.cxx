@@ -89,6 +89,12 @@ void LowMemoryLocalPatchMeanDistanceBridge::Update(int specificSplitToDo, bool g
         m_DatabaseImages->SetBlockIndex(splitIndexesToProcess[i]);
         m_DatabaseImages->Update();
 
+        // Next block images are read from disk while this one is processed
+        if (i + 1 < splitIndexesToProcess.size())
+        {
+            m_DatabaseImages->PrefetchBlock(splitIndexesToProcess[i+1]);
+        }
+
         MainFilterType::Pointer mainFilter = MainFilterType::New();
 
         for (unsigned int j = 0;j < m_DatabaseImages->GetNbImages();++j)
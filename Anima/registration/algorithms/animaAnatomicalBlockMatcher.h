@@ -1,5 +1,7 @@
 #pragma once
 #include <animaBaseAffineBlockMatcher.h>
+#include <animaFixedBlockStatisticsCache.h>
+#include <animaExhaustiveTranslationBlockSearch.h>
 
 namespace anima
 {
@@ -31,12 +33,25 @@ public:
 
 protected:
     virtual MetricPointer SetupMetric();
+    virtual void PrepareThreadMetric(MetricPointer &metric);
+    virtual void ReferenceDataModified();
     virtual double ComputeBlockWeight(double val, unsigned int block);
 
     virtual void BlockMatchingSetup(MetricPointer &metric, unsigned int block);
 
+    virtual void PrepareThreadData(unsigned int numThreads);
+    virtual bool FastExhaustiveSearch(unsigned int threadId, unsigned int block, double &value);
+
 private:
     SimilarityDefinition m_SimilarityType;
+
+    // Fixed block values and statistics, kept as long as the reference image and blocks are unchanged
+    anima::FixedBlockStatisticsCache <InputImageType> m_FixedBlockStatistics;
+
+    // Integral image exhaustive search, for translations between images on the same grid
+    typedef anima::ExhaustiveTranslationBlockSearch <InputImageType> ExhaustiveSearchType;
+    std::vector <ExhaustiveSearchType> m_ThreadExhaustiveSearches;
+    bool m_FastExhaustiveSearchAvailable;
 };
 
 } // end namespace anima
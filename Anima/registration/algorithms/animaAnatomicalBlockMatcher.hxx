@@ -16,6 +16,9 @@ AnatomicalBlockMatcher<TInputImageType>
 ::AnatomicalBlockMatcher()
 {
     m_SimilarityType = SquaredCorrelation;
+
+    this->SetPrecomputeBlockFixedPoints(true);
+    m_FastExhaustiveSearchAvailable = false;
 }
 
 template <typename TInputImageType>
@@ -45,6 +48,7 @@ AnatomicalBlockMatcher<TInputImageType>
 
             typename LocalMetricType::Pointer tmpMetric = LocalMetricType::New();
             tmpMetric->SetSquaredCorrelation(m_SimilarityType == SquaredCorrelation);
+            tmpMetric->SetBatchedLinearEvaluation(true);
 
             metric = tmpMetric;
             break;
@@ -55,7 +59,10 @@ AnatomicalBlockMatcher<TInputImageType>
         {
             typedef anima::FastMeanSquaresImageToImageMetric <InputImageType,InputImageType> LocalMetricType;
 
-            metric = LocalMetricType::New();
+            typename LocalMetricType::Pointer tmpMetric = LocalMetricType::New();
+            tmpMetric->SetBatchedLinearEvaluation(true);
+
+            metric = tmpMetric;
             break;
         }
     }
@@ -76,6 +83,33 @@ AnatomicalBlockMatcher<TInputImageType>
     return metric;
 }
 
+template <typename TInputImageType>
+void
+AnatomicalBlockMatcher<TInputImageType>
+::ReferenceDataModified()
+{
+    m_FixedBlockStatistics.Initialize(this->GetBlockRegions());
+}
+
+template <typename TInputImageType>
+void
+AnatomicalBlockMatcher<TInputImageType>
+::PrepareThreadMetric(MetricPointer &metric)
+{
+    if (!metric)
+        metric = this->SetupMetric();
+
+    // Only images change between two updates: ITK initialization is done here once for all blocks
+    typedef itk::ImageToImageMetric <InputImageType,InputImageType> BaseMetricType;
+    BaseMetricType *baseMetric = dynamic_cast <BaseMetricType *> (metric.GetPointer());
+
+    baseMetric->SetFixedImage(this->GetReferenceImage());
+    baseMetric->SetMovingImage(this->GetMovingImage());
+    baseMetric->SetFixedImageRegion(this->GetBlockRegion(0));
+    baseMetric->SetTransform(this->GetBlockTransformPointer(0));
+    baseMetric->Initialize();
+}
+
 template <typename TInputImageType>
 double
 AnatomicalBlockMatcher<TInputImageType>
@@ -108,11 +142,107 @@ AnatomicalBlockMatcher<TInputImageType>
     InternalMetricType *tmpMetric = dynamic_cast <InternalMetricType *> (metric.GetPointer());
     tmpMetric->SetFixedImageRegion(this->GetBlockRegion(block));
     tmpMetric->SetTransform(this->GetBlockTransformPointer(block));
-    tmpMetric->Initialize();
+
+    // Each block is processed by a single thread per update, cache entries can be filled concurrently
+    if (!m_FixedBlockStatistics.IsBlockComputed(block))
+        m_FixedBlockStatistics.ComputeBlock(this->GetReferenceImage(), block);
+
     if (m_SimilarityType != MeanSquares)
-        ((anima::FastCorrelationImageToImageMetric<InputImageType, InputImageType> *)metric.GetPointer())->PreComputeFixedValues();
+    {
+        typedef anima::FastCorrelationImageToImageMetric <InputImageType, InputImageType> CorrelationMetricType;
+        CorrelationMetricType *correlationMetric = (CorrelationMetricType *)metric.GetPointer();
+        correlationMetric->SetPrecomputedFixedImagePoints(this->GetBlockFixedPoints(block));
+        correlationMetric->SetPrecomputedFixedValues(m_FixedBlockStatistics.GetBlockValues(block),
+                                                     m_FixedBlockStatistics.GetBlockSum(block),
+                                                     m_FixedBlockStatistics.GetBlockVariance(block));
+        correlationMetric->PreComputeFixedValues();
+    }
     else
-        ((anima::FastMeanSquaresImageToImageMetric<InputImageType, InputImageType> *)metric.GetPointer())->PreComputeFixedValues();
+    {
+        typedef anima::FastMeanSquaresImageToImageMetric <InputImageType, InputImageType> MeanSquaresMetricType;
+        MeanSquaresMetricType *meanSquaresMetric = (MeanSquaresMetricType *)metric.GetPointer();
+        meanSquaresMetric->SetPrecomputedFixedImagePoints(this->GetBlockFixedPoints(block));
+        meanSquaresMetric->SetPrecomputedFixedValues(m_FixedBlockStatistics.GetBlockValues(block));
+        meanSquaresMetric->PreComputeFixedValues();
+    }
+}
+
+template <typename TInputImageType>
+void
+AnatomicalBlockMatcher<TInputImageType>
+::PrepareThreadData(unsigned int numThreads)
+{
+    m_FastExhaustiveSearchAvailable = false;
+    if ((this->GetOptimizerType() != Superclass::Exhaustive) || (this->GetBlockTransformType() != Superclass::Translation))
+        return;
+
+    // Grid displacements should be whole voxels in a common index space
+    double stepSize = this->GetStepSize();
+    if ((stepSize < 1) || (std::abs(stepSize - std::round(stepSize)) > 1.0e-6))
+        return;
+
+    InputImageType *refImage = this->GetReferenceImage();
+    InputImageType *movingImage = this->GetMovingImage();
+    if ((refImage->GetOrigin() != movingImage->GetOrigin()) || (refImage->GetSpacing() != movingImage->GetSpacing()) ||
+            (refImage->GetDirection() != movingImage->GetDirection()))
+        return;
+
+    typename ExhaustiveSearchType::SimilarityDefinition searchSimilarity;
+    switch (m_SimilarityType)
+    {
+        case MeanSquares:
+            searchSimilarity = ExhaustiveSearchType::MeanSquares;
+            break;
+
+        case Correlation:
+            searchSimilarity = ExhaustiveSearchType::Correlation;
+            break;
+
+        case SquaredCorrelation:
+        default:
+            searchSimilarity = ExhaustiveSearchType::SquaredCorrelation;
+            break;
+    }
+
+    m_ThreadExhaustiveSearches.resize(numThreads);
+    for (unsigned int i = 0;i < numThreads;++i)
+    {
+        m_ThreadExhaustiveSearches[i].SetSimilarityType(searchSimilarity);
+        m_ThreadExhaustiveSearches[i].SetNumberOfSteps((unsigned int)this->GetSearchRadius());
+        m_ThreadExhaustiveSearches[i].SetStepSize((unsigned int)std::round(stepSize));
+    }
+
+    m_FastExhaustiveSearchAvailable = true;
+}
+
+template <typename TInputImageType>
+bool
+AnatomicalBlockMatcher<TInputImageType>
+::FastExhaustiveSearch(unsigned int threadId, unsigned int block, double &value)
+{
+    if (!m_FastExhaustiveSearchAvailable)
+        return false;
+
+    // Fixed block statistics are computed in BlockMatchingSetup
+    typename ExhaustiveSearchType::DisplacementType displacement;
+    value = m_ThreadExhaustiveSearches[threadId].Search(this->GetMovingImage(), this->GetBlockRegion(block),
+                                                        m_FixedBlockStatistics.GetBlockValues(block),
+                                                        m_FixedBlockStatistics.GetBlockSum(block),
+                                                        m_FixedBlockStatistics.GetBlockVariance(block), displacement);
+
+    // Voxel displacement to physical translation
+    typename InputImageType::DirectionType direction = this->GetReferenceImage()->GetDirection();
+    typename InputImageType::SpacingType spacing = this->GetReferenceImage()->GetSpacing();
+    typename Superclass::BaseInputTransformType::ParametersType translation(InputImageType::ImageDimension);
+    for (unsigned int i = 0;i < InputImageType::ImageDimension;++i)
+    {
+        translation[i] = 0;
+        for (unsigned int j = 0;j < InputImageType::ImageDimension;++j)
+            translation[i] += direction(i,j) * spacing[j] * displacement[j];
+    }
+
+    this->GetBlockTransformPointer(block)->SetParameters(translation);
+    return true;
 }
 
 } // end namespace anima
@@ -150,10 +150,12 @@ void
 BaseAffineBlockMatcher<TInputImageType>
 ::TransformDependantOptimizerSetup(OptimizerPointer &optimizer)
 {
-    if (this->GetOptimizerType() == Superclass::Exhaustive)
+    // Only Bobyqa (main or exhaustive search refinement) optimizers need transform dependent setup
+    typedef anima::BobyqaOptimizer LocalOptimizerType;
+    LocalOptimizerType * tmpOpt = dynamic_cast <LocalOptimizerType *> (optimizer.GetPointer());
+    if (!tmpOpt)
         return;
 
-    typedef anima::BobyqaOptimizer LocalOptimizerType;
     LocalOptimizerType::ScalesType tmpScales(this->GetBlockTransformPointer(0)->GetNumberOfParameters());
     LocalOptimizerType::ScalesType lowerBounds(this->GetBlockTransformPointer(0)->GetNumberOfParameters());
     LocalOptimizerType::ScalesType upperBounds(this->GetBlockTransformPointer(0)->GetNumberOfParameters());
@@ -163,12 +165,17 @@ BaseAffineBlockMatcher<TInputImageType>
     {
         case Translation:
         {
+            // Refinement of an exhaustive search should be able to reach the whole search window
+            double translateMax = m_TranslateMax;
+            if (this->GetOptimizerType() == Superclass::Exhaustive)
+                translateMax = std::max(translateMax, this->GetSearchRadius() * this->GetStepSize() + 1.0);
+
             for (unsigned int i = 0;i < InputImageType::ImageDimension;++i)
             {
                 tmpScales[i] = 1.0 / fixedSpacing[i];
 
-                lowerBounds[i] = - m_TranslateMax * fixedSpacing[i];
-                upperBounds[i] = m_TranslateMax * fixedSpacing[i];
+                lowerBounds[i] = - translateMax * fixedSpacing[i];
+                upperBounds[i] = translateMax * fixedSpacing[i];
             }
 
             break;
@@ -236,7 +243,6 @@ BaseAffineBlockMatcher<TInputImageType>
         }
     }
 
-    LocalOptimizerType * tmpOpt = dynamic_cast <LocalOptimizerType *> (optimizer.GetPointer());
     tmpOpt->SetScales(tmpScales);
     tmpOpt->SetLowerBounds(lowerBounds);
     tmpOpt->SetUpperBounds(upperBounds);
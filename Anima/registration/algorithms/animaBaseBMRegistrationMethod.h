@@ -111,6 +111,9 @@ public:
     void SetBlockMatcher(BlockMatcherType *matcher) {m_BlockMatcher = matcher;}
     BlockMatcherType *GetBlockMatcher() {return m_BlockMatcher;}
 
+    /** Update transform computed at the last iteration, i.e. what blocks matched at that iteration agreed on */
+    TransformType *GetLastAddOnTransform() {return m_LastAddOnTransform.GetPointer();}
+
     /** Returns the transform resulting from the registration process  */
     TransformOutputType *GetOutput();
 
@@ -159,6 +162,7 @@ private:
     bool m_VerboseProgression;
 
     TransformPointer m_InitialTransform;
+    TransformPointer m_LastAddOnTransform;
     BlockMatcherType * m_BlockMatcher;
 };
 
@@ -34,6 +34,7 @@ BaseBMRegistrationMethod <TInputImageType>
     this->SetNumberOfWorkUnits(this->GetMultiThreader()->GetNumberOfWorkUnits());
 
     m_InitialTransform = 0;
+    m_LastAddOnTransform = 0;
     this->SetNumberOfRequiredOutputs(1);
     TransformOutputPointer transformDecorator = static_cast <TransformOutputType *> (this->MakeOutput(0).GetPointer());
     this->itk::ProcessObject::SetNthOutput(0, transformDecorator.GetPointer());
@@ -106,6 +107,7 @@ BaseBMRegistrationMethod <TInputImageType>
         this->GetAgregator()->SetCurrentLinearTransform(computedTransform);
         TransformPointer addOn;
         this->PerformOneIteration(fixedResampled, movingResampled, addOn);
+        m_LastAddOnTransform = addOn;
 
         bool continueLoop = this->ComposeAddOnWithTransform(computedTransform,addOn);
 
@@ -3,7 +3,7 @@
 
 #include <itkSingleValuedNonLinearOptimizer.h>
 #include <itkSingleValuedCostFunction.h>
-#include <mutex>
+#include <animaWorkStealingRangeScheduler.h>
 
 namespace anima
 {
@@ -26,6 +26,7 @@ public:
     typedef typename InputImageType::Pointer InputImagePointer;
     typedef typename InputImageType::RegionType ImageRegionType;
     typedef typename InputImageType::PointType PointType;
+    typedef typename PointType::VectorType VectorType;
 
     typedef anima::BaseTransformAgregator<TInputImageType::ImageDimension> AgregatorType;
     typedef typename AgregatorType::InternalScalarType InternalScalarType;
@@ -69,9 +70,26 @@ public:
     double GetSearchRadius() {return m_SearchRadius;}
     void SetFinalRadius(double val) {m_FinalRadius = val;}
     void SetStepSize (double val) {m_StepSize = val;}
+    double GetStepSize() {return m_StepSize;}
+
+    //! For the exhaustive optimizer, refines the best grid displacement of each block with Bobyqa
+    void SetExhaustiveRefinement(bool val) {m_ExhaustiveRefinement = val;}
+    bool GetExhaustiveRefinement() {return m_ExhaustiveRefinement;}
 
     void SetOptimizerMaximumIterations (unsigned int val) {m_OptimizerMaximumIterations = val;}
 
+    /**
+     * Block results of a previous (coarser) pyramid level: positions, weights and residual displacements at block centers,
+     * i.e. what the transform of that level did not explain. When blocks are generated, each block takes the result of the
+     * closest previous block as a prior: blocks with a previous weight below the threshold are not matched (null weight),
+     * for Bobyqa the search starts from the residual displacement (translation blocks) with a search radius adapted to its norm.
+     * Start and search radius priors are used on the first update after blocks generation only, skipped blocks on all updates
+     */
+    void SetPreviousLevelBlocks(const std::vector <PointType> &positions, const std::vector <double> &weights,
+                                const std::vector <VectorType> &residuals);
+    void SetPreviousLevelWeightThreshold(double val) {m_PreviousLevelWeightThreshold = val;}
+    double GetPreviousLevelWeightThreshold() {return m_PreviousLevelWeightThreshold;}
+
     void Update();
 
     std::vector <PointType> &GetBlockPositions() {return m_BlockPositions;}
@@ -95,6 +113,9 @@ public:
     void SetVerbose(bool value) {m_Verbose = value;}
     bool GetVerbose() {return m_Verbose;}
 
+    //! Scheduler of the last Update call, gives access to per-thread load balance statistics
+    const anima::WorkStealingRangeScheduler &GetBlockScheduler() {return m_BlockScheduler;}
+
 protected:
     struct ThreadedMatchData
     {
@@ -104,18 +125,46 @@ protected:
     /** Do the matching for a batch of regions (splited according to the thread id + nb threads) */
     static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ThreadedMatching(void *arg);
 
-    void ProcessBlockMatch();
-    void BlockMatch(unsigned int startIndex, unsigned int endIndex);
+    void ProcessBlockMatch(unsigned int threadId);
+    void BlockMatch(unsigned int threadId, unsigned int startIndex, unsigned int endIndex);
 
     virtual void InitializeBlocks();
 
     virtual MetricPointer SetupMetric() = 0;
+
+    /**
+     * Prepares the persistent metric of a thread for a new Update call, i.e. new reference and moving images.
+     * Metric is null on the first call. Default implementation creates a new metric from SetupMetric,
+     * re-implementations may only refresh the images of the existing metric
+     */
+    virtual void PrepareThreadMetric(MetricPointer &metric);
+
+    /**
+     * Called on Update when blocks were generated or the reference image has changed since the last update.
+     * Re-implementations should invalidate any cached fixed block data there, it is kept otherwise
+     */
+    virtual void ReferenceDataModified() {}
+
     virtual double ComputeBlockWeight(double val, unsigned int block) = 0;
     virtual BaseInputTransformPointer GetNewBlockTransform(PointType &blockCenter) = 0;
 
     // May be overloaded but in practice, much easier if this superclass implementation is always called
     virtual OptimizerPointer SetupOptimizer();
 
+    //! Bobyqa optimizer started at the best exhaustive search position, with a search radius of half a grid step
+    OptimizerPointer SetupRefinementOptimizer();
+
+    /**
+     * Called by Update with the number of threads before matching, for subclasses to set up their own per-thread data
+     */
+    virtual void PrepareThreadData(unsigned int numThreads) {}
+
+    /**
+     * Exhaustive search engine replacing the exhaustive optimizer when available (returns false otherwise).
+     * Called after BlockMatchingSetup, sets the block transform to the best displacement and its similarity value
+     */
+    virtual bool FastExhaustiveSearch(unsigned int threadId, unsigned int block, double &value) {return false;}
+
     virtual void BlockMatchingSetup(MetricPointer &metric, unsigned int block) = 0;
     virtual void TransformDependantOptimizerSetup(OptimizerPointer &optimizer) = 0;
 
@@ -124,6 +173,13 @@ protected:
     void SetBlockRegions(std::vector <ImageRegionType> &val) {m_BlockRegions = val;}
     void SetBlockPositions(std::vector <PointType> &val) {m_BlockPositions = val;}
 
+    //! If activated, fixed physical points of all blocks are computed once when blocks are generated
+    void SetPrecomputeBlockFixedPoints(bool val) {m_PrecomputeBlockFixedPoints = val;}
+    bool GetPrecomputeBlockFixedPoints() {return m_PrecomputeBlockFixedPoints;}
+
+    //! Fixed physical points of a block, in region iteration order. Null if not precomputed
+    const PointType *GetBlockFixedPoints(unsigned int block);
+
 private:
     InputImagePointer m_ReferenceImage;
     InputImagePointer m_MovingImage;
@@ -156,9 +212,48 @@ private:
     double m_FinalRadius;
     unsigned int m_OptimizerMaximumIterations;
     double m_StepSize;
-
-    std::mutex m_LockHighestProcessedBlock;
-    int m_HighestProcessedBlock;
+    bool m_ExhaustiveRefinement;
+
+    anima::WorkStealingRangeScheduler m_BlockScheduler;
+
+    void ComputeBlockFixedPoints();
+    void ComputeBlockPriors();
+    void InitializeThreadContexts(bool referenceModified);
+
+    //! Sets the block search start and radius from its previous level prior, for Bobyqa optimizers only
+    void ApplyBlockPrior(OptimizerPointer &optimizer, unsigned int block);
+
+    // Persistent matching context of each thread, kept across blocks and Update calls
+    std::vector <MetricPointer> m_ThreadMetrics;
+    std::vector <OptimizerPointer> m_ThreadOptimizers;
+    std::vector <OptimizerPointer> m_ThreadRefinementOptimizers;
+
+    // Optimizer parameters the thread optimizers were built with, they are rebuilt when any of them changes
+    OptimizerDefinition m_ContextOptimizerType;
+    double m_ContextSearchRadius;
+    double m_ContextFinalRadius;
+    unsigned int m_ContextOptimizerMaximumIterations;
+    double m_ContextStepSize;
+    bool m_ContextExhaustiveRefinement;
+
+    // Flat array of block fixed points, block i points start at m_BlockFixedPointsOffsets[i]
+    bool m_PrecomputeBlockFixedPoints;
+    std::vector <PointType> m_BlockFixedPoints;
+    std::vector <size_t> m_BlockFixedPointsOffsets;
+
+    // Reference image used at the last update, to detect actual reference changes
+    InputImagePointer m_LastReferenceImage;
+    itk::ModifiedTimeType m_LastReferenceImageMTime;
+
+    // Previous pyramid level results and the priors they give to the current blocks (empty if none)
+    std::vector <PointType> m_PreviousLevelPositions;
+    std::vector <double> m_PreviousLevelWeights;
+    std::vector <VectorType> m_PreviousLevelResiduals;
+    double m_PreviousLevelWeightThreshold;
+
+    std::vector <unsigned char> m_BlockSkipped;
+    std::vector <VectorType> m_BlockPriorDisplacements;
+    std::vector <double> m_BlockPriorSearchRadii;
 };
 
 } // end namespace anima
@@ -5,6 +5,9 @@
 #include <animaVoxelExhaustiveOptimizer.h>
 #include <animaBlockMatchInitializer.h>
 #include <itkPoolMultiThreader.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+
+#include <limits>
 
 namespace anima
 {
@@ -26,11 +29,22 @@ BaseBlockMatcher <TInputImageType>
     m_FinalRadius = 0.001;
     m_OptimizerMaximumIterations = 100;
     m_StepSize = 1.0;
+    m_ExhaustiveRefinement = false;
 
     m_OptimizerType = Bobyqa;
     m_Verbose = true;
 
-    m_HighestProcessedBlock = 0;
+    m_PrecomputeBlockFixedPoints = false;
+    m_LastReferenceImageMTime = 0;
+
+    m_PreviousLevelWeightThreshold = 0.05;
+
+    m_ContextOptimizerType = m_OptimizerType;
+    m_ContextSearchRadius = m_SearchRadius;
+    m_ContextFinalRadius = m_FinalRadius;
+    m_ContextOptimizerMaximumIterations = m_OptimizerMaximumIterations;
+    m_ContextStepSize = m_StepSize;
+    m_ContextExhaustiveRefinement = m_ExhaustiveRefinement;
 }
 
 template <typename TInputImageType>
@@ -70,6 +84,317 @@ BaseBlockMatcher <TInputImageType>
         m_BlockTransformPointers[i] = this->GetNewBlockTransform(m_BlockPositions[i]);
 }
 
+template <typename TInputImageType>
+void
+BaseBlockMatcher <TInputImageType>
+::ComputeBlockFixedPoints()
+{
+    m_BlockFixedPoints.clear();
+    m_BlockFixedPointsOffsets.clear();
+
+    if (!m_PrecomputeBlockFixedPoints)
+        return;
+
+    unsigned int numBlocks = m_BlockRegions.size();
+    m_BlockFixedPointsOffsets.resize(numBlocks + 1);
+    m_BlockFixedPointsOffsets[0] = 0;
+    for (unsigned int i = 0;i < numBlocks;++i)
+        m_BlockFixedPointsOffsets[i + 1] = m_BlockFixedPointsOffsets[i] + m_BlockRegions[i].GetNumberOfPixels();
+
+    m_BlockFixedPoints.resize(m_BlockFixedPointsOffsets[numBlocks]);
+
+    typedef itk::ImageRegionConstIteratorWithIndex <InputImageType> IteratorType;
+    for (unsigned int i = 0;i < numBlocks;++i)
+    {
+        IteratorType blockItr(m_ReferenceImage, m_BlockRegions[i]);
+        size_t pos = m_BlockFixedPointsOffsets[i];
+        while (!blockItr.IsAtEnd())
+        {
+            m_ReferenceImage->TransformIndexToPhysicalPoint(blockItr.GetIndex(), m_BlockFixedPoints[pos]);
+            ++blockItr;
+            ++pos;
+        }
+    }
+}
+
+template <typename TInputImageType>
+const typename BaseBlockMatcher <TInputImageType>::PointType *
+BaseBlockMatcher <TInputImageType>
+::GetBlockFixedPoints(unsigned int block)
+{
+    if (m_BlockFixedPointsOffsets.size() == 0)
+        return 0;
+
+    return m_BlockFixedPoints.data() + m_BlockFixedPointsOffsets[block];
+}
+
+template <typename TInputImageType>
+void
+BaseBlockMatcher <TInputImageType>
+::SetPreviousLevelBlocks(const std::vector <PointType> &positions, const std::vector <double> &weights,
+                         const std::vector <VectorType> &residuals)
+{
+    if ((positions.size() != weights.size()) || (positions.size() != residuals.size()))
+        throw itk::ExceptionObject(__FILE__, __LINE__,"Previous level block positions, weights and residuals should have the same size",ITK_LOCATION);
+
+    m_PreviousLevelPositions = positions;
+    m_PreviousLevelWeights = weights;
+    m_PreviousLevelResiduals = residuals;
+}
+
+template <typename TInputImageType>
+void
+BaseBlockMatcher <TInputImageType>
+::ComputeBlockPriors()
+{
+    m_BlockSkipped.clear();
+    m_BlockPriorDisplacements.clear();
+    m_BlockPriorSearchRadii.clear();
+
+    const unsigned int dimension = InputImageType::ImageDimension;
+    unsigned int numPreviousBlocks = m_PreviousLevelPositions.size();
+    unsigned int numBlocks = m_BlockPositions.size();
+    if ((numPreviousBlocks == 0) || (numBlocks == 0))
+        return;
+
+    // Uniform binning of previous block positions, with about one block per bin
+    PointType minPoint = m_PreviousLevelPositions[0];
+    PointType maxPoint = minPoint;
+    for (unsigned int i = 1;i < numPreviousBlocks;++i)
+    {
+        for (unsigned int j = 0;j < dimension;++j)
+        {
+            minPoint[j] = std::min(minPoint[j], m_PreviousLevelPositions[i][j]);
+            maxPoint[j] = std::max(maxPoint[j], m_PreviousLevelPositions[i][j]);
+        }
+    }
+
+    double maxExtent = 0;
+    for (unsigned int j = 0;j < dimension;++j)
+        maxExtent = std::max(maxExtent, maxPoint[j] - minPoint[j]);
+
+    unsigned int binsPerAxis = std::ceil(std::pow((double)numPreviousBlocks, 1.0 / dimension));
+    double binSize = (maxExtent > 0) ? maxExtent / binsPerAxis : 1.0;
+
+    int numBins[dimension];
+    unsigned int binStrides[dimension];
+    unsigned int totalNumBins = 1;
+    for (unsigned int j = 0;j < dimension;++j)
+    {
+        numBins[j] = std::floor((maxPoint[j] - minPoint[j]) / binSize) + 1;
+        binStrides[j] = totalNumBins;
+        totalNumBins *= numBins[j];
+    }
+
+    std::vector <unsigned int> binStarts(totalNumBins + 1, 0);
+    std::vector <unsigned int> previousBins(numPreviousBlocks);
+    for (unsigned int i = 0;i < numPreviousBlocks;++i)
+    {
+        unsigned int bin = 0;
+        for (unsigned int j = 0;j < dimension;++j)
+        {
+            int binIndex = std::floor((m_PreviousLevelPositions[i][j] - minPoint[j]) / binSize);
+            bin += std::min(binIndex, numBins[j] - 1) * binStrides[j];
+        }
+
+        previousBins[i] = bin;
+        ++binStarts[bin + 1];
+    }
+
+    for (unsigned int i = 0;i < totalNumBins;++i)
+        binStarts[i + 1] += binStarts[i];
+
+    std::vector <unsigned int> binBlocks(numPreviousBlocks);
+    std::vector <unsigned int> binFillPositions(binStarts.begin(), binStarts.end() - 1);
+    for (unsigned int i = 0;i < numPreviousBlocks;++i)
+        binBlocks[binFillPositions[previousBins[i]]++] = i;
+
+    int maxNumBins = 0;
+    for (unsigned int j = 0;j < dimension;++j)
+        maxNumBins = std::max(maxNumBins, numBins[j]);
+
+    // Residual norms are converted to voxels of the current reference image, as Bobyqa translation scales
+    typename InputImageType::SpacingType spacing = m_ReferenceImage->GetSpacing();
+    typename InputImageType::DirectionType direction = m_ReferenceImage->GetDirection();
+    double minimalSearchRadius = std::min(1.0, m_SearchRadius);
+
+    m_BlockSkipped.resize(numBlocks);
+    m_BlockPriorDisplacements.resize(numBlocks);
+    m_BlockPriorSearchRadii.resize(numBlocks);
+
+    unsigned int numSkipped = 0;
+    int queryBin[dimension];
+    for (unsigned int b = 0;b < numBlocks;++b)
+    {
+        const PointType &blockPosition = m_BlockPositions[b];
+        for (unsigned int j = 0;j < dimension;++j)
+        {
+            int binIndex = std::floor((blockPosition[j] - minPoint[j]) / binSize);
+            queryBin[j] = std::max(0, std::min(binIndex, numBins[j] - 1));
+        }
+
+        // Visit bins ring by ring (Chebyshev distance to the query bin), points in ring r + 1 are at least r bins away
+        int closestBlock = -1;
+        double closestDistance = std::numeric_limits <double>::max();
+        for (int ring = 0;ring <= maxNumBins;++ring)
+        {
+            unsigned int cubeSize = 2 * ring + 1;
+            unsigned int numCubeBins = 1;
+            for (unsigned int j = 0;j < dimension;++j)
+                numCubeBins *= cubeSize;
+
+            for (unsigned int c = 0;c < numCubeBins;++c)
+            {
+                unsigned int remainder = c;
+                int ringDistance = 0;
+                bool validBin = true;
+                unsigned int bin = 0;
+                for (unsigned int j = 0;j < dimension;++j)
+                {
+                    int offset = (int)(remainder % cubeSize) - ring;
+                    remainder /= cubeSize;
+
+                    int binIndex = queryBin[j] + offset;
+                    if ((binIndex < 0) || (binIndex >= numBins[j]))
+                    {
+                        validBin = false;
+                        break;
+                    }
+
+                    ringDistance = std::max(ringDistance, std::abs(offset));
+                    bin += binIndex * binStrides[j];
+                }
+
+                if ((!validBin) || (ringDistance != ring))
+                    continue;
+
+                for (unsigned int k = binStarts[bin];k < binStarts[bin + 1];++k)
+                {
+                    unsigned int candidate = binBlocks[k];
+                    double distance = blockPosition.SquaredEuclideanDistanceTo(m_PreviousLevelPositions[candidate]);
+                    if (distance < closestDistance)
+                    {
+                        closestDistance = distance;
+                        closestBlock = candidate;
+                    }
+                }
+            }
+
+            if ((closestBlock >= 0) && (closestDistance <= ring * ring * binSize * binSize))
+                break;
+        }
+
+        m_BlockSkipped[b] = (m_PreviousLevelWeights[closestBlock] < m_PreviousLevelWeightThreshold);
+        if (m_BlockSkipped[b])
+            ++numSkipped;
+
+        const VectorType &residual = m_PreviousLevelResiduals[closestBlock];
+        m_BlockPriorDisplacements[b] = residual;
+
+        // Blocks well explained by the previous level transform are searched closer to their start
+        double residualNorm = 0;
+        for (unsigned int j = 0;j < dimension;++j)
+        {
+            double voxelResidual = 0;
+            for (unsigned int i = 0;i < dimension;++i)
+                voxelResidual += direction(i,j) * residual[i];
+
+            voxelResidual /= spacing[j];
+            residualNorm += voxelResidual * voxelResidual;
+        }
+
+        residualNorm = std::sqrt(residualNorm);
+        m_BlockPriorSearchRadii[b] = std::max(minimalSearchRadius, std::min(residualNorm, m_SearchRadius));
+    }
+
+    if (m_Verbose)
+        std::cout << "Skipped " << numSkipped << " blocks with negligible weight at previous level..." << std::endl;
+}
+
+template <typename TInputImageType>
+void
+BaseBlockMatcher <TInputImageType>
+::ApplyBlockPrior(OptimizerPointer &optimizer, unsigned int block)
+{
+    typedef anima::BobyqaOptimizer LocalOptimizerType;
+    LocalOptimizerType *tmpOpt = dynamic_cast <LocalOptimizerType *> (optimizer.GetPointer());
+    if (!tmpOpt)
+        return;
+
+    tmpOpt->SetRhoBegin(std::max(m_BlockPriorSearchRadii[block], 2.0 * m_FinalRadius));
+
+    if (this->GetAgregatorInputTransformType() != AgregatorType::TRANSLATION)
+        return;
+
+    // Translation parameters are the physical displacement, block transform was reset by BlockMatchingSetup
+    typename BaseInputTransformType::ParametersType parameters = m_BlockTransformPointers[block]->GetParameters();
+    for (unsigned int i = 0;i < InputImageType::ImageDimension;++i)
+        parameters[i] += m_BlockPriorDisplacements[block][i];
+
+    m_BlockTransformPointers[block]->SetParameters(parameters);
+}
+
+template <typename TInputImageType>
+void
+BaseBlockMatcher <TInputImageType>
+::PrepareThreadMetric(MetricPointer &metric)
+{
+    metric = this->SetupMetric();
+}
+
+template <typename TInputImageType>
+void
+BaseBlockMatcher <TInputImageType>
+::InitializeThreadContexts(bool referenceModified)
+{
+    unsigned int numThreads = std::max(m_NumberOfThreads,1u);
+
+    if (m_ThreadMetrics.size() != numThreads)
+    {
+        m_ThreadMetrics.clear();
+        m_ThreadMetrics.resize(numThreads);
+    }
+
+    // Optimizers depend on matcher parameters, block transform type and reference geometry (exhaustive search grid),
+    // they are kept as long as none of them changes
+    bool rebuildOptimizers = (m_ThreadOptimizers.size() != numThreads) || (referenceModified) ||
+            (m_OptimizerType != m_ContextOptimizerType) || (m_SearchRadius != m_ContextSearchRadius) ||
+            (m_FinalRadius != m_ContextFinalRadius) || (m_OptimizerMaximumIterations != m_ContextOptimizerMaximumIterations) ||
+            (m_StepSize != m_ContextStepSize) || (m_ExhaustiveRefinement != m_ContextExhaustiveRefinement);
+
+    if (rebuildOptimizers)
+    {
+        m_ContextOptimizerType = m_OptimizerType;
+        m_ContextSearchRadius = m_SearchRadius;
+        m_ContextFinalRadius = m_FinalRadius;
+        m_ContextOptimizerMaximumIterations = m_OptimizerMaximumIterations;
+        m_ContextStepSize = m_StepSize;
+        m_ContextExhaustiveRefinement = m_ExhaustiveRefinement;
+
+        m_ThreadOptimizers.resize(numThreads);
+        m_ThreadRefinementOptimizers.clear();
+        for (unsigned int i = 0;i < numThreads;++i)
+            m_ThreadOptimizers[i] = this->SetupOptimizer();
+
+        if ((m_OptimizerType == Exhaustive) && (m_ExhaustiveRefinement))
+        {
+            m_ThreadRefinementOptimizers.resize(numThreads);
+            for (unsigned int i = 0;i < numThreads;++i)
+                m_ThreadRefinementOptimizers[i] = this->SetupRefinementOptimizer();
+        }
+    }
+
+    for (unsigned int i = 0;i < numThreads;++i)
+    {
+        this->PrepareThreadMetric(m_ThreadMetrics[i]);
+        m_ThreadOptimizers[i]->SetCostFunction(m_ThreadMetrics[i]);
+        if (m_ThreadRefinementOptimizers.size() == numThreads)
+            m_ThreadRefinementOptimizers[i]->SetCostFunction(m_ThreadMetrics[i]);
+    }
+
+    this->PrepareThreadData(numThreads);
+}
+
 template <typename TInputImageType>
 typename BaseBlockMatcher <TInputImageType>::OptimizerPointer
 BaseBlockMatcher <TInputImageType>
@@ -136,16 +461,61 @@ BaseBlockMatcher <TInputImageType>
     return optimizer;
 }
 
+template <typename TInputImageType>
+typename BaseBlockMatcher <TInputImageType>::OptimizerPointer
+BaseBlockMatcher <TInputImageType>
+::SetupRefinementOptimizer()
+{
+    typedef anima::BobyqaOptimizer LocalOptimizerType;
+    LocalOptimizerType::Pointer tmpOpt = LocalOptimizerType::New();
+
+    // Exhaustive grid step is in voxels, as is the scaled Bobyqa translation search space
+    tmpOpt->SetRhoBegin(std::max(m_StepSize / 2.0, 2.0 * m_FinalRadius));
+    tmpOpt->SetRhoEnd(m_FinalRadius);
+
+    tmpOpt->SetNumberSamplingPoints(m_BlockTransformPointers[0]->GetNumberOfParameters() + 2);
+    tmpOpt->SetMaximumIteration(m_OptimizerMaximumIterations);
+    tmpOpt->SetMaximize(this->GetMaximizedMetric());
+
+    OptimizerPointer optimizer = tmpOpt.GetPointer();
+    this->TransformDependantOptimizerSetup(optimizer);
+
+    return optimizer;
+}
+
 template <typename TInputImageType>
 void
 BaseBlockMatcher <TInputImageType>
 ::Update()
 {
     // Generate blocks if needed on reference image
+    bool blocksGenerated = false;
+    bool referenceModified = false;
     if ((m_ForceComputeBlocks) || (m_BlockTransformPointers.size() == 0))
+    {
         this->InitializeBlocks();
+        this->ComputeBlockFixedPoints();
+        this->ComputeBlockPriors();
+        blocksGenerated = true;
+    }
+
+    // Fixed block data is kept across updates (e.g. asymmetric scheme) unless the reference image actually changed
+    if ((blocksGenerated) || (m_ReferenceImage != m_LastReferenceImage) || (m_ReferenceImage->GetMTime() != m_LastReferenceImageMTime))
+    {
+        m_LastReferenceImage = m_ReferenceImage;
+        m_LastReferenceImageMTime = m_ReferenceImage->GetMTime();
+        this->ReferenceDataModified();
+        referenceModified = true;
+    }
+
+    if (m_BlockRegions.size() == 0)
+        return;
+
+    this->InitializeThreadContexts(referenceModified);
+
+    // Metric and optimizer are set up once per thread, chunks do not need to amortize any setup
+    m_BlockScheduler.Initialize(m_BlockRegions.size(),m_NumberOfThreads);
 
-    m_HighestProcessedBlock = 0;
     itk::PoolMultiThreader::Pointer threadWorker = itk::PoolMultiThreader::New();
     ThreadedMatchData *tmpStr = new ThreadedMatchData;
     tmpStr->BlockMatch = this;
@@ -155,6 +525,15 @@ BaseBlockMatcher <TInputImageType>
     threadWorker->SingleMethodExecute();
 
     delete tmpStr;
+
+    // Previous level priors only warm start the first update: block transforms then include the residuals.
+    // Optimizers had their search radius changed by the priors, they are rebuilt. Skipped blocks stay skipped
+    if (m_BlockPriorSearchRadii.size() != 0)
+    {
+        m_BlockPriorDisplacements.clear();
+        m_BlockPriorSearchRadii.clear();
+        m_ThreadOptimizers.clear();
+    }
 }
 
 template <typename TInputImageType>
@@ -165,74 +544,84 @@ BaseBlockMatcher <TInputImageType>
     itk::MultiThreaderBase::WorkUnitInfo *threadArgs = (itk::MultiThreaderBase::WorkUnitInfo *)arg;
     ThreadedMatchData* data = (ThreadedMatchData *)threadArgs->UserData;
 
-    data->BlockMatch->ProcessBlockMatch();
+    data->BlockMatch->ProcessBlockMatch(threadArgs->WorkUnitID);
     return ITK_THREAD_RETURN_DEFAULT_VALUE;
 }
 
 template <typename TInputImageType>
 void
 BaseBlockMatcher <TInputImageType>
-::ProcessBlockMatch()
+::ProcessBlockMatch(unsigned int threadId)
 {
-    bool continueLoop = true;
-    unsigned int highestToleratedBlockIndex = m_BlockRegions.size();
-
-    unsigned int stepData = std::min((int)m_BlockRegions.size(),100);
-    if (stepData == 0)
-        stepData = 1;
-
-    while (continueLoop)
-    {
-        m_LockHighestProcessedBlock.lock();
-
-        if (m_HighestProcessedBlock >= highestToleratedBlockIndex)
-        {
-            m_LockHighestProcessedBlock.unlock();
-            continueLoop = false;
-            continue;
-        }
-
-        unsigned int startPoint = m_HighestProcessedBlock;
-        unsigned int endPoint = m_HighestProcessedBlock + stepData;
-        if (endPoint > highestToleratedBlockIndex)
-            endPoint = highestToleratedBlockIndex;
-
-        m_HighestProcessedBlock = endPoint;
-
-        m_LockHighestProcessedBlock.unlock();
-
-        this->BlockMatch(startPoint,endPoint);
-    }
+    unsigned int startPoint, endPoint;
+    while (m_BlockScheduler.GetNextChunk(threadId,startPoint,endPoint))
+        this->BlockMatch(threadId,startPoint,endPoint);
 }
 
 template <typename TInputImageType>
 void
 BaseBlockMatcher <TInputImageType>
-::BlockMatch(unsigned int startIndex, unsigned int endIndex)
+::BlockMatch(unsigned int threadId, unsigned int startIndex, unsigned int endIndex)
 {
-    MetricPointer metric = this->SetupMetric();
-    OptimizerPointer optimizer = this->SetupOptimizer();
+    MetricPointer &metric = m_ThreadMetrics[threadId];
+    OptimizerPointer &optimizer = m_ThreadOptimizers[threadId];
+    bool refineExhaustiveSearch = (m_ThreadRefinementOptimizers.size() > threadId);
 
     // Loop over the desired blocks
     for (unsigned int block = startIndex;block < endIndex;++block)
     {
+        if ((m_BlockSkipped.size() != 0) && (m_BlockSkipped[block]))
+        {
+            // Negligible weight at the previous pyramid level
+            m_BlockWeights[block] = 0;
+            continue;
+        }
+
         this->BlockMatchingSetup(metric, block);
-        optimizer->SetCostFunction(metric);
-        optimizer->SetInitialPosition(m_BlockTransformPointers[block]->GetParameters());
 
-        try
+        double val = 0;
+        bool fastSearchDone = (m_OptimizerType == Exhaustive) && this->FastExhaustiveSearch(threadId, block, val);
+
+        if (!fastSearchDone)
         {
-            optimizer->StartOptimization();
+            if (m_BlockPriorSearchRadii.size() != 0)
+                this->ApplyBlockPrior(optimizer, block);
+
+            optimizer->SetInitialPosition(m_BlockTransformPointers[block]->GetParameters());
+
+            try
+            {
+                optimizer->StartOptimization();
+            }
+            catch (itk::ExceptionObject & err)
+            {
+                m_BlockWeights[block] = 0;
+                continue;
+            }
+
+            m_BlockTransformPointers[block]->SetParameters(optimizer->GetCurrentPosition());
+            val = optimizer->GetValue(optimizer->GetCurrentPosition());
         }
-        catch (itk::ExceptionObject & err)
+
+        if (refineExhaustiveSearch)
         {
-            m_BlockWeights[block] = 0;
-            continue;
-        }
+            // Local refinement around the best grid displacement, kept only if it succeeds
+            OptimizerPointer &refinementOptimizer = m_ThreadRefinementOptimizers[threadId];
+            typename BaseInputTransformType::ParametersType gridParameters = m_BlockTransformPointers[block]->GetParameters();
+            refinementOptimizer->SetInitialPosition(gridParameters);
 
-        m_BlockTransformPointers[block]->SetParameters(optimizer->GetCurrentPosition());
+            try
+            {
+                refinementOptimizer->StartOptimization();
+                m_BlockTransformPointers[block]->SetParameters(refinementOptimizer->GetCurrentPosition());
+                val = refinementOptimizer->GetValue(refinementOptimizer->GetCurrentPosition());
+            }
+            catch (itk::ExceptionObject & err)
+            {
+                m_BlockTransformPointers[block]->SetParameters(gridParameters);
+            }
+        }
 
-        double val = optimizer->GetValue(optimizer->GetCurrentPosition());
         m_BlockWeights[block] = this->ComputeBlockWeight(val,block);
     }
 }
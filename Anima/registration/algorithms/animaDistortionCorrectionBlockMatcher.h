@@ -1,5 +1,6 @@
 #pragma once
 #include <animaBaseBlockMatcher.h>
+#include <animaFixedBlockStatisticsCache.h>
 
 namespace anima
 {
@@ -53,6 +54,8 @@ protected:
     virtual BaseInputTransformPointer GetNewBlockTransform(PointType &blockCenter);
 
     virtual MetricPointer SetupMetric();
+    virtual void PrepareThreadMetric(MetricPointer &metric);
+    virtual void ReferenceDataModified();
     virtual double ComputeBlockWeight(double val, unsigned int block);
 
     virtual void BlockMatchingSetup(MetricPointer &metric, unsigned int block);
@@ -72,6 +75,9 @@ private:
     double m_ScaleMax;
 
     unsigned int m_TransformDirection;
+
+    // Fixed block values and statistics, kept as long as the reference image and blocks are unchanged
+    anima::FixedBlockStatisticsCache <InputImageType> m_FixedBlockStatistics;
 };
 
 } // end namespace anima
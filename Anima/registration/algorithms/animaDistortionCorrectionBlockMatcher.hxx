@@ -30,6 +30,8 @@ DistortionCorrectionBlockMatcher<TInputImageType>
     m_SearchScaleRadius = 0.1;
 
     m_TransformDirection = 1;
+
+    this->SetPrecomputeBlockFixedPoints(true);
 }
 
 template <typename TInputImageType>
@@ -153,6 +155,33 @@ DistortionCorrectionBlockMatcher<TInputImageType>
     return outputValue;
 }
 
+template <typename TInputImageType>
+void
+DistortionCorrectionBlockMatcher<TInputImageType>
+::ReferenceDataModified()
+{
+    m_FixedBlockStatistics.Initialize(this->GetBlockRegions());
+}
+
+template <typename TInputImageType>
+void
+DistortionCorrectionBlockMatcher<TInputImageType>
+::PrepareThreadMetric(MetricPointer &metric)
+{
+    if (!metric)
+        metric = this->SetupMetric();
+
+    // Only images change between two updates: ITK initialization is done here once for all blocks
+    typedef itk::ImageToImageMetric <InputImageType,InputImageType> BaseMetricType;
+    BaseMetricType *baseMetric = dynamic_cast <BaseMetricType *> (metric.GetPointer());
+
+    baseMetric->SetFixedImage(this->GetReferenceImage());
+    baseMetric->SetMovingImage(this->GetMovingImage());
+    baseMetric->SetFixedImageRegion(this->GetBlockRegion(0));
+    baseMetric->SetTransform(this->GetBlockTransformPointer(0));
+    baseMetric->Initialize();
+}
+
 template <typename TInputImageType>
 double
 DistortionCorrectionBlockMatcher<TInputImageType>
@@ -250,12 +279,29 @@ DistortionCorrectionBlockMatcher<TInputImageType>
     InternalMetricType *tmpMetric = dynamic_cast <InternalMetricType *> (metric.GetPointer());
     tmpMetric->SetFixedImageRegion(this->GetBlockRegion(block));
     tmpMetric->SetTransform(this->GetBlockTransformPointer(block));
-    tmpMetric->Initialize();
+
+    // Each block is processed by a single thread per update, cache entries can be filled concurrently
+    if (!m_FixedBlockStatistics.IsBlockComputed(block))
+        m_FixedBlockStatistics.ComputeBlock(this->GetReferenceImage(), block);
 
     if (m_SimilarityType != MeanSquares)
-        ((anima::FastCorrelationImageToImageMetric<InputImageType, InputImageType> *)metric.GetPointer())->PreComputeFixedValues();
+    {
+        typedef anima::FastCorrelationImageToImageMetric <InputImageType, InputImageType> CorrelationMetricType;
+        CorrelationMetricType *correlationMetric = (CorrelationMetricType *)metric.GetPointer();
+        correlationMetric->SetPrecomputedFixedImagePoints(this->GetBlockFixedPoints(block));
+        correlationMetric->SetPrecomputedFixedValues(m_FixedBlockStatistics.GetBlockValues(block),
+                                                     m_FixedBlockStatistics.GetBlockSum(block),
+                                                     m_FixedBlockStatistics.GetBlockVariance(block));
+        correlationMetric->PreComputeFixedValues();
+    }
     else
-        ((anima::FastMeanSquaresImageToImageMetric<InputImageType, InputImageType> *)metric.GetPointer())->PreComputeFixedValues();
+    {
+        typedef anima::FastMeanSquaresImageToImageMetric <InputImageType, InputImageType> MeanSquaresMetricType;
+        MeanSquaresMetricType *meanSquaresMetric = (MeanSquaresMetricType *)metric.GetPointer();
+        meanSquaresMetric->SetPrecomputedFixedImagePoints(this->GetBlockFixedPoints(block));
+        meanSquaresMetric->SetPrecomputedFixedValues(m_FixedBlockStatistics.GetBlockValues(block));
+        meanSquaresMetric->PreComputeFixedValues();
+    }
 }
 
 template <typename TInputImageType>
@@ -313,7 +359,6 @@ DistortionCorrectionBlockMatcher<TInputImageType>
             break;
         }
 
-
         case Direction:
         default:
         {
@@ -48,6 +48,7 @@ int main(int argc, const char** argv)
     TCLAP::ValueArg<unsigned int> symmetryArg("","sym-reg","Registration symmetry type (0: asymmetric, 1: symmetric, 2: kissing, default: 0)",false,0,"symmetry type",cmd);
 
     TCLAP::ValueArg<unsigned int> agregatorArg("a","agregator","Transformation agregator type (0: Baloo, 1: M-smoother, default: 0)",false,0,"agregator type",cmd);
+    TCLAP::SwitchArg latticeAgregationArg("","lattice-agreg","M-smoother agregation on a control point lattice with the block spacing, upsampled once to the image grid",cmd,false);
     TCLAP::ValueArg<double> extrapolationSigmaArg("","fs","Sigma for extrapolation of local pairings (default: 3)",false,3,"extrapolation sigma",cmd);
     TCLAP::ValueArg<double> elasticSigmaArg("","es","Sigma for elastic regularization (default: 3)",false,3,"elastic regularization sigma",cmd);
     TCLAP::ValueArg<double> outlierSigmaArg("","os","Sigma for outlier rejection among local pairings (default: 3)",false,3,"outlier rejection sigma",cmd);
@@ -105,6 +106,7 @@ int main(int argc, const char** argv)
     matcher->SetScaleUpperBound( scaleUpperBoundArg.getValue() );
     matcher->SetSymmetryType( (PyramidBMType::SymmetryType) symmetryArg.getValue() );
     matcher->SetAgregator( (PyramidBMType::Agregator) agregatorArg.getValue() );
+    matcher->SetControlPointLatticeAgregation(latticeAgregationArg.isSet());
     matcher->SetExtrapolationSigma(extrapolationSigmaArg.getValue());
     matcher->SetElasticSigma(elasticSigmaArg.getValue());
     matcher->SetOutlierSigma(outlierSigmaArg.getValue());
@@ -186,6 +186,9 @@ public:
     Agregator GetAgregator() {return m_Agregator;}
     void SetAgregator(Agregator agregator) {m_Agregator=agregator;}
 
+    bool GetControlPointLatticeAgregation() {return m_ControlPointLatticeAgregation;}
+    void SetControlPointLatticeAgregation(bool val) {m_ControlPointLatticeAgregation = val;}
+
     double GetExtrapolationSigma() {return m_ExtrapolationSigma;}
     void SetExtrapolationSigma(double extrapolationSigma) {m_ExtrapolationSigma = extrapolationSigma;}
 
@@ -265,6 +268,7 @@ private:
     double m_AngleUpperBound;
     double m_ScaleUpperBound;
     Agregator m_Agregator;
+    bool m_ControlPointLatticeAgregation;
     double m_ExtrapolationSigma;
     double m_ElasticSigma;
     double m_OutlierSigma;
@@ -51,6 +51,7 @@ PyramidalDenseSVFMatchingBridge<ImageDimension>::PyramidalDenseSVFMatchingBridge
     m_AngleUpperBound = 180;
     m_ScaleUpperBound = 3;
     m_Agregator = Baloo;
+    m_ControlPointLatticeAgregation = false;
     m_ExtrapolationSigma = 3;
     m_ElasticSigma = 3;
     m_OutlierSigma = 3;
@@ -174,6 +175,9 @@ PyramidalDenseSVFMatchingBridge<ImageDimension>::Update()
             agreg->SetDistanceBoundary(m_ExtrapolationSigma * meanSpacing * m_NeighborhoodApproximation);
             agreg->SetMEstimateConvergenceThreshold(m_MEstimateConvergenceThreshold);
 
+            if (m_ControlPointLatticeAgregation)
+                agreg->SetControlPointSpacing(GetBlockSpacing());
+
             agregPtr = agreg;
         }
         else
@@ -56,6 +56,7 @@ int main(int argc, const char** argv)
     TCLAP::ValueArg<double> searchScaleRadiusArg("","scr","Search scale radius (rho start for bobyqa, default: 0.1)",false,0.1,"optimizer search scale radius",cmd);
     TCLAP::ValueArg<double> finalRadiusArg("","fr","Final radius (rho end for bobyqa, default: 0.001)",false,0.001,"optimizer final radius",cmd);
     TCLAP::ValueArg<double> searchStepArg("","st","Search step for exhaustive search (default: 2)",false,2,"exhaustive optimizer search step",cmd);
+    TCLAP::SwitchArg exhaustiveRefinementArg("","exh-refine","Refine exhaustive search results with bobyqa",cmd,false);
 
     TCLAP::ValueArg<double> translateUpperBoundArg("","tub","Upper bound on translation for bobyqa (in voxels, default: 10)",false,10,"Bobyqa translate upper bound",cmd);
     TCLAP::ValueArg<double> angleUpperBoundArg("","aub","Upper bound on angles for bobyqa (in degrees, default: 180)",false,180,"Bobyqa angle upper bound",cmd);
@@ -69,6 +70,8 @@ int main(int argc, const char** argv)
 
     TCLAP::ValueArg<unsigned int> numPyramidLevelsArg("p","pyr","Number of pyramid levels (default: 3)",false,3,"number of pyramid levels",cmd);
     TCLAP::ValueArg<unsigned int> lastPyramidLevelArg("l","last-level","Index of the last pyramid level explored (default: 0)",false,0,"last pyramid level",cmd);
+    TCLAP::SwitchArg blockPropagationArg("","prop-blocks","Use block weights and residual displacements of a pyramid level at the next one (asymmetric registration only)",cmd,false);
+    TCLAP::ValueArg<double> blockPropagationThresholdArg("","prop-thr","Previous level weight under which blocks are not matched (default: 0.05)",false,0.05,"block propagation weight threshold",cmd);
     TCLAP::ValueArg<unsigned int> numThreadsArg("T","threads","Number of execution threads (default: 0 = all cores)",false,0,"number of threads",cmd);
 
     try
@@ -97,6 +100,7 @@ int main(int argc, const char** argv)
     matcher->SetSearchAngleRadius( searchAngleRadiusArg.getValue() );
     matcher->SetSearchScaleRadius( searchScaleRadiusArg.getValue() );
     matcher->SetStepSize( searchStepArg.getValue() );
+    matcher->SetExhaustiveRefinement( exhaustiveRefinementArg.isSet() );
     matcher->SetTranslateUpperBound( translateUpperBoundArg.getValue() );
     matcher->SetAngleUpperBound( angleUpperBoundArg.getValue() );
     matcher->SetScaleUpperBound( scaleUpperBoundArg.getValue() );
@@ -107,6 +111,8 @@ int main(int argc, const char** argv)
     matcher->SetSeStoppingThreshold( seStoppingThresholdArg.getValue() );
     matcher->SetNumberOfPyramidLevels( numPyramidLevelsArg.getValue() );
     matcher->SetLastPyramidLevel( lastPyramidLevelArg.getValue() );
+    matcher->SetBlockPropagation( blockPropagationArg.isSet() );
+    matcher->SetBlockPropagationWeightThreshold( blockPropagationThresholdArg.getValue() );
 
     if (blockMaskArg.getValue() != "")
         matcher->SetBlockGenerationMask(anima::readImage<PyramidBMType::MaskImageType>(blockMaskArg.getValue()));
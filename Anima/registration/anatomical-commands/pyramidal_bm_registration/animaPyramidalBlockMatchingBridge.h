@@ -190,6 +190,16 @@ public:
     double GetStepSize() {return m_StepSize;}
     void SetStepSize(double StepSize) {m_StepSize=StepSize;}
 
+    bool GetExhaustiveRefinement() {return m_ExhaustiveRefinement;}
+    void SetExhaustiveRefinement(bool val) {m_ExhaustiveRefinement = val;}
+
+    //! Block weights and residual displacements of a level are used by the next level (asymmetric, non anisotropic similarity outputs only)
+    bool GetBlockPropagation() {return m_BlockPropagation;}
+    void SetBlockPropagation(bool val) {m_BlockPropagation = val;}
+
+    double GetBlockPropagationWeightThreshold() {return m_BlockPropagationWeightThreshold;}
+    void SetBlockPropagationWeightThreshold(double val) {m_BlockPropagationWeightThreshold = val;}
+
     double GetTranslateUpperBound() {return m_TranslateUpperBound;}
     void SetTranslateUpperBound(double TranslateUpperBound) {m_TranslateUpperBound=TranslateUpperBound;}
 
@@ -276,6 +286,9 @@ private:
     double m_SearchScaleRadius;
     double m_FinalRadius;
     double m_StepSize;
+    bool m_ExhaustiveRefinement;
+    bool m_BlockPropagation;
+    double m_BlockPropagationWeightThreshold;
     double m_TranslateUpperBound;
     double m_AngleUpperBound;
     double m_ScaleUpperBound;
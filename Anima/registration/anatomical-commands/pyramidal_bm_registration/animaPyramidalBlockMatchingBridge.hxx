@@ -52,6 +52,9 @@ PyramidalBlockMatchingBridge<ImageDimension>::PyramidalBlockMatchingBridge()
     m_SearchScaleRadius = 0.1;
     m_FinalRadius = 0.001;
     m_StepSize = 1;
+    m_ExhaustiveRefinement = false;
+    m_BlockPropagation = false;
+    m_BlockPropagationWeightThreshold = 0.05;
     m_TranslateUpperBound = 50;
     m_AngleUpperBound = 180;
     m_ScaleUpperBound = 3;
@@ -154,6 +157,13 @@ void PyramidalBlockMatchingBridge<ImageDimension>::Update()
     this->SetupPyramids();
 
     typedef anima::AnatomicalBlockMatcher <InputImageType> BlockMatcherType;
+    typedef typename BlockMatcherType::VectorType BlockVectorType;
+
+    // Block results are residuals to the last update of a level, only meaningful for incremental updates of the transform
+    bool propagateBlocks = m_BlockPropagation && (m_SymmetryType == Asymmetric) && (GetOutputTransformType() != outAnisotropic_Sim);
+    std::vector <PointType> previousBlockPositions;
+    std::vector <double> previousBlockWeights;
+    std::vector <BlockVectorType> previousBlockResiduals;
 
     // Iterate over pyramid levels
     for (unsigned int i = 0;i < GetNumberOfPyramidLevels() && !m_Abort; ++i)
@@ -408,6 +418,13 @@ void PyramidalBlockMatchingBridge<ImageDimension>::Update()
 
         double ss = GetStepSize();
         mainMatcher->SetStepSize(ss);
+        mainMatcher->SetExhaustiveRefinement(m_ExhaustiveRefinement);
+
+        if (previousBlockPositions.size() != 0)
+        {
+            mainMatcher->SetPreviousLevelBlocks(previousBlockPositions, previousBlockWeights, previousBlockResiduals);
+            mainMatcher->SetPreviousLevelWeightThreshold(m_BlockPropagationWeightThreshold);
+        }
 
         double tub = GetTranslateUpperBound();
         mainMatcher->SetTranslateMax(tub);
@@ -428,6 +445,7 @@ void PyramidalBlockMatchingBridge<ImageDimension>::Update()
             reverseMatcher->SetSearchScaleRadius(scr);
             reverseMatcher->SetFinalRadius(fr);
             reverseMatcher->SetStepSize(ss);
+            reverseMatcher->SetExhaustiveRefinement(m_ExhaustiveRefinement);
             reverseMatcher->SetTranslateMax(tub);
             reverseMatcher->SetAngleMax(aub);
             reverseMatcher->SetScaleMax(scub);
@@ -452,6 +470,27 @@ void PyramidalBlockMatchingBridge<ImageDimension>::Update()
         AffineTransformType *tmpTrsf = dynamic_cast<AffineTransformType *>(m_OutputTransform.GetPointer());
         tmpTrsf->SetParameters(m_bmreg->GetOutput()->Get()->GetParameters());
 
+        previousBlockPositions.clear();
+        previousBlockWeights.clear();
+        previousBlockResiduals.clear();
+        BaseTransformType *lastAddOn = m_bmreg->GetLastAddOnTransform();
+        if (propagateBlocks && lastAddOn)
+        {
+            // Block displacements at block centers, minus the part the last update transform accounted for
+            previousBlockPositions = mainMatcher->GetBlockPositions();
+            previousBlockWeights = mainMatcher->GetBlockWeights();
+            previousBlockResiduals.resize(previousBlockPositions.size());
+            for (unsigned int j = 0;j < previousBlockPositions.size();++j)
+            {
+                typename BlockMatcherType::BaseInputTransformType::OutputPointType blockPoint =
+                        mainMatcher->GetBlockTransformPointer(j)->TransformPoint(previousBlockPositions[j]);
+                typename BaseTransformType::OutputPointType updatePoint = lastAddOn->TransformPoint(previousBlockPositions[j]);
+
+                for (unsigned int k = 0;k < ImageDimension;++k)
+                    previousBlockResiduals[j][k] = blockPoint[k] - updatePoint[k];
+            }
+        }
+
         delete mainMatcher;
         if (reverseMatcher)
             delete reverseMatcher;
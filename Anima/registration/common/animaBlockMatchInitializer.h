@@ -82,13 +82,16 @@ public:
     struct BlockGeneratorThreadStruct
     {
         Pointer Filter;
-        std::vector < std::vector <ImageRegionType> > tmpOutput;
         std::vector <unsigned int> blockStartOffsets;
+        std::vector <unsigned int> numberOfBlocksPerAxis;
+        //! Voxel index intervals [start, end[ of blocks along each axis (clipped to the image), for each lattice position
+        std::vector < std::vector <int> > blockIntervalStarts, blockIntervalEnds;
         std::vector < std::vector <unsigned int> > startBlocks, nb_blocks;
         std::vector <unsigned int> totalNumberOfBlocks;
+        //! Blocks kept by each thread, as linear lattice indexes and variances
+        std::vector < std::vector <unsigned int> > blocks_indexes;
         std::vector < std::vector <double> > blocks_variances;
         unsigned int maskIndex;
-        std::vector < std::vector <PointType> > blocks_positions;
 
         //! To be able to inherit from it
         virtual ~BlockGeneratorThreadStruct() {}
@@ -118,22 +121,32 @@ protected:
 
     virtual void InitializeThreading(unsigned int maskIndex, BlockGeneratorThreadStruct *&workStr);
 
-    bool CheckBlockConditions(ImageRegionType &region, double &blockVariance, BlockGeneratorThreadStruct *workStr,
-                              unsigned int threadId);
+    //! Region and center index of a block from its linear lattice index
+    void ComputeBlockRegion(BlockGeneratorThreadStruct *workStr, unsigned int latticeIndex, ImageRegionType &region,
+                            IndexType &blockCenter);
+
+    /**
+     * Sums of values and squared values of scalar reference images over the blocks of a lattice hyperplane (all axes
+     * but the last one), for one voxel plane along the last axis. Output is channel-major (2 channels per scalar image)
+     */
+    void ComputeVoxelPlaneSums(BlockGeneratorThreadStruct *workStr, int planeIndex, std::vector <double> &planeSums,
+                               std::vector <double> &values, std::vector <double> &reducedValues,
+                               std::vector <double> &lineBuffer);
+
+    //! Sums values along one axis over the block intervals of that axis, dims is updated to the reduced sizes
+    void ReduceBlockAxis(BlockGeneratorThreadStruct *workStr, unsigned int axis, const std::vector <double> &input,
+                         std::vector <unsigned int> &dims, std::vector <double> &output, std::vector <double> &lineBuffer);
+
+    /**
+     * Checks mask and variance conditions of all blocks of a lattice hyperplane, given their scalar image sums
+     * (null if there is no scalar reference image), and stores the ones kept
+     */
+    void EvaluateBlockPlane(BlockGeneratorThreadStruct *workStr, unsigned int threadId, unsigned int blockPlane,
+                            const double *blockSums);
 
-    bool CheckScalarVariance(ScalarImageType *refImage, ImageRegionType &region, double &blockVariance);
     virtual bool CheckOrientedModelVariance(unsigned int imageIndex, ImageRegionType &region, double &blockVariance,
                                             BlockGeneratorThreadStruct *workStr, unsigned int threadId);
 
-    bool ProgressCounter(std::vector <unsigned int> &counter, std::vector <unsigned int> &bounds);
-
-    struct pair_comparator
-    {
-        bool operator() (const std::pair<double, std::pair <PointType, ImageRegionType> > & f,
-                         const std::pair<double, std::pair <PointType, ImageRegionType> > & s)
-        { return (f.first < s.first); }
-    };
-
 private:
     BlockMatchingInitializer(const Self&); //purposely not implemented
     void operator=(const Self&); //purposely not implemented
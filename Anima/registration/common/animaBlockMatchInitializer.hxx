@@ -10,6 +10,8 @@
 #include <itkBinaryBallStructuringElement.h>
 #include <itkPoolMultiThreader.h>
 
+#include <algorithm>
+
 namespace anima
 {
 
@@ -197,45 +199,73 @@ BlockMatchingInitializer<PixelType,NDimensions>
     threaderBlockGenerator->SetSingleMethod(this->ThreadBlockGenerator,tmpStr);
     threaderBlockGenerator->SingleMethodExecute();
 
-    m_Output.clear();
-    m_OutputPositions.clear();
     unsigned int totalNumberOfBlocks = 0;
     unsigned int realNumberOfBlocks = 0;
 
     for (unsigned int i = 0;i < this->GetNumberOfThreads();++i)
     {
-        realNumberOfBlocks += tmpStr->tmpOutput[i].size();
+        realNumberOfBlocks += tmpStr->blocks_indexes[i].size();
         totalNumberOfBlocks += tmpStr->totalNumberOfBlocks[i];
     }
 
     double percentageBlocksKept = (double) realNumberOfBlocks / totalNumberOfBlocks;
 
-    if (percentageBlocksKept > m_PercentageKept)
+    // Variance under which blocks are removed, and number of blocks exactly at that variance still kept
+    bool selectBlocks = (percentageBlocksKept > m_PercentageKept);
+    double varianceCut = 0;
+    unsigned int numCutBlocksKept = 0;
+    if (selectBlocks)
     {
-        std::vector < std::pair <double, std::pair <PointType, ImageRegionType> > > sortVector;
+        // Same number of removed blocks as before, at least one block being kept when too many blocks failed the variance test
+        unsigned int numRemoved = std::floor((1.0 - m_PercentageKept) * totalNumberOfBlocks);
+        if (numRemoved >= realNumberOfBlocks)
+            numRemoved = realNumberOfBlocks - 1;
+
+        // Linear time selection instead of sorting
+        std::vector <double> variances;
+        variances.reserve(realNumberOfBlocks);
         for (unsigned int i = 0;i < this->GetNumberOfThreads();++i)
-            for (unsigned int j = 0;j < tmpStr->tmpOutput[i].size();++j)
-            {
-                std::pair <PointType, ImageRegionType> tmpPair(tmpStr->blocks_positions[i][j],tmpStr->tmpOutput[i][j]);
-                sortVector.push_back(std::make_pair(tmpStr->blocks_variances[i][j],tmpPair));
-            }
+            variances.insert(variances.end(),tmpStr->blocks_variances[i].begin(),tmpStr->blocks_variances[i].end());
 
-        unsigned int numRemoved = std::floor((1.0 - m_PercentageKept) * totalNumberOfBlocks);
-        std::partial_sort(sortVector.begin(),sortVector.begin() + numRemoved,sortVector.end(),pair_comparator());
+        std::nth_element(variances.begin(),variances.begin() + numRemoved,variances.end());
+        varianceCut = variances[numRemoved];
 
-        for (unsigned int i = numRemoved;i < sortVector.size();++i)
+        numCutBlocksKept = realNumberOfBlocks - numRemoved;
+        for (unsigned int i = numRemoved + 1;i < realNumberOfBlocks;++i)
         {
-            m_Output.push_back(sortVector[i].second.second);
-            m_OutputPositions.push_back(sortVector[i].second.first);
+            if (variances[i] > varianceCut)
+                --numCutBlocksKept;
         }
     }
-    else
+
+    // Regions and positions are only built for kept blocks, in lattice order
+    IndexType blockCenter;
+    ImageRegionType blockRegion;
+    PointType blockOrigin;
+    for (unsigned int i = 0;i < this->GetNumberOfThreads();++i)
     {
-        for (unsigned int i = 0;i < this->GetNumberOfThreads();++i)
+        for (unsigned int j = 0;j < tmpStr->blocks_indexes[i].size();++j)
         {
-            m_Output.insert(m_Output.end(), tmpStr->tmpOutput[i].begin(), tmpStr->tmpOutput[i].end());
-            m_OutputPositions.insert(m_OutputPositions.end(), tmpStr->blocks_positions[i].begin(),
-                                     tmpStr->blocks_positions[i].end());
+            if (selectBlocks)
+            {
+                double blockVariance = tmpStr->blocks_variances[i][j];
+                if (blockVariance < varianceCut)
+                    continue;
+
+                if (blockVariance == varianceCut)
+                {
+                    if (numCutBlocksKept == 0)
+                        continue;
+
+                    --numCutBlocksKept;
+                }
+            }
+
+            this->ComputeBlockRegion(tmpStr,tmpStr->blocks_indexes[i][j],blockRegion,blockCenter);
+            this->GetFirstReferenceImage()->TransformIndexToPhysicalPoint(blockCenter,blockOrigin);
+
+            m_Output.push_back(blockRegion);
+            m_OutputPositions.push_back(blockOrigin);
         }
     }
 
@@ -295,6 +325,27 @@ BlockMatchingInitializer<PixelType, NDimensions>
         workStr->blockStartOffsets[i] = workRegion.GetIndex()[i] + std::floor(spaceRequired / 2.0);
     }
 
+    // Block intervals along each axis, clipped to the reference image
+    ImageRegionType largestRegion = this->GetFirstReferenceImage()->GetLargestPossibleRegion();
+    int blockHalfSize = std::floor((this->GetBlockSize() - 1) / 2.0);
+    workStr->numberOfBlocksPerAxis = totalNbBlocks;
+    workStr->blockIntervalStarts.resize(NDimensions);
+    workStr->blockIntervalEnds.resize(NDimensions);
+    for (unsigned int i = 0;i < NDimensions;++i)
+    {
+        int lowerBound = largestRegion.GetIndex()[i];
+        int upperBound = lowerBound + largestRegion.GetSize()[i];
+
+        workStr->blockIntervalStarts[i].resize(totalNbBlocks[i]);
+        workStr->blockIntervalEnds[i].resize(totalNbBlocks[i]);
+        for (unsigned int j = 0;j < totalNbBlocks[i];++j)
+        {
+            int blockStart = (int)(workStr->blockStartOffsets[i] + j * this->GetBlockSpacing()) - blockHalfSize;
+            workStr->blockIntervalStarts[i][j] = std::max(blockStart, lowerBound);
+            workStr->blockIntervalEnds[i][j] = std::min(blockStart + (int)this->GetBlockSize(), upperBound);
+        }
+    }
+
     unsigned int nb_blocks_per_thread = (unsigned int) std::floor((float)(totalNbBlocks[NDimensions-1] / this->GetNumberOfThreads()));
     if (nb_blocks_per_thread < 1)
     {
@@ -332,16 +383,14 @@ BlockMatchingInitializer<PixelType, NDimensions>
     }
 
     workStr->Filter = this;
-    workStr->tmpOutput.resize(this->GetNumberOfThreads());
     workStr->totalNumberOfBlocks.resize(this->GetNumberOfThreads());
-    workStr->blocks_positions.resize(this->GetNumberOfThreads());
+    workStr->blocks_indexes.resize(this->GetNumberOfThreads());
     workStr->blocks_variances.resize(this->GetNumberOfThreads());
 
     for (unsigned int i = 0;i < this->GetNumberOfThreads();++i)
     {
-        workStr->tmpOutput[i].clear();
         workStr->totalNumberOfBlocks[i] = 0;
-        workStr->blocks_positions[i].clear();
+        workStr->blocks_indexes[i].clear();
         workStr->blocks_variances[i].clear();
     }
 }
@@ -366,132 +415,268 @@ template <class PixelType, unsigned int NDimensions>
 void BlockMatchingInitializer<PixelType,NDimensions>
 ::RegionBlockGenerator(BlockGeneratorThreadStruct *workStr, unsigned int threadId)
 {
-    typename ImageRegionType::IndexType startPosition, blockPosition;
-    typename ImageRegionType::SizeType blockSize;
-    PointType blockOrigin;
-    ImageRegionType largestRegion = this->GetFirstReferenceImage()->GetLargestPossibleRegion();
-
-    ImageRegionType tmpBlock;
-    int indexPos;
-    double blockVar = 0;
+    const unsigned int lastDimension = NDimensions - 1;
     workStr->totalNumberOfBlocks[threadId] = 0;
+    workStr->blocks_indexes[threadId].clear();
     workStr->blocks_variances[threadId].clear();
-    workStr->blocks_positions[threadId].clear();
 
-    unsigned int block_half_size = std::floor ((this->GetBlockSize() - 1) / 2.0);
+    unsigned int firstBlockPlane = workStr->startBlocks[threadId][lastDimension];
+    unsigned int endBlockPlane = firstBlockPlane + workStr->nb_blocks[threadId][lastDimension];
+    if (firstBlockPlane >= endBlockPlane)
+        return;
 
-    bool continueLoop = true;
-    std::vector <unsigned int> positionCounter(NDimensions,0);
+    unsigned int numScalarImages = m_ReferenceScalarImages.size();
+    if (numScalarImages == 0)
+    {
+        for (unsigned int blockPlane = firstBlockPlane;blockPlane < endBlockPlane;++blockPlane)
+            this->EvaluateBlockPlane(workStr,threadId,blockPlane,0);
 
-    while (continueLoop)
+        return;
+    }
+
+    unsigned int planeNumberOfBlocks = 1;
+    for (unsigned int i = 0;i < lastDimension;++i)
+        planeNumberOfBlocks *= workStr->numberOfBlocksPerAxis[i];
+
+    // Scalar image sums are streamed along the last axis: each voxel plane is reduced once over the blocks of a lattice
+    // hyperplane, then added to the block planes whose interval contains it, kept in a ring until their interval ends
+    unsigned int numSums = 2 * numScalarImages * planeNumberOfBlocks;
+    unsigned int ringSize = std::ceil((double)this->GetBlockSize() / this->GetBlockSpacing()) + 1;
+    std::vector <double> blockPlaneSums(ringSize * numSums);
+    std::vector <double> voxelPlaneSums(numSums);
+    std::vector <double> values, reducedValues, lineBuffer;
+
+    const std::vector <int> &planeStarts = workStr->blockIntervalStarts[lastDimension];
+    const std::vector <int> &planeEnds = workStr->blockIntervalEnds[lastDimension];
+
+    unsigned int nextPlaneToOpen = firstBlockPlane;
+    unsigned int nextPlaneToClose = firstBlockPlane;
+    for (int voxelPlane = planeStarts[firstBlockPlane];voxelPlane < planeEnds[endBlockPlane - 1];++voxelPlane)
     {
-        for (unsigned int i = 0;i < NDimensions;++i)
+        while ((nextPlaneToOpen < endBlockPlane) && (planeStarts[nextPlaneToOpen] <= voxelPlane))
         {
-            blockSize[i] = this->GetBlockSize();
-            indexPos = workStr->blockStartOffsets[i] + (workStr->startBlocks[threadId][i] + positionCounter[i])*this->GetBlockSpacing() - block_half_size;
-            if (indexPos < largestRegion.GetIndex()[i])
-            {
-                blockSize[i] += indexPos - largestRegion.GetIndex()[i];
-                indexPos = largestRegion.GetIndex()[i];
-            }
-            startPosition[i] = indexPos;
-            if (startPosition[i] + blockSize[i] > largestRegion.GetIndex()[i] + largestRegion.GetSize()[i])
-                blockSize[i] = largestRegion.GetIndex()[i] + largestRegion.GetSize()[i] - startPosition[i];
+            double *sums = blockPlaneSums.data() + ((nextPlaneToOpen - firstBlockPlane) % ringSize) * numSums;
+            std::fill(sums, sums + numSums, 0.0);
+            ++nextPlaneToOpen;
         }
 
-        tmpBlock.SetIndex(startPosition);
-        tmpBlock.SetSize(blockSize);
-        workStr->totalNumberOfBlocks[threadId]++;
+        // Voxel plane between block intervals (block spacing larger than block size)
+        if (nextPlaneToClose == nextPlaneToOpen)
+            continue;
+
+        this->ComputeVoxelPlaneSums(workStr,voxelPlane,voxelPlaneSums,values,reducedValues,lineBuffer);
 
-        if (this->CheckBlockConditions(tmpBlock,blockVar,workStr,threadId))
+        // Open block planes all contain the current voxel plane (intervals starts and ends are non decreasing)
+        for (unsigned int blockPlane = nextPlaneToClose;blockPlane < nextPlaneToOpen;++blockPlane)
         {
-            for (unsigned int i = 0;i < NDimensions;++i)
-                blockPosition[i] = workStr->blockStartOffsets[i] + (workStr->startBlocks[threadId][i] + positionCounter[i])*this->GetBlockSpacing();
+            double *sums = blockPlaneSums.data() + ((blockPlane - firstBlockPlane) % ringSize) * numSums;
+            for (unsigned int i = 0;i < numSums;++i)
+                sums[i] += voxelPlaneSums[i];
+        }
+
+        while ((nextPlaneToClose < nextPlaneToOpen) && (planeEnds[nextPlaneToClose] <= voxelPlane + 1))
+        {
+            double *sums = blockPlaneSums.data() + ((nextPlaneToClose - firstBlockPlane) % ringSize) * numSums;
+            this->EvaluateBlockPlane(workStr,threadId,nextPlaneToClose,sums);
+            ++nextPlaneToClose;
+        }
+    }
+}
+
+template <class PixelType, unsigned int NDimensions>
+void BlockMatchingInitializer<PixelType,NDimensions>
+::ComputeVoxelPlaneSums(BlockGeneratorThreadStruct *workStr, int planeIndex, std::vector <double> &planeSums,
+                        std::vector <double> &values, std::vector <double> &reducedValues,
+                        std::vector <double> &lineBuffer)
+{
+    const unsigned int lastDimension = NDimensions - 1;
+
+    // Voxel box covered by the blocks of a lattice hyperplane
+    IndexType boxStart;
+    std::vector <unsigned int> boxSize(lastDimension);
+    unsigned int boxNumberOfVoxels = 1;
+    for (unsigned int i = 0;i < lastDimension;++i)
+    {
+        boxStart[i] = workStr->blockIntervalStarts[i].front();
+        boxSize[i] = workStr->blockIntervalEnds[i].back() - boxStart[i];
+        boxNumberOfVoxels *= boxSize[i];
+    }
 
-            if (m_GenerationMasks[workStr->maskIndex]->GetPixel(blockPosition) == 0)
+    boxStart[lastDimension] = planeIndex;
+
+    unsigned int rowLength = (lastDimension > 0) ? boxSize[0] : 1;
+    unsigned int numRows = boxNumberOfVoxels / rowLength;
+    unsigned int planeNumberOfBlocks = planeSums.size() / (2 * m_ReferenceScalarImages.size());
+
+    std::vector <unsigned int> dims;
+    std::vector <unsigned int> rowIndex(NDimensions,0);
+    for (unsigned int imageIndex = 0;imageIndex < m_ReferenceScalarImages.size();++imageIndex)
+    {
+        ScalarImageType *refImage = m_ReferenceScalarImages[imageIndex];
+        const PixelType *refBuffer = refImage->GetBufferPointer();
+        const typename ScalarImageType::OffsetValueType *offsetTable = refImage->GetOffsetTable();
+        typename ScalarImageType::OffsetValueType boxOffset = refImage->ComputeOffset(boxStart);
+
+        for (unsigned int channel = 0;channel < 2;++channel)
+        {
+            values.resize(boxNumberOfVoxels);
+            std::fill(rowIndex.begin(),rowIndex.end(),0);
+            unsigned int pos = 0;
+            for (unsigned int row = 0;row < numRows;++row)
             {
-                continueLoop = this->ProgressCounter(positionCounter,workStr->nb_blocks[threadId]);
-                continue;
+                typename ScalarImageType::OffsetValueType rowOffset = boxOffset;
+                for (unsigned int i = 1;i < lastDimension;++i)
+                    rowOffset += rowIndex[i] * offsetTable[i];
+
+                for (unsigned int x = 0;x < rowLength;++x,++pos)
+                {
+                    double value = refBuffer[rowOffset + x];
+                    values[pos] = (channel == 0) ? value : value * value;
+                }
+
+                for (unsigned int i = 1;i < lastDimension;++i)
+                {
+                    ++rowIndex[i];
+                    if (rowIndex[i] < boxSize[i])
+                        break;
+
+                    rowIndex[i] = 0;
+                }
             }
 
-            workStr->tmpOutput[threadId].push_back(tmpBlock);
-            workStr->blocks_variances[threadId].push_back(blockVar);
+            dims = boxSize;
+            for (unsigned int i = 0;i < lastDimension;++i)
+            {
+                this->ReduceBlockAxis(workStr,i,values,dims,reducedValues,lineBuffer);
+                values.swap(reducedValues);
+            }
 
-            this->GetFirstReferenceImage()->TransformIndexToPhysicalPoint(blockPosition,blockOrigin);
-            workStr->blocks_positions[threadId].push_back(blockOrigin);
+            std::copy(values.begin(),values.begin() + planeNumberOfBlocks,
+                      planeSums.begin() + (2 * imageIndex + channel) * planeNumberOfBlocks);
         }
-
-        continueLoop = this->ProgressCounter(positionCounter,workStr->nb_blocks[threadId]);
     }
 }
 
 template <class PixelType, unsigned int NDimensions>
-bool
-BlockMatchingInitializer<PixelType,NDimensions>
-::ProgressCounter(std::vector <unsigned int> &counter, std::vector <unsigned int> & bounds)
+void BlockMatchingInitializer<PixelType,NDimensions>
+::ReduceBlockAxis(BlockGeneratorThreadStruct *workStr, unsigned int axis, const std::vector <double> &input,
+                  std::vector <unsigned int> &dims, std::vector <double> &output, std::vector <double> &lineBuffer)
 {
-    unsigned int pos = counter.size() - 1;
+    unsigned int stride = 1;
+    for (unsigned int i = 0;i < axis;++i)
+        stride *= dims[i];
 
-    bool needUpdate = false;
-    do
-    {
-        counter[pos]++;
-        needUpdate = false;
+    unsigned int lineLength = dims[axis];
+    unsigned int numBlocks = workStr->numberOfBlocksPerAxis[axis];
+    unsigned int numOuterLines = input.size() / (stride * lineLength);
+
+    const std::vector <int> &blockStarts = workStr->blockIntervalStarts[axis];
+    const std::vector <int> &blockEnds = workStr->blockIntervalEnds[axis];
+    int axisStart = blockStarts.front();
+
+    output.resize(stride * numBlocks * numOuterLines);
+    lineBuffer.resize(lineLength + 1);
 
-        if ((counter[pos] == bounds[pos])&&(pos > 0))
+    // Prefix sums along each line, block sums are then differences of two prefix sums
+    for (unsigned int outer = 0;outer < numOuterLines;++outer)
+    {
+        for (unsigned int inner = 0;inner < stride;++inner)
         {
-            counter[pos] = 0;
-            --pos;
-            needUpdate = true;
+            const double *inputLine = input.data() + outer * stride * lineLength + inner;
+            lineBuffer[0] = 0;
+            for (unsigned int i = 0;i < lineLength;++i)
+                lineBuffer[i + 1] = lineBuffer[i] + inputLine[i * stride];
+
+            double *outputLine = output.data() + outer * stride * numBlocks + inner;
+            for (unsigned int j = 0;j < numBlocks;++j)
+                outputLine[j * stride] = lineBuffer[blockEnds[j] - axisStart] - lineBuffer[blockStarts[j] - axisStart];
         }
-    } while (needUpdate);
-
-    if (counter[pos] >= bounds[pos])
-        return false;
+    }
 
-    return true;
+    dims[axis] = numBlocks;
 }
 
 template <class PixelType, unsigned int NDimensions>
-bool
-BlockMatchingInitializer<PixelType,NDimensions>
-::CheckBlockConditions(ImageRegionType &region, double &blockVariance, BlockGeneratorThreadStruct *workStr,
-                       unsigned int threadId)
+void BlockMatchingInitializer<PixelType,NDimensions>
+::ComputeBlockRegion(BlockGeneratorThreadStruct *workStr, unsigned int latticeIndex, ImageRegionType &region,
+                     IndexType &blockCenter)
 {
-    ImageRegionType refRegion = this->GetFirstReferenceImage()->GetLargestPossibleRegion();
-
+    IndexType blockStart;
+    typename ImageRegionType::SizeType blockSize;
     for (unsigned int i = 0;i < NDimensions;++i)
     {
-        if (refRegion.GetIndex()[i] > region.GetIndex()[i])
-            return false;
+        unsigned int axisIndex = latticeIndex % workStr->numberOfBlocksPerAxis[i];
+        latticeIndex /= workStr->numberOfBlocksPerAxis[i];
 
-        if (refRegion.GetIndex()[i] + refRegion.GetSize()[i] < region.GetIndex()[i] + region.GetSize()[i])
-            return false;
+        blockCenter[i] = workStr->blockStartOffsets[i] + axisIndex * this->GetBlockSpacing();
+        blockStart[i] = workStr->blockIntervalStarts[i][axisIndex];
+        blockSize[i] = workStr->blockIntervalEnds[i][axisIndex] - blockStart[i];
     }
 
-    blockVariance = 0;
+    region.SetIndex(blockStart);
+    region.SetSize(blockSize);
+}
+
+template <class PixelType, unsigned int NDimensions>
+void BlockMatchingInitializer<PixelType,NDimensions>
+::EvaluateBlockPlane(BlockGeneratorThreadStruct *workStr, unsigned int threadId, unsigned int blockPlane,
+                     const double *blockSums)
+{
+    const unsigned int lastDimension = NDimensions - 1;
+    unsigned int planeNumberOfBlocks = 1;
+    for (unsigned int i = 0;i < lastDimension;++i)
+        planeNumberOfBlocks *= workStr->numberOfBlocksPerAxis[i];
+
+    MaskImageType *generationMask = m_GenerationMasks[workStr->maskIndex];
+    IndexType blockCenter;
+    ImageRegionType blockRegion;
     double tmpVar = 0;
 
-    for (unsigned int i = 0;i < m_ReferenceScalarImages.size();++i)
+    for (unsigned int planeBlock = 0;planeBlock < planeNumberOfBlocks;++planeBlock)
     {
-        if (!this->CheckScalarVariance(m_ReferenceScalarImages[i],region,tmpVar))
-            return false;
+        unsigned int latticeIndex = blockPlane * planeNumberOfBlocks + planeBlock;
+        workStr->totalNumberOfBlocks[threadId]++;
 
-        if (tmpVar > blockVariance)
-            blockVariance = tmpVar;
-    }
+        this->ComputeBlockRegion(workStr,latticeIndex,blockRegion,blockCenter);
+        if (generationMask->GetPixel(blockCenter) == 0)
+            continue;
 
-    for (unsigned int i = 0;i < m_ReferenceVectorImages.size();++i)
-    {
-        if (!this->CheckOrientedModelVariance(i,region,tmpVar,workStr,threadId))
-            return false;
+        unsigned int numBlockVoxels = blockRegion.GetNumberOfPixels();
+        if (numBlockVoxels <= 1)
+            continue;
 
-        if (tmpVar > blockVariance)
-            blockVariance = tmpVar;
-    }
+        bool blockKept = true;
+        double blockVariance = 0;
+        for (unsigned int i = 0;i < m_ReferenceScalarImages.size();++i)
+        {
+            double sum = blockSums[2 * i * planeNumberOfBlocks + planeBlock];
+            double sumSquares = blockSums[(2 * i + 1) * planeNumberOfBlocks + planeBlock];
+            tmpVar = std::max(0.0, (sumSquares - sum * sum / numBlockVoxels) / (numBlockVoxels - 1.0));
+
+            if (tmpVar <= this->GetScalarVarianceThreshold())
+            {
+                blockKept = false;
+                break;
+            }
+
+            if (tmpVar > blockVariance)
+                blockVariance = tmpVar;
+        }
+
+        for (unsigned int i = 0;(i < m_ReferenceVectorImages.size()) && blockKept;++i)
+        {
+            if (!this->CheckOrientedModelVariance(i,blockRegion,tmpVar,workStr,threadId))
+                blockKept = false;
+            else if (tmpVar > blockVariance)
+                blockVariance = tmpVar;
+        }
+
+        if (!blockKept)
+            continue;
 
-    // Reaches here if block respects criterions on all images
-    return true;
+        workStr->blocks_indexes[threadId].push_back(latticeIndex);
+        workStr->blocks_variances[threadId].push_back(blockVariance);
+    }
 }
 
 template <class PixelType, unsigned int NDimensions>
@@ -552,43 +737,4 @@ bool BlockMatchingInitializer<PixelType,NDimensions>
         return false;
 }
 
-template <class PixelType, unsigned int NDimensions>
-bool BlockMatchingInitializer<PixelType,NDimensions>
-::CheckScalarVariance(ScalarImageType *refImage, ImageRegionType &region, double &blockVariance)
-{
-    itk::ImageRegionConstIterator <ScalarImageType> refItr(refImage,region);
-    blockVariance = 0;
-    double meanVal = 0;
-
-    unsigned int nbPts = 0;
-    while (!refItr.IsAtEnd())
-    {
-        double tmpVal = refItr.Get();
-        meanVal += tmpVal;
-
-        ++nbPts;
-        ++refItr;
-    }
-
-    if (nbPts <= 1)
-        return false;
-
-    meanVal /= nbPts;
-    refItr.GoToBegin();
-    while (!refItr.IsAtEnd())
-    {
-        double tmpVal = refItr.Get();
-        blockVariance += (meanVal - tmpVal) * (meanVal - tmpVal);
-
-        ++refItr;
-    }
-
-    blockVariance /= (nbPts - 1.0);
-
-    if (blockVariance > this->GetScalarVarianceThreshold())
-        return true;
-    else
-        return false;
-}
-
 }// end of namespace anima
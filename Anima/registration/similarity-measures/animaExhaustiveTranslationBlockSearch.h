@@ -0,0 +1,79 @@
+#pragma once
+
+#include <itkImage.h>
+#include <itkOffset.h>
+#include <vector>
+
+namespace anima
+{
+
+/**
+ * @brief Exhaustive search of the integer voxel translation of a fixed block inside a moving image sharing the fixed image grid.
+ * The moving search window (block extended by the search radius) is extracted once per block with zero padding outside
+ * the moving buffer, as in anima::FastCorrelationImageToImageMetric and anima::FastMeanSquaresImageToImageMetric.
+ * Moving sums and sums of squares for all displacements are then read in constant time from integral images of the window,
+ * only the fixed x moving products being computed for each displacement, row by row on contiguous data.
+ */
+template <class TImage>
+class ExhaustiveTranslationBlockSearch
+{
+public:
+    static const unsigned int ImageDimension = TImage::ImageDimension;
+
+    typedef TImage ImageType;
+    typedef typename ImageType::RegionType RegionType;
+    typedef typename ImageType::IndexType IndexType;
+    typedef typename ImageType::SizeType SizeType;
+    typedef typename ImageType::OffsetValueType OffsetValueType;
+    typedef itk::Offset <ImageDimension> DisplacementType;
+    typedef double RealType;
+
+    enum SimilarityDefinition
+    {
+        MeanSquares = 0,
+        Correlation,
+        SquaredCorrelation
+    };
+
+    ExhaustiveTranslationBlockSearch();
+    virtual ~ExhaustiveTranslationBlockSearch() {}
+
+    void SetSimilarityType(SimilarityDefinition val) {m_SimilarityType = val;}
+
+    /** Number of steps on each side of the block, and step size in voxels: displacements are k * StepSize, k in [-NumberOfSteps, NumberOfSteps] */
+    void SetNumberOfSteps(unsigned int val) {m_NumberOfSteps = val;}
+    void SetStepSize(unsigned int val) {m_StepSize = val;}
+
+    /**
+     * Searches the best displacement of the block region. Fixed values are given in region iteration order, along
+     * with their sum and centered sum of squares. The null displacement is the initial guess, it is only replaced by
+     * strictly better ones. Returns the measure at the best displacement.
+     */
+    RealType Search(const ImageType *movingImage, const RegionType &blockRegion, const RealType *fixedValues,
+                    RealType sumFixed, RealType varFixed, DisplacementType &bestDisplacement);
+
+private:
+    void ExtractWindow(const ImageType *movingImage, const RegionType &blockRegion);
+    void ComputeIntegralImages();
+    RealType BoxSum(const std::vector <RealType> &integralImage, const OffsetValueType *start) const;
+    RealType ComputeMeasure(RealType smm, RealType sfm, RealType sm, RealType sumFixed, RealType varFixed) const;
+
+    SimilarityDefinition m_SimilarityType;
+    unsigned int m_NumberOfSteps;
+    unsigned int m_StepSize;
+
+    // Search window data, x fastest. Integral images have one more (zero) sample on each axis
+    SizeType m_BlockSize;
+    OffsetValueType m_WindowSize[ImageDimension];
+    OffsetValueType m_WindowStrides[ImageDimension];
+    OffsetValueType m_IntegralStrides[ImageDimension];
+    unsigned int m_NumberOfBlockPixels;
+
+    std::vector <RealType> m_Window;
+    std::vector <RealType> m_IntegralSum;
+    std::vector <RealType> m_IntegralSquares;
+};
+
+} // end namespace anima
+
+#include "animaExhaustiveTranslationBlockSearch.hxx"
@@ -0,0 +1,314 @@
+#pragma once
+#include "animaExhaustiveTranslationBlockSearch.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace anima
+{
+
+template <class TImage>
+ExhaustiveTranslationBlockSearch<TImage>
+::ExhaustiveTranslationBlockSearch()
+{
+    m_SimilarityType = SquaredCorrelation;
+    m_NumberOfSteps = 2;
+    m_StepSize = 1;
+    m_NumberOfBlockPixels = 0;
+
+    m_BlockSize.Fill(0);
+    for (unsigned int i = 0;i < ImageDimension;++i)
+    {
+        m_WindowSize[i] = 0;
+        m_WindowStrides[i] = 0;
+        m_IntegralStrides[i] = 0;
+    }
+}
+
+template <class TImage>
+void
+ExhaustiveTranslationBlockSearch<TImage>
+::ExtractWindow(const ImageType *movingImage, const RegionType &blockRegion)
+{
+    OffsetValueType margin = m_NumberOfSteps * m_StepSize;
+    IndexType windowStart;
+    unsigned int windowNumberOfPixels = 1;
+    for (unsigned int i = 0;i < ImageDimension;++i)
+    {
+        windowStart[i] = blockRegion.GetIndex()[i] - margin;
+        m_WindowSize[i] = m_BlockSize[i] + 2 * margin;
+        m_WindowStrides[i] = (i == 0) ? 1 : m_WindowStrides[i - 1] * m_WindowSize[i - 1];
+        windowNumberOfPixels *= m_WindowSize[i];
+    }
+
+    m_Window.resize(windowNumberOfPixels);
+
+    const typename ImageType::PixelType *movingBuffer = movingImage->GetBufferPointer();
+    const OffsetValueType *movingOffsetTable = movingImage->GetOffsetTable();
+    RegionType bufferedRegion = movingImage->GetBufferedRegion();
+    IndexType bufferStart = bufferedRegion.GetIndex();
+    SizeType bufferSize = bufferedRegion.GetSize();
+
+    OffsetValueType rowIndex[ImageDimension];
+    std::fill(rowIndex, rowIndex + ImageDimension, 0);
+
+    unsigned int numRows = windowNumberOfPixels / m_WindowSize[0];
+    unsigned int pos = 0;
+    for (unsigned int row = 0;row < numRows;++row)
+    {
+        // Row offset in the moving buffer, and check that the row is inside along dimensions other than x
+        bool rowInside = true;
+        OffsetValueType rowOffset = 0;
+        for (unsigned int i = 1;i < ImageDimension;++i)
+        {
+            OffsetValueType movingIndex = windowStart[i] + rowIndex[i] - bufferStart[i];
+            if ((movingIndex < 0) || (movingIndex >= (OffsetValueType)bufferSize[i]))
+            {
+                rowInside = false;
+                break;
+            }
+
+            rowOffset += movingIndex * movingOffsetTable[i];
+        }
+
+        for (OffsetValueType x = 0;x < m_WindowSize[0];++x,++pos)
+        {
+            OffsetValueType movingIndex = windowStart[0] + x - bufferStart[0];
+            if ((rowInside) && (movingIndex >= 0) && (movingIndex < (OffsetValueType)bufferSize[0]))
+                m_Window[pos] = movingBuffer[rowOffset + movingIndex];
+            else
+                m_Window[pos] = 0;
+        }
+
+        for (unsigned int i = 1;i < ImageDimension;++i)
+        {
+            ++rowIndex[i];
+            if (rowIndex[i] < m_WindowSize[i])
+                break;
+
+            rowIndex[i] = 0;
+        }
+    }
+}
+
+template <class TImage>
+void
+ExhaustiveTranslationBlockSearch<TImage>
+::ComputeIntegralImages()
+{
+    OffsetValueType integralSize[ImageDimension];
+    unsigned int integralNumberOfPixels = 1;
+    for (unsigned int i = 0;i < ImageDimension;++i)
+    {
+        integralSize[i] = m_WindowSize[i] + 1;
+        m_IntegralStrides[i] = (i == 0) ? 1 : m_IntegralStrides[i - 1] * integralSize[i - 1];
+        integralNumberOfPixels *= integralSize[i];
+    }
+
+    m_IntegralSum.resize(integralNumberOfPixels);
+    m_IntegralSquares.resize(integralNumberOfPixels);
+    std::fill(m_IntegralSum.begin(),m_IntegralSum.end(),0.0);
+    std::fill(m_IntegralSquares.begin(),m_IntegralSquares.end(),0.0);
+
+    // Copy window values shifted by one sample on each axis, first samples remain zero
+    OffsetValueType windowIndex[ImageDimension];
+    std::fill(windowIndex, windowIndex + ImageDimension, 0);
+    for (unsigned int pos = 0;pos < m_Window.size();++pos)
+    {
+        OffsetValueType integralOffset = 0;
+        for (unsigned int i = 0;i < ImageDimension;++i)
+            integralOffset += (windowIndex[i] + 1) * m_IntegralStrides[i];
+
+        m_IntegralSum[integralOffset] = m_Window[pos];
+        m_IntegralSquares[integralOffset] = m_Window[pos] * m_Window[pos];
+
+        for (unsigned int i = 0;i < ImageDimension;++i)
+        {
+            ++windowIndex[i];
+            if (windowIndex[i] < m_WindowSize[i])
+                break;
+
+            windowIndex[i] = 0;
+        }
+    }
+
+    // Separable cumulative sums along each axis
+    for (unsigned int axis = 0;axis < ImageDimension;++axis)
+    {
+        OffsetValueType stride = m_IntegralStrides[axis];
+        for (unsigned int pos = 0;pos < integralNumberOfPixels;++pos)
+        {
+            if ((pos / stride) % integralSize[axis] == 0)
+                continue;
+
+            m_IntegralSum[pos] += m_IntegralSum[pos - stride];
+            m_IntegralSquares[pos] += m_IntegralSquares[pos - stride];
+        }
+    }
+}
+
+template <class TImage>
+typename ExhaustiveTranslationBlockSearch<TImage>::RealType
+ExhaustiveTranslationBlockSearch<TImage>
+::BoxSum(const std::vector <RealType> &integralImage, const OffsetValueType *start) const
+{
+    const unsigned int numCorners = 1 << ImageDimension;
+    RealType sum = 0;
+    for (unsigned int corner = 0;corner < numCorners;++corner)
+    {
+        OffsetValueType integralOffset = 0;
+        unsigned int numLowerCorners = 0;
+        for (unsigned int i = 0;i < ImageDimension;++i)
+        {
+            if (corner & (1 << i))
+                integralOffset += (start[i] + m_BlockSize[i]) * m_IntegralStrides[i];
+            else
+            {
+                integralOffset += start[i] * m_IntegralStrides[i];
+                ++numLowerCorners;
+            }
+        }
+
+        if (numLowerCorners % 2 == 0)
+            sum += integralImage[integralOffset];
+        else
+            sum -= integralImage[integralOffset];
+    }
+
+    return sum;
+}
+
+template <class TImage>
+typename ExhaustiveTranslationBlockSearch<TImage>::RealType
+ExhaustiveTranslationBlockSearch<TImage>
+::ComputeMeasure(RealType smm, RealType sfm, RealType sm, RealType sumFixed, RealType varFixed) const
+{
+    if (m_SimilarityType == MeanSquares)
+    {
+        RealType sff = varFixed + sumFixed * sumFixed / m_NumberOfBlockPixels;
+        return std::max(0.0, smm - 2.0 * sfm + sff) / m_NumberOfBlockPixels;
+    }
+
+    // Same measure as the fast correlation metric, with a relative tolerance on the moving variance
+    // since moving sums come from differences of integral image values
+    RealType movingVariance = smm - sm * sm / m_NumberOfBlockPixels;
+    if (movingVariance <= std::numeric_limits <RealType>::epsilon() * smm)
+        return 0;
+
+    RealType covData = sfm - sumFixed * sm / m_NumberOfBlockPixels;
+    RealType multVars = varFixed * movingVariance;
+
+    if ((m_NumberOfBlockPixels <= 1) || (multVars <= 0))
+        return 0;
+
+    if (m_SimilarityType == SquaredCorrelation)
+        return covData * covData / multVars;
+
+    return std::max(0.0, covData / std::sqrt(multVars));
+}
+
+template <class TImage>
+typename ExhaustiveTranslationBlockSearch<TImage>::RealType
+ExhaustiveTranslationBlockSearch<TImage>
+::Search(const ImageType *movingImage, const RegionType &blockRegion, const RealType *fixedValues,
+         RealType sumFixed, RealType varFixed, DisplacementType &bestDisplacement)
+{
+    m_BlockSize = blockRegion.GetSize();
+    m_NumberOfBlockPixels = blockRegion.GetNumberOfPixels();
+
+    this->ExtractWindow(movingImage, blockRegion);
+    this->ComputeIntegralImages();
+
+    const unsigned int numStepsPerAxis = 2 * m_NumberOfSteps + 1;
+    unsigned int numDisplacements = 1;
+    for (unsigned int i = 0;i < ImageDimension;++i)
+        numDisplacements *= numStepsPerAxis;
+
+    const unsigned int blockRowLength = m_BlockSize[0];
+    const unsigned int numBlockRows = m_NumberOfBlockPixels / blockRowLength;
+    bool maximize = (m_SimilarityType != MeanSquares);
+
+    OffsetValueType stepIndex[ImageDimension];
+    OffsetValueType blockStart[ImageDimension];
+    OffsetValueType blockRowIndex[ImageDimension];
+    std::fill(stepIndex, stepIndex + ImageDimension, 0);
+
+    // Initial guess is the null displacement (block centered in the window)
+    bestDisplacement.Fill(0);
+    RealType bestValue = 0;
+    bool bestValueSet = false;
+
+    for (unsigned int displacement = 0;displacement < numDisplacements + 1;++displacement)
+    {
+        // First pass evaluates the null displacement, then all grid displacements
+        for (unsigned int i = 0;i < ImageDimension;++i)
+        {
+            if (displacement == 0)
+                blockStart[i] = m_NumberOfSteps * m_StepSize;
+            else
+                blockStart[i] = stepIndex[i] * m_StepSize;
+        }
+
+        RealType sm = this->BoxSum(m_IntegralSum, blockStart);
+        RealType smm = this->BoxSum(m_IntegralSquares, blockStart);
+
+        RealType sfm = 0;
+        std::fill(blockRowIndex, blockRowIndex + ImageDimension, 0);
+        unsigned int pos = 0;
+        for (unsigned int row = 0;row < numBlockRows;++row)
+        {
+            OffsetValueType windowOffset = blockStart[0];
+            for (unsigned int i = 1;i < ImageDimension;++i)
+                windowOffset += (blockStart[i] + blockRowIndex[i]) * m_WindowStrides[i];
+
+            const RealType *windowRow = m_Window.data() + windowOffset;
+            const RealType *fixedRow = fixedValues + pos;
+            RealType rowSum = 0;
+            for (unsigned int x = 0;x < blockRowLength;++x)
+                rowSum += fixedRow[x] * windowRow[x];
+
+            sfm += rowSum;
+            pos += blockRowLength;
+
+            for (unsigned int i = 1;i < ImageDimension;++i)
+            {
+                ++blockRowIndex[i];
+                if (blockRowIndex[i] < (OffsetValueType)m_BlockSize[i])
+                    break;
+
+                blockRowIndex[i] = 0;
+            }
+        }
+
+        RealType value = this->ComputeMeasure(smm, sfm, sm, sumFixed, varFixed);
+
+        if (!bestValueSet)
+        {
+            bestValue = value;
+            bestValueSet = true;
+        }
+        else if ((maximize && (value > bestValue)) || (!maximize && (value < bestValue)))
+        {
+            bestValue = value;
+            for (unsigned int i = 0;i < ImageDimension;++i)
+                bestDisplacement[i] = blockStart[i] - (OffsetValueType)(m_NumberOfSteps * m_StepSize);
+        }
+
+        if (displacement == 0)
+            continue;
+
+        for (unsigned int i = 0;i < ImageDimension;++i)
+        {
+            ++stepIndex[i];
+            if (stepIndex[i] < numStepsPerAxis)
+                break;
+
+            stepIndex[i] = 0;
+        }
+    }
+
+    return bestValue;
+}
+
+} // end namespace anima
@@ -3,6 +3,7 @@
 #include <itkImageToImageMetric.h>
 #include <itkCovariantVector.h>
 #include <itkPoint.h>
+#include <animaLinearBlockSampler.h>
 
 
 namespace anima
@@ -57,15 +58,36 @@ public:
                                MeasureType& Value, DerivativeType& Derivative) const ITK_OVERRIDE;
 
     void PreComputeFixedValues();
+
+    /**
+     * Sets fixed physical points precomputed outside of the metric for the current fixed region, in region
+     * iteration order. They are then not recomputed by PreComputeFixedValues. The buffer must remain valid
+     * while the metric is used, null to let the metric compute its own points.
+     */
+    void SetPrecomputedFixedImagePoints(const InputPointType *points) {m_PrecomputedFixedImagePoints = points;}
+
+    /**
+     * Sets fixed values, sum and centered sum of squares precomputed outside of the metric for the current fixed
+     * region (see anima::FixedBlockStatisticsCache). The fixed image is then not read by PreComputeFixedValues.
+     * Null values to let the metric compute them.
+     */
+    void SetPrecomputedFixedValues(const RealType *values, RealType sumFixed, RealType varFixed);
     itkSetMacro(SquaredCorrelation, bool);
     itkSetMacro(ScaleIntensities, bool);
 
+    /** Use batched block sampling when the transform is linear, requires a linear interpolator */
+    itkSetMacro(BatchedLinearEvaluation, bool);
+    itkGetConstMacro(BatchedLinearEvaluation, bool);
+
 protected:
     FastCorrelationImageToImageMetric();
     virtual ~FastCorrelationImageToImageMetric() {}
     void PrintSelf(std::ostream& os, itk::Indent indent) const ITK_OVERRIDE;
 
 private:
+    /** Computes the final measure from the moving sums over the block */
+    MeasureType ComputeMeasure(RealType smm, RealType sfm, RealType sm) const;
+
     FastCorrelationImageToImageMetric(const Self&); //purposely not implemented
     void operator=(const Self&); //purposely not implemented
 
@@ -74,9 +96,20 @@ private:
 
     bool m_SquaredCorrelation;
     bool m_ScaleIntensities;
+    bool m_BatchedLinearEvaluation;
 
     std::vector <InputPointType> m_FixedImagePoints;
+    const InputPointType *m_PrecomputedFixedImagePoints;
+    const InputPointType *m_FixedImagePointsData;
     std::vector <RealType> m_FixedImageValues;
+    const RealType *m_PrecomputedFixedImageValues;
+    const RealType *m_FixedImageValuesData;
+    RealType m_PrecomputedSumFixed;
+    RealType m_PrecomputedVarFixed;
+
+    typedef anima::LinearBlockSampler <TFixedImage, TMovingImage> BlockSamplerType;
+    mutable BlockSamplerType m_BlockSampler;
+    mutable std::vector <RealType> m_MovingValues;
 };
 
 } // end of namespace anima
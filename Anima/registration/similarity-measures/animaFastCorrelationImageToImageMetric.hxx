@@ -17,6 +17,13 @@ FastCorrelationImageToImageMetric<TFixedImage,TMovingImage>
     m_VarFixed = 0;
     m_SquaredCorrelation = true;
     m_ScaleIntensities = false;
+    m_BatchedLinearEvaluation = false;
+    m_PrecomputedFixedImagePoints = 0;
+    m_FixedImagePointsData = 0;
+    m_PrecomputedFixedImageValues = 0;
+    m_FixedImageValuesData = 0;
+    m_PrecomputedSumFixed = 0;
+    m_PrecomputedVarFixed = 0;
     m_FixedImagePoints.clear();
     m_FixedImageValues.clear();
 }
@@ -39,7 +46,6 @@ FastCorrelationImageToImageMetric<TFixedImage,TMovingImage>
     if ( this->m_NumberOfPixelsCounted == 0 )
         return 0;
 
-    MeasureType measure;
     this->SetTransformParameters( parameters );
 
     typedef typename itk::NumericTraits< MeasureType >::AccumulateType AccumulateType;
@@ -48,13 +54,34 @@ FastCorrelationImageToImageMetric<TFixedImage,TMovingImage>
     AccumulateType sfm = itk::NumericTraits< AccumulateType >::Zero;
     AccumulateType sm  = itk::NumericTraits< AccumulateType >::Zero;
 
+    if (m_BatchedLinearEvaluation && m_BlockSampler.UpdateMapping(this->m_Transform))
+    {
+        // Batched path: block walked linearly in moving index space, zero outside of the moving buffer
+        m_BlockSampler.SampleBlock(m_MovingValues.data());
+
+        RealType factor = 1.0;
+        if (m_ScaleIntensities)
+            factor = m_BlockSampler.GetTransformDeterminant();
+
+        for (unsigned int i = 0;i < this->m_NumberOfPixelsCounted;++i)
+        {
+            RealType movingValue = factor * m_MovingValues[i];
+
+            smm += movingValue * movingValue;
+            sfm += m_FixedImageValuesData[i] * movingValue;
+            sm += movingValue;
+        }
+
+        return this->ComputeMeasure(smm, sfm, sm);
+    }
+
     OutputPointType transformedPoint;
     ContinuousIndexType transformedIndex;
     RealType movingValue;
 
     for (unsigned int i = 0;i < this->m_NumberOfPixelsCounted;++i)
     {
-        transformedPoint = this->m_Transform->TransformPoint( m_FixedImagePoints[i] );
+        transformedPoint = this->m_Transform->TransformPoint( m_FixedImagePointsData[i] );
         this->m_Interpolator->GetInputImage()->TransformPhysicalPointToContinuousIndex(transformedPoint,transformedIndex);
 
         if( this->m_Interpolator->IsInsideBuffer( transformedIndex ) )
@@ -72,11 +99,20 @@ FastCorrelationImageToImageMetric<TFixedImage,TMovingImage>
             }
 
             smm += movingValue * movingValue;
-            sfm += m_FixedImageValues[i] * movingValue;
+            sfm += m_FixedImageValuesData[i] * movingValue;
             sm += movingValue;
         }
     }
 
+    return this->ComputeMeasure(smm, sfm, sm);
+}
+
+template <class TFixedImage, class TMovingImage>
+typename FastCorrelationImageToImageMetric<TFixedImage,TMovingImage>::MeasureType
+FastCorrelationImageToImageMetric<TFixedImage,TMovingImage>
+::ComputeMeasure(RealType smm, RealType sfm, RealType sm) const
+{
+    MeasureType measure;
     RealType movingVariance = smm - sm * sm / this->m_NumberOfPixelsCounted;
     if (movingVariance <= 0)
         return 0;
@@ -99,6 +135,16 @@ FastCorrelationImageToImageMetric<TFixedImage,TMovingImage>
     return measure;
 }
 
+template < class TFixedImage, class TMovingImage>
+void
+FastCorrelationImageToImageMetric<TFixedImage,TMovingImage>
+::SetPrecomputedFixedValues(const RealType *values, RealType sumFixed, RealType varFixed)
+{
+    m_PrecomputedFixedImageValues = values;
+    m_PrecomputedSumFixed = sumFixed;
+    m_PrecomputedVarFixed = varFixed;
+}
+
 template < class TFixedImage, class TMovingImage>
 void
 FastCorrelationImageToImageMetric<TFixedImage,TMovingImage>
@@ -111,41 +157,75 @@ FastCorrelationImageToImageMetric<TFixedImage,TMovingImage>
         itkExceptionMacro( << "Fixed image has not been assigned" );
     }
 
-    m_SumFixed = 0;
-    m_VarFixed = 0;
-    RealType sumSquared = 0;
+    this->m_NumberOfPixelsCounted = this->GetFixedImageRegion().GetNumberOfPixels();
 
-    typedef itk::ImageRegionConstIteratorWithIndex<FixedImageType> FixedIteratorType;
+    bool computePoints = (m_PrecomputedFixedImagePoints == 0);
+    bool computeValues = (m_PrecomputedFixedImageValues == 0);
 
-    FixedIteratorType ti( fixedImage, this->GetFixedImageRegion() );
-    typename FixedImageType::IndexType index;
+    if (computePoints)
+        m_FixedImagePoints.resize(this->m_NumberOfPixelsCounted);
 
-    this->m_NumberOfPixelsCounted = this->GetFixedImageRegion().GetNumberOfPixels();
+    if (computeValues)
+    {
+        m_FixedImageValues.resize(this->m_NumberOfPixelsCounted);
+        m_SumFixed = 0;
+        m_VarFixed = 0;
+    }
 
-    m_FixedImagePoints.resize(this->m_NumberOfPixelsCounted);
-    m_FixedImageValues.resize(this->m_NumberOfPixelsCounted);
+    if (computePoints || computeValues)
+    {
+        RealType sumSquared = 0;
 
-    InputPointType inputPoint;
+        typedef itk::ImageRegionConstIteratorWithIndex<FixedImageType> FixedIteratorType;
 
-    unsigned int pos = 0;
-    RealType fixedValue;
-    while(!ti.IsAtEnd())
-    {
-        index = ti.GetIndex();
-        fixedImage->TransformIndexToPhysicalPoint( index, inputPoint );
+        FixedIteratorType ti( fixedImage, this->GetFixedImageRegion() );
+        typename FixedImageType::IndexType index;
+
+        InputPointType inputPoint;
+
+        unsigned int pos = 0;
+        RealType fixedValue;
+        while(!ti.IsAtEnd())
+        {
+            if (computePoints)
+            {
+                index = ti.GetIndex();
+                fixedImage->TransformIndexToPhysicalPoint( index, inputPoint );
+                m_FixedImagePoints[pos] = inputPoint;
+            }
+
+            if (computeValues)
+            {
+                fixedValue = ti.Value();
+                m_FixedImageValues[pos] = fixedValue;
+
+                sumSquared += fixedValue * fixedValue;
+                m_SumFixed += fixedValue;
+            }
 
-        m_FixedImagePoints[pos] = inputPoint;
-        fixedValue = ti.Value();
-        m_FixedImageValues[pos] = fixedValue;
+            ++ti;
+            ++pos;
+        }
 
-        sumSquared += fixedValue * fixedValue;
-        m_SumFixed += fixedValue;
+        if (computeValues)
+            m_VarFixed = sumSquared - m_SumFixed * m_SumFixed / this->m_NumberOfPixelsCounted;
+    }
 
-        ++ti;
-        ++pos;
+    if (!computeValues)
+    {
+        m_SumFixed = m_PrecomputedSumFixed;
+        m_VarFixed = m_PrecomputedVarFixed;
     }
 
-    m_VarFixed = sumSquared - m_SumFixed * m_SumFixed / this->m_NumberOfPixelsCounted;
+    m_FixedImagePointsData = computePoints ? m_FixedImagePoints.data() : m_PrecomputedFixedImagePoints;
+    m_FixedImageValuesData = computeValues ? m_FixedImageValues.data() : m_PrecomputedFixedImageValues;
+
+    if (m_BatchedLinearEvaluation)
+    {
+        m_BlockSampler.SetFixedRegion(fixedImage, this->GetFixedImageRegion());
+        m_BlockSampler.SetMovingImage(this->m_MovingImage);
+        m_MovingValues.resize(this->m_NumberOfPixelsCounted);
+    }
 }
 
 /**
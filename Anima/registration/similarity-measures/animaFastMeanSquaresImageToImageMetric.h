@@ -3,6 +3,7 @@
 #include "itkImageToImageMetric.h"
 #include "itkCovariantVector.h"
 #include "itkPoint.h"
+#include <animaLinearBlockSampler.h>
 
 namespace anima
 {
@@ -57,8 +58,25 @@ public:
 
     itkSetMacro(ScaleIntensities, bool)
 
+    /** Use batched block sampling when the transform is linear, requires a linear interpolator */
+    itkSetMacro(BatchedLinearEvaluation, bool)
+    itkGetConstMacro(BatchedLinearEvaluation, bool)
+
     void PreComputeFixedValues();
 
+    /**
+     * Sets fixed physical points precomputed outside of the metric for the current fixed region, in region
+     * iteration order. They are then not recomputed by PreComputeFixedValues. The buffer must remain valid
+     * while the metric is used, null to let the metric compute its own points.
+     */
+    void SetPrecomputedFixedImagePoints(const InputPointType *points) {m_PrecomputedFixedImagePoints = points;}
+
+    /**
+     * Sets fixed values precomputed outside of the metric for the current fixed region (see anima::FixedBlockStatisticsCache).
+     * The fixed image is then not read by PreComputeFixedValues. Null to let the metric compute them.
+     */
+    void SetPrecomputedFixedValues(const RealType *values) {m_PrecomputedFixedImageValues = values;}
+
 protected:
     FastMeanSquaresImageToImageMetric();
     virtual ~FastMeanSquaresImageToImageMetric() {}
@@ -69,9 +87,18 @@ private:
     void operator=(const Self&); //purposely not implemented
 
     bool m_ScaleIntensities;
+    bool m_BatchedLinearEvaluation;
 
     std::vector <InputPointType> m_FixedImagePoints;
+    const InputPointType *m_PrecomputedFixedImagePoints;
+    const InputPointType *m_FixedImagePointsData;
     std::vector <RealType> m_FixedImageValues;
+    const RealType *m_PrecomputedFixedImageValues;
+    const RealType *m_FixedImageValuesData;
+
+    typedef anima::LinearBlockSampler <TFixedImage, TMovingImage> BlockSamplerType;
+    mutable BlockSamplerType m_BlockSampler;
+    mutable std::vector <RealType> m_MovingValues;
 };
 
 } // end namespace anima
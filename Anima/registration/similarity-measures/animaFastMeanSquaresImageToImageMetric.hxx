@@ -14,6 +14,11 @@ FastMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
 ::FastMeanSquaresImageToImageMetric()
 {
     m_ScaleIntensities = false;
+    m_BatchedLinearEvaluation = false;
+    m_PrecomputedFixedImagePoints = 0;
+    m_FixedImagePointsData = 0;
+    m_PrecomputedFixedImageValues = 0;
+    m_FixedImageValuesData = 0;
 }
 
 /**
@@ -37,13 +42,32 @@ FastMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
     MeasureType measure = 0;
     this->SetTransformParameters( parameters );
 
+    if (m_BatchedLinearEvaluation && m_BlockSampler.UpdateMapping(this->m_Transform))
+    {
+        // Batched path: block walked linearly in moving index space, zero outside of the moving buffer
+        m_BlockSampler.SampleBlock(m_MovingValues.data());
+
+        RealType factor = 1.0;
+        if (m_ScaleIntensities)
+            factor = m_BlockSampler.GetTransformDeterminant();
+
+        for (unsigned int i = 0;i < this->m_NumberOfPixelsCounted;++i)
+        {
+            RealType residual = factor * m_MovingValues[i] - m_FixedImageValuesData[i];
+            measure += residual * residual;
+        }
+
+        measure /= this->m_NumberOfPixelsCounted;
+        return measure;
+    }
+
     OutputPointType transformedPoint;
     ContinuousIndexType transformedIndex;
     RealType movingValue;
 
     for (unsigned int i = 0;i < this->m_NumberOfPixelsCounted;++i)
     {
-        transformedPoint = this->m_Transform->TransformPoint( m_FixedImagePoints[i] );
+        transformedPoint = this->m_Transform->TransformPoint( m_FixedImagePointsData[i] );
         this->m_Interpolator->GetInputImage()->TransformPhysicalPointToContinuousIndex(transformedPoint,transformedIndex);
 
         movingValue = 0;
@@ -63,7 +87,7 @@ FastMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
             }
         }
 
-        measure += (movingValue - m_FixedImageValues[i]) * (movingValue - m_FixedImageValues[i]);
+        measure += (movingValue - m_FixedImageValuesData[i]) * (movingValue - m_FixedImageValuesData[i]);
     }
 
     measure /= this->m_NumberOfPixelsCounted;
@@ -107,34 +131,54 @@ FastMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
         itkExceptionMacro( << "Fixed image has not been assigned" );
     }
 
-    typedef itk::ImageRegionConstIteratorWithIndex<FixedImageType> FixedIteratorType;
-
-    FixedIteratorType ti( fixedImage, this->GetFixedImageRegion() );
-    typename FixedImageType::IndexType index;
-
     this->m_NumberOfPixelsCounted = this->GetFixedImageRegion().GetSize()[0];
     for (unsigned int i = 1;i < TFixedImage::GetImageDimension();++i)
         this->m_NumberOfPixelsCounted *= this->GetFixedImageRegion().GetSize()[i];
 
-    m_FixedImagePoints.resize(this->m_NumberOfPixelsCounted);
-    m_FixedImageValues.resize(this->m_NumberOfPixelsCounted);
-
-    InputPointType inputPoint;
+    bool computePoints = (m_PrecomputedFixedImagePoints == 0);
+    bool computeValues = (m_PrecomputedFixedImageValues == 0);
 
-    unsigned int pos = 0;
-    RealType fixedValue;
+    if (computePoints)
+        m_FixedImagePoints.resize(this->m_NumberOfPixelsCounted);
+    if (computeValues)
+        m_FixedImageValues.resize(this->m_NumberOfPixelsCounted);
 
-    while(!ti.IsAtEnd())
+    if (computePoints || computeValues)
     {
-        index = ti.GetIndex();
-        fixedImage->TransformIndexToPhysicalPoint( index, inputPoint );
+        typedef itk::ImageRegionConstIteratorWithIndex<FixedImageType> FixedIteratorType;
+
+        FixedIteratorType ti( fixedImage, this->GetFixedImageRegion() );
+        typename FixedImageType::IndexType index;
 
-        m_FixedImagePoints[pos] = inputPoint;
-        fixedValue = ti.Value();
-        m_FixedImageValues[pos] = fixedValue;
+        InputPointType inputPoint;
 
-        ++ti;
-        ++pos;
+        unsigned int pos = 0;
+
+        while(!ti.IsAtEnd())
+        {
+            if (computePoints)
+            {
+                index = ti.GetIndex();
+                fixedImage->TransformIndexToPhysicalPoint( index, inputPoint );
+                m_FixedImagePoints[pos] = inputPoint;
+            }
+
+            if (computeValues)
+                m_FixedImageValues[pos] = ti.Value();
+
+            ++ti;
+            ++pos;
+        }
+    }
+
+    m_FixedImagePointsData = computePoints ? m_FixedImagePoints.data() : m_PrecomputedFixedImagePoints;
+    m_FixedImageValuesData = computeValues ? m_FixedImageValues.data() : m_PrecomputedFixedImageValues;
+
+    if (m_BatchedLinearEvaluation)
+    {
+        m_BlockSampler.SetFixedRegion(fixedImage, this->GetFixedImageRegion());
+        m_BlockSampler.SetMovingImage(this->m_MovingImage);
+        m_MovingValues.resize(this->m_NumberOfPixelsCounted);
     }
 }
 
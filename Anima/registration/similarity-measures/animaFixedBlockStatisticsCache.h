@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace anima
+{
+
+/**
+ * @brief Cache of fixed image block data for fast block matching metrics: block values in region iteration
+ * order, sum and centered sum of squares (as computed by PreComputeFixedValues of anima::FastCorrelationImageToImageMetric
+ * and anima::FastMeanSquaresImageToImageMetric).
+ * Values of all blocks are stored in one flat array. Blocks are computed on first use, from any thread as long as a
+ * given block is computed by only one thread. Entries remain valid until Initialize is called again, which is to be done
+ * when blocks or the reference image change.
+ */
+template <class TFixedImage>
+class FixedBlockStatisticsCache
+{
+public:
+    typedef TFixedImage FixedImageType;
+    typedef typename FixedImageType::RegionType RegionType;
+    typedef double RealType;
+
+    FixedBlockStatisticsCache() {}
+    virtual ~FixedBlockStatisticsCache() {}
+
+    /** Sets up storage for the given block regions, and invalidates all cached entries */
+    void Initialize(const std::vector <RegionType> &blockRegions);
+
+    unsigned int GetNumberOfBlocks() const {return m_BlockRegions.size();}
+
+    bool IsBlockComputed(unsigned int block) const {return m_BlockComputed[block] != 0;}
+
+    /** Computes block values and statistics from the fixed image. Thread safe for distinct blocks */
+    void ComputeBlock(const FixedImageType *fixedImage, unsigned int block);
+
+    const RealType *GetBlockValues(unsigned int block) const {return m_BlockValues.data() + m_BlockOffsets[block];}
+    RealType GetBlockSum(unsigned int block) const {return m_BlockSums[block];}
+    RealType GetBlockVariance(unsigned int block) const {return m_BlockVariances[block];}
+
+private:
+    std::vector <RegionType> m_BlockRegions;
+    std::vector <size_t> m_BlockOffsets;
+    std::vector <RealType> m_BlockValues;
+    std::vector <RealType> m_BlockSums;
+    std::vector <RealType> m_BlockVariances;
+
+    // One byte per block so that threads computing distinct blocks never write to the same location
+    std::vector <unsigned char> m_BlockComputed;
+};
+
+} // end namespace anima
+
+#include "animaFixedBlockStatisticsCache.hxx"
@@ -0,0 +1,62 @@
+#pragma once
+#include "animaFixedBlockStatisticsCache.h"
+
+#include <itkImageRegionConstIterator.h>
+#include <algorithm>
+
+namespace anima
+{
+
+template <class TFixedImage>
+void
+FixedBlockStatisticsCache<TFixedImage>
+::Initialize(const std::vector <RegionType> &blockRegions)
+{
+    m_BlockRegions = blockRegions;
+    unsigned int numBlocks = m_BlockRegions.size();
+
+    m_BlockOffsets.resize(numBlocks + 1);
+    m_BlockOffsets[0] = 0;
+    for (unsigned int i = 0;i < numBlocks;++i)
+        m_BlockOffsets[i + 1] = m_BlockOffsets[i] + m_BlockRegions[i].GetNumberOfPixels();
+
+    m_BlockValues.resize(m_BlockOffsets[numBlocks]);
+    m_BlockSums.resize(numBlocks);
+    m_BlockVariances.resize(numBlocks);
+
+    m_BlockComputed.resize(numBlocks);
+    std::fill(m_BlockComputed.begin(),m_BlockComputed.end(),0);
+}
+
+template <class TFixedImage>
+void
+FixedBlockStatisticsCache<TFixedImage>
+::ComputeBlock(const FixedImageType *fixedImage, unsigned int block)
+{
+    itk::ImageRegionConstIterator <FixedImageType> fixedItr(fixedImage, m_BlockRegions[block]);
+    RealType *blockValues = m_BlockValues.data() + m_BlockOffsets[block];
+
+    RealType sum = 0;
+    RealType sumSquared = 0;
+    unsigned int pos = 0;
+    while (!fixedItr.IsAtEnd())
+    {
+        RealType fixedValue = fixedItr.Value();
+        blockValues[pos] = fixedValue;
+
+        sum += fixedValue;
+        sumSquared += fixedValue * fixedValue;
+
+        ++fixedItr;
+        ++pos;
+    }
+
+    m_BlockSums[block] = sum;
+    m_BlockVariances[block] = 0;
+    if (pos > 0)
+        m_BlockVariances[block] = sumSquared - sum * sum / pos;
+
+    m_BlockComputed[block] = 1;
+}
+
+} // end namespace anima
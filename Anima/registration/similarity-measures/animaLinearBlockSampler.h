@@ -0,0 +1,91 @@
+#pragma once
+
+#include <itkTransform.h>
+#include <itkImageRegion.h>
+#include <vnl/vnl_matrix_fixed.h>
+#include <vnl/vnl_vector_fixed.h>
+
+namespace anima
+{
+
+/**
+ * @brief Batched trilinear sampler of a moving image over a fixed image block, for linear block transforms.
+ * For translation and matrix-offset transforms, the mapping from fixed voxel indexes to moving continuous
+ * indexes is affine. It is computed once per transform update, the block grid is then walked row by row
+ * and moving values are interpolated directly from the moving image buffer, without going through
+ * the transform and interpolator virtual calls for each voxel.
+ * Points are inside the moving buffer if their continuous index lies within half a voxel of it, as for
+ * itk::ImageFunction::IsInsideBuffer, and get a zero value otherwise. In the half voxel border bands, values
+ * are not extrapolated: along each dimension, a continuous index below the first voxel takes the first voxel
+ * value and one beyond the last voxel takes the last voxel value.
+ */
+template <class TFixedImage, class TMovingImage>
+class LinearBlockSampler
+{
+public:
+    static const unsigned int ImageDimension = TFixedImage::ImageDimension;
+
+    typedef TFixedImage FixedImageType;
+    typedef TMovingImage MovingImageType;
+    typedef typename FixedImageType::RegionType FixedRegionType;
+    typedef typename MovingImageType::PixelType MovingPixelType;
+    typedef typename MovingImageType::IndexValueType IndexValueType;
+    typedef typename MovingImageType::OffsetValueType OffsetValueType;
+
+    typedef itk::Transform <double, ImageDimension, ImageDimension> TransformType;
+    typedef vnl_matrix_fixed <double, ImageDimension, ImageDimension> MatrixType;
+    typedef vnl_vector_fixed <double, ImageDimension> VectorType;
+
+    LinearBlockSampler();
+    virtual ~LinearBlockSampler() {}
+
+    /** Returns true if the transform is one of the linear types handled by the sampler */
+    static bool IsLinearTransform(const TransformType *transform);
+
+    /** Sets the fixed image geometry and the block region to be sampled */
+    void SetFixedRegion(const FixedImageType *fixedImage, const FixedRegionType &region);
+
+    /** Sets the moving image to sample from, caches its buffer and geometry */
+    void SetMovingImage(const MovingImageType *movingImage);
+
+    /** Updates the fixed index to moving continuous index mapping, returns false if the transform is not linear */
+    bool UpdateMapping(const TransformType *transform);
+
+    /** Determinant of the linear part of the last transform given to UpdateMapping */
+    double GetTransformDeterminant() const {return m_TransformDeterminant;}
+
+    unsigned int GetNumberOfSamples() const {return m_NumberOfSamples;}
+
+    /**
+     * Fills movingValues (of size GetNumberOfSamples()) with interpolated moving values, in the same order
+     * as an itk::ImageRegionConstIteratorWithIndex on the block region. Returns the number of samples inside
+     * the moving buffer, others are set to 0.
+     */
+    template <class TRealType> unsigned int SampleBlock(TRealType *movingValues) const;
+
+private:
+    // Fixed block description
+    MatrixType m_FixedIndexToPhysical;
+    VectorType m_FixedOrigin;
+    FixedRegionType m_FixedRegion;
+    unsigned int m_NumberOfSamples;
+
+    // Moving image description
+    const MovingPixelType *m_MovingBuffer;
+    const OffsetValueType *m_MovingOffsetTable;
+    MatrixType m_MovingPhysicalToIndex;
+    VectorType m_MovingOrigin;
+    IndexValueType m_MovingStartIndex[ImageDimension];
+    IndexValueType m_MovingEndIndex[ImageDimension];
+    double m_MovingStartContinuousIndex[ImageDimension];
+    double m_MovingEndContinuousIndex[ImageDimension];
+
+    // Current affine mapping from fixed indexes to moving continuous indexes
+    MatrixType m_IndexMatrix;
+    VectorType m_IndexOffset;
+    double m_TransformDeterminant;
+};
+
+} // end namespace anima
+
+#include "animaLinearBlockSampler.hxx"
@@ -0,0 +1,235 @@
+#pragma once
+#include "animaLinearBlockSampler.h"
+
+#include <itkMatrixOffsetTransformBase.h>
+#include <itkTranslationTransform.h>
+#include <vnl/algo/vnl_determinant.h>
+
+namespace anima
+{
+
+template <class TFixedImage, class TMovingImage>
+LinearBlockSampler<TFixedImage,TMovingImage>
+::LinearBlockSampler()
+{
+    m_NumberOfSamples = 0;
+    m_MovingBuffer = 0;
+    m_MovingOffsetTable = 0;
+    m_TransformDeterminant = 1.0;
+
+    m_FixedIndexToPhysical.set_identity();
+    m_FixedOrigin.fill(0.0);
+    m_MovingPhysicalToIndex.set_identity();
+    m_MovingOrigin.fill(0.0);
+    m_IndexMatrix.set_identity();
+    m_IndexOffset.fill(0.0);
+
+    for (unsigned int i = 0;i < ImageDimension;++i)
+    {
+        m_MovingStartIndex[i] = 0;
+        m_MovingEndIndex[i] = 0;
+        m_MovingStartContinuousIndex[i] = 0;
+        m_MovingEndContinuousIndex[i] = 0;
+    }
+}
+
+template <class TFixedImage, class TMovingImage>
+bool
+LinearBlockSampler<TFixedImage,TMovingImage>
+::IsLinearTransform(const TransformType *transform)
+{
+    typedef itk::MatrixOffsetTransformBase <double, ImageDimension, ImageDimension> MatrixTransformType;
+    typedef itk::TranslationTransform <double, ImageDimension> TranslationTransformType;
+
+    if (dynamic_cast <const MatrixTransformType *> (transform))
+        return true;
+
+    if (dynamic_cast <const TranslationTransformType *> (transform))
+        return true;
+
+    return false;
+}
+
+template <class TFixedImage, class TMovingImage>
+void
+LinearBlockSampler<TFixedImage,TMovingImage>
+::SetFixedRegion(const FixedImageType *fixedImage, const FixedRegionType &region)
+{
+    m_FixedRegion = region;
+    m_NumberOfSamples = region.GetNumberOfPixels();
+
+    m_FixedIndexToPhysical = fixedImage->GetIndexToPhysicalPoint().GetVnlMatrix();
+    for (unsigned int i = 0;i < ImageDimension;++i)
+        m_FixedOrigin[i] = fixedImage->GetOrigin()[i];
+}
+
+template <class TFixedImage, class TMovingImage>
+void
+LinearBlockSampler<TFixedImage,TMovingImage>
+::SetMovingImage(const MovingImageType *movingImage)
+{
+    m_MovingBuffer = movingImage->GetBufferPointer();
+    m_MovingOffsetTable = movingImage->GetOffsetTable();
+
+    m_MovingPhysicalToIndex = movingImage->GetPhysicalPointToIndex().GetVnlMatrix();
+
+    typename MovingImageType::RegionType bufferedRegion = movingImage->GetBufferedRegion();
+    for (unsigned int i = 0;i < ImageDimension;++i)
+    {
+        m_MovingOrigin[i] = movingImage->GetOrigin()[i];
+
+        m_MovingStartIndex[i] = bufferedRegion.GetIndex()[i];
+        m_MovingEndIndex[i] = m_MovingStartIndex[i] + bufferedRegion.GetSize()[i] - 1;
+
+        // Same conventions as itk::ImageFunction::IsInsideBuffer
+        m_MovingStartContinuousIndex[i] = m_MovingStartIndex[i] - 0.5;
+        m_MovingEndContinuousIndex[i] = m_MovingEndIndex[i] + 0.5;
+    }
+}
+
+template <class TFixedImage, class TMovingImage>
+bool
+LinearBlockSampler<TFixedImage,TMovingImage>
+::UpdateMapping(const TransformType *transform)
+{
+    typedef itk::MatrixOffsetTransformBase <double, ImageDimension, ImageDimension> MatrixTransformType;
+    typedef itk::TranslationTransform <double, ImageDimension> TranslationTransformType;
+
+    MatrixType transformMatrix;
+    VectorType transformOffset;
+
+    if (const MatrixTransformType *matrixTrsf = dynamic_cast <const MatrixTransformType *> (transform))
+    {
+        transformMatrix = matrixTrsf->GetMatrix().GetVnlMatrix();
+        for (unsigned int i = 0;i < ImageDimension;++i)
+            transformOffset[i] = matrixTrsf->GetOffset()[i];
+    }
+    else if (const TranslationTransformType *translationTrsf = dynamic_cast <const TranslationTransformType *> (transform))
+    {
+        transformMatrix.set_identity();
+        for (unsigned int i = 0;i < ImageDimension;++i)
+            transformOffset[i] = translationTrsf->GetOffset()[i];
+    }
+    else
+        return false;
+
+    // Fixed index -> fixed point -> transformed point -> moving continuous index
+    m_IndexMatrix = m_MovingPhysicalToIndex * transformMatrix * m_FixedIndexToPhysical;
+    m_IndexOffset = m_MovingPhysicalToIndex * (transformMatrix * m_FixedOrigin + transformOffset - m_MovingOrigin);
+
+    m_TransformDeterminant = vnl_determinant(transformMatrix);
+
+    return true;
+}
+
+template <class TFixedImage, class TMovingImage>
+template <class TRealType>
+unsigned int
+LinearBlockSampler<TFixedImage,TMovingImage>
+::SampleBlock(TRealType *movingValues) const
+{
+    if ((m_NumberOfSamples == 0) || (m_MovingBuffer == 0))
+        return 0;
+
+    typename FixedRegionType::IndexType startIndex = m_FixedRegion.GetIndex();
+    typename FixedRegionType::SizeType regionSize = m_FixedRegion.GetSize();
+
+    const unsigned int rowLength = regionSize[0];
+    const unsigned int numRows = m_NumberOfSamples / rowLength;
+    const unsigned int numCorners = 1 << ImageDimension;
+
+    IndexValueType rowIndex[ImageDimension];
+    double rowStart[ImageDimension];
+    double rowStep[ImageDimension];
+    for (unsigned int i = 0;i < ImageDimension;++i)
+    {
+        rowIndex[i] = 0;
+        rowStep[i] = m_IndexMatrix(i,0);
+    }
+
+    double distances[ImageDimension];
+    OffsetValueType neighborSteps[ImageDimension];
+
+    unsigned int numInside = 0;
+    unsigned int pos = 0;
+    for (unsigned int row = 0;row < numRows;++row)
+    {
+        // Continuous index of the first voxel of the row, the row is then walked linearly
+        for (unsigned int i = 0;i < ImageDimension;++i)
+        {
+            rowStart[i] = m_IndexOffset[i] + m_IndexMatrix(i,0) * startIndex[0];
+            for (unsigned int j = 1;j < ImageDimension;++j)
+                rowStart[i] += m_IndexMatrix(i,j) * (startIndex[j] + rowIndex[j]);
+        }
+
+        for (unsigned int x = 0;x < rowLength;++x,++pos)
+        {
+            bool insideBuffer = true;
+            OffsetValueType baseOffset = 0;
+
+            for (unsigned int i = 0;i < ImageDimension;++i)
+            {
+                double contIndex = rowStart[i] + rowStep[i] * x;
+                if (!(contIndex >= m_MovingStartContinuousIndex[i] && contIndex <= m_MovingEndContinuousIndex[i]))
+                {
+                    insideBuffer = false;
+                    break;
+                }
+
+                IndexValueType baseIndex = static_cast <IndexValueType> (std::floor(contIndex));
+                double distance = contIndex - baseIndex;
+                // Lower half voxel border band: first voxel value, no extrapolation
+                if (baseIndex < m_MovingStartIndex[i])
+                {
+                    baseIndex = m_MovingStartIndex[i];
+                    distance = 0;
+                }
+
+                neighborSteps[i] = (baseIndex < m_MovingEndIndex[i]) ? m_MovingOffsetTable[i] : 0;
+                baseOffset += (baseIndex - m_MovingStartIndex[i]) * m_MovingOffsetTable[i];
+                distances[i] = distance;
+            }
+
+            if (!insideBuffer)
+            {
+                movingValues[pos] = 0;
+                continue;
+            }
+
+            double value = 0;
+            for (unsigned int corner = 0;corner < numCorners;++corner)
+            {
+                double weight = 1.0;
+                OffsetValueType cornerOffset = baseOffset;
+                for (unsigned int i = 0;i < ImageDimension;++i)
+                {
+                    if (corner & (1 << i))
+                    {
+                        weight *= distances[i];
+                        cornerOffset += neighborSteps[i];
+                    }
+                    else
+                        weight *= 1.0 - distances[i];
+                }
+
+                value += weight * m_MovingBuffer[cornerOffset];
+            }
+
+            movingValues[pos] = value;
+            ++numInside;
+        }
+
+        for (unsigned int j = 1;j < ImageDimension;++j)
+        {
+            ++rowIndex[j];
+            if (rowIndex[j] < (IndexValueType)regionSize[j])
+                break;
+
+            rowIndex[j] = 0;
+        }
+    }
+
+    return numInside;
+}
+
+} // end namespace anima
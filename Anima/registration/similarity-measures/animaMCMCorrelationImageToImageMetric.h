@@ -3,6 +3,8 @@
 #include <animaBaseOrientedModelImageToImageMetric.h>
 #include <animaMultiCompartmentModel.h>
 #include <animaMCMImage.h>
+#include <animaMCMBlockSoAView.h>
+#include <animaMultiTensorSmoothingCostFunction.h>
 
 namespace anima
 {
@@ -71,7 +73,11 @@ protected:
     void UpdateSphereWeights();
 
     bool CheckTensorCompatibility() const;
-    double ComputeTensorBasedMetric(const std::vector <MCModelPointer> &movingValues) const;
+
+    //! Builds fixed models and the pool of moving models used by the approximation, if not already done for the current block
+    void UpdateApproximationModels() const;
+
+    double ComputeTensorBasedMetric() const;
     double ComputeNonTensorBasedMetric(const std::vector <MCModelPointer> &movingValues) const;
 
     bool isZero(PixelType &vector) const;
@@ -81,7 +87,18 @@ private:
     void operator=(const Self&); //purposely not implemented
 
     std::vector <InputPointType> m_FixedImagePoints;
-    std::vector <MCModelPointer> m_FixedImageValues;
+    bool m_TensorCompatible;
+
+    // Tensor compatible models: fixed models are held by the smoothing cost function, moving ones in a block view
+    // filled from a single work model
+    anima::MultiTensorSmoothingCostFunction::Pointer m_TensorSmoothingCostFunction;
+    MCModelPointer m_MovingWorkModel;
+    mutable anima::MCMBlockSoAView m_MovingImageView;
+
+    // Approximation: full models are required for signal evaluation, moving models are taken from a pool allocated once
+    mutable std::vector <MCModelPointer> m_FixedImageValues;
+    mutable std::vector <MCModelPointer> m_MovingWorkModels;
+    mutable std::vector <MCModelPointer> m_MovingImageValues;
 
     // Optional parameters for the case when compartments are not tensor compatible
     std::vector <double> m_GradientStrengths;
@@ -6,7 +6,7 @@
 #include <animaMultiCompartmentModelCreator.h>
 #include <itkImageRegionConstIteratorWithIndex.h>
 
-#include <animaMultiTensorSmoothingCostFunction.h>
+#include <algorithm>
 #include <animaApproximateMCMSmoothingCostFunction.h>
 #include <animaNLOPTOptimizers.h>
 #include <animaMCMConstants.h>
@@ -20,6 +20,10 @@ MCMCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,Imag
 {
     m_FixedImagePoints.clear();
     m_FixedImageValues.clear();
+    m_TensorCompatible = true;
+
+    m_TensorSmoothingCostFunction = anima::MultiTensorSmoothingCostFunction::New();
+    m_TensorSmoothingCostFunction->SetTensorsScale(1000.0);
 
     anima::MultiCompartmentModelCreator mcmCreator;
     mcmCreator.SetNumberOfCompartments(0);
@@ -45,9 +49,6 @@ bool
 MCMCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,ImageDimension>
 ::CheckTensorCompatibility() const
 {
-    if (m_ForceApproximation)
-        return false;
-
     FixedImageType *fixedImage = const_cast <FixedImageType *> (this->GetFixedImage());
     MCModelPointer val = fixedImage->GetDescriptionModel();
     for (unsigned int i = 0;i < val->GetNumberOfCompartments();++i)
@@ -87,54 +88,51 @@ MCMCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,Imag
     OutputPointType transformedPoint;
     ContinuousIndexType transformedIndex;
 
-    MovingImageType *movingImage = const_cast <MovingImageType *> (this->GetMovingImage());
-    bool tensorCompatibilityCondition = this->CheckTensorCompatibility();
-
-    std::vector <MCModelPointer> movingValues(this->m_NumberOfPixelsCounted);
+    bool tensorCompatibilityCondition = m_TensorCompatible && !m_ForceApproximation;
+    if (!tensorCompatibilityCondition)
+        this->UpdateApproximationModels();
 
     for (unsigned int i = 0;i < this->m_NumberOfPixelsCounted;++i)
     {
         transformedPoint = this->m_Transform->TransformPoint( m_FixedImagePoints[i] );
         this->m_Interpolator->GetInputImage()->TransformPhysicalPointToContinuousIndex(transformedPoint,transformedIndex);
 
+        bool zeroMovingValue = true;
         if( this->m_Interpolator->IsInsideBuffer( transformedIndex ) )
         {
             movingValue = this->m_Interpolator->EvaluateAtContinuousIndex( transformedIndex );
+            zeroMovingValue = isZero(movingValue);
+        }
 
-            if (!isZero(movingValue))
-            {
-                MCModelPointer currentMovingValue = movingImage->GetDescriptionModel()->Clone();
-                currentMovingValue->SetModelVector(movingValue);
-
-                if (this->GetModelRotation() != Superclass::NONE)
-                    currentMovingValue->Reorient(this->m_OrientationMatrix, (this->GetModelRotation() == Superclass::PPD));
+        MCModelType *currentMovingValue = m_ZeroDiffusionModel;
+        if (!zeroMovingValue)
+        {
+            currentMovingValue = tensorCompatibilityCondition ? m_MovingWorkModel.GetPointer() : m_MovingWorkModels[i].GetPointer();
+            currentMovingValue->SetModelVector(movingValue);
 
-                movingValues[i] = currentMovingValue;
-            }
-            else
-                movingValues[i] = m_ZeroDiffusionModel;
+            if (this->GetModelRotation() != Superclass::NONE)
+                currentMovingValue->Reorient(this->m_OrientationMatrix, (this->GetModelRotation() == Superclass::PPD));
         }
+
+        if (tensorCompatibilityCondition)
+            m_MovingImageView.SetVoxel(i,currentMovingValue);
         else
-            movingValues[i] = m_ZeroDiffusionModel;
+            m_MovingImageValues[i] = currentMovingValue;
     }
 
     if (tensorCompatibilityCondition)
-        return this->ComputeTensorBasedMetric(movingValues);
+        return this->ComputeTensorBasedMetric();
 
-    return this->ComputeNonTensorBasedMetric(movingValues);
+    return this->ComputeNonTensorBasedMetric(m_MovingImageValues);
 }
 
 template < class TFixedImagePixelType, class TMovingImagePixelType, unsigned int ImageDimension >
 double
 MCMCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,ImageDimension>
-::ComputeTensorBasedMetric(const std::vector <MCModelPointer> &movingValues) const
+::ComputeTensorBasedMetric() const
 {
-    typedef anima::MultiTensorSmoothingCostFunction CostFunctionType;
-    typename CostFunctionType::Pointer smootherCostFunction = CostFunctionType::New();
-
-    smootherCostFunction->SetReferenceModels(m_FixedImageValues);
-    smootherCostFunction->SetMovingModels(movingValues);
-    smootherCostFunction->SetTensorsScale(1000.0);
+    anima::MultiTensorSmoothingCostFunction *smootherCostFunction = m_TensorSmoothingCostFunction;
+    smootherCostFunction->SetMovingModels(m_MovingImageView);
 
     typedef anima::NLOPTOptimizers OptimizerType;
     OptimizerType::ParametersType p(smootherCostFunction->GetNumberOfParameters());
@@ -360,8 +358,26 @@ MCMCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,Imag
     FixedIteratorType ti(fixedImage, this->GetFixedImageRegion());
     typename FixedImageType::IndexType index;
 
+    m_TensorCompatible = this->CheckTensorCompatibility();
+
+    MovingImageType *movingImage = const_cast <MovingImageType *> (this->GetMovingImage());
+    MCModelPointer fixedWorkModel = fixedImage->GetDescriptionModel()->Clone();
+    unsigned int maxNumCompartments = std::max(fixedWorkModel->GetNumberOfCompartments(),
+                                               movingImage->GetDescriptionModel()->GetNumberOfCompartments());
+    maxNumCompartments = std::max(maxNumCompartments, m_ZeroDiffusionModel->GetNumberOfCompartments());
+
     m_FixedImagePoints.resize(this->m_NumberOfPixelsCounted);
-    m_FixedImageValues.resize(this->m_NumberOfPixelsCounted);
+
+    // Full models for approximation are only built if needed
+    m_FixedImageValues.clear();
+
+    anima::MCMBlockSoAView fixedImageView;
+    if (m_TensorCompatible)
+    {
+        fixedImageView.Initialize(this->m_NumberOfPixelsCounted, maxNumCompartments, true);
+        m_MovingImageView.Initialize(this->m_NumberOfPixelsCounted, maxNumCompartments, true);
+        m_MovingWorkModel = movingImage->GetDescriptionModel()->Clone();
+    }
 
     InputPointType inputPoint;
 
@@ -373,6 +389,59 @@ MCMCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,Imag
         fixedImage->TransformIndexToPhysicalPoint( index, inputPoint );
 
         m_FixedImagePoints[pos] = inputPoint;
+
+        if (m_TensorCompatible)
+        {
+            fixedValue = ti.Get();
+
+            if (!isZero(fixedValue))
+            {
+                fixedWorkModel->SetModelVector(fixedValue);
+                fixedImageView.SetVoxel(pos, fixedWorkModel);
+            }
+            else
+                fixedImageView.SetVoxel(pos, m_ZeroDiffusionModel);
+        }
+
+        ++ti;
+        ++pos;
+    }
+
+    // Reference data (and its determinants) is computed once per block instead of at each metric evaluation
+    if (m_TensorCompatible)
+        m_TensorSmoothingCostFunction->SetReferenceModels(fixedImageView);
+}
+
+template < class TFixedImagePixelType, class TMovingImagePixelType, unsigned int ImageDimension >
+void
+MCMCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,ImageDimension>
+::UpdateApproximationModels() const
+{
+    MovingImageType *movingImage = const_cast <MovingImageType *> (this->GetMovingImage());
+    m_MovingImageValues.resize(this->m_NumberOfPixelsCounted);
+
+    // Pool of moving models, only re-allocated when the block size or moving model change
+    if ((m_MovingWorkModels.size() != this->m_NumberOfPixelsCounted)||
+            (m_MovingWorkModels[0]->GetSize() != movingImage->GetDescriptionModel()->GetSize()))
+    {
+        m_MovingWorkModels.resize(this->m_NumberOfPixelsCounted);
+        for (unsigned int i = 0;i < this->m_NumberOfPixelsCounted;++i)
+            m_MovingWorkModels[i] = movingImage->GetDescriptionModel()->Clone();
+    }
+
+    if (m_FixedImageValues.size() == this->m_NumberOfPixelsCounted)
+        return;
+
+    FixedImageType *fixedImage = const_cast <FixedImageType *> (this->GetFixedImage());
+    m_FixedImageValues.resize(this->m_NumberOfPixelsCounted);
+
+    typedef itk::ImageRegionConstIteratorWithIndex<FixedImageType> FixedIteratorType;
+    FixedIteratorType ti(fixedImage, this->GetFixedImageRegion());
+
+    unsigned int pos = 0;
+    PixelType fixedValue;
+    while(!ti.IsAtEnd())
+    {
         fixedValue = ti.Get();
 
         if (!isZero(fixedValue))
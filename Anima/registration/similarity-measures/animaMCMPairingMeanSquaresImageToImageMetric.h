@@ -3,6 +3,7 @@
 #include <animaBaseOrientedModelImageToImageMetric.h>
 #include <animaMultiCompartmentModel.h>
 #include <animaMCMImage.h>
+#include <animaMCMBlockSoAView.h>
 
 namespace anima
 {
@@ -61,8 +62,18 @@ protected:
     virtual ~MCMPairingMeanSquaresImageToImageMetric() {}
 
     bool CheckTensorCompatibility() const;
-    double ComputeTensorBasedMetricPart(unsigned int index, const MCModelPointer &movingValue) const;
-    double ComputeNonTensorBasedMetricPart(unsigned int index, const MCModelPointer &movingValue) const;
+
+    //! Precomputes compartment assignments explored by the pairing metric, for all compartment numbers up to maxNumCompartments
+    void ComputePairingTables(unsigned int maxNumCompartments);
+    void ComputePairingTable(unsigned int minCompartmentsNumber, unsigned int maxCompartmentsNumber, bool oneToOneMapping,
+                             std::vector <unsigned int> &assignments, std::vector <double> &factors);
+
+    /**
+     * Pairing metric between two models given as packed weights and log-tensors (six values per compartment),
+     * uses only pre-allocated work buffers
+     */
+    double ComputeTensorBasedMetricPart(unsigned int fixedNumCompartments, const double *fixedWeights, const double *fixedLogTensors,
+                                        unsigned int movingNumCompartments, const double *movingWeights, const double *movingLogTensors) const;
 
     bool isZero(PixelType &vector) const;
 
@@ -74,7 +85,25 @@ private:
     PixelType m_ZeroDiffusionVector;
 
     std::vector <InputPointType> m_FixedImagePoints;
-    std::vector <MCModelPointer> m_FixedImageValues;
+    anima::MCMBlockSoAView m_FixedImageView;
+    bool m_TensorCompatible;
+
+    //! Moving model re-used for all samples, its compartments are extracted in a one voxel view
+    MCModelPointer m_MovingWorkModel;
+    mutable anima::MCMBlockSoAView m_MovingWorkView;
+
+    std::vector <double> m_ZeroDiffusionWeights, m_ZeroDiffusionLogTensors;
+
+    // Pairing tables: for each mapping type and (minimal, maximal) compartment numbers, list of assignments of the maximal number of compartments
+    // to the minimal one, and their distance normalization factors (zero for unpaired compartments)
+    unsigned int m_PairingTablesSize;
+    std::vector < std::vector <unsigned int> > m_PairingAssignments;
+    std::vector < std::vector <double> > m_PairingFactors;
+
+    // Work buffers
+    mutable std::vector <double> m_FixedWorkWeights, m_FixedWorkLogTensors;
+    mutable std::vector <double> m_MovingWorkWeights, m_MovingWorkLogTensors;
+    mutable std::vector <double> m_WorkDistances;
 
     bool m_OneToOneMapping;
 };
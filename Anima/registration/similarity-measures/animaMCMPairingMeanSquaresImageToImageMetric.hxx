@@ -6,6 +6,7 @@
 #include <animaMultiCompartmentModelCreator.h>
 #include <itkImageRegionConstIteratorWithIndex.h>
 
+#include <algorithm>
 #include <boost/math/special_functions/factorials.hpp>
 
 namespace anima
@@ -16,7 +17,8 @@ MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTy
 ::MCMPairingMeanSquaresImageToImageMetric()
 {
     m_FixedImagePoints.clear();
-    m_FixedImageValues.clear();
+    m_TensorCompatible = true;
+    m_PairingTablesSize = 0;
 
     anima::MultiCompartmentModelCreator mcmCreator;
     mcmCreator.SetNumberOfCompartments(0);
@@ -42,7 +44,7 @@ MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTy
             return false;
      }
 
-    MovingImageType *movingImage = const_cast <MovingImageType *> (this->GetFixedImage());
+    MovingImageType *movingImage = const_cast <MovingImageType *> (this->GetMovingImage());
     val = movingImage->GetDescriptionModel();
     for (unsigned int i = 0;i < val->GetNumberOfCompartments();++i)
     {
@@ -66,6 +68,9 @@ MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTy
     if (this->m_NumberOfPixelsCounted == 0)
         return 0;
 
+    if (!m_TensorCompatible)
+        itkExceptionMacro("DDI basic metric not implemented yet");
+
     this->SetTransformParameters( parameters );
 
     PixelType movingValue;
@@ -73,50 +78,48 @@ MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTy
     OutputPointType transformedPoint;
     ContinuousIndexType transformedIndex;
 
-    MovingImageType *movingImage = const_cast <MovingImageType *> (this->GetMovingImage());
-    MCModelPointer currentMovingValue = movingImage->GetDescriptionModel()->Clone();
+    double *fixedWeights = m_FixedWorkWeights.data();
+    double *fixedLogTensors = m_FixedWorkLogTensors.data();
+    double *movingWeights = m_MovingWorkWeights.data();
+    double *movingLogTensors = m_MovingWorkLogTensors.data();
+    unsigned int zeroNumCompartments = m_ZeroDiffusionWeights.size();
 
     double measure = 0;
-    bool tensorCompatibilityCondition = this->CheckTensorCompatibility();
 
     for (unsigned int i = 0;i < this->m_NumberOfPixelsCounted;++i)
     {
+        unsigned int fixedNumCompartments = m_FixedImageView.GetVoxelLogTensors(i,fixedWeights,fixedLogTensors);
+        if (fixedNumCompartments == 0)
+            continue;
+
         transformedPoint = this->m_Transform->TransformPoint( m_FixedImagePoints[i] );
         this->m_Interpolator->GetInputImage()->TransformPhysicalPointToContinuousIndex(transformedPoint,transformedIndex);
 
+        bool zeroMovingValue = true;
         if( this->m_Interpolator->IsInsideBuffer( transformedIndex ) )
         {
             movingValue = this->m_Interpolator->EvaluateAtContinuousIndex( transformedIndex );
-
-            if (!isZero(movingValue))
-            {
-                currentMovingValue->SetModelVector(movingValue);
-
-                if (this->GetModelRotation() != Superclass::NONE)
-                    currentMovingValue->Reorient(this->m_OrientationMatrix, (this->GetModelRotation() == Superclass::PPD));
-
-                // Now compute actual measure, depends on model compartment types
-                if (tensorCompatibilityCondition)
-                    measure += this->ComputeTensorBasedMetricPart(i,currentMovingValue);
-                else
-                    measure += this->ComputeNonTensorBasedMetricPart(i,currentMovingValue);
-            }
-            else
-            {
-                if (tensorCompatibilityCondition)
-                    measure += this->ComputeTensorBasedMetricPart(i,m_ZeroDiffusionModel);
-                else
-                    measure += this->ComputeNonTensorBasedMetricPart(i,m_ZeroDiffusionModel);
-            }
+            zeroMovingValue = isZero(movingValue);
         }
-        else
+
+        if (zeroMovingValue)
         {
-            if (tensorCompatibilityCondition)
-                measure += this->ComputeTensorBasedMetricPart(i,m_ZeroDiffusionModel);
-            else
-                measure += this->ComputeNonTensorBasedMetricPart(i,m_ZeroDiffusionModel);
+            measure += this->ComputeTensorBasedMetricPart(fixedNumCompartments,fixedWeights,fixedLogTensors,
+                                                          zeroNumCompartments,m_ZeroDiffusionWeights.data(),
+                                                          m_ZeroDiffusionLogTensors.data());
+            continue;
         }
 
+        m_MovingWorkModel->SetModelVector(movingValue);
+
+        if (this->GetModelRotation() != Superclass::NONE)
+            m_MovingWorkModel->Reorient(this->m_OrientationMatrix, (this->GetModelRotation() == Superclass::PPD));
+
+        m_MovingWorkView.SetVoxel(0,m_MovingWorkModel);
+        unsigned int movingNumCompartments = m_MovingWorkView.GetVoxelLogTensors(0,movingWeights,movingLogTensors);
+
+        measure += this->ComputeTensorBasedMetricPart(fixedNumCompartments,fixedWeights,fixedLogTensors,
+                                                      movingNumCompartments,movingWeights,movingLogTensors);
     }
 
     if (measure <= 0)
@@ -129,82 +132,109 @@ MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTy
 template < class TFixedImagePixelType, class TMovingImagePixelType, unsigned int ImageDimension >
 double
 MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,ImageDimension>
-::ComputeTensorBasedMetricPart(unsigned int index, const MCModelPointer &movingValue) const
+::ComputeTensorBasedMetricPart(unsigned int fixedNumCompartments, const double *fixedWeights, const double *fixedLogTensors,
+                               unsigned int movingNumCompartments, const double *movingWeights, const double *movingLogTensors) const
 {
-    unsigned int fixedNumCompartments = m_FixedImageValues[index]->GetNumberOfCompartments();
-    unsigned int movingNumCompartments = movingValue->GetNumberOfCompartments();
-
-    typedef itk::VariableLengthVector <double> LogVectorType;
-    std::vector <LogVectorType> fixedLogVectors(fixedNumCompartments);
-    std::vector <LogVectorType> movingLogVectors(movingNumCompartments);
-    std::vector <double> fixedWeights(fixedNumCompartments);
-    std::vector <double> movingWeights(movingNumCompartments);
-    vnl_matrix <double> workLogMatrix(3,3);
+    if ((fixedNumCompartments == 0)||(movingNumCompartments == 0))
+        return 0;
 
-    unsigned int pos = 0;
+    // Weighted distances between all pairs of compartments, fixed compartment major
+    double *weightedDistances = m_WorkDistances.data();
     for (unsigned int i = 0;i < fixedNumCompartments;++i)
     {
-        if (m_FixedImageValues[index]->GetCompartmentWeight(i) == 0)
-            continue;
-
-        anima::GetTensorLogarithm(m_FixedImageValues[index]->GetCompartment(i)->GetDiffusionTensor().GetVnlMatrix().as_matrix(),
-                                  workLogMatrix);
-        anima::GetVectorRepresentation(workLogMatrix,fixedLogVectors[pos],6,true);
+        const double *fixedLogTensor = fixedLogTensors + 6 * i;
+        for (unsigned int j = 0;j < movingNumCompartments;++j)
+        {
+            const double *movingLogTensor = movingLogTensors + 6 * j;
+            double dist = 0;
+            for (unsigned int k = 0;k < 6;++k)
+                dist += (fixedLogTensor[k] - movingLogTensor[k]) * (fixedLogTensor[k] - movingLogTensor[k]);
 
-        fixedWeights[pos] = m_FixedImageValues[index]->GetCompartmentWeight(i);
-        ++pos;
+            weightedDistances[i * movingNumCompartments + j] = fixedWeights[i] * movingWeights[j] * dist;
+        }
     }
 
-    fixedNumCompartments = pos;
+    bool fixedMin = (fixedNumCompartments <= movingNumCompartments);
+    unsigned int minCompartmentsNumber = fixedMin ? fixedNumCompartments : movingNumCompartments;
+    unsigned int maxCompartmentsNumber = fixedMin ? movingNumCompartments : fixedNumCompartments;
 
-    if (fixedNumCompartments == 0)
-        return 0;
-    fixedLogVectors.resize(fixedNumCompartments);
-    fixedWeights.resize(fixedNumCompartments);
+    unsigned int tableIndex = minCompartmentsNumber * (m_PairingTablesSize + 1) + maxCompartmentsNumber;
+    if (m_OneToOneMapping)
+        tableIndex += (m_PairingTablesSize + 1) * (m_PairingTablesSize + 1);
+
+    const std::vector <unsigned int> &assignments = m_PairingAssignments[tableIndex];
+    const std::vector <double> &factors = m_PairingFactors[tableIndex];
+    unsigned int numAssignments = assignments.size() / maxCompartmentsNumber;
 
-    pos = 0;
-    for (unsigned int i = 0;i < movingNumCompartments;++i)
+    // Stride of min and max compartments in the distance matrix
+    unsigned int minStride = fixedMin ? movingNumCompartments : 1;
+    unsigned int maxStride = fixedMin ? 1 : movingNumCompartments;
+
+    double bestMetricValue = -1;
+    for (unsigned int l = 0;l < numAssignments;++l)
     {
-        if (movingValue->GetCompartmentWeight(i) == 0)
-            continue;
+        const unsigned int *assignment = assignments.data() + l * maxCompartmentsNumber;
+        const double *factor = factors.data() + l * maxCompartmentsNumber;
 
-        anima::GetTensorLogarithm(movingValue->GetCompartment(i)->GetDiffusionTensor().GetVnlMatrix().as_matrix(),
-                                  workLogMatrix);
-        anima::GetVectorRepresentation(workLogMatrix,movingLogVectors[pos],6,true);
+        double metricValue = 0;
+        for (unsigned int j = 0;j < maxCompartmentsNumber;++j)
+            metricValue += factor[j] * weightedDistances[assignment[j] * minStride + j * maxStride];
 
-        movingWeights[pos] = movingValue->GetCompartmentWeight(i);
-        ++pos;
+        if ((metricValue < bestMetricValue)||(bestMetricValue < 0))
+            bestMetricValue = metricValue;
     }
 
-    movingNumCompartments = pos;
+    return bestMetricValue;
+}
 
-    if (movingNumCompartments == 0)
-        return 0;
-    movingLogVectors.resize(movingNumCompartments);
-    movingWeights.resize(movingNumCompartments);
+template < class TFixedImagePixelType, class TMovingImagePixelType, unsigned int ImageDimension >
+void
+MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,ImageDimension>
+::ComputePairingTables(unsigned int maxNumCompartments)
+{
+    // Tables are computed for both mapping types, one to one tables stored after the others
+    unsigned int numTables = (maxNumCompartments + 1) * (maxNumCompartments + 1);
+    if ((m_PairingTablesSize == maxNumCompartments)&&(m_PairingAssignments.size() == 2 * numTables))
+        return;
 
-    double bestMetricValue = -1;
+    m_PairingTablesSize = maxNumCompartments;
+    m_PairingAssignments.resize(2 * numTables);
+    m_PairingFactors.resize(2 * numTables);
 
-    unsigned int minCompartmentsNumber = fixedNumCompartments;
-    int rest = movingNumCompartments - minCompartmentsNumber;
-    bool fixedMin = true;
-    if (rest < 0)
+    for (unsigned int oneToOneMapping = 0;oneToOneMapping < 2;++oneToOneMapping)
     {
-        fixedMin = false;
-        minCompartmentsNumber = movingNumCompartments;
-        rest *= -1;
+        for (unsigned int minCompartmentsNumber = 1;minCompartmentsNumber <= maxNumCompartments;++minCompartmentsNumber)
+        {
+            for (unsigned int maxCompartmentsNumber = minCompartmentsNumber;maxCompartmentsNumber <= maxNumCompartments;++maxCompartmentsNumber)
+            {
+                unsigned int tableIndex = oneToOneMapping * numTables + minCompartmentsNumber * (maxNumCompartments + 1) + maxCompartmentsNumber;
+                this->ComputePairingTable(minCompartmentsNumber, maxCompartmentsNumber, oneToOneMapping,
+                                          m_PairingAssignments[tableIndex], m_PairingFactors[tableIndex]);
+            }
+        }
     }
+}
 
-    unsigned int maxCompartmentsNumber = minCompartmentsNumber + rest;
+template < class TFixedImagePixelType, class TMovingImagePixelType, unsigned int ImageDimension >
+void
+MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,ImageDimension>
+::ComputePairingTable(unsigned int minCompartmentsNumber, unsigned int maxCompartmentsNumber, bool oneToOneMapping,
+                      std::vector <unsigned int> &assignments, std::vector <double> &factors)
+{
+    assignments.clear();
+    factors.clear();
+
+    unsigned int rest = maxCompartmentsNumber - minCompartmentsNumber;
     unsigned int totalNumPairingVectors = 1;
-    if (!m_OneToOneMapping)
+    if (!oneToOneMapping)
         totalNumPairingVectors = boost::math::factorial<double>(maxCompartmentsNumber-1)
                 / (boost::math::factorial<double>(minCompartmentsNumber-1)
                    * boost::math::factorial<double>(maxCompartmentsNumber - minCompartmentsNumber));
 
+    // Numbers of max compartments paired to each min compartment
     std::vector < std::vector <unsigned int> > numPairingsVectors(totalNumPairingVectors);
 
-    if (!m_OneToOneMapping)
+    if (!oneToOneMapping)
     {
         std::vector <unsigned int> initialPairingsNumber(maxCompartmentsNumber-1,0);
         std::vector <unsigned int> pairing(minCompartmentsNumber,1);
@@ -242,14 +272,11 @@ MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTy
         numPairingsVectors[0] = initialPairingsNumber;
     }
 
-    // Loop on all possible numbers of pairings
+    // All permutations of each pairing vector, unpaired compartments (one to one mapping) get a null factor
     std::vector <unsigned int> currentPermutation(maxCompartmentsNumber);
-
     for (unsigned int l = 0;l < totalNumPairingVectors;++l)
     {
-        currentPermutation.resize(maxCompartmentsNumber);
-
-        pos = 0;
+        unsigned int pos = 0;
         for (unsigned int i = 0;i < numPairingsVectors[l].size();++i)
             for (unsigned int j = 0;j < numPairingsVectors[l][i];++j)
             {
@@ -259,52 +286,23 @@ MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTy
 
         do
         {
-            double metricValue = 0;
-
             for (unsigned int j = 0;j < maxCompartmentsNumber;++j)
             {
-                unsigned int firstIndex;
-                unsigned int secondIndex;
-
-                if (fixedMin)
-                {
-                    firstIndex = currentPermutation[j];
-                    secondIndex = j;
-                }
-                else
+                if (currentPermutation[j] >= minCompartmentsNumber)
                 {
-                    firstIndex = j;
-                    secondIndex = currentPermutation[j];
-                }
-
-                if ((firstIndex >= fixedLogVectors.size())||(secondIndex >= movingLogVectors.size()))
+                    assignments.push_back(0);
+                    factors.push_back(0.0);
                     continue;
+                }
 
-                double dist = 0;
-                for (unsigned int k = 0;k < fixedLogVectors[firstIndex].GetSize();++k)
-                    dist += (fixedLogVectors[firstIndex][k] - movingLogVectors[secondIndex][k]) * (fixedLogVectors[firstIndex][k] - movingLogVectors[secondIndex][k]);
-
-                if (!m_OneToOneMapping)
-                    dist /= numPairingsVectors[l][currentPermutation[j]];
-
-                metricValue += fixedWeights[firstIndex] * movingWeights[secondIndex] * dist;
+                assignments.push_back(currentPermutation[j]);
+                if (oneToOneMapping)
+                    factors.push_back(1.0);
+                else
+                    factors.push_back(1.0 / numPairingsVectors[l][currentPermutation[j]]);
             }
-
-            if ((metricValue < bestMetricValue)||(bestMetricValue < 0))
-                bestMetricValue = metricValue;
         } while(std::next_permutation(currentPermutation.begin(),currentPermutation.end()));
     }
-
-    return bestMetricValue;
-}
-
-template < class TFixedImagePixelType, class TMovingImagePixelType, unsigned int ImageDimension >
-double
-MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,ImageDimension>
-::ComputeNonTensorBasedMetricPart(unsigned int index, const MCModelPointer &movingValue) const
-{
-    itkExceptionMacro("DDI basic metric not implemented yet");
-    return 0;
 }
 
 template < class TFixedImagePixelType, class TMovingImagePixelType, unsigned int ImageDimension >
@@ -338,8 +336,40 @@ MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTy
     FixedIteratorType ti(fixedImage, this->GetFixedImageRegion());
     typename FixedImageType::IndexType index;
 
+    m_TensorCompatible = this->CheckTensorCompatibility();
+
+    MovingImageType *movingImage = const_cast <MovingImageType *> (this->GetMovingImage());
+    MCModelPointer fixedWorkModel = fixedImage->GetDescriptionModel()->Clone();
+    m_MovingWorkModel = movingImage->GetDescriptionModel()->Clone();
+
+    unsigned int maxNumCompartments = std::max(fixedWorkModel->GetNumberOfCompartments(),
+                                               m_MovingWorkModel->GetNumberOfCompartments());
+    maxNumCompartments = std::max(maxNumCompartments, m_ZeroDiffusionModel->GetNumberOfCompartments());
+
     m_FixedImagePoints.resize(this->m_NumberOfPixelsCounted);
-    m_FixedImageValues.resize(this->m_NumberOfPixelsCounted);
+    m_FixedImageView.Initialize(this->m_NumberOfPixelsCounted, maxNumCompartments, m_TensorCompatible);
+    m_MovingWorkView.Initialize(1, maxNumCompartments, m_TensorCompatible);
+
+    m_FixedWorkWeights.resize(maxNumCompartments);
+    m_FixedWorkLogTensors.resize(6 * maxNumCompartments);
+    m_MovingWorkWeights.resize(maxNumCompartments);
+    m_MovingWorkLogTensors.resize(6 * maxNumCompartments);
+    m_WorkDistances.resize(maxNumCompartments * maxNumCompartments);
+
+    m_ZeroDiffusionWeights.resize(maxNumCompartments);
+    m_ZeroDiffusionLogTensors.resize(6 * maxNumCompartments);
+    if (m_TensorCompatible)
+    {
+        anima::MCMBlockSoAView zeroDiffusionView;
+        zeroDiffusionView.Initialize(1, maxNumCompartments, true);
+        zeroDiffusionView.SetVoxel(0, m_ZeroDiffusionModel);
+        unsigned int zeroNumCompartments = zeroDiffusionView.GetVoxelLogTensors(0, m_ZeroDiffusionWeights.data(),
+                                                                                m_ZeroDiffusionLogTensors.data());
+        m_ZeroDiffusionWeights.resize(zeroNumCompartments);
+        m_ZeroDiffusionLogTensors.resize(6 * zeroNumCompartments);
+    }
+
+    this->ComputePairingTables(maxNumCompartments);
 
     InputPointType inputPoint;
 
@@ -355,14 +385,11 @@ MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTy
 
         if (!isZero(fixedValue))
         {
-            m_FixedImageValues[pos] = fixedImage->GetDescriptionModel()->Clone();
-            m_FixedImageValues[pos]->SetModelVector(fixedValue);
+            fixedWorkModel->SetModelVector(fixedValue);
+            m_FixedImageView.SetVoxel(pos, fixedWorkModel);
         }
         else
-        {
-            m_FixedImageValues[pos] = m_ZeroDiffusionModel->Clone();
-            m_FixedImageValues[pos]->SetModelVector(m_ZeroDiffusionVector);
-        }
+            m_FixedImageView.SetVoxel(pos, m_ZeroDiffusionModel);
 
         ++ti;
         ++pos;
@@ -81,6 +81,52 @@ MultiTensorSmoothingCostFunction
     m_RecomputeConstantTerm = true;
 }
 
+void
+MultiTensorSmoothingCostFunction
+::SetReferenceModels(const anima::MCMBlockSoAView &refModels)
+{
+    this->FillModelsFromView(refModels, m_ReferenceModels, m_ReferenceModelWeights);
+    m_ReferenceNumberOfIsotropicCompartments.assign(refModels.GetNumberOfVoxels(), 0);
+
+    m_UpdatedReferenceData = true;
+    m_RecomputeConstantTerm = true;
+}
+
+void
+MultiTensorSmoothingCostFunction
+::SetMovingModels(const anima::MCMBlockSoAView &movingModels)
+{
+    this->FillModelsFromView(movingModels, m_MovingModels, m_MovingModelWeights);
+
+    m_UpdatedMovingData = true;
+    m_RecomputeConstantTerm = true;
+}
+
+void
+MultiTensorSmoothingCostFunction
+::FillModelsFromView(const anima::MCMBlockSoAView &view, std::vector < std::vector <TensorType> > &models,
+                     std::vector < std::vector <double> > &modelWeights)
+{
+    if (!view.GetStoreTensors())
+        throw itk::ExceptionObject(__FILE__, __LINE__, "Models view does not hold tensors", ITK_LOCATION);
+
+    unsigned int numModels = view.GetNumberOfVoxels();
+    unsigned int maxNumCompartments = view.GetMaximalNumberOfCompartments();
+    models.resize(numModels);
+    modelWeights.resize(numModels);
+
+    for (unsigned int i = 0;i < numModels;++i)
+    {
+        // Resizing to the maximal size first keeps storage allocated from one call to the next
+        models[i].resize(maxNumCompartments);
+        modelWeights[i].resize(maxNumCompartments);
+
+        unsigned int numCompartments = view.GetVoxelTensors(i, modelWeights[i].data(), models[i].data());
+        models[i].resize(numCompartments);
+        modelWeights[i].resize(numCompartments);
+    }
+}
+
 MultiTensorSmoothingCostFunction::MeasureType
 MultiTensorSmoothingCostFunction
 ::GetValue(const ParametersType &parameters) const
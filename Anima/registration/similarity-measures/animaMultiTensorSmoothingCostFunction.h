@@ -3,6 +3,7 @@
 #include <itkSingleValuedCostFunction.h>
 #include <AnimaMCMSimilarityExport.h>
 #include <animaMultiCompartmentModel.h>
+#include <animaMCMBlockSoAView.h>
 
 namespace anima
 {
@@ -35,6 +36,10 @@ public:
     void SetReferenceModels(const std::vector <MCMPointer> &refModels);
     void SetMovingModels(const std::vector <MCMPointer> &movingModels);
 
+    //! Sets reference and moving models from block views (storing tensors), re-using internal storage across calls
+    void SetReferenceModels(const anima::MCMBlockSoAView &refModels);
+    void SetMovingModels(const anima::MCMBlockSoAView &movingModels);
+
     itkSetMacro(TensorsScale, double)
     itkSetMacro(LowPassGaussianSigma, double)
 
@@ -57,6 +62,9 @@ protected:
     void UpdateDeterminants() const;
     void ComputeMatrixTraces(const TensorType &matrix, double &matrixTrace, double &squaredMatrixTrace) const;
 
+    void FillModelsFromView(const anima::MCMBlockSoAView &view, std::vector < std::vector <TensorType> > &models,
+                            std::vector < std::vector <double> > &modelWeights);
+
 private:
     MultiTensorSmoothingCostFunction(const Self&); //purposely not implemented
     void operator=(const Self&); //purposely not implemented
@@ -0,0 +1,230 @@
+#include <animaExhaustiveTranslationBlockSearch.h>
+
+#include <itkImage.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIterator.h>
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+typedef itk::Image <double, 3> ImageType;
+typedef anima::ExhaustiveTranslationBlockSearch <ImageType> SearchType;
+
+//! Moving value with zero padding outside of the buffered region, as in the fast metrics
+double GetPaddedValue(const ImageType *image, const ImageType::IndexType &index)
+{
+    if (!image->GetBufferedRegion().IsInside(index))
+        return 0;
+
+    return image->GetPixel(index);
+}
+
+//! Measure of a displacement computed directly from block values
+double ComputeBruteForceMeasure(const std::vector <double> &fixedValues, const std::vector <double> &movingValues,
+                                SearchType::SimilarityDefinition similarityType)
+{
+    unsigned int numPixels = fixedValues.size();
+    double fixedMean = 0, movingMean = 0;
+    for (unsigned int i = 0;i < numPixels;++i)
+    {
+        fixedMean += fixedValues[i];
+        movingMean += movingValues[i];
+    }
+
+    fixedMean /= numPixels;
+    movingMean /= numPixels;
+
+    double squaredDifferences = 0, covariance = 0, fixedVariance = 0, movingVariance = 0;
+    for (unsigned int i = 0;i < numPixels;++i)
+    {
+        double diffValue = fixedValues[i] - movingValues[i];
+        squaredDifferences += diffValue * diffValue;
+        covariance += (fixedValues[i] - fixedMean) * (movingValues[i] - movingMean);
+        fixedVariance += (fixedValues[i] - fixedMean) * (fixedValues[i] - fixedMean);
+        movingVariance += (movingValues[i] - movingMean) * (movingValues[i] - movingMean);
+    }
+
+    if (similarityType == SearchType::MeanSquares)
+        return squaredDifferences / numPixels;
+
+    if ((fixedVariance <= 0) || (movingVariance <= 0))
+        return 0;
+
+    if (similarityType == SearchType::SquaredCorrelation)
+        return covariance * covariance / (fixedVariance * movingVariance);
+
+    return std::max(0.0, covariance / std::sqrt(fixedVariance * movingVariance));
+}
+
+//! Brute force search over the same displacements, in the same order, the null displacement being the initial guess
+double BruteForceSearch(const ImageType *fixedImage, const ImageType *movingImage, const ImageType::RegionType &blockRegion,
+                        unsigned int numSteps, unsigned int stepSize, SearchType::SimilarityDefinition similarityType,
+                        SearchType::DisplacementType &bestDisplacement)
+{
+    std::vector <double> fixedValues, movingValues;
+    itk::ImageRegionConstIterator <ImageType> fixedItr(fixedImage, blockRegion);
+    while (!fixedItr.IsAtEnd())
+    {
+        fixedValues.push_back(fixedItr.Get());
+        ++fixedItr;
+    }
+
+    bool maximize = (similarityType != SearchType::MeanSquares);
+    int numStepsPerAxis = 2 * numSteps + 1;
+    int signedStepSize = stepSize;
+    int maxDisplacement = numSteps * signedStepSize;
+
+    bestDisplacement.Fill(0);
+    double bestValue = 0;
+    for (int k = -1;k < numStepsPerAxis * numStepsPerAxis * numStepsPerAxis;++k)
+    {
+        SearchType::DisplacementType displacement;
+        displacement.Fill(0);
+        if (k >= 0)
+        {
+            displacement[0] = (k % numStepsPerAxis) * signedStepSize - maxDisplacement;
+            displacement[1] = ((k / numStepsPerAxis) % numStepsPerAxis) * signedStepSize - maxDisplacement;
+            displacement[2] = (k / (numStepsPerAxis * numStepsPerAxis)) * signedStepSize - maxDisplacement;
+        }
+
+        movingValues.clear();
+        fixedItr.GoToBegin();
+        while (!fixedItr.IsAtEnd())
+        {
+            movingValues.push_back(GetPaddedValue(movingImage, fixedItr.GetIndex() + displacement));
+            ++fixedItr;
+        }
+
+        double value = ComputeBruteForceMeasure(fixedValues, movingValues, similarityType);
+        if (k < 0)
+            bestValue = value;
+        else if ((maximize && (value > bestValue)) || (!maximize && (value < bestValue)))
+        {
+            bestValue = value;
+            bestDisplacement = displacement;
+        }
+    }
+
+    return bestValue;
+}
+
+ImageType::Pointer CreateRandomImage(const ImageType::RegionType &region, std::mt19937 &generator)
+{
+    ImageType::Pointer image = ImageType::New();
+    image->SetRegions(region);
+    image->Allocate();
+
+    std::uniform_real_distribution <double> distribution(0.0, 100.0);
+    itk::ImageRegionIterator <ImageType> imageItr(image, region);
+    while (!imageItr.IsAtEnd())
+    {
+        imageItr.Set(distribution(generator));
+        ++imageItr;
+    }
+
+    return image;
+}
+
+int main()
+{
+    std::mt19937 generator(42);
+
+    // Non zero region index, blocks close to borders have search windows partly outside of the moving image
+    ImageType::RegionType imageRegion;
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        imageRegion.SetIndex(i, 2 - 3 * (int)i);
+        imageRegion.SetSize(i, 18 + 2 * i);
+    }
+
+    ImageType::Pointer fixedImage = CreateRandomImage(imageRegion, generator);
+    ImageType::Pointer movingImage = CreateRandomImage(imageRegion, generator);
+
+    // Moving image partly copies shifted fixed values, so that real matches exist
+    itk::ImageRegionIterator <ImageType> movingItr(movingImage, imageRegion);
+    while (!movingItr.IsAtEnd())
+    {
+        ImageType::IndexType fixedIndex = movingItr.GetIndex();
+        fixedIndex[0] -= 2;
+        fixedIndex[1] += 1;
+        if (imageRegion.IsInside(fixedIndex) && (movingItr.GetIndex()[2] % 2 == 0))
+            movingItr.Set(fixedImage->GetPixel(fixedIndex) + 5.0);
+
+        ++movingItr;
+    }
+
+    SearchType::SimilarityDefinition similarityTypes[3] = {SearchType::MeanSquares, SearchType::Correlation, SearchType::SquaredCorrelation};
+    unsigned int stepSizes[2] = {1, 2};
+    std::uniform_int_distribution <int> blockStartDistribution(-2, 17);
+
+    unsigned int numTests = 0;
+    unsigned int numFailures = 0;
+    double maxValueDifference = 0;
+    for (unsigned int blockNumber = 0;blockNumber < 40;++blockNumber)
+    {
+        ImageType::RegionType blockRegion;
+        for (unsigned int i = 0;i < 3;++i)
+        {
+            blockRegion.SetIndex(i, imageRegion.GetIndex()[i] + blockStartDistribution(generator));
+            blockRegion.SetSize(i, 3 + blockNumber % 3);
+        }
+
+        // Blocks are inside the fixed image
+        if (!blockRegion.Crop(imageRegion) || (blockRegion.GetNumberOfPixels() < 2))
+            continue;
+
+        std::vector <double> fixedValues;
+        double sumFixed = 0;
+        itk::ImageRegionConstIterator <ImageType> fixedItr(fixedImage, blockRegion);
+        while (!fixedItr.IsAtEnd())
+        {
+            fixedValues.push_back(fixedItr.Get());
+            sumFixed += fixedItr.Get();
+            ++fixedItr;
+        }
+
+        double varFixed = 0;
+        for (unsigned int i = 0;i < fixedValues.size();++i)
+            varFixed += (fixedValues[i] - sumFixed / fixedValues.size()) * (fixedValues[i] - sumFixed / fixedValues.size());
+
+        for (unsigned int t = 0;t < 3;++t)
+        {
+            for (unsigned int s = 0;s < 2;++s)
+            {
+                SearchType search;
+                search.SetSimilarityType(similarityTypes[t]);
+                search.SetNumberOfSteps(3);
+                search.SetStepSize(stepSizes[s]);
+
+                SearchType::DisplacementType fastDisplacement, bruteForceDisplacement;
+                double fastValue = search.Search(movingImage, blockRegion, fixedValues.data(), sumFixed, varFixed, fastDisplacement);
+                double bruteForceValue = BruteForceSearch(fixedImage, movingImage, blockRegion, 3, stepSizes[s],
+                                                          similarityTypes[t], bruteForceDisplacement);
+
+                double valueDifference = std::abs(fastValue - bruteForceValue) / std::max(1.0, std::abs(bruteForceValue));
+                maxValueDifference = std::max(maxValueDifference, valueDifference);
+                ++numTests;
+
+                if ((valueDifference > 1.0e-9) || (fastDisplacement != bruteForceDisplacement))
+                {
+                    std::cerr << "Block " << blockRegion.GetIndex() << " " << blockRegion.GetSize() << ", measure " << t
+                              << ", step " << stepSizes[s] << ": " << fastDisplacement << " (" << fastValue << ") instead of "
+                              << bruteForceDisplacement << " (" << bruteForceValue << ")" << std::endl;
+                    ++numFailures;
+                }
+            }
+        }
+    }
+
+    std::cout << numTests << " searches, maximal relative measure difference to brute force: " << maxValueDifference << std::endl;
+
+    if (numFailures != 0)
+    {
+        std::cerr << numFailures << " searches differ from brute force search" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <itkImageToImageFilter.h>
+#include <animaVelocityFieldJacobian.h>
+
+namespace anima
+{
+
+/**
+ * @brief Computes the BCH approximation of log(exp(v) o exp(u)) for two stationary velocity fields v (input 0) and u (input 1)
+ *
+ * Up to order 4: v + u + 1/2 [v,u] + 1/12 ([v,[v,u]] + [[v,u],u]) + 1/24 [[v,[v,u]],u], with the Lie bracket
+ * [a,b] = Jac(a).b - Jac(b).a as in anima::SVFLieBracketImageFilter. All terms are computed in a single pass:
+ * the output region of each thread is processed by slabs, Jacobians are computed on the fly and nested brackets
+ * are only stored on the slab extended by the necessary margin. No intermediate field is allocated.
+ * M. Bossa et al. "Contributions to 3D diffeomorphic atlas estimation : application to brain images.", MICCAI 2007, p. 667–674.
+ */
+template <typename TPixelType, unsigned int Dimension>
+class SVFBCHCompositionImageFilter :
+public itk::ImageToImageFilter< itk::Image <itk::Vector <TPixelType, Dimension>, Dimension> ,
+        itk::Image <itk::Vector <TPixelType, Dimension>, Dimension> >
+{
+public:
+    typedef SVFBCHCompositionImageFilter Self;
+    typedef typename itk::Image <itk::Vector <TPixelType, Dimension>, Dimension> InputImageType;
+    typedef typename itk::Image <itk::Vector <TPixelType, Dimension>, Dimension> OutputImageType;
+    typedef itk::ImageToImageFilter <InputImageType, OutputImageType> Superclass;
+    typedef itk::SmartPointer<Self> Pointer;
+    typedef itk::SmartPointer<const Self> ConstPointer;
+
+    itkNewMacro(Self)
+
+    itkTypeMacro(SVFBCHCompositionImageFilter, itk::ImageToImageFilter)
+
+    typedef typename InputImageType::PixelType InputPixelType;
+    typedef typename OutputImageType::PixelType OutputPixelType;
+    typedef typename InputImageType::IndexType IndexType;
+    typedef typename InputImageType::RegionType RegionType;
+
+    typedef typename Superclass::OutputImageRegionType OutputImageRegionType;
+
+    typedef anima::VelocityFieldJacobian <Dimension> JacobianComputerType;
+    typedef typename JacobianComputerType::MatrixType MatrixType;
+    typedef itk::Vector <double, Dimension> BracketVectorType;
+
+    itkSetMacro(BCHOrder, unsigned int)
+    itkGetConstMacro(BCHOrder, unsigned int)
+
+protected:
+    SVFBCHCompositionImageFilter()
+    {
+        this->SetNumberOfRequiredInputs(2);
+        m_BCHOrder = 1;
+        m_SlabThickness = 8;
+    }
+
+    virtual ~SVFBCHCompositionImageFilter() {}
+
+    void GenerateInputRequestedRegion() ITK_OVERRIDE;
+    void BeforeThreadedGenerateData() ITK_OVERRIDE;
+    void DynamicThreadedGenerateData(const OutputImageRegionType &outputRegionForThread) ITK_OVERRIDE;
+
+    //! Computes [v,b] on a region, v being the base input and b a field stored in a buffer covering secondBufferRegion
+    template <class TSecondVectorType>
+    void ComputeBracketOnRegion(const RegionType &region, const TSecondVectorType *secondBuffer,
+                                const RegionType &secondBufferRegion, std::vector <BracketVectorType> &bracketField);
+
+    static typename RegionType::OffsetValueType ComputeRegionOffset(const RegionType &region, const IndexType &index);
+
+private:
+    ITK_DISALLOW_COPY_AND_ASSIGN(SVFBCHCompositionImageFilter);
+
+    //! BCH approximation order (1 to 4)
+    unsigned int m_BCHOrder;
+
+    //! Number of planes along the last axis processed at once, brackets are stored on slabs only
+    unsigned int m_SlabThickness;
+
+    JacobianComputerType m_JacobianComputer;
+};
+
+} // end namespace anima
+
+#include "animaSVFBCHCompositionImageFilter.hxx"
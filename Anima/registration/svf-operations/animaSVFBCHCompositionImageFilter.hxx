@@ -0,0 +1,203 @@
+#pragma once
+#include "animaSVFBCHCompositionImageFilter.h"
+
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+namespace anima
+{
+
+template <typename TPixelType, unsigned int Dimension>
+void
+SVFBCHCompositionImageFilter <TPixelType, Dimension>
+::GenerateInputRequestedRegion()
+{
+    this->Superclass::GenerateInputRequestedRegion();
+
+    // Jacobians need neighbors of the output region
+    for (unsigned int i = 0;i < this->GetNumberOfIndexedInputs();++i)
+    {
+        InputImageType *input = const_cast <InputImageType *> (this->GetInput(i));
+        if (input)
+            input->SetRequestedRegionToLargestPossibleRegion();
+    }
+}
+
+template <typename TPixelType, unsigned int Dimension>
+void
+SVFBCHCompositionImageFilter <TPixelType, Dimension>
+::BeforeThreadedGenerateData()
+{
+    this->Superclass::BeforeThreadedGenerateData();
+
+    if ((m_BCHOrder < 1)||(m_BCHOrder > 4))
+        itkExceptionMacro("Invalid BCH order, not implemented yet");
+
+    if (this->GetInput(0)->GetLargestPossibleRegion() != this->GetInput(1)->GetLargestPossibleRegion())
+        itkExceptionMacro("Velocity fields should be defined on the same grid");
+
+    m_JacobianComputer.SetGeometry(this->GetInput(0));
+}
+
+template <typename TPixelType, unsigned int Dimension>
+typename SVFBCHCompositionImageFilter <TPixelType, Dimension>::RegionType::OffsetValueType
+SVFBCHCompositionImageFilter <TPixelType, Dimension>
+::ComputeRegionOffset(const RegionType &region, const IndexType &index)
+{
+    typename RegionType::OffsetValueType offset = 0;
+    typename RegionType::OffsetValueType stride = 1;
+    for (unsigned int i = 0;i < Dimension;++i)
+    {
+        offset += (index[i] - region.GetIndex()[i]) * stride;
+        stride *= region.GetSize()[i];
+    }
+
+    return offset;
+}
+
+template <typename TPixelType, unsigned int Dimension>
+template <class TSecondVectorType>
+void
+SVFBCHCompositionImageFilter <TPixelType, Dimension>
+::ComputeBracketOnRegion(const RegionType &region, const TSecondVectorType *secondBuffer,
+                         const RegionType &secondBufferRegion, std::vector <BracketVectorType> &bracketField)
+{
+    const InputImageType *baseField = this->GetInput(0);
+    const InputPixelType *baseBuffer = baseField->GetBufferPointer();
+    RegionType fieldRegion = baseField->GetBufferedRegion();
+
+    bracketField.resize(region.GetNumberOfPixels());
+
+    typedef itk::ImageRegionConstIteratorWithIndex <InputImageType> InputIteratorType;
+    InputIteratorType baseItr(baseField,region);
+
+    MatrixType firstJacobian, secondJacobian;
+    InputPixelType baseValue;
+    unsigned int pos = 0;
+    while (!baseItr.IsAtEnd())
+    {
+        IndexType index = baseItr.GetIndex();
+        baseValue = baseItr.Get();
+        const TSecondVectorType &secondValue = secondBuffer[ComputeRegionOffset(secondBufferRegion,index)];
+
+        m_JacobianComputer.Compute(baseBuffer,fieldRegion,index,firstJacobian);
+        m_JacobianComputer.Compute(secondBuffer,secondBufferRegion,index,secondJacobian);
+
+        BracketVectorType &bracketValue = bracketField[pos];
+        bracketValue.Fill(0.0);
+        JacobianComputerType::AddProduct(firstJacobian,secondValue,1.0,bracketValue);
+        JacobianComputerType::AddProduct(secondJacobian,baseValue,-1.0,bracketValue);
+
+        ++baseItr;
+        ++pos;
+    }
+}
+
+template <typename TPixelType, unsigned int Dimension>
+void
+SVFBCHCompositionImageFilter <TPixelType, Dimension>
+::DynamicThreadedGenerateData(const OutputImageRegionType &outputRegionForThread)
+{
+    typedef typename RegionType::IndexValueType IndexValueType;
+    typedef itk::ImageRegionIteratorWithIndex <OutputImageType> OutputIteratorType;
+
+    const InputImageType *baseField = this->GetInput(0);
+    const InputImageType *addonField = this->GetInput(1);
+    const InputPixelType *baseBuffer = baseField->GetBufferPointer();
+    const InputPixelType *addonBuffer = addonField->GetBufferPointer();
+    RegionType fieldRegion = baseField->GetBufferedRegion();
+
+    // Margins around a slab where brackets are needed: L = [v,u] for Jac(L) and M = [v,L] (order 4) for Jac(M)
+    unsigned int firstBracketMargin = (m_BCHOrder == 4) ? 2 : 1;
+    std::vector <BracketVectorType> firstBracket, secondBracket;
+    RegionType firstBracketRegion, secondBracketRegion;
+
+    MatrixType baseJacobian, addonJacobian, bracketJacobian;
+    BracketVectorType firstBracketValue, outputValue;
+    OutputPixelType outputPixel;
+
+    const unsigned int lastAxis = Dimension - 1;
+    IndexValueType regionEnd = outputRegionForThread.GetIndex()[lastAxis] + outputRegionForThread.GetSize()[lastAxis];
+
+    for (IndexValueType slabStart = outputRegionForThread.GetIndex()[lastAxis];slabStart < regionEnd;slabStart += m_SlabThickness)
+    {
+        OutputImageRegionType slabRegion = outputRegionForThread;
+        slabRegion.SetIndex(lastAxis,slabStart);
+        slabRegion.SetSize(lastAxis,std::min((IndexValueType)m_SlabThickness,regionEnd - slabStart));
+
+        if (m_BCHOrder >= 3)
+        {
+            firstBracketRegion = slabRegion;
+            firstBracketRegion.PadByRadius(firstBracketMargin);
+            firstBracketRegion.Crop(fieldRegion);
+            this->ComputeBracketOnRegion(firstBracketRegion,addonBuffer,fieldRegion,firstBracket);
+        }
+
+        if (m_BCHOrder == 4)
+        {
+            secondBracketRegion = slabRegion;
+            secondBracketRegion.PadByRadius(1);
+            secondBracketRegion.Crop(fieldRegion);
+            this->ComputeBracketOnRegion(secondBracketRegion,firstBracket.data(),firstBracketRegion,secondBracket);
+        }
+
+        OutputIteratorType outItr(this->GetOutput(),slabRegion);
+        while (!outItr.IsAtEnd())
+        {
+            IndexType index = outItr.GetIndex();
+            typename RegionType::OffsetValueType fieldOffset = ComputeRegionOffset(fieldRegion,index);
+            const InputPixelType &baseValue = baseBuffer[fieldOffset];
+            const InputPixelType &addonValue = addonBuffer[fieldOffset];
+
+            for (unsigned int i = 0;i < Dimension;++i)
+                outputValue[i] = baseValue[i] + addonValue[i];
+
+            if (m_BCHOrder >= 2)
+            {
+                m_JacobianComputer.Compute(baseBuffer,fieldRegion,index,baseJacobian);
+                m_JacobianComputer.Compute(addonBuffer,fieldRegion,index,addonJacobian);
+
+                if (m_BCHOrder >= 3)
+                    firstBracketValue = firstBracket[ComputeRegionOffset(firstBracketRegion,index)];
+                else
+                {
+                    firstBracketValue.Fill(0.0);
+                    JacobianComputerType::AddProduct(baseJacobian,addonValue,1.0,firstBracketValue);
+                    JacobianComputerType::AddProduct(addonJacobian,baseValue,-1.0,firstBracketValue);
+                }
+
+                for (unsigned int i = 0;i < Dimension;++i)
+                    outputValue[i] += 0.5 * firstBracketValue[i];
+            }
+
+            if (m_BCHOrder >= 3)
+            {
+                m_JacobianComputer.Compute(firstBracket.data(),firstBracketRegion,index,bracketJacobian);
+
+                // 1/12 [v,L] + 1/12 [L,u]
+                JacobianComputerType::AddProduct(baseJacobian,firstBracketValue,1.0 / 12,outputValue);
+                JacobianComputerType::AddProduct(bracketJacobian,baseValue,- 1.0 / 12,outputValue);
+                JacobianComputerType::AddProduct(bracketJacobian,addonValue,1.0 / 12,outputValue);
+                JacobianComputerType::AddProduct(addonJacobian,firstBracketValue,- 1.0 / 12,outputValue);
+            }
+
+            if (m_BCHOrder == 4)
+            {
+                // 1/24 [M,u]
+                const BracketVectorType &secondBracketValue = secondBracket[ComputeRegionOffset(secondBracketRegion,index)];
+                m_JacobianComputer.Compute(secondBracket.data(),secondBracketRegion,index,bracketJacobian);
+
+                JacobianComputerType::AddProduct(bracketJacobian,addonValue,1.0 / 24,outputValue);
+                JacobianComputerType::AddProduct(addonJacobian,secondBracketValue,- 1.0 / 24,outputValue);
+            }
+
+            for (unsigned int i = 0;i < Dimension;++i)
+                outputPixel[i] = outputValue[i];
+
+            outItr.Set(outputPixel);
+            ++outItr;
+        }
+    }
+}
+
+} // end namespace anima
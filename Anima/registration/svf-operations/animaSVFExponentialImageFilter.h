@@ -1,6 +1,8 @@
 #pragma once
 
 #include <itkImageToImageFilter.h>
+#include <animaVelocityFieldJacobian.h>
+#include <animaWorkStealingRangeScheduler.h>
 
 namespace anima
 {
@@ -14,6 +16,14 @@ namespace anima
  *
  * S. Ferraris et al. Accurate small deformation exponential approximant to integrate large velocity fields: Application to image registration. WBIR 2016
  * V. Arsigny et al. A Log-Euclidean Framework for Statistics on Diffeomorphisms. MICCAI 2006.
+ *
+ * The field Jacobian needed at order 1 is computed on the fly (see anima::VelocityFieldJacobian). If ComputeInverse
+ * is on, exp(-v) is computed directly without negating the input field beforehand.
+ *
+ * Squarings d <- d + d o (Id + d) are performed in place on the output buffer and a single scratch field (ping-pong),
+ * tile by tile with linear interpolation and nearest neighbor extrapolation as itk::ComposeDisplacementFieldsImageFilter
+ * did. With FloatSquaringStorage on, both squaring buffers are stored in single precision (interpolation is still
+ * done in double), halving the memory traffic of the squaring loop.
  */
 template <typename TPixelType, unsigned int Dimension>
 class SVFExponentialImageFilter :
@@ -23,7 +33,6 @@ public itk::ImageToImageFilter< itk::Image <itk::Vector <TPixelType, Dimension>,
 public:
     typedef SVFExponentialImageFilter Self;
     typedef typename itk::Image <itk::Vector <TPixelType, Dimension>, Dimension> InputImageType;
-    typedef typename itk::Image <itk::Vector <TPixelType, Dimension * Dimension>, Dimension> JacobianImageType;
     typedef typename itk::Image <itk::Vector <TPixelType, Dimension>, Dimension> OutputImageType;
     typedef itk::ImageToImageFilter <InputImageType, OutputImageType> Superclass;
     typedef itk::SmartPointer<Self> Pointer;
@@ -35,28 +44,54 @@ public:
 
     typedef typename InputImageType::PixelType InputPixelType;
     typedef typename OutputImageType::PixelType OutputPixelType;
-    typedef typename JacobianImageType::Pointer JacobianImagePointer;
-    typedef typename JacobianImageType::PixelType JacobianPixelType;
+    typedef typename InputImageType::IndexType IndexType;
+    typedef typename InputImageType::RegionType RegionType;
+
+    typedef anima::VelocityFieldJacobian <Dimension> JacobianComputerType;
+    typedef typename JacobianComputerType::MatrixType MatrixType;
+    typedef itk::Vector <float, Dimension> FloatVectorType;
 
     typedef typename Superclass::OutputImageRegionType OutputImageRegionType;
 
     itkSetMacro(ExponentiationOrder, unsigned int)
     itkSetMacro(MaximalDisplacementAmplitude, double)
+    itkSetMacro(ComputeInverse, bool)
+    itkSetMacro(FloatSquaringStorage, bool)
 
 protected:
     SVFExponentialImageFilter()
     {
         m_ExponentiationOrder = 0;
         m_MaximalDisplacementAmplitude = 0.25;
-        m_FieldJacobian = 0;
+        m_ComputeInverse = false;
+        m_FloatSquaringStorage = false;
+        m_TileSize = 16;
     }
 
     virtual ~SVFExponentialImageFilter() {}
 
+    void GenerateInputRequestedRegion() ITK_OVERRIDE;
     void BeforeThreadedGenerateData() ITK_OVERRIDE;
     void DynamicThreadedGenerateData(const OutputImageRegionType &outputRegionForThread) ITK_OVERRIDE;
     void AfterThreadedGenerateData() ITK_OVERRIDE;
 
+    //! Performs all squarings, alternating between the two buffers. Returns the buffer holding the result
+    template <class TStorageVectorType>
+    TStorageVectorType *PerformSquarings(TStorageVectorType *firstBuffer, TStorageVectorType *secondBuffer);
+
+    //! One squaring step on the tiles given to thread threadId by the scheduler
+    template <class TStorageVectorType>
+    void SquareFieldOnTiles(unsigned int threadId, const TStorageVectorType *inputField, TStorageVectorType *outputField);
+
+    static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ThreadSquaring(void *arg);
+
+    struct SquaringThreadStruct
+    {
+        Pointer Filter;
+        const void *InputField;
+        void *OutputField;
+    };
+
 private:
     ITK_DISALLOW_COPY_AND_ASSIGN(SVFExponentialImageFilter);
 
@@ -66,11 +101,25 @@ private:
     //! Exponentiation order (0: Arsigny et al., 1: ss_aei from Ferraris et al.)
     double m_ExponentiationOrder;
 
-    //! Jacobian field (computed only if order 1)
-    JacobianImagePointer m_FieldJacobian;
+    //! Computes exp(-v) instead of exp(v)
+    bool m_ComputeInverse;
+
+    //! Jacobian computation from the input field (used only if order 1)
+    JacobianComputerType m_JacobianComputer;
 
     //! Internal variable that holds the automatically computed number of recursive squarings
     unsigned int m_NumberOfSquarings;
+
+    //! Stores squaring buffers as float vectors
+    bool m_FloatSquaringStorage;
+
+    //! Squaring tiles: edge length in voxels, number of tiles along each axis, scheduler over tiles
+    unsigned int m_TileSize;
+    unsigned int m_NumberOfTilesPerAxis[Dimension];
+    anima::WorkStealingRangeScheduler m_TileScheduler;
+
+    //! Maps a physical displacement to a continuous index displacement: (direction * spacing)^-1
+    MatrixType m_DisplacementToIndex;
 };
 
 } // end namespace anima
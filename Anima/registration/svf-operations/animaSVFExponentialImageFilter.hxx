@@ -1,16 +1,29 @@
 #pragma once
 #include "animaSVFExponentialImageFilter.h"
 
-#include <animaJacobianMatrixImageFilter.h>
 #include <itkImageRegionConstIterator.h>
-#include <itkImageRegionIterator.h>
+#include <itkImageRegionIteratorWithIndex.h>
 
-#include <itkComposeDisplacementFieldsImageFilter.h>
-#include <itkVectorLinearInterpolateNearestNeighborExtrapolateImageFunction.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 namespace anima
 {
 
+template <typename TPixelType, unsigned int Dimension>
+void
+SVFExponentialImageFilter <TPixelType, Dimension>
+::GenerateInputRequestedRegion()
+{
+    this->Superclass::GenerateInputRequestedRegion();
+
+    // Field norm and Jacobian need the whole input
+    InputImageType *input = const_cast <InputImageType *> (this->GetInput());
+    if (input)
+        input->SetRequestedRegionToLargestPossibleRegion();
+}
+
 template <typename TPixelType, unsigned int Dimension>
 void
 SVFExponentialImageFilter <TPixelType, Dimension>
@@ -21,22 +34,7 @@ SVFExponentialImageFilter <TPixelType, Dimension>
     if ((m_ExponentiationOrder != 0)&&(m_ExponentiationOrder != 1))
         itkExceptionMacro("Exponentiation order not supported");
 
-    // Precomputes jacobian if needed
-    if (m_ExponentiationOrder > 0)
-    {
-        typedef anima::JacobianMatrixImageFilter <TPixelType, TPixelType, Dimension> JacobianFilterType;
-
-        typename JacobianFilterType::Pointer jacFilter = JacobianFilterType::New();
-        jacFilter->SetInput(this->GetInput());
-        jacFilter->SetNoIdentity(true);
-        jacFilter->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
-        jacFilter->SetNeighborhood(0);
-
-        jacFilter->Update();
-
-        m_FieldJacobian = jacFilter->GetOutput();
-        m_FieldJacobian->DisconnectPipeline();
-    }
+    m_JacobianComputer.SetGeometry(this->GetInput());
 
     // Computes field maximal norm
     typedef itk::ImageRegionConstIterator <InputImageType> IteratorType;
@@ -81,43 +79,38 @@ SVFExponentialImageFilter <TPixelType, Dimension>
 ::DynamicThreadedGenerateData(const OutputImageRegionType &outputRegionForThread)
 {
     typedef itk::ImageRegionConstIterator <InputImageType> InputIteratorType;
-    typedef itk::ImageRegionConstIterator <JacobianImageType> JacobianIteratorType;
-    typedef itk::ImageRegionIterator <OutputImageType> OutIteratorType;
+    typedef itk::ImageRegionIteratorWithIndex <OutputImageType> OutIteratorType;
 
     InputIteratorType inputItr(this->GetInput(),outputRegionForThread);
     OutIteratorType outItr(this->GetOutput(),outputRegionForThread);
 
-    JacobianIteratorType jacItr;
-    if (m_ExponentiationOrder > 0)
-        jacItr = JacobianIteratorType(m_FieldJacobian,outputRegionForThread);
+    const InputPixelType *inputBuffer = this->GetInput()->GetBufferPointer();
+    RegionType inputRegion = this->GetInput()->GetBufferedRegion();
 
     InputPixelType inputValue;
     OutputPixelType outputValue;
-    JacobianPixelType jacValue;
+    MatrixType jacValue;
 
+    // Second order term is even in v and keeps its sign when computing exp(-v)
     double scalingFactor = 1.0 / std::pow(2.0, m_NumberOfSquarings);
+    double firstOrderFactor = m_ComputeInverse ? - scalingFactor : scalingFactor;
+    double secondOrderFactor = 0.5 * scalingFactor * scalingFactor;
     while (!outItr.IsAtEnd())
     {
         inputValue = inputItr.Get();
         for (unsigned int i = 0;i < Dimension;++i)
-            outputValue[i] = scalingFactor * inputValue[i];
+            outputValue[i] = firstOrderFactor * inputValue[i];
 
         if (m_ExponentiationOrder > 0)
         {
-            jacValue = jacItr.Get();
-            for (unsigned int i = 0;i < Dimension;++i)
-            {
-                for (unsigned int j = 0;j < Dimension;++j)
-                    outputValue[i] += 0.5 * scalingFactor * scalingFactor * jacValue[i * Dimension + j] * inputValue[j];
-            }
+            m_JacobianComputer.Compute(inputBuffer,inputRegion,outItr.GetIndex(),jacValue);
+            JacobianComputerType::AddProduct(jacValue,inputValue,secondOrderFactor,outputValue);
         }
 
         outItr.Set(outputValue);
 
         ++inputItr;
         ++outItr;
-        if (m_ExponentiationOrder > 0)
-            ++jacItr;
     }
 }
 
@@ -128,30 +121,225 @@ SVFExponentialImageFilter <TPixelType, Dimension>
 {
     this->Superclass::AfterThreadedGenerateData();
 
-    // Compute recursive squaring of the output
-    typedef itk::ComposeDisplacementFieldsImageFilter <OutputImageType,OutputImageType> ComposeFilterType;
-    typedef itk::VectorLinearInterpolateNearestNeighborExtrapolateImageFunction <OutputImageType,
-            typename OutputImageType::PixelType::ValueType> VectorInterpolateFunctionType;
+    if (m_NumberOfSquarings == 0)
+        return;
+
+    OutputImageType *output = this->GetOutput();
+    RegionType fieldRegion = output->GetLargestPossibleRegion();
+
+    typename OutputImageType::SpacingType spacing = output->GetSpacing();
+    MatrixType indexToPhysical;
+    for (unsigned int i = 0;i < Dimension;++i)
+    {
+        for (unsigned int j = 0;j < Dimension;++j)
+            indexToPhysical(i,j) = output->GetDirection()(i,j) * spacing[j];
+    }
+
+    m_DisplacementToIndex = indexToPhysical.GetInverse();
+
+    for (unsigned int i = 0;i < Dimension;++i)
+        m_NumberOfTilesPerAxis[i] = (fieldRegion.GetSize()[i] + m_TileSize - 1) / m_TileSize;
+
+    unsigned int numPixels = fieldRegion.GetNumberOfPixels();
+    OutputPixelType *outputBuffer = output->GetBufferPointer();
+
+    if (m_FloatSquaringStorage)
+    {
+        std::vector <FloatVectorType> firstBuffer(numPixels), secondBuffer(numPixels);
+        for (unsigned int i = 0;i < numPixels;++i)
+        {
+            for (unsigned int j = 0;j < Dimension;++j)
+                firstBuffer[i][j] = outputBuffer[i][j];
+        }
+
+        FloatVectorType *resultBuffer = this->PerformSquarings(firstBuffer.data(),secondBuffer.data());
+
+        for (unsigned int i = 0;i < numPixels;++i)
+        {
+            for (unsigned int j = 0;j < Dimension;++j)
+                outputBuffer[i][j] = resultBuffer[i][j];
+        }
+    }
+    else
+    {
+        // Output buffer is one of the ping-pong buffers, copy back only if the result ends in the scratch one
+        std::vector <OutputPixelType> scratchBuffer(numPixels);
+        OutputPixelType *resultBuffer = this->PerformSquarings(outputBuffer,scratchBuffer.data());
+
+        if (resultBuffer != outputBuffer)
+            std::copy(resultBuffer,resultBuffer + numPixels,outputBuffer);
+    }
+}
+
+template <typename TPixelType, unsigned int Dimension>
+template <class TStorageVectorType>
+TStorageVectorType *
+SVFExponentialImageFilter <TPixelType, Dimension>
+::PerformSquarings(TStorageVectorType *firstBuffer, TStorageVectorType *secondBuffer)
+{
+    unsigned int numTiles = 1;
+    for (unsigned int i = 0;i < Dimension;++i)
+        numTiles *= m_NumberOfTilesPerAxis[i];
 
-    typename OutputImageType::Pointer outputPtr = this->GetOutput();
+    SquaringThreadStruct str;
+    str.Filter = this;
 
+    TStorageVectorType *inputBuffer = firstBuffer;
+    TStorageVectorType *outputBuffer = secondBuffer;
     for (unsigned int i = 0;i < m_NumberOfSquarings;++i)
     {
-        typename ComposeFilterType::Pointer composer = ComposeFilterType::New();
-        composer->SetWarpingField(outputPtr);
-        composer->SetDisplacementField(outputPtr);
-        composer->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+        str.InputField = inputBuffer;
+        str.OutputField = outputBuffer;
 
-        typename VectorInterpolateFunctionType::Pointer interpolator = VectorInterpolateFunctionType::New();
+        m_TileScheduler.Initialize(numTiles,this->GetNumberOfWorkUnits());
 
-        composer->SetInterpolator(interpolator);
-        composer->Update();
-        outputPtr = composer->GetOutput();
-        outputPtr->DisconnectPipeline();
+        this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+        this->GetMultiThreader()->SetSingleMethod(this->ThreadSquaring,&str);
+        this->GetMultiThreader()->SingleMethodExecute();
+
+        std::swap(inputBuffer,outputBuffer);
     }
 
-    if (m_NumberOfSquarings > 0)
-        this->GraftOutput(outputPtr);
+    return inputBuffer;
+}
+
+template <typename TPixelType, unsigned int Dimension>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+SVFExponentialImageFilter <TPixelType, Dimension>
+::ThreadSquaring(void *arg)
+{
+    itk::MultiThreaderBase::WorkUnitInfo *threadArgs = (itk::MultiThreaderBase::WorkUnitInfo *)arg;
+    SquaringThreadStruct *str = (SquaringThreadStruct *)(threadArgs->UserData);
+
+    if (str->Filter->m_FloatSquaringStorage)
+        str->Filter->SquareFieldOnTiles(threadArgs->WorkUnitID,(const FloatVectorType *)str->InputField,
+                                        (FloatVectorType *)str->OutputField);
+    else
+        str->Filter->SquareFieldOnTiles(threadArgs->WorkUnitID,(const OutputPixelType *)str->InputField,
+                                        (OutputPixelType *)str->OutputField);
+
+    return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+template <typename TPixelType, unsigned int Dimension>
+template <class TStorageVectorType>
+void
+SVFExponentialImageFilter <TPixelType, Dimension>
+::SquareFieldOnTiles(unsigned int threadId, const TStorageVectorType *inputField, TStorageVectorType *outputField)
+{
+    typedef typename RegionType::OffsetValueType OffsetValueType;
+
+    RegionType fieldRegion = this->GetOutput()->GetLargestPossibleRegion();
+    OffsetValueType fieldSize[Dimension];
+    OffsetValueType strides[Dimension];
+    OffsetValueType stride = 1;
+    for (unsigned int i = 0;i < Dimension;++i)
+    {
+        fieldSize[i] = fieldRegion.GetSize()[i];
+        strides[i] = stride;
+        stride *= fieldSize[i];
+    }
+
+    const unsigned int numCorners = 1 << Dimension;
+    OffsetValueType tileStart[Dimension], tileEnd[Dimension], index[Dimension];
+    OffsetValueType baseIndex[Dimension], nextStep[Dimension];
+    double fraction[Dimension];
+    double displacement[Dimension], interpolatedValue[Dimension];
+
+    unsigned int startTile, endTile;
+    while (m_TileScheduler.GetNextChunk(threadId,startTile,endTile))
+    {
+        for (unsigned int tile = startTile;tile < endTile;++tile)
+        {
+            unsigned int tilePosition = tile;
+            unsigned int numTilePixels = 1;
+            for (unsigned int i = 0;i < Dimension;++i)
+            {
+                tileStart[i] = (tilePosition % m_NumberOfTilesPerAxis[i]) * m_TileSize;
+                tileEnd[i] = std::min(tileStart[i] + (OffsetValueType)m_TileSize,fieldSize[i]);
+                tilePosition /= m_NumberOfTilesPerAxis[i];
+
+                index[i] = tileStart[i];
+                numTilePixels *= tileEnd[i] - tileStart[i];
+            }
+
+            for (unsigned int pos = 0;pos < numTilePixels;++pos)
+            {
+                OffsetValueType offset = 0;
+                for (unsigned int i = 0;i < Dimension;++i)
+                    offset += index[i] * strides[i];
+
+                const TStorageVectorType &centerValue = inputField[offset];
+                for (unsigned int i = 0;i < Dimension;++i)
+                    displacement[i] = centerValue[i];
+
+                // Continuous index of the warped point. As in itk::ComposeDisplacementFieldsImageFilter, points outside
+                // the buffer (extended by half a voxel) add nothing, others are clamped (nearest neighbor extrapolation)
+                bool insideBuffer = true;
+                for (unsigned int i = 0;i < Dimension;++i)
+                {
+                    double continuousIndex = index[i];
+                    for (unsigned int j = 0;j < Dimension;++j)
+                        continuousIndex += m_DisplacementToIndex(i,j) * displacement[j];
+
+                    if ((continuousIndex < -0.5)||(continuousIndex > fieldSize[i] - 0.5))
+                    {
+                        insideBuffer = false;
+                        break;
+                    }
+
+                    continuousIndex = std::max(0.0,std::min(continuousIndex,(double)(fieldSize[i] - 1)));
+                    baseIndex[i] = static_cast <OffsetValueType> (std::floor(continuousIndex));
+                    fraction[i] = continuousIndex - baseIndex[i];
+                    nextStep[i] = (baseIndex[i] < fieldSize[i] - 1) ? strides[i] : 0;
+                }
+
+                OffsetValueType baseOffset = 0;
+                for (unsigned int i = 0;i < Dimension;++i)
+                {
+                    interpolatedValue[i] = 0;
+                    if (insideBuffer)
+                        baseOffset += baseIndex[i] * strides[i];
+                }
+
+                for (unsigned int corner = 0;(corner < numCorners)&&(insideBuffer);++corner)
+                {
+                    double weight = 1.0;
+                    OffsetValueType cornerOffset = baseOffset;
+                    for (unsigned int i = 0;i < Dimension;++i)
+                    {
+                        if (corner & (1 << i))
+                        {
+                            weight *= fraction[i];
+                            cornerOffset += nextStep[i];
+                        }
+                        else
+                            weight *= 1.0 - fraction[i];
+                    }
+
+                    if (weight == 0)
+                        continue;
+
+                    const TStorageVectorType &cornerValue = inputField[cornerOffset];
+                    for (unsigned int i = 0;i < Dimension;++i)
+                        interpolatedValue[i] += weight * cornerValue[i];
+                }
+
+                TStorageVectorType &outputValue = outputField[offset];
+                for (unsigned int i = 0;i < Dimension;++i)
+                    outputValue[i] = displacement[i] + interpolatedValue[i];
+
+                for (unsigned int i = 0;i < Dimension;++i)
+                {
+                    ++index[i];
+                    if (index[i] < tileEnd[i])
+                        break;
+
+                    index[i] = tileStart[i];
+                }
+            }
+        }
+    }
 }
 
 } // end namespace anima
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <itkImageBase.h>
+#include <itkMatrix.h>
+
+namespace anima
+{
+
+/**
+ * @brief Jacobian matrix of a vector field computed on the fly from central differences, borders being replicated.
+ *
+ * Gives the same matrices as anima::JacobianMatrixImageFilter with 6-connectivity and no identity, without storing a
+ * Jacobian field. Values are read from any buffer laid out as an image region (x fastest), e.g. a whole field or a tile of it.
+ */
+template <unsigned int Dimension>
+class VelocityFieldJacobian
+{
+public:
+    typedef itk::ImageBase <Dimension> ImageBaseType;
+    typedef typename ImageBaseType::RegionType RegionType;
+    typedef typename ImageBaseType::IndexType IndexType;
+    typedef typename ImageBaseType::OffsetValueType OffsetValueType;
+    typedef itk::Matrix <double, Dimension, Dimension> MatrixType;
+
+    VelocityFieldJacobian();
+    ~VelocityFieldJacobian() {}
+
+    //! Takes spacing and direction from the field geometry
+    void SetGeometry(const ImageBaseType *field);
+
+    //! Jacobian at index of the field stored in buffer, buffer covering bufferRegion which contains index
+    template <class TVectorType>
+    void Compute(const TVectorType *buffer, const RegionType &bufferRegion, const IndexType &index, MatrixType &jacobian) const;
+
+    //! Adds factor * jacobian * vector to output
+    template <class TInputVectorType, class TOutputVectorType>
+    static void AddProduct(const MatrixType &jacobian, const TInputVectorType &vector, double factor, TOutputVectorType &output);
+
+private:
+    //! Maps index differences along each axis to physical derivatives: m_GradientMatrix(a,j) = direction(j,a) / (2 spacing[a])
+    MatrixType m_GradientMatrix;
+};
+
+} // end namespace anima
+
+#include "animaVelocityFieldJacobian.hxx"
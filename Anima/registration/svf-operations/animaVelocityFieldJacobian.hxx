@@ -0,0 +1,78 @@
+#pragma once
+#include "animaVelocityFieldJacobian.h"
+
+namespace anima
+{
+
+template <unsigned int Dimension>
+VelocityFieldJacobian <Dimension>
+::VelocityFieldJacobian()
+{
+    m_GradientMatrix.SetIdentity();
+    m_GradientMatrix *= 0.5;
+}
+
+template <unsigned int Dimension>
+void
+VelocityFieldJacobian <Dimension>
+::SetGeometry(const ImageBaseType *field)
+{
+    for (unsigned int a = 0;a < Dimension;++a)
+    {
+        for (unsigned int j = 0;j < Dimension;++j)
+            m_GradientMatrix(a,j) = field->GetDirection()(j,a) / (2.0 * field->GetSpacing()[a]);
+    }
+}
+
+template <unsigned int Dimension>
+template <class TVectorType>
+void
+VelocityFieldJacobian <Dimension>
+::Compute(const TVectorType *buffer, const RegionType &bufferRegion, const IndexType &index, MatrixType &jacobian) const
+{
+    OffsetValueType strides[Dimension];
+    OffsetValueType centerOffset = 0;
+    OffsetValueType stride = 1;
+    for (unsigned int a = 0;a < Dimension;++a)
+    {
+        strides[a] = stride;
+        centerOffset += (index[a] - bufferRegion.GetIndex()[a]) * stride;
+        stride *= bufferRegion.GetSize()[a];
+    }
+
+    jacobian.Fill(0.0);
+    for (unsigned int a = 0;a < Dimension;++a)
+    {
+        // One sided differences (still divided by twice the spacing) on borders, as with replicated values
+        OffsetValueType beforeStep = (index[a] > bufferRegion.GetIndex()[a]) ? strides[a] : 0;
+        OffsetValueType afterStep = (index[a] < (OffsetValueType)(bufferRegion.GetIndex()[a] + bufferRegion.GetSize()[a] - 1)) ? strides[a] : 0;
+
+        const TVectorType &beforeValue = buffer[centerOffset - beforeStep];
+        const TVectorType &afterValue = buffer[centerOffset + afterStep];
+
+        for (unsigned int i = 0;i < Dimension;++i)
+        {
+            double diffValue = afterValue[i] - beforeValue[i];
+            for (unsigned int j = 0;j < Dimension;++j)
+                jacobian(i,j) += diffValue * m_GradientMatrix(a,j);
+        }
+    }
+}
+
+template <unsigned int Dimension>
+template <class TInputVectorType, class TOutputVectorType>
+void
+VelocityFieldJacobian <Dimension>
+::AddProduct(const MatrixType &jacobian, const TInputVectorType &vector, double factor, TOutputVectorType &output)
+{
+    for (unsigned int i = 0;i < Dimension;++i)
+    {
+        double productValue = 0;
+        for (unsigned int j = 0;j < Dimension;++j)
+            productValue += jacobian(i,j) * vector[j];
+
+        output[i] += factor * productValue;
+    }
+}
+
+} // end namespace anima
@@ -1,12 +1,11 @@
 #pragma once
 #include "animaVelocityUtils.h"
 
-#include <itkAddImageFilter.h>
 #include <itkMultiplyImageFilter.h>
 
 #include <itkComposeDisplacementFieldsImageFilter.h>
 #include <itkVectorLinearInterpolateNearestNeighborExtrapolateImageFunction.h>
-#include <animaSVFLieBracketImageFilter.h>
+#include <animaSVFBCHCompositionImageFilter.h>
 #include <animaSVFExponentialImageFilter.h>
 
 namespace anima
@@ -31,176 +30,21 @@ void composeSVF(itk::StationaryVelocityFieldTransform <ScalarType,NDimensions> *
         return;
     }
 
-    typedef itk::AddImageFilter <VelocityFieldType, VelocityFieldType> AddFilterType;    
-    typedef itk::MultiplyImageFilter <VelocityFieldType, itk::Image <double, NDimensions>,
-            VelocityFieldType> MultiplyConstFilterType;
-
-    typename AddFilterType::Pointer bchAdder = AddFilterType::New();
-    bchAdder->SetInput(0,baseTrsf->GetParametersAsVectorField());
-    bchAdder->SetInput(1,addonTrsf->GetParametersAsVectorField());
+    // Single pass BCH approximation, no intermediate bracket or Jacobian field is stored
+    typedef anima::SVFBCHCompositionImageFilter <ScalarType, NDimensions> BCHFilterType;
+    typename BCHFilterType::Pointer bchFilter = BCHFilterType::New();
+    bchFilter->SetInput(0,baseTrsf->GetParametersAsVectorField());
+    bchFilter->SetInput(1,addonTrsf->GetParametersAsVectorField());
+    bchFilter->SetBCHOrder(bchOrder);
 
     if (numThreads > 0)
-        bchAdder->SetNumberOfWorkUnits(numThreads);
+        bchFilter->SetNumberOfWorkUnits(numThreads);
 
-    bchAdder->Update();
+    bchFilter->Update();
 
-    typename VelocityFieldType::Pointer resField = bchAdder->GetOutput();
+    typename VelocityFieldType::Pointer resField = bchFilter->GetOutput();
     resField->DisconnectPipeline();
 
-    typedef anima::SVFLieBracketImageFilter <ScalarType, NDimensions> LieBracketFilterType;
-    typename LieBracketFilterType::JacobianImagePointer baseTrsfJac, addonTrsfJac;
-    typename LieBracketFilterType::OutputImagePointer previousLieBracket;
-
-    if (bchOrder >= 2)
-    {
-        // Compute Lie bracket and add half of it to the output
-        typename LieBracketFilterType::Pointer lieBracketFilter = LieBracketFilterType::New();
-
-        lieBracketFilter->SetInput(0,baseTrsf->GetParametersAsVectorField());
-        lieBracketFilter->SetInput(1,addonTrsf->GetParametersAsVectorField());
-
-        if (numThreads > 0)
-            lieBracketFilter->SetNumberOfWorkUnits(numThreads);
-
-        lieBracketFilter->Update();
-        baseTrsfJac = lieBracketFilter->GetFirstFieldJacobian();
-        baseTrsfJac->DisconnectPipeline();
-        addonTrsfJac = lieBracketFilter->GetSecondFieldJacobian();
-        addonTrsfJac->DisconnectPipeline();
-        previousLieBracket = lieBracketFilter->GetOutput();
-        previousLieBracket->DisconnectPipeline();
-
-        typename MultiplyConstFilterType::Pointer bracketMultiplier = MultiplyConstFilterType::New();
-        bracketMultiplier->SetInput(0,previousLieBracket);
-        bracketMultiplier->SetConstant(0.5);
-
-        if (numThreads > 0)
-            bracketMultiplier->SetNumberOfWorkUnits(numThreads);
-
-        bracketMultiplier->Update();
-
-        typename AddFilterType::Pointer bchSecondAdder = AddFilterType::New();
-        bchSecondAdder->SetInput(0,resField);
-        bchSecondAdder->SetInput(1,bracketMultiplier->GetOutput());
-
-        if (numThreads > 0)
-            bchSecondAdder->SetNumberOfWorkUnits(numThreads);
-
-        bchSecondAdder->Update();
-
-        resField = bchSecondAdder->GetOutput();
-        resField->DisconnectPipeline();
-    }
-
-    if (bchOrder >= 3)
-    {
-        // Compute Lie bracket one way and add 1/12 of it to the output
-        typename LieBracketFilterType::Pointer lieBracketFilter = LieBracketFilterType::New();
-
-        lieBracketFilter->SetInput(0,baseTrsf->GetParametersAsVectorField());
-        lieBracketFilter->SetInput(1,previousLieBracket);
-        lieBracketFilter->SetFirstFieldJacobian(baseTrsfJac);
-
-        if (numThreads > 0)
-            lieBracketFilter->SetNumberOfWorkUnits(numThreads);
-
-        lieBracketFilter->Update();
-
-        typename MultiplyConstFilterType::Pointer bracketMultiplier = MultiplyConstFilterType::New();
-        bracketMultiplier->SetInput(0,lieBracketFilter->GetOutput());
-        bracketMultiplier->SetConstant(1.0 / 12);
-
-        if (numThreads > 0)
-            bracketMultiplier->SetNumberOfWorkUnits(numThreads);
-
-        bracketMultiplier->Update();
-
-        typename AddFilterType::Pointer bchSecondAdder = AddFilterType::New();
-        bchSecondAdder->SetInput(0,resField);
-        bchSecondAdder->SetInput(1,bracketMultiplier->GetOutput());
-
-        if (numThreads > 0)
-            bchSecondAdder->SetNumberOfWorkUnits(numThreads);
-
-        bchSecondAdder->Update();
-
-        resField = bchSecondAdder->GetOutput();
-        resField->DisconnectPipeline();
-
-        // Compute Lie bracket the other way round and add 1/12 of it to the output
-        typename LieBracketFilterType::Pointer reverseLieBracketFilter = LieBracketFilterType::New();
-
-        reverseLieBracketFilter->SetInput(0,previousLieBracket);
-        reverseLieBracketFilter->SetInput(1,addonTrsf->GetParametersAsVectorField());
-        reverseLieBracketFilter->SetFirstFieldJacobian(lieBracketFilter->GetSecondFieldJacobian());
-        reverseLieBracketFilter->SetSecondFieldJacobian(addonTrsfJac);
-
-        if (numThreads > 0)
-            reverseLieBracketFilter->SetNumberOfWorkUnits(numThreads);
-
-        reverseLieBracketFilter->Update();
-
-        bracketMultiplier = MultiplyConstFilterType::New();
-        bracketMultiplier->SetInput(0,reverseLieBracketFilter->GetOutput());
-        bracketMultiplier->SetConstant(1.0 / 12);
-
-        if (numThreads > 0)
-            bracketMultiplier->SetNumberOfWorkUnits(numThreads);
-
-        bracketMultiplier->Update();
-
-        bchSecondAdder = AddFilterType::New();
-        bchSecondAdder->SetInput(0,resField);
-        bchSecondAdder->SetInput(1,bracketMultiplier->GetOutput());
-
-        if (numThreads > 0)
-            bchSecondAdder->SetNumberOfWorkUnits(numThreads);
-
-        bchSecondAdder->Update();
-
-        resField = bchSecondAdder->GetOutput();
-        resField->DisconnectPipeline();
-
-        previousLieBracket = lieBracketFilter->GetOutput();
-        previousLieBracket->DisconnectPipeline();
-    }
-
-    if (bchOrder == 4)
-    {
-        // Compute Lie bracket one way and add 1/24 of it to the output
-        typename LieBracketFilterType::Pointer lieBracketFilter = LieBracketFilterType::New();
-
-        lieBracketFilter->SetInput(0,previousLieBracket);
-        lieBracketFilter->SetInput(1,addonTrsf->GetParametersAsVectorField());
-        lieBracketFilter->SetSecondFieldJacobian(addonTrsfJac);
-
-        if (numThreads > 0)
-            lieBracketFilter->SetNumberOfWorkUnits(numThreads);
-
-        lieBracketFilter->Update();
-
-        typename MultiplyConstFilterType::Pointer bracketMultiplier = MultiplyConstFilterType::New();
-        bracketMultiplier->SetInput(0,lieBracketFilter->GetOutput());
-        bracketMultiplier->SetConstant(1.0 / 24);
-
-        if (numThreads > 0)
-            bracketMultiplier->SetNumberOfWorkUnits(numThreads);
-
-        bracketMultiplier->Update();
-
-        typename AddFilterType::Pointer bchSecondAdder = AddFilterType::New();
-        bchSecondAdder->SetInput(0,resField);
-        bchSecondAdder->SetInput(1,bracketMultiplier->GetOutput());
-
-        if (numThreads > 0)
-            bchSecondAdder->SetNumberOfWorkUnits(numThreads);
-
-        bchSecondAdder->Update();
-
-        resField = bchSecondAdder->GetOutput();
-        resField->DisconnectPipeline();
-    }
-
     baseTrsf->SetParametersAsVectorField(resField.GetPointer());
 }
 
@@ -218,24 +62,10 @@ void GetSVFExponential(itk::StationaryVelocityFieldTransform <ScalarType,NDimens
 
     typedef anima::SVFExponentialImageFilter <ScalarType, NDimensions> ExponentialFilterType;
 
-    FieldPointer tmpPtr = const_cast <FieldType *> (baseTrsf->GetParametersAsVectorField());
-    if (invert)
-    {
-        typedef itk::MultiplyImageFilter <FieldType,itk::Image <float, NDimensions>, FieldType> MultiplyFilterType;
-        typename MultiplyFilterType::Pointer multiplier = MultiplyFilterType::New();
-        multiplier->SetInput(tmpPtr);
-        multiplier->SetConstant(-1.0);
-
-        multiplier->SetNumberOfWorkUnits(numThreads);
-        multiplier->Update();
-
-        tmpPtr = multiplier->GetOutput();
-        tmpPtr->DisconnectPipeline();
-    }
-
     typename ExponentialFilterType::Pointer expFilter = ExponentialFilterType::New();
-    expFilter->SetInput(tmpPtr);
+    expFilter->SetInput(baseTrsf->GetParametersAsVectorField());
     expFilter->SetExponentiationOrder(exponentiationOrder);
+    expFilter->SetComputeInverse(invert);
     expFilter->SetNumberOfWorkUnits(numThreads);
     expFilter->SetMaximalDisplacementAmplitude(0.25);
 
@@ -48,6 +48,14 @@ public:
     void SetDistanceBoundary(double num) {m_DistanceBoundary = num;}
     void SetMEstimateConvergenceThreshold(double num) {m_MEstimateConvergenceThreshold = num;}
 
+    /**
+     * Spacing (in voxels of the geometry image) of the control point lattice on which block transforms are splatted
+     * and M-smoothed. The smoothed lattice is linearly interpolated once on the image grid to build the output.
+     * Typically the block spacing, 1 (default) for an agregation on the image grid
+     */
+    void SetControlPointSpacing(unsigned int num) {m_ControlPointSpacing = std::max(num,1u);}
+    unsigned int GetControlPointSpacing() {return m_ControlPointSpacing;}
+
     template <class TInputImageType> void SetGeometryInformation(const TInputImageType *geomImage)
     {
         if (geomImage == NULL)
@@ -78,6 +86,25 @@ private:
     void estimateSVFFromTranslations();
     void estimateSVFFromRigidTransforms();
     void estimateSVFFromAffineTransforms();
+
+    //! Sets the grid on which transforms are smoothed: image grid or control point lattice with a node on the first block
+    void computeWorkingGeometry();
+
+    //! Index of the working grid node closest to an input origin
+    void getWorkingIndex(WeightImageType *weights, const PointType &inputOrigin, IndexType &posIndex);
+
+    //! Continuous working grid index of an image grid index
+    template <class TContinuousIndexType>
+    void getLatticeContinuousIndex(const VelocityFieldIndexType &index, TContinuousIndexType &latticeIndex);
+
+    unsigned int m_ControlPointSpacing;
+
+    VelocityFieldPointType m_WorkingOrigin;
+    VelocityFieldRegionType m_WorkingRegion;
+    VelocityFieldSpacingType m_WorkingSpacing;
+
+    //! Image grid index (relative to the largest region start) of the first lattice node
+    IndexType m_LatticeStart;
 };
 
 } // end of namespace anima
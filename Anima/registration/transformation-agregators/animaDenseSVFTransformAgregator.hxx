@@ -7,6 +7,7 @@
 
 #include <animaMatrixLogExp.h>
 #include <itkTimeProbe.h>
+#include <itkVectorLinearInterpolateNearestNeighborExtrapolateImageFunction.h>
 
 namespace anima
 {
@@ -21,6 +22,8 @@ DenseSVFTransformAgregator() : Superclass()
     m_NeighborhoodHalfSize = (unsigned int)floor(m_ExtrapolationSigma * 3);
     m_DistanceBoundary = m_ExtrapolationSigma * 3;
     m_MEstimateConvergenceThreshold = 0.001;
+    m_ControlPointSpacing = 1;
+    m_LatticeStart.Fill(0);
 
     m_NumberOfThreads = itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
 }
@@ -40,6 +43,8 @@ Update()
 
     itk::TimeProbe tmpTime;
     tmpTime.Start();
+    this->computeWorkingGeometry();
+
     switch (this->GetInputTransformType())
     {
         case Superclass::TRANSLATION:
@@ -77,15 +82,15 @@ estimateSVFFromTranslations()
     VelocityFieldPointer velocityField = VelocityFieldType::New();
     velocityField->Initialize();
 
-    velocityField->SetRegions (m_LargestRegion);
-    velocityField->SetSpacing (m_Spacing);
-    velocityField->SetOrigin (m_Origin);
+    velocityField->SetRegions (m_WorkingRegion);
+    velocityField->SetSpacing (m_WorkingSpacing);
+    velocityField->SetOrigin (m_WorkingOrigin);
     velocityField->SetDirection (m_Direction);
     velocityField->Allocate();
 
     VelocityFieldPixelType zeroDisp;
     zeroDisp.Fill(0);
-    itk::ImageRegionIterator < VelocityFieldType > svfIterator(velocityField,m_LargestRegion);
+    itk::ImageRegionIterator < VelocityFieldType > svfIterator(velocityField,m_WorkingRegion);
     while (!svfIterator.IsAtEnd())
     {
         svfIterator.Set(zeroDisp);
@@ -95,9 +100,9 @@ estimateSVFFromTranslations()
     WeightImagePointer weights = WeightImageType::New();
     weights->Initialize();
 
-    weights->SetRegions (m_LargestRegion);
-    weights->SetSpacing (m_Spacing);
-    weights->SetOrigin (m_Origin);
+    weights->SetRegions (m_WorkingRegion);
+    weights->SetSpacing (m_WorkingSpacing);
+    weights->SetOrigin (m_WorkingOrigin);
     weights->SetDirection (m_Direction);
     weights->Allocate();
     weights->FillBuffer(0);
@@ -118,7 +123,11 @@ estimateSVFFromTranslations()
         }
         double tmpWeight = this->GetInputWeight(i);
 
-        weights->TransformPhysicalPointToIndex(this->GetInputOrigin(i),posIndex);
+        // Keep the largest weight block when several of them fall on the same lattice node
+        this->getWorkingIndex(weights,this->GetInputOrigin(i),posIndex);
+        if (tmpWeight < weights->GetPixel(posIndex))
+            continue;
+
         for (unsigned int j = 0;j < NDimensions;++j)
             curDisp[j] = tmpParams[j];
 
@@ -145,6 +154,40 @@ estimateSVFFromTranslations()
     velocityField = fieldSmoother->GetOutput();
     velocityField->DisconnectPipeline();
 
+    if (m_ControlPointSpacing > 1)
+    {
+        // Single upsampling of the smoothed lattice to the image grid
+        typedef itk::VectorLinearInterpolateNearestNeighborExtrapolateImageFunction <VelocityFieldType,double> InterpolatorType;
+        typename InterpolatorType::Pointer interpolator = InterpolatorType::New();
+        interpolator->SetInputImage(velocityField);
+
+        VelocityFieldPointer denseField = VelocityFieldType::New();
+        denseField->Initialize();
+
+        denseField->SetRegions (m_LargestRegion);
+        denseField->SetSpacing (m_Spacing);
+        denseField->SetOrigin (m_Origin);
+        denseField->SetDirection (m_Direction);
+        denseField->Allocate();
+
+        typename InterpolatorType::ContinuousIndexType latticeIndex;
+        typename InterpolatorType::OutputType latticeValue;
+        itk::ImageRegionIteratorWithIndex < VelocityFieldType > denseIterator(denseField,m_LargestRegion);
+        while (!denseIterator.IsAtEnd())
+        {
+            this->getLatticeContinuousIndex(denseIterator.GetIndex(),latticeIndex);
+            latticeValue = interpolator->EvaluateAtContinuousIndex(latticeIndex);
+
+            for (unsigned int j = 0;j < NDimensions;++j)
+                curDisp[j] = latticeValue[j];
+
+            denseIterator.Set(curDisp);
+            ++denseIterator;
+        }
+
+        velocityField = denseField;
+    }
+
     // Create the final transform
     typename BaseOutputTransformType::Pointer resultTransform = BaseOutputTransformType::New();
     resultTransform->SetIdentity();
@@ -167,15 +210,15 @@ estimateSVFFromRigidTransforms()
     RigidFieldPointer rigidField = RigidFieldType::New();
     rigidField->Initialize();
 
-    rigidField->SetRegions (m_LargestRegion);
-    rigidField->SetSpacing (m_Spacing);
-    rigidField->SetOrigin (m_Origin);
+    rigidField->SetRegions (m_WorkingRegion);
+    rigidField->SetSpacing (m_WorkingSpacing);
+    rigidField->SetOrigin (m_WorkingOrigin);
     rigidField->SetDirection (m_Direction);
     rigidField->Allocate();
 
     RigidVectorType zeroDisp;
     zeroDisp.Fill(0);
-    itk::ImageRegionIterator < RigidFieldType > rigidIterator(rigidField,m_LargestRegion);
+    itk::ImageRegionIterator < RigidFieldType > rigidIterator(rigidField,m_WorkingRegion);
     while (!rigidIterator.IsAtEnd())
     {
         rigidIterator.Set(zeroDisp);
@@ -185,9 +228,9 @@ estimateSVFFromRigidTransforms()
     WeightImagePointer weights = WeightImageType::New();
     weights->Initialize();
 
-    weights->SetRegions (m_LargestRegion);
-    weights->SetSpacing (m_Spacing);
-    weights->SetOrigin (m_Origin);
+    weights->SetRegions (m_WorkingRegion);
+    weights->SetSpacing (m_WorkingSpacing);
+    weights->SetOrigin (m_WorkingOrigin);
     weights->SetDirection (m_Direction);
     weights->Allocate();
     weights->FillBuffer(0);
@@ -203,7 +246,11 @@ estimateSVFFromRigidTransforms()
     for (unsigned int i = 0;i < nbPts;++i)
     {
         double tmpWeight = this->GetInputWeight(i);
-        weights->TransformPhysicalPointToIndex(this->GetInputOrigin(i),posIndex);
+
+        // Keep the largest weight block when several of them fall on the same lattice node
+        this->getWorkingIndex(weights,this->GetInputOrigin(i),posIndex);
+        if (tmpWeight < weights->GetPixel(posIndex))
+            continue;
 
         LogRigidTransformType *tmpTrsf = (LogRigidTransformType *)this->GetInputTransform(i);
         rigidField->SetPixel(posIndex,tmpTrsf->GetLogVector());
@@ -244,10 +291,28 @@ estimateSVFFromRigidTransforms()
     VelocityFieldPointType curPoint;
     VelocityFieldPixelType curDisp;
 
-    rigidIterator = itk::ImageRegionIterator < RigidFieldType > (rigidField,m_LargestRegion);
+    typedef itk::VectorLinearInterpolateNearestNeighborExtrapolateImageFunction <RigidFieldType,double> InterpolatorType;
+    typename InterpolatorType::Pointer interpolator = InterpolatorType::New();
+    interpolator->SetInputImage(rigidField);
+    typename InterpolatorType::ContinuousIndexType latticeIndex;
+    typename InterpolatorType::OutputType latticeValue;
+
+    rigidIterator = itk::ImageRegionIterator < RigidFieldType > (rigidField,m_WorkingRegion);
     while (!svfIterator.IsAtEnd())
     {
-        curLog = rigidIterator.Get();
+        curIndex = svfIterator.GetIndex();
+        if (m_ControlPointSpacing > 1)
+        {
+            this->getLatticeContinuousIndex(curIndex,latticeIndex);
+            latticeValue = interpolator->EvaluateAtContinuousIndex(latticeIndex);
+            for (unsigned int j = 0;j < NDegreesFreedom;++j)
+                curLog[j] = latticeValue[j];
+        }
+        else
+        {
+            curLog = rigidIterator.Get();
+            ++rigidIterator;
+        }
 
         unsigned int pos = 0;
         for (unsigned int j = 0;j < NDimensions;++j)
@@ -264,7 +329,6 @@ estimateSVFFromRigidTransforms()
             ++pos;
         }
 
-        curIndex = svfIterator.GetIndex();
         velocityField->TransformIndexToPhysicalPoint(curIndex,curPoint);
         for (unsigned int i = 0;i < NDimensions;++i)
         {
@@ -274,8 +338,6 @@ estimateSVFFromRigidTransforms()
         }
 
         svfIterator.Set(curDisp);
-
-        ++rigidIterator;
         ++svfIterator;
     }
 
@@ -301,15 +363,15 @@ estimateSVFFromAffineTransforms()
     AffineFieldPointer affineField = AffineFieldType::New();
     affineField->Initialize();
 
-    affineField->SetRegions (m_LargestRegion);
-    affineField->SetSpacing (m_Spacing);
-    affineField->SetOrigin (m_Origin);
+    affineField->SetRegions (m_WorkingRegion);
+    affineField->SetSpacing (m_WorkingSpacing);
+    affineField->SetOrigin (m_WorkingOrigin);
     affineField->SetDirection (m_Direction);
     affineField->Allocate();
 
     AffineVectorType zeroDisp;
     zeroDisp.Fill(0);
-    itk::ImageRegionIterator < AffineFieldType > affineIterator(affineField,m_LargestRegion);
+    itk::ImageRegionIterator < AffineFieldType > affineIterator(affineField,m_WorkingRegion);
     while (!affineIterator.IsAtEnd())
     {
         affineIterator.Set(zeroDisp);
@@ -319,9 +381,9 @@ estimateSVFFromAffineTransforms()
     WeightImagePointer weights = WeightImageType::New();
     weights->Initialize();
 
-    weights->SetRegions (m_LargestRegion);
-    weights->SetSpacing (m_Spacing);
-    weights->SetOrigin (m_Origin);
+    weights->SetRegions (m_WorkingRegion);
+    weights->SetSpacing (m_WorkingSpacing);
+    weights->SetOrigin (m_WorkingOrigin);
     weights->SetDirection (m_Direction);
     weights->Allocate();
     weights->FillBuffer(0);
@@ -361,7 +423,7 @@ estimateSVFFromAffineTransforms()
     for (unsigned int i = 0;i < nbPts;++i)
     {
         double tmpWeight = this->GetInputWeight(i);
-        weights->TransformPhysicalPointToIndex(this->GetInputOrigin(i),posIndex);
+        this->getWorkingIndex(weights,this->GetInputOrigin(i),posIndex);
 
         if (std::isnan(logVectors[i][0]))
         {
@@ -369,6 +431,10 @@ estimateSVFFromAffineTransforms()
             logVectors[i].Fill(0);
         }
 
+        // Keep the largest weight block when several of them fall on the same lattice node
+        if (tmpWeight < weights->GetPixel(posIndex))
+            continue;
+
         affineField->SetPixel(posIndex,logVectors[i]);
         weights->SetPixel(posIndex,tmpWeight);
     }
@@ -407,10 +473,28 @@ estimateSVFFromAffineTransforms()
     VelocityFieldPointType curPoint;
     VelocityFieldPixelType curDisp;
 
-    affineIterator = itk::ImageRegionIterator < AffineFieldType > (affineField,m_LargestRegion);
+    typedef itk::VectorLinearInterpolateNearestNeighborExtrapolateImageFunction <AffineFieldType,double> InterpolatorType;
+    typename InterpolatorType::Pointer interpolator = InterpolatorType::New();
+    interpolator->SetInputImage(affineField);
+    typename InterpolatorType::ContinuousIndexType latticeIndex;
+    typename InterpolatorType::OutputType latticeValue;
+
+    affineIterator = itk::ImageRegionIterator < AffineFieldType > (affineField,m_WorkingRegion);
     while (!svfIterator.IsAtEnd())
     {
-        curLog = affineIterator.Get();
+        curIndex = svfIterator.GetIndex();
+        if (m_ControlPointSpacing > 1)
+        {
+            this->getLatticeContinuousIndex(curIndex,latticeIndex);
+            latticeValue = interpolator->EvaluateAtContinuousIndex(latticeIndex);
+            for (unsigned int j = 0;j < NDegreesFreedom;++j)
+                curLog[j] = latticeValue[j];
+        }
+        else
+        {
+            curLog = affineIterator.Get();
+            ++affineIterator;
+        }
 
         unsigned int pos = 0;
         for (unsigned int j = 0;j < NDimensions;++j)
@@ -420,7 +504,6 @@ estimateSVFFromAffineTransforms()
                 ++pos;
             }
 
-        curIndex = svfIterator.GetIndex();
         velocityField->TransformIndexToPhysicalPoint(curIndex,curPoint);
         for (unsigned int i = 0;i < NDimensions;++i)
         {
@@ -430,8 +513,6 @@ estimateSVFFromAffineTransforms()
         }
 
         svfIterator.Set(curDisp);
-
-        ++affineIterator;
         ++svfIterator;
     }
 
@@ -443,4 +524,73 @@ estimateSVFFromAffineTransforms()
     this->SetOutput(resultTransform);
 }
 
+template <unsigned int NDimensions>
+void
+DenseSVFTransformAgregator <NDimensions>::
+computeWorkingGeometry()
+{
+    m_WorkingOrigin = m_Origin;
+    m_WorkingRegion = m_LargestRegion;
+    m_WorkingSpacing = m_Spacing;
+    m_LatticeStart.Fill(0);
+
+    if ((m_ControlPointSpacing <= 1)||(this->GetInputOrigins().size() == 0))
+        return;
+
+    // Blocks lie on a regular grid with the block spacing, a node on the first block aligns the lattice on all of them
+    WeightImagePointer geometryImage = WeightImageType::New();
+    geometryImage->Initialize();
+
+    geometryImage->SetRegions (m_LargestRegion);
+    geometryImage->SetSpacing (m_Spacing);
+    geometryImage->SetOrigin (m_Origin);
+    geometryImage->SetDirection (m_Direction);
+
+    IndexType firstBlockIndex, latticeOriginIndex;
+    geometryImage->TransformPhysicalPointToIndex(this->GetInputOrigin(0),firstBlockIndex);
+
+    int latticeSpacing = m_ControlPointSpacing;
+    for (unsigned int i = 0;i < NDimensions;++i)
+    {
+        int largestStart = m_LargestRegion.GetIndex()[i];
+        int largestSize = m_LargestRegion.GetSize()[i];
+
+        m_LatticeStart[i] = ((firstBlockIndex[i] - largestStart) % latticeSpacing + latticeSpacing) % latticeSpacing;
+        latticeOriginIndex[i] = largestStart + m_LatticeStart[i];
+
+        int latticeSize = (largestSize - m_LatticeStart[i] + latticeSpacing - 1) / latticeSpacing;
+        m_WorkingRegion.SetIndex(i,0);
+        m_WorkingRegion.SetSize(i,std::max(latticeSize,1));
+        m_WorkingSpacing[i] = m_Spacing[i] * latticeSpacing;
+    }
+
+    geometryImage->TransformIndexToPhysicalPoint(latticeOriginIndex,m_WorkingOrigin);
+}
+
+template <unsigned int NDimensions>
+void
+DenseSVFTransformAgregator <NDimensions>::
+getWorkingIndex(WeightImageType *weights, const PointType &inputOrigin, IndexType &posIndex)
+{
+    weights->TransformPhysicalPointToIndex(inputOrigin,posIndex);
+
+    // Blocks close to the image end may be closer to a node outside of the lattice
+    for (unsigned int i = 0;i < NDimensions;++i)
+    {
+        int workingStart = m_WorkingRegion.GetIndex()[i];
+        int workingEnd = workingStart + m_WorkingRegion.GetSize()[i] - 1;
+        posIndex[i] = std::max(workingStart,std::min((int)posIndex[i],workingEnd));
+    }
+}
+
+template <unsigned int NDimensions>
+template <class TContinuousIndexType>
+void
+DenseSVFTransformAgregator <NDimensions>::
+getLatticeContinuousIndex(const VelocityFieldIndexType &index, TContinuousIndexType &latticeIndex)
+{
+    for (unsigned int i = 0;i < NDimensions;++i)
+        latticeIndex[i] = (index[i] - m_LargestRegion.GetIndex()[i] - m_LatticeStart[i]) / (double)m_ControlPointSpacing;
+}
+
 } // end of namespace anima